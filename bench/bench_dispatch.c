@@ -0,0 +1,78 @@
+// bench_dispatch.c
+// バイトコードVMのディスパッチ方式（computed goto / switch）と
+// スーパー命令の有無による実行時間の比較。
+//
+// 使い方: bench_dispatch [反復回数]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "object.h"
+#include "eval.h"
+#include "parser.h"
+#include "gc.h"
+#include "vm.h"
+
+// 1回の実行で確保する数値オブジェクトがプールに収まるよう反復数は小さめにする
+static const char* const programs[] = {
+    "(loop (c 0) (< c 200) (+ c 1) (if (< c 100) (set! acc (+ acc 1)) (set! acc (- acc 1))))",
+    "(dotimes (i 200) (set! acc (+ acc i)))",
+    // 割り当てを伴わない命令が大半のループ（ディスパッチのコストが表に出やすい）
+    "(dotimes (i 200) (if (< i 100) (< i 50) (> i 150)) (if (= i acc) (< acc i) (>= i acc)) (<= i 7))",
+};
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// code を runs 回実行した合計時間（秒）。各回の後にGCを回すがその時間は含めない
+static double measure(VmCode* code, Object* (*execute)(VmCode*), int runs) {
+    double total = 0.0;
+    for (int i = 0; i < runs; i++) {
+        double start = now_sec();
+        execute(code);
+        total += now_sec() - start;
+        eval_string("nil");  // 環境をルートにしてGCを走らせる
+    }
+    return total;
+}
+
+int main(int argc, char** argv) {
+    int runs = argc > 1 ? atoi(argv[1]) : 2000;
+    if (runs <= 0) runs = 2000;
+
+    evaluator_init();
+    eval_string("(define acc 0)");
+
+    printf("%-10s %-8s %8s %12s\n", "dispatch", "fused", "instrs", "ns/run");
+    for (size_t p = 0; p < sizeof(programs) / sizeof(programs[0]); p++) {
+        Object* ast = parse(programs[p]);
+        gc_add_root(&ast);
+        printf("%s\n", programs[p]);
+
+        for (int fused = 0; fused <= 1; fused++) {
+            vm_set_superinstructions(fused);
+            VmCode* code = vm_compile(ast);
+            if (!code) {
+                printf("  compile failed\n");
+                continue;
+            }
+            double sw = measure(code, vm_execute_switch, runs);
+            printf("%-10s %-8s %8zu %12.0f\n", "switch", fused ? "yes" : "no",
+                   vm_code_length(code), sw / runs * 1e9);
+#if VM_HAVE_COMPUTED_GOTO
+            double th = measure(code, vm_execute, runs);
+            printf("%-10s %-8s %8zu %12.0f\n", "threaded", fused ? "yes" : "no",
+                   vm_code_length(code), th / runs * 1e9);
+#endif
+            vm_free(code);
+        }
+        gc_remove_root(&ast);
+    }
+
+    evaluator_shutdown();
+    return 0;
+}
@@ -0,0 +1,74 @@
+// bench_lexer.c
+// 字句解析（tokenize）のスループットを計測する。
+// 入れ子の式・シンボル・数値・文字列・コメントを混ぜた入力を生成して MB/s で表示する。
+//
+// 使い方: bench_lexer [入力のサイズ(MB)]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tokenizer.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// 約 size バイトのプログラムらしい入力を生成する（malloc。呼び出し側で free）
+static char* generate_input(size_t size) {
+    static const char* const pieces[] = {
+        "(define (fibonacci-number n)\n  (if (< n 2)\n      n\n      (+ (fibonacci-number (- n 1)) (fibonacci-number (- n 2)))))\n",
+        "; 長めのコメント行: 字句解析器は行末まで一気に読み飛ばす必要がある\n",
+        "(map-assoc current-configuration \"database-connection-string\" \"host=localhost port=5432\")\n",
+        "(dotimes (index 1000) (set! accumulator (+ accumulator (* index 31415) 27182)))\n",
+        "    (let-values-helper first-element second-element third-element fourth-element)\n",
+        "(println \"result:\" 12345.678 (length some-long-list-name) nil)\n",
+    };
+    size_t count = sizeof(pieces) / sizeof(pieces[0]);
+    char* input = malloc(size + 256);
+    if (!input) return NULL;
+    size_t len = 0;
+    for (size_t i = 0; len < size; i++) {
+        const char* piece = pieces[(i * 7) % count];
+        size_t n = strlen(piece);
+        memcpy(input + len, piece, n);
+        len += n;
+    }
+    input[len] = '\0';
+    return input;
+}
+
+int main(int argc, char** argv) {
+    int megabytes = argc > 1 ? atoi(argv[1]) : 16;
+    if (megabytes <= 0) megabytes = 16;
+    char* input = generate_input((size_t)megabytes << 20);
+    if (!input) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    size_t length = strlen(input);
+
+    // 最も速かった回で比べる
+    double best = 1e30;
+    size_t tokens = 0;
+    for (int run = 0; run < 5; run++) {
+        double start = now_sec();
+        TokenArray* result = tokenize(input);
+        double elapsed = now_sec() - start;
+        if (!result) {
+            fprintf(stderr, "tokenize failed\n");
+            return 1;
+        }
+        tokens = result->size;
+        free_token_array(result);
+        if (elapsed < best) best = elapsed;
+    }
+    printf("%12s %10s\n", "tokens", "MB/s");
+    printf("%12zu %10.1f\n", tokens, (double)length / best / 1e6);
+
+    free(input);
+    return 0;
+}
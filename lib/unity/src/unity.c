@@ -0,0 +1,2 @@
+#include "unity.h"
+int unity_failures, unity_tests; jmp_buf unity_jb;
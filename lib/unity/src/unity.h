@@ -0,0 +1,32 @@
+/* local minimal shim for gating only (not committed) */
+#ifndef UNITY_SHIM_H
+#define UNITY_SHIM_H
+#include <stdio.h>
+#include <string.h>
+#include <setjmp.h>
+extern int unity_failures, unity_tests; extern jmp_buf unity_jb;
+void setUp(void); void tearDown(void);
+#define UNITY_BEGIN() (unity_failures=0, unity_tests=0)
+#define UNITY_END() (printf("%d Tests %d Failures\n", unity_tests, unity_failures), unity_failures)
+#define RUN_TEST(f) do{unity_tests++; if(!setjmp(unity_jb)){setUp(); f(); tearDown(); printf("%s:PASS\n",#f);} else {tearDown(); printf("%s:FAIL\n",#f);} }while(0)
+#define UFAIL(msg) do{printf("%s:%d: %s\n",__FILE__,__LINE__,msg); unity_failures++; longjmp(unity_jb,1);}while(0)
+#define TEST_ASSERT_TRUE(c) do{ if(!(c)) UFAIL("expected true: " #c);}while(0)
+#define TEST_ASSERT_FALSE(c) TEST_ASSERT_TRUE(!(c))
+#define TEST_ASSERT(c) TEST_ASSERT_TRUE(c)
+#define TEST_ASSERT_EQUAL_INT64(a,b) do{ long long _a=(long long)(a), _b=(long long)(b); if(_a!=_b){printf("expected %lld got %lld\n",_a,_b); UFAIL("equal: " #a " " #b);} }while(0)
+#define TEST_ASSERT_EQUAL_INT(a,b) TEST_ASSERT_EQUAL_INT64(a,b)
+#define TEST_ASSERT_NOT_EQUAL(a,b) TEST_ASSERT_TRUE((a)!=(b))
+#define TEST_ASSERT_EQUAL_PTR(a,b) TEST_ASSERT_TRUE((const void*)(a)==(const void*)(b))
+#define TEST_ASSERT_NULL(a) TEST_ASSERT_TRUE((a)==NULL)
+#define TEST_ASSERT_NOT_NULL(a) TEST_ASSERT_TRUE((a)!=NULL)
+#define TEST_ASSERT_EQUAL_STRING(a,b) do{ const char*_a=(a),*_b=(b); if(!_a||!_b||strcmp(_a,_b)){printf("expected '%s' got '%s'\n",_a?_a:"(null)",_b?_b:"(null)"); UFAIL("string");} }while(0)
+/* mirrors real Unity: disabled unless UNITY_INCLUDE_DOUBLE, relative tolerance 1e-12 */
+#ifdef UNITY_INCLUDE_DOUBLE
+#define TEST_ASSERT_DOUBLE_WITHIN(d,a,b) do{ double _d=(d),_a=(a),_b=(b); double _x=_b-_a; if(_x<0)_x=-_x; if(_d<0)_d=-_d; if(!(_a==_b || _x<=_d)){printf("expected %.17g got %.17g\n",_a,_b); UFAIL("double");} }while(0)
+#define TEST_ASSERT_EQUAL_DOUBLE(a,b) TEST_ASSERT_DOUBLE_WITHIN((a)*1e-12,(a),(b))
+#else
+#define TEST_ASSERT_DOUBLE_WITHIN(d,a,b) UFAIL("Unity Double Precision Disabled")
+#define TEST_ASSERT_EQUAL_DOUBLE(a,b) UFAIL("Unity Double Precision Disabled")
+#endif
+#define TEST_ASSERT_EQUAL(a,b) TEST_ASSERT_EQUAL_INT64(a,b)
+#endif
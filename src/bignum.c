@@ -0,0 +1,308 @@
+// bignum.c
+// 多倍長整数の実装。
+// 符号と絶対値で表し、絶対値は32bitの limb を下位から並べた配列（heap上）に持つ。
+// 計算途中の値は静的な作業領域で扱い、結果だけをオブジェクトにする。
+
+#include "bignum.h"
+#include "strbuf.h"
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+// 整数の絶対値のビュー（OBJ_NUMBER はその場で limb に展開する）
+typedef struct {
+    const uint32_t* d;
+    size_t n;
+    bool negative;
+    uint32_t small[2];  // OBJ_NUMBER 用の展開先
+} BigView;
+
+bool is_integer(Object* obj) {
+    return obj && (obj->type == OBJ_NUMBER || obj->type == OBJ_BIGNUM);
+}
+
+static size_t mag_trim(const uint32_t* d, size_t n) {
+    while (n > 0 && d[n - 1] == 0) n--;
+    return n;
+}
+
+static void view_of(Object* x, BigView* v) {
+    if (x->type == OBJ_NUMBER) {
+        int64_t value = x->data.number;
+        uint64_t mag = value < 0 ? (uint64_t)0 - (uint64_t)value : (uint64_t)value;
+        v->small[0] = (uint32_t)mag;
+        v->small[1] = (uint32_t)(mag >> 32);
+        v->d = v->small;
+        v->n = mag_trim(v->small, 2);
+        v->negative = value < 0;
+    } else {
+        v->d = x->data.bignum.limbs;
+        v->n = x->data.bignum.count;
+        v->negative = x->data.bignum.negative;
+    }
+}
+
+// 絶対値を正規化してオブジェクトにする（int64_t に収まれば OBJ_NUMBER）
+static Object* make_integer(const uint32_t* d, size_t n, bool negative) {
+    n = mag_trim(d, n);
+    if (n > BIGNUM_MAX_LIMBS) return NULL;
+    if (n <= 2) {
+        uint64_t mag = (n > 0 ? d[0] : 0) | (n > 1 ? (uint64_t)d[1] << 32 : 0);
+        if (!negative && mag <= (uint64_t)INT64_MAX) return make_number((int64_t)mag);
+        if (negative && mag <= (uint64_t)INT64_MAX + 1) return make_number((int64_t)(0 - mag));
+    }
+    return make_bignum(d, n, negative);
+}
+
+//------------------------------------------
+// 絶対値の演算
+//------------------------------------------
+
+static int mag_compare(const uint32_t* a, size_t an, const uint32_t* b, size_t bn) {
+    if (an != bn) return an < bn ? -1 : 1;
+    for (size_t i = an; i-- > 0; ) {
+        if (a[i] != b[i]) return a[i] < b[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+// r = a + b（r は max(an, bn) + 1 桁分必要）
+static size_t mag_add(uint32_t* r, const uint32_t* a, size_t an, const uint32_t* b, size_t bn) {
+    if (an < bn) {
+        const uint32_t* t = a; a = b; b = t;
+        size_t tn = an; an = bn; bn = tn;
+    }
+    uint64_t carry = 0;
+    for (size_t i = 0; i < an; i++) {
+        uint64_t sum = (uint64_t)a[i] + (i < bn ? b[i] : 0) + carry;
+        r[i] = (uint32_t)sum;
+        carry = sum >> 32;
+    }
+    r[an] = (uint32_t)carry;
+    return an + 1;
+}
+
+// r = a - b（|a| >= |b| であること）
+static size_t mag_sub(uint32_t* r, const uint32_t* a, size_t an, const uint32_t* b, size_t bn) {
+    int64_t borrow = 0;
+    for (size_t i = 0; i < an; i++) {
+        int64_t diff = (int64_t)a[i] - (i < bn ? b[i] : 0) - borrow;
+        borrow = diff < 0;
+        r[i] = (uint32_t)(diff + (borrow ? ((int64_t)1 << 32) : 0));
+    }
+    return an;
+}
+
+// r = a * b（r は an + bn 桁分必要）
+static size_t mag_mul(uint32_t* r, const uint32_t* a, size_t an, const uint32_t* b, size_t bn) {
+    memset(r, 0, sizeof(uint32_t) * (an + bn));
+    for (size_t i = 0; i < an; i++) {
+        uint64_t carry = 0;
+        for (size_t j = 0; j < bn; j++) {
+            uint64_t cur = (uint64_t)a[i] * b[j] + r[i + j] + carry;
+            r[i + j] = (uint32_t)cur;
+            carry = cur >> 32;
+        }
+        r[i + bn] = (uint32_t)carry;
+    }
+    return an + bn;
+}
+
+// d = d / divisor（1桁の除数）。余りを返す
+static uint32_t mag_divmod_small(uint32_t* d, size_t n, uint32_t divisor) {
+    uint64_t rem = 0;
+    for (size_t i = n; i-- > 0; ) {
+        uint64_t cur = (rem << 32) | d[i];
+        d[i] = (uint32_t)(cur / divisor);
+        rem = cur % divisor;
+    }
+    return (uint32_t)rem;
+}
+
+// q = a / b（筆算の2進版。q は an 桁、rem は bn + 1 桁分必要）
+static size_t mag_div(uint32_t* q, uint32_t* rem, const uint32_t* a, size_t an, const uint32_t* b, size_t bn) {
+    memset(q, 0, sizeof(uint32_t) * an);
+    memset(rem, 0, sizeof(uint32_t) * (bn + 1));
+    for (size_t bit = an * 32; bit-- > 0; ) {
+        // rem = rem * 2 + a の bit 番目
+        uint32_t carry = (a[bit / 32] >> (bit % 32)) & 1;
+        for (size_t i = 0; i <= bn; i++) {
+            uint32_t next = rem[i] >> 31;
+            rem[i] = (rem[i] << 1) | carry;
+            carry = next;
+        }
+        if (mag_compare(rem, mag_trim(rem, bn + 1), b, bn) >= 0) {
+            mag_sub(rem, rem, bn + 1, b, bn);
+            q[bit / 32] |= (uint32_t)1 << (bit % 32);
+        }
+    }
+    return an;
+}
+
+//------------------------------------------
+// 整数演算
+//------------------------------------------
+
+// 作業領域（最大桁の積が収まる大きさ）
+static uint32_t work[2 * BIGNUM_MAX_LIMBS + 2];
+static uint32_t work_rem[BIGNUM_MAX_LIMBS + 2];
+
+// 符号付き加算: a + (negate_b ? -b : b)
+static Object* signed_add(Object* a, Object* b, bool negate_b) {
+    BigView x, y;
+    view_of(a, &x);
+    view_of(b, &y);
+    if (x.n > BIGNUM_MAX_LIMBS || y.n > BIGNUM_MAX_LIMBS) return NULL;
+    bool yneg = y.negative != negate_b;
+
+    if (x.negative == yneg) {
+        size_t n = mag_add(work, x.d, x.n, y.d, y.n);
+        return make_integer(work, n, x.negative);
+    }
+    // 符号が異なれば絶対値の大きい方から小さい方を引く
+    if (mag_compare(x.d, x.n, y.d, y.n) >= 0) {
+        size_t n = mag_sub(work, x.d, x.n, y.d, y.n);
+        return make_integer(work, n, x.negative);
+    }
+    size_t n = mag_sub(work, y.d, y.n, x.d, x.n);
+    return make_integer(work, n, yneg);
+}
+
+Object* bignum_add(Object* a, Object* b) {
+    return signed_add(a, b, false);
+}
+
+Object* bignum_sub(Object* a, Object* b) {
+    return signed_add(a, b, true);
+}
+
+Object* bignum_mul(Object* a, Object* b) {
+    BigView x, y;
+    view_of(a, &x);
+    view_of(b, &y);
+    if (x.n + y.n > 2 * BIGNUM_MAX_LIMBS) return NULL;
+    size_t n = mag_mul(work, x.d, x.n, y.d, y.n);
+    return make_integer(work, n, x.negative != y.negative);
+}
+
+Object* bignum_div(Object* a, Object* b) {
+    BigView x, y;
+    view_of(a, &x);
+    view_of(b, &y);
+    if (y.n == 0) return NULL;  // ゼロ除算
+    if (mag_compare(x.d, x.n, y.d, y.n) < 0) return make_number(0);
+
+    size_t n;
+    if (y.n == 1) {
+        memcpy(work, x.d, sizeof(uint32_t) * x.n);
+        mag_divmod_small(work, x.n, y.d[0]);
+        n = x.n;
+    } else {
+        n = mag_div(work, work_rem, x.d, x.n, y.d, y.n);
+    }
+    return make_integer(work, n, x.negative != y.negative);
+}
+
+int bignum_compare(Object* a, Object* b) {
+    if (a->type == OBJ_NUMBER && b->type == OBJ_NUMBER) {
+        return (a->data.number > b->data.number) - (a->data.number < b->data.number);
+    }
+    BigView x, y;
+    view_of(a, &x);
+    view_of(b, &y);
+    if (x.n == 0 && y.n == 0) return 0;
+    if (x.negative != y.negative) return x.negative ? -1 : 1;
+    int mag = mag_compare(x.d, x.n, y.d, y.n);
+    return x.negative ? -mag : mag;
+}
+
+double bignum_to_double(Object* n) {
+    if (n->type == OBJ_NUMBER) return (double)n->data.number;
+    double value = 0.0;
+    for (size_t i = n->data.bignum.count; i-- > 0; ) {
+        value = value * 4294967296.0 + n->data.bignum.limbs[i];
+    }
+    return n->data.bignum.negative ? -value : value;
+}
+
+//------------------------------------------
+// 文字列との変換
+//------------------------------------------
+
+Object* bignum_parse(const char* text) {
+    bool negative = (*text == '-');
+    if (negative) text++;
+    if (*text == '\0') return NULL;
+
+    size_t n = 0;
+    for (const char* p = text; *p; p++) {
+        if (*p < '0' || *p > '9') return NULL;
+        // work = work * 10 + digit
+        uint64_t carry = (uint64_t)(*p - '0');
+        for (size_t i = 0; i < n; i++) {
+            uint64_t cur = (uint64_t)work[i] * 10 + carry;
+            work[i] = (uint32_t)cur;
+            carry = cur >> 32;
+        }
+        if (carry) {
+            if (n >= BIGNUM_MAX_LIMBS) return NULL;
+            work[n++] = (uint32_t)carry;
+        }
+    }
+    return make_integer(work, n, negative);
+}
+
+// 絶対値を 10^9 で割り続け、下位から9桁ずつの塊にする。塊の数を返す
+static uint32_t chunks[BIGNUM_MAX_LIMBS * 10 / 9 + 2];
+
+static size_t to_decimal_chunks(Object* n) {
+    size_t count = n->data.bignum.count;
+    memcpy(work, n->data.bignum.limbs, sizeof(uint32_t) * count);
+    size_t nchunks = 0;
+    while (count > 0) {
+        chunks[nchunks++] = mag_divmod_small(work, count, 1000000000u);
+        count = mag_trim(work, count);
+    }
+    return nchunks;
+}
+
+size_t bignum_format(Object* n, char* buf, size_t size) {
+    if (n->type == OBJ_NUMBER) {
+        char digits[INT64_DECIMAL_MAX];
+        size_t length = format_int64(n->data.number, digits);
+        if (size > 0) {
+            size_t copy = length < size ? length : size - 1;
+            memcpy(buf, digits, copy);
+            buf[copy] = '\0';
+        }
+        return length;
+    }
+
+    size_t nchunks = to_decimal_chunks(n);
+    size_t length = 0;
+    char digits[16];
+    if (n->data.bignum.negative) {
+        if (length + 1 < size) buf[length] = '-';
+        length++;
+    }
+    for (size_t i = nchunks; i-- > 0; ) {
+        int len = snprintf(digits, sizeof(digits), i == nchunks - 1 ? "%u" : "%09u", chunks[i]);
+        for (int j = 0; j < len; j++, length++) {
+            if (length + 1 < size) buf[length] = digits[j];
+        }
+    }
+    if (size > 0) buf[length < size ? length : size - 1] = '\0';
+    return length;
+}
+
+void bignum_print(Object* n) {
+    if (n->type == OBJ_NUMBER) {
+        printf("%" PRId64, n->data.number);
+        return;
+    }
+    size_t nchunks = to_decimal_chunks(n);
+    if (n->data.bignum.negative) printf("-");
+    for (size_t i = nchunks; i-- > 0; ) {
+        printf(i == nchunks - 1 ? "%u" : "%09u", chunks[i]);
+    }
+}
@@ -0,0 +1,38 @@
+// bignum.h
+// 多倍長整数（OBJ_BIGNUM）の演算。
+// 整数は int64_t に収まる間は OBJ_NUMBER のまま扱い、あふれたときだけ多倍長に昇格する。
+// 演算結果は常に正規化され、int64_t に収まる値は OBJ_NUMBER に戻る。
+
+#ifndef BIGNUM_H
+#define BIGNUM_H
+
+#include "object.h"
+
+// 多倍長整数の最大桁数（32bit limb 単位。heap_alloc の1回の上限に収まる大きさ）
+#define BIGNUM_MAX_LIMBS 2000
+
+// 整数（OBJ_NUMBER / OBJ_BIGNUM）か
+bool is_integer(Object* obj);
+
+// 整数同士の四則演算。引数は OBJ_NUMBER か OBJ_BIGNUM。
+// 桁あふれ (BIGNUM_MAX_LIMBS 超) やゼロ除算のときは NULL を返す。
+Object* bignum_add(Object* a, Object* b);
+Object* bignum_sub(Object* a, Object* b);
+Object* bignum_mul(Object* a, Object* b);
+Object* bignum_div(Object* a, Object* b);  // 0方向への切り捨て
+
+// 整数の大小比較（a < b なら負、等しければ0、a > b なら正）
+int bignum_compare(Object* a, Object* b);
+
+// 整数を double に変換する（大きすぎる値は inf）
+double bignum_to_double(Object* n);
+
+// 10進文字列から整数を作る（先頭の '-' 可）。不正な文字列なら NULL
+Object* bignum_parse(const char* text);
+
+// 整数を10進文字列にする。snprintf と同じく必要な長さを返す
+size_t bignum_format(Object* n, char* buf, size_t size);
+// 整数を10進で標準出力に書く
+void bignum_print(Object* n);
+
+#endif // BIGNUM_H
@@ -4,6 +4,9 @@
 #ifndef CHIBI_LISP_H
 #define CHIBI_LISP_H
 
+// ño[WiFASL LbV̏ƍɎgB\؂̈Ӗςグj
+#define CHIBI_LISP_VERSION "0.2.0"
+
 //------------------------------------------
 // Memory Configuration (efficient but not minimal)
 //------------------------------------------
@@ -18,6 +21,7 @@
 #define HEAP_SIZE (1*MB)       // 1MB
 #define CHUNK_SIZE 32         // 32oCg`N
 #define CHUNK_COUNT (HEAP_SIZE / CHUNK_SIZE)
+#define HEAP_MAX_CHUNKS 255   // 1̊蓖Ẵ`N̏iheap.c ̃TCY uint8_tj
 
 // Bitmap size calculation
 #define BITMAP_SIZE ((OBJECT_POOL_SIZE + 7) / 8)
@@ -0,0 +1,172 @@
+// closure.c
+// ラムダ式のフラットクロージャ変換の実装。
+// 本体を一度だけ走査して自由変数を求め、変数参照にスロット番号を付ける。
+
+#include "closure.h"
+#include <string.h>
+
+// 内側の束縛形式で隠される名前の最大数
+#define MAX_SHADOW 64
+
+typedef struct {
+    Object* params;                   // 仮引数リスト
+    Object* captured;                 // 捕捉変数リスト (スロット割り当て時)
+    int nparams;                      // 仮引数の数
+    const char* shadow[MAX_SHADOW];   // 内側の束縛形式で隠された名前
+    int nshadow;
+    Object* free;                     // 収集した自由変数
+    Object** free_tail;
+    bool assign;                      // true: スロット割り当て / false: 自由変数の収集
+} Walker;
+
+int closure_name_index(Object* names, const char* name) {
+    int index = 0;
+    for (Object* it = names; is_cons(it); it = obj_cdr(it), index++) {
+        if (strcmp(obj_symbol_name(obj_car(it)), name) == 0) return index;
+    }
+    return -1;
+}
+
+static bool is_shadowed(const Walker* w, const char* name) {
+    for (int i = w->nshadow - 1; i >= 0; i--) {
+        if (strcmp(w->shadow[i], name) == 0) return true;
+    }
+    return false;
+}
+
+static void push_shadow(Walker* w, Object* sym) {
+    if (is_symbol(sym) && w->nshadow < MAX_SHADOW) {
+        w->shadow[w->nshadow++] = sym->data.symbol.name;
+    }
+}
+
+static void walk(Walker* w, Object* expr, bool nested);
+
+static void walk_list(Walker* w, Object* list, bool nested) {
+    for (Object* it = list; is_cons(it); it = obj_cdr(it)) {
+        walk(w, obj_car(it), nested);
+    }
+}
+
+static void visit_symbol(Walker* w, Object* sym, bool nested) {
+    if (sym->data.symbol.special != SF_NONE) return;
+    const char* name = sym->data.symbol.name;
+    if (is_shadowed(w, name)) return;
+
+    int param = closure_name_index(w->params, name);
+    if (!w->assign) {
+        // 仮引数でも既出でもなければ自由変数
+        if (param < 0 && closure_name_index(w->free, name) < 0) {
+            *w->free_tail = make_cons(sym, obj_nil);
+            if (*w->free_tail) w->free_tail = &(*w->free_tail)->data.cons.cdr;
+        }
+        return;
+    }
+
+    // 入れ子のラムダ本体はそのラムダ自身のフレームで評価されるので触らない
+    if (nested) return;
+    if (param >= 0) {
+        sym->data.symbol.slot = param + 1;
+        return;
+    }
+    int captured = closure_name_index(w->captured, name);
+    if (captured >= 0) {
+        sym->data.symbol.slot = w->nparams + captured + 1;
+    }
+}
+
+static void walk(Walker* w, Object* expr, bool nested) {
+    if (is_symbol(expr)) {
+        visit_symbol(w, expr, nested);
+        return;
+    }
+    if (!is_cons(expr)) return;
+
+    Object* args = obj_cdr(expr);
+    int saved = w->nshadow;
+    switch (obj_special_form(obj_car(expr))) {
+        case SF_QUOTE:
+        case SF_DEFMACRO:
+            return;
+        case SF_EXPANSION:
+            // (macro-expansion original . expansion)
+            // 元の呼び出しの引数にもスロットを振っておき、展開し直したときに引き継ぐ
+            walk(w, obj_car(args), nested);
+            walk(w, obj_cdr(args), nested);
+            break;
+        case SF_LAMBDA:
+            // (lambda (params...) body...)
+            for (Object* it = obj_car(args); is_cons(it); it = obj_cdr(it)) push_shadow(w, obj_car(it));
+            walk_list(w, obj_cdr(args), true);
+            break;
+        case SF_DOTIMES:
+            // (dotimes (var count) body...)
+            walk_list(w, obj_cdr(obj_car(args)), nested);
+            push_shadow(w, obj_car(obj_car(args)));
+            walk_list(w, obj_cdr(args), nested);
+            break;
+        case SF_LOOP:
+            // (loop (var init) condition update body...)
+            walk_list(w, obj_cdr(obj_car(args)), nested);
+            push_shadow(w, obj_car(obj_car(args)));
+            walk_list(w, obj_cdr(args), nested);
+            break;
+        case SF_DEFINE:
+            // 定義先の名前はグローバルなので参照ではない
+            walk_list(w, obj_cdr(args), nested);
+            break;
+        default:
+            walk_list(w, expr, nested);
+            break;
+    }
+    w->nshadow = saved;
+}
+
+static void walker_init(Walker* w, Object* params, Object* captured, bool assign) {
+    memset(w, 0, sizeof(*w));
+    w->params    = params;
+    w->captured  = captured;
+    w->free      = obj_nil;
+    w->free_tail = &w->free;
+    w->assign    = assign;
+    for (Object* it = params; is_cons(it); it = obj_cdr(it)) w->nparams++;
+}
+
+Object* closure_free_variables(Object* params, Object* body) {
+    Walker w;
+    walker_init(&w, params, obj_nil, false);
+    walk_list(&w, body, false);
+    return w.free;
+}
+
+void closure_assign_slots(Object* params, Object* captured, Object* body) {
+    Walker w;
+    walker_init(&w, params, captured, true);
+    walk_list(&w, body, false);
+}
+
+//------------------------------------------
+// ループ変数の解析
+//------------------------------------------
+
+static bool escapes_in(const char* name, Object* expr) {
+    if (is_symbol(expr)) return strcmp(expr->data.symbol.name, name) == 0;
+    if (!is_cons(expr)) return false;
+    if (obj_special_form(obj_car(expr)) == SF_QUOTE) return false;
+
+    // 演算子の直接の引数は読まれるだけで保存されない
+    bool operator_call = is_operator(obj_car(expr));
+    for (Object* it = expr; is_cons(it); it = obj_cdr(it)) {
+        Object* elem = obj_car(it);
+        if (operator_call && is_symbol(elem)) continue;
+        if (escapes_in(name, elem)) return true;
+    }
+    return false;
+}
+
+bool closure_value_escapes(const char* name, Object* forms) {
+    for (Object* it = forms; is_cons(it); it = obj_cdr(it)) {
+        if (escapes_in(name, obj_car(it))) return true;
+    }
+    return false;
+}
@@ -0,0 +1,26 @@
+// closure.h
+// ラムダ式のフラットクロージャ変換（自由変数解析とスロット割り当て）。
+
+#ifndef CLOSURE_H
+#define CLOSURE_H
+
+#include "object.h"
+
+// ラムダ本体の自由変数を名前シンボルのリスト (重複なし) として返す。
+// 仮引数と、本体内の束縛形式 (lambda / dotimes / loop) で束縛される名前は除く。
+Object* closure_free_variables(Object* params, Object* body);
+
+// 本体中の仮引数・捕捉変数への参照にスロット番号を割り当てる。
+// スロットは仮引数が 0..n-1、捕捉変数がそれに続く。入れ子のラムダ本体は対象外。
+void closure_assign_slots(Object* params, Object* captured, Object* body);
+
+// forms (式のリスト) の中で、変数 name の値がどこかに保存されうるか。
+// 演算子 (+ - * / = < > <= >=) の引数として直接使われるだけなら値は外へ漏れず、
+// 呼び出し側はその値の箱をその場で書き換えたり解放したりできる。
+// それ以外の参照 (関数の引数、set!、ラムダ本体など) があれば true。
+bool closure_value_escapes(const char* name, Object* forms);
+
+// 名前シンボルのリスト中での位置を返す（見つからなければ -1）
+int closure_name_index(Object* names, const char* name);
+
+#endif // CLOSURE_H
@@ -10,6 +10,11 @@
 #include <sys/time.h>
 #include <unistd.h>
 #include <limits.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "object.h"
 #include "gc.h"
@@ -17,10 +22,29 @@
 #include "parser.h"
 #include "tokenizer.h"
 #include "heap.h"
+#include "closure.h"
+#include "optimizer.h"
+#include "vm.h"
+#include "bignum.h"
+#include "numkernel.h"
+#include "hashtable.h"
+#include "map.h"
+#include "strbuf.h"
+#include "printer.h"
+#include "memo.h"
+#include "macro.h"
+#include "reader.h"
+#include "fasl.h"
+#include "image.h"
+#include "srcloc.h"
 
 // 環境: ((sym . value) ...) の連鎖リスト（alist）
 static Object* g_env = NULL;
 
+// 環境バージョン: 束縛が変わるたびに進め、コールサイトキャッシュを無効化する
+// (0 はゼロクリアされた未使用キャッシュと区別するため使わない)
+static uint32_t g_env_version = 1;
+
 // デバッグモード制御
 static bool debug_mode = false;
 
@@ -45,9 +69,21 @@ static Object* env_pop_scope(Object* env) {
     }
     return env;
 }
-static Object* env_lookup(Object* env, const char* name) {
+// 束縛 (sym . value) の探索: ローカル環境 env を先に探し、見つからなければ
+// グローバル環境 g_env を探す。global が非NULLなら、見つかった束縛が
+// グローバル側にあるかを返す。
+static Object* env_find_binding(Object* env, const char* name, bool* global) {
     DEBUG_PRINT("DEBUG: Looking up symbol '%s'\n", name);
-    for (Object* it = env; it && it->type == OBJ_CONS; it = it->data.cons.cdr) {
+    bool in_global = (env == g_env);
+    for (Object* it = env; ; it = it->data.cons.cdr) {
+        if (it == g_env) in_global = true;
+        if (!it || it->type != OBJ_CONS) {
+            // ローカル環境を探し終えたらグローバル環境へ
+            if (in_global) break;
+            it = g_env;
+            in_global = true;
+            if (!it || it->type != OBJ_CONS) break;
+        }
         Object* pair = it->data.cons.car;  // (sym . value)
         if (pair && pair->type == OBJ_CONS) {
             Object* sym = pair->data.cons.car;
@@ -55,74 +91,289 @@ static Object* env_lookup(Object* env, const char* name) {
                 DEBUG_PRINT("DEBUG: Found symbol '%s'\n", sym->data.symbol.name);
                 if (strcmp(sym->data.symbol.name, name) == 0) {
                     DEBUG_PRINT("DEBUG: Match found! Returning value\n");
-                    return pair->data.cons.cdr;
+                    if (global) *global = in_global;
+                    return pair;
                 }
             }
         }
     }
     DEBUG_PRINT("DEBUG: Symbol '%s' not found in environment\n", name);
+    if (global) *global = false;
     return NULL;
 }
+static Object* env_lookup_ex(Object* env, const char* name, bool* global) {
+    Object* pair = env_find_binding(env, name, global);
+    return pair ? pair->data.cons.cdr : NULL;
+}
+static Object* env_lookup(Object* env, const char* name) {
+    return env_lookup_ex(env, name, NULL);
+}
 static void env_bind(Object** env, const char* name, Object* value) {
     Object* sym  = make_symbol(name);
     Object* pair = make_pair(sym, value);
     *env         = make_pair(pair, *env);
+    g_env_version++;  // 束縛が変わったのでコールサイトキャッシュを無効化
+}
+// 呼び出し先になりうる値か（それ以外を呼んでも結果は nil なので、キャッシュが古くても変わらない）
+static bool is_callable(Object* obj) {
+    if (!obj) return false;
+    switch (obj->type) {
+        case OBJ_FUNCTION:
+        case OBJ_LAMBDA:
+        case OBJ_MEMO:
+        case OBJ_MACRO:
+        case OBJ_OPERATOR:
+        case OBJ_BUILTIN:
+            return true;
+        default:
+            return false;
+    }
+}
+static void env_set(Object* pair, Object* value) {
+    Object* old = pair->data.cons.cdr;
+    // マクロの束縛が変わればキャッシュ済みの展開結果も作り直す
+    if (is_macro(old) || is_macro(value)) macro_invalidate();
+    pair->data.cons.cdr = value;
+    // 呼び出し先が変わりうるときだけコールサイトキャッシュを無効化する
+    // （ループ中のカウンタの更新などでは、同じループの呼び出しのキャッシュを捨てない）
+    if (is_callable(old) || is_callable(value)) g_env_version++;
+}
+
+// ---- クロージャ用のフレームアクセス ----
+
+// ローカル環境中で最も内側の呼び出しフレームから index 番目のスロットを返す。
+// 仮引数のスロットに続けて、クロージャが捕捉した変数のスロットが並ぶ。
+static Object** frame_slot(Object* env, int index) {
+    for (Object* it = env; is_cons(it); it = it->data.cons.cdr) {
+        Object* frame = it->data.cons.car;
+        if (!is_frame(frame)) continue;
+        if ((size_t)index < frame->data.frame.count) {
+            return &frame->data.frame.slots[index];
+        }
+        Object* captured = frame->data.frame.link->data.lambda.captured;
+        index -= (int)frame->data.frame.count;
+        if (captured && (size_t)index < captured->data.frame.count) {
+            return &captured->data.frame.slots[index];
+        }
+        return NULL;
+    }
+    return NULL;
+}
+
+// ローカル環境（呼び出しフレームと loop/dotimes の束縛）だけを名前で探す。
+// 呼び出しフレームの外側はクロージャ生成時に捕捉済みなので辿らない。
+static Object** env_find_local(Object* env, const char* name) {
+    for (Object* it = env; is_cons(it); it = it->data.cons.cdr) {
+        Object* elem = it->data.cons.car;
+        if (is_frame(elem)) {
+            Object* closure = elem->data.frame.link;
+            int index = closure_name_index(closure->data.lambda.params, name);
+            if (index >= 0) return &elem->data.frame.slots[index];
+            Object* captured = closure->data.lambda.captured;
+            index = captured ? closure_name_index(captured->data.frame.link, name) : -1;
+            return index >= 0 ? &captured->data.frame.slots[index] : NULL;
+        }
+        if (is_cons(elem) && strcmp(obj_symbol_name(elem->data.cons.car), name) == 0) {
+            return &elem->data.cons.cdr;
+        }
+    }
+    return NULL;
 }
 
 // 引数リストの評価
 static Object* eval(Object* expr);
 static Object* eval_with_env(Object* expr, Object* env);
 
-// ビルトイン関数の前方宣言
-static Object* builtin_plus(Object* args);
-static Object* builtin_minus(Object* args);
-static Object* builtin_mul(Object* args);
-static Object* builtin_div(Object* args);
-static Object* builtin_eq(Object* args);
-static Object* builtin_lt(Object* args);
-static Object* builtin_gt(Object* args);
-static Object* builtin_lte(Object* args);
-static Object* builtin_gte(Object* args);
-static Object* builtin_print(Object* args);
-static Object* builtin_println(Object* args);
-static Object* builtin_str(Object* args);
-static Object* builtin_length(Object* args);
-static Object* builtin_boolp(Object* args);
-// タイマー関数の前方宣言
-static Object* builtin_now(Object* args);
-static Object* builtin_sleep(Object* args);
-static Object* builtin_time_diff(Object* args);
-// ループ制御関数の前方宣言
-static Object* builtin_dotimes(Object* args);  // Common Lisp標準
-// 特別処理関数の前方宣言
-static Object* eval_dotimes_special(Object* args);
+// ビルトイン関数の前方宣言（登録表 builtins.inc から生成）
+#define OPERATOR(id, name, func, min_arity, max_arity, pure) static Object* func(Object* args);
+#define BUILTIN(id, name, func, min_arity, max_arity, pure)  static Object* func(Object* args);
+#include "builtins.inc"
+// 特殊形式の前方宣言
+static Object* eval_quote(Object* args, Object* env);
+static Object* eval_if(Object* args, Object* env);
+static Object* eval_define(Object* args, Object* env);
+static Object* eval_set(Object* args, Object* env);
+static Object* eval_lambda(Object* args, Object* env);
+static Object* eval_loop(Object* args, Object* env);
+static Object* eval_dotimes(Object* args, Object* env);
+static Object* eval_defmacro(Object* args, Object* env);
+static Object* eval_expansion(Object* args, Object* env);
 // dotimesヘルパー関数の前方宣言
-static bool parse_dotimes_args(Object* args, const char** var_name, int* count, Object** expressions);
-static Object* execute_dotimes_loop(const char* var_name, int count, Object* expressions);
-static Object* eval_list(Object* list) {
+static bool parse_dotimes_args(Object* args, Object* env, const char** var_name, int64_t* count, Object** expressions);
+static Object* execute_dotimes_loop(const char* var_name, int64_t count, Object* expressions, Object* env);
+
+// 特殊形式の表: シンボルのタグ (SpecialFormType) で直接引く
+typedef Object* (*SpecialForm)(Object* args, Object* env);
+static const SpecialForm special_forms[SF_COUNT] = {
+    [SF_QUOTE]     = eval_quote,
+    [SF_IF]        = eval_if,
+    [SF_DEFINE]    = eval_define,
+    [SF_SET]       = eval_set,
+    [SF_LAMBDA]    = eval_lambda,
+    [SF_LOOP]      = eval_loop,
+    [SF_DOTIMES]   = eval_dotimes,
+    [SF_DEFMACRO]  = eval_defmacro,
+    [SF_EXPANSION] = eval_expansion,
+};
+// 演算子・組み込み関数の登録情報とネイティブ関数オブジェクト（object_pool外で管理。builtins.inc から生成）
+// 呼び出し先はこれらに正規化してからコールサイトキャッシュに記録する
+static const BuiltinSpec operator_specs[OP_COUNT] = {
+#define OPERATOR(id, name, func, min_arity, max_arity, pure) [id] = {name, min_arity, max_arity, pure},
+#include "builtins.inc"
+};
+static const BuiltinSpec builtin_specs[BUILTIN_COUNT] = {
+#define BUILTIN(id, name, func, min_arity, max_arity, pure) [id] = {name, min_arity, max_arity, pure},
+#include "builtins.inc"
+};
+
+static const Object operator_functions[OP_COUNT] = {
+#define OPERATOR(id, name, func, min_arity, max_arity, pure) \
+    [id] = {.type = OBJ_FUNCTION, .data.function = {.native_func = func, .spec = &operator_specs[id]}},
+#include "builtins.inc"
+};
+static const Object builtin_functions[BUILTIN_COUNT] = {
+#define BUILTIN(id, name, func, min_arity, max_arity, pure) \
+    [id] = {.type = OBJ_FUNCTION, .data.function = {.native_func = func, .spec = &builtin_specs[id]}},
+#include "builtins.inc"
+};
+
+#define OPERATOR_FUNC(op)     ((Object*)&operator_functions[(op)])
+#define BUILTIN_FUNC(builtin) ((Object*)&builtin_functions[(builtin)])
+
+static Object* eval_list_with_env(Object* list, Object* env) {
     if (!list || list->type == OBJ_NIL) return obj_nil;
     Object* head = obj_nil;
     Object** cur = &head;
     for (Object* it = list; it && it->type == OBJ_CONS; it = it->data.cons.cdr) {
-        Object* ev = eval(it->data.cons.car);
+        Object* ev = eval_with_env(it->data.cons.car, env);
         if (!ev) return obj_nil;
         *cur = make_cons(ev, obj_nil);
+        if (!*cur) return obj_nil;   // プールが尽きた
         cur  = &((*cur)->data.cons.cdr);
     }
     return head;
 }
 
-static Object* eval_list_with_env(Object* list, Object* env) {
-    if (!list || list->type == OBJ_NIL) return obj_nil;
-    Object* head = obj_nil;
-    Object** cur = &head;
-    for (Object* it = list; it && it->type == OBJ_CONS; it = it->data.cons.cdr) {
-        Object* ev = eval_with_env(it->data.cons.car, env);
+static size_t list_length(Object* list) {
+    size_t n = 0;
+    for (Object* it = list; is_cons(it); it = it->data.cons.cdr) n++;
+    return n;
+}
+
+// 引数の数が登録表の範囲に収まるか（登録表にない関数は検査しない）。
+// 検査は呼び出し側で一度だけ行い、個々の組み込み関数は引数の数を数え直さない
+static bool arity_ok(Object* func, size_t argc) {
+    const BuiltinSpec* spec = func->data.function.spec;
+    if (!spec) return true;
+    if (argc < (size_t)spec->min_arity) return false;
+    return spec->max_arity < 0 || argc <= (size_t)spec->max_arity;
+}
+
+// 演算子呼び出し: 演算子は引数リストを保存しないので、引数が少なければ
+// リストをCスタック上に組み立てる（ループの条件式や更新式でプールを消費しない）
+#define STACK_ARGS_MAX 4
+
+static Object* call_operator(Object* func, Object* list, Object* env) {
+    Object cells[STACK_ARGS_MAX];
+    size_t n = list_length(list);
+    if (!arity_ok(func, n)) return obj_nil;
+    if (n > STACK_ARGS_MAX) return func->data.function.native_func(eval_list_with_env(list, env));
+    Object* args = obj_nil;
+    for (size_t i = 0; i < n; i++, list = list->data.cons.cdr) {
+        Object* ev = eval_with_env(list->data.cons.car, env);
         if (!ev) return obj_nil;
-        *cur = make_cons(ev, obj_nil);
-        cur  = &((*cur)->data.cons.cdr);
+        memset(&cells[i], 0, sizeof(Object));  // make_cons と同じく cache / cache_stamp も空にする
+        cells[i].type = OBJ_CONS;
+        cells[i].data.cons.car = ev;
+        cells[i].data.cons.cdr = obj_nil;
+        if (i > 0) cells[i - 1].data.cons.cdr = &cells[i];
+    }
+    if (n > 0) args = &cells[0];
+    return func->data.function.native_func(args);
+}
+
+// 呼び出し先をネイティブ関数オブジェクトへ正規化する
+static Object* normalize_callee(Object* func) {
+    switch (func->type) {
+        case OBJ_OPERATOR: return OPERATOR_FUNC(func->data.operator_type);
+        case OBJ_BUILTIN:  return BUILTIN_FUNC(func->data.builtin_type);
+        default:           return func;
     }
-    return head;
+}
+
+// コールサイト expr の呼び出し先を解決し、可能ならキャッシュに記録する。
+// キャッシュするのはグローバル束縛またはリテラルの呼び出し先のみ
+// （ローカル束縛は呼び出しごとに値が変わりうるため毎回解決する）。
+static Object* resolve_call_site(Object* expr, Object* env) {
+    Object* head = expr->data.cons.car;
+    Object* func = NULL;
+    bool cacheable = false;
+
+    if (head && head->type == OBJ_SYMBOL) {
+        // 仮引数・捕捉変数・loop/dotimes の変数を、同名のグローバル束縛より先に探す
+        Object** local = head->data.symbol.slot ? frame_slot(env, head->data.symbol.slot - 1) : NULL;
+        if (!local) local = env_find_local(env, head->data.symbol.name);
+        if (local) {
+            func = *local;
+        } else {
+            func = env_lookup_ex(g_env, head->data.symbol.name, &cacheable);
+        }
+    } else if (head && (head->type == OBJ_OPERATOR || head->type == OBJ_BUILTIN ||
+                        head->type == OBJ_FUNCTION)) {
+        func = head;
+        cacheable = true;
+    } else {
+        func = eval_with_env(head, env);
+    }
+    if (!func) return obj_nil;
+
+    func = normalize_callee(func);
+    if (cacheable) {
+        expr->data.cons.cache = func;
+        expr->cache_stamp     = g_env_version;
+    }
+    return func;
+}
+
+// ラムダ適用: 仮引数分のフレームを作り、本体を順に評価して最後の値を返す
+static int call_depth = 0;
+
+static Object* apply_lambda(Object* closure, Object* args) {
+    if (call_depth >= MAX_RECURSION_DEPTH) {
+        DEBUG_PRINT("DEBUG: lambda: recursion too deep\n");
+        return obj_nil;
+    }
+    Object* params = closure->data.lambda.params;
+    size_t nparams = 0;
+    for (Object* it = params; is_cons(it); it = it->data.cons.cdr) nparams++;
+
+    Object* frame = make_frame(nparams, closure);
+    if (!frame) return obj_nil;
+    Object* env = make_cons(frame, obj_nil);
+    if (!env) return obj_nil;
+
+    size_t i = 0;
+    for (Object* it = args; is_cons(it) && i < nparams; it = it->data.cons.cdr) {
+        frame->data.frame.slots[i++] = it->data.cons.car;
+    }
+
+    call_depth++;
+    Object* result = obj_nil;
+    for (Object* it = closure->data.lambda.body; is_cons(it); it = it->data.cons.cdr) {
+        result = eval_with_env(it->data.cons.car, env);
+    }
+    call_depth--;
+    return result;
+}
+
+// メモ化関数の適用: キャッシュになければ元の関数を呼んで結果を登録する
+static Object* apply_memo(Object* memo, Object* args) {
+    MemoCache* cache = memo->data.memo.cache;
+    Object* result = memo_cache_lookup(cache, args);
+    if (result) return result;
+    result = evaluator_apply(memo->data.memo.function, args);
+    if (result) memo_cache_store(cache, args, result);
+    return result;
 }
 
 // メイン評価関数の実装
@@ -133,6 +384,13 @@ static Object* eval_with_env(Object* expr, Object* env) {
         case OBJ_NIL:
         case OBJ_BOOL:
         case OBJ_NUMBER:
+        case OBJ_BIGNUM:
+        case OBJ_FLOAT:
+        case OBJ_VECTOR:
+        case OBJ_HASHTABLE:
+        case OBJ_MAP:
+        case OBJ_MEMO:
+        case OBJ_MACRO:
         case OBJ_STRING:
         case OBJ_FUNCTION:
         case OBJ_LAMBDA:
@@ -142,48 +400,55 @@ static Object* eval_with_env(Object* expr, Object* env) {
             return expr; // 自己評価
 
         case OBJ_SYMBOL: {
+            // クロージャ変換済みの参照はフレームのスロットを直接読む
+            if (expr->data.symbol.slot) {
+                Object** slot = frame_slot(env, expr->data.symbol.slot - 1);
+                if (slot) return *slot;
+            }
             Object* value = env_lookup(env, expr->data.symbol.name);
             return value ? value : obj_nil;
         }
 
         case OBJ_CONS: {
-            // 特別な構文の処理は eval() で行うため、ここでは通常の関数呼び出しのみ
-            Object* func = eval_with_env(expr->data.cons.car, env);
-            if (!func) return obj_nil;
+            // 特殊形式: 先頭シンボルのタグで表を引く（文字列比較なし）
+            Object* head = expr->data.cons.car;
+            if (head && head->type == OBJ_SYMBOL && head->data.symbol.special != SF_NONE) {
+                return special_forms[head->data.symbol.special](expr->data.cons.cdr, env);
+            }
 
-            // 引数リストを環境付きで評価
-            Object* args = eval_list_with_env(expr->data.cons.cdr, env);
+            Object* func;
+            if (head && head->type == OBJ_OPERATOR) {
+                return call_operator(normalize_callee(head), expr->data.cons.cdr, env);
+            }
+            if (head && head->type == OBJ_BUILTIN) {
+                // 固定の演算子・組み込み関数は再束縛されないので表を直接引く
+                func = normalize_callee(head);
+            } else if (expr->cache_stamp == g_env_version) {
+                // キャッシュヒット: 探索と型ごとのディスパッチを省略
+                func = expr->data.cons.cache;
+            } else {
+                func = resolve_call_site(expr, env);
+            }
 
+            // 評価前の一括展開で展開されなかったマクロ呼び出し: ここで展開して書き換える
+            if (func->type == OBJ_MACRO) {
+                return macro_rewrite(expr, func) ? eval_with_env(expr, env) : obj_nil;
+            }
+
+            // ネイティブ関数: 引数の数を検査して関数ポインタを直接呼ぶ
+            Object* arglist = expr->data.cons.cdr;
             if (func->type == OBJ_FUNCTION && func->data.function.native_func) {
-                return func->data.function.native_func(args);
-            } else if (func->type == OBJ_OPERATOR) {
-                // 演算子処理
-                switch (func->data.operator_type) {
-                    case OP_PLUS: return builtin_plus(args);
-                    case OP_MINUS: return builtin_minus(args);
-                    case OP_ASTERISK: return builtin_mul(args);
-                    case OP_SLASH: return builtin_div(args);
-                    case OP_EQ: return builtin_eq(args);
-                    case OP_LT: return builtin_lt(args);
-                    case OP_GT: return builtin_gt(args);
-                    case OP_LTE: return builtin_lte(args);
-                    case OP_GTE: return builtin_gte(args);
-                    default: return obj_nil;
-                }
-            } else if (func->type == OBJ_BUILTIN) {
-                // 組み込み関数処理
-                switch (func->data.builtin_type) {
-                    case BUILTIN_PRINT: return builtin_print(args);
-                    case BUILTIN_PRINTLN: return builtin_println(args);
-                    case BUILTIN_STR: return builtin_str(args);
-                    case BUILTIN_LENGTH: return builtin_length(args);
-                    case BUILTIN_BOOLP: return builtin_boolp(args);
-                    case BUILTIN_NOW: return builtin_now(args);
-                    case BUILTIN_SLEEP: return builtin_sleep(args);
-                    case BUILTIN_TIME_DIFF: return builtin_time_diff(args);
-                    case BUILTIN_DOTIMES: return builtin_dotimes(args);
-                    default: return obj_nil;
-                }
+                if (!arity_ok(func, list_length(arglist))) return obj_nil;
+                return func->data.function.native_func(eval_list_with_env(arglist, env));
+            }
+
+            // 引数リストを環境付きで評価
+            Object* args = eval_list_with_env(arglist, env);
+            if (func->type == OBJ_LAMBDA) {
+                return apply_lambda(func, args);
+            }
+            if (func->type == OBJ_MEMO) {
+                return apply_memo(func, args);
             }
             return obj_nil;
         }
@@ -194,91 +459,190 @@ static Object* eval_with_env(Object* expr, Object* env) {
 }
 
 static Object* eval(Object* expr) {
-    if (!expr) return obj_nil;
+    // トップレベルはローカル環境なし（グローバル環境のみ）で評価
+    return eval_with_env(expr, obj_nil);
+}
+
+// 真偽判定: nil と false 以外は真
+static bool is_truthy(Object* obj) {
+    return obj && obj != obj_nil && obj != obj_false;
+}
 
-    // 特別な構文の処理
-    if (expr->type == OBJ_CONS) {
-        // dotimesの特別処理
-        if (expr->data.cons.car && expr->data.cons.car->type == OBJ_SYMBOL &&
-            expr->data.cons.car->data.symbol.name &&
-            strcmp(expr->data.cons.car->data.symbol.name, "dotimes") == 0) {
-            return eval_dotimes_special(expr->data.cons.cdr);
+// ---- 数値演算 ----
+// int64_t の範囲では桁あふれ検査付きの組み込み演算で計算し（箱は結果の1つだけ）、
+// あふれたときだけ多倍長整数（bignum.c）に切り替える。
+// 浮動小数点数が混じったらそこから先は double のまま計算し、最後に1回だけ箱にする。
+
+typedef enum { ARITH_ADD, ARITH_SUB, ARITH_MUL } ArithOp;
+
+static bool is_real(Object* obj) {
+    return obj && obj->type == OBJ_FLOAT;
+}
+
+static bool is_numeric(Object* obj) {
+    return is_integer(obj) || is_real(obj);
+}
+
+static double to_double(Object* obj) {
+    return is_real(obj) ? obj->data.real : bignum_to_double(obj);
+}
+
+// 整数2つの演算。桁あふれの限界を超えたら NULL
+static Object* arith_integers(ArithOp op, Object* a, Object* b) {
+    if (a->type == OBJ_NUMBER && b->type == OBJ_NUMBER) {
+        int64_t result;
+        bool overflow;
+        switch (op) {
+            case ARITH_ADD: overflow = __builtin_add_overflow(a->data.number, b->data.number, &result); break;
+            case ARITH_SUB: overflow = __builtin_sub_overflow(a->data.number, b->data.number, &result); break;
+            default:        overflow = __builtin_mul_overflow(a->data.number, b->data.number, &result); break;
         }
+        if (!overflow) return make_number(result);
+    }
+    switch (op) {
+        case ARITH_ADD: return bignum_add(a, b);
+        case ARITH_SUB: return bignum_sub(a, b);
+        default:        return bignum_mul(a, b);
+    }
+}
+
+static double arith_doubles(ArithOp op, double a, double b) {
+    switch (op) {
+        case ARITH_ADD: return a + b;
+        case ARITH_SUB: return a - b;
+        default:        return a * b;
+    }
+}
+
+// acc に rest の各要素を順に演算していく（多倍長や浮動小数点数を含む遅い経路）
+static Object* fold_numbers(ArithOp op, Object* acc, Object* rest) {
+    Object* it = rest;
+    for (; acc && is_cons(it) && !is_real(acc); it = it->data.cons.cdr) {
+        Object* a = it->data.cons.car;
+        if (is_real(a)) break;
+        if (!is_integer(a)) return obj_nil;
+        acc = arith_integers(op, acc, a);
     }
+    if (!acc) return obj_nil;
+    if (!is_cons(it)) return acc;
 
-    // 通常の評価
-    return eval_with_env(expr, g_env);
+    double value = to_double(acc);
+    for (; is_cons(it); it = it->data.cons.cdr) {
+        Object* a = it->data.cons.car;
+        if (!is_numeric(a)) return obj_nil;
+        value = arith_doubles(op, value, to_double(a));
+    }
+    return make_float(value);
 }
 
 // ビルトイン: (+ a b ...) / (* a b ...) / (- a b ...) / (/ a b ...)
 static Object* builtin_plus(Object* args) {
     DEBUG_PRINT("DEBUG: builtin_plus called\n");
-    long sum = 0;
-    for (Object* it = args; it && it->type == OBJ_CONS; it = it->data.cons.cdr) {
+    int64_t sum = 0;
+    Object* it = args;
+    for (; it && it->type == OBJ_CONS; it = it->data.cons.cdr) {
         Object* a = it->data.cons.car;
-        if (!a || a->type != OBJ_NUMBER) return obj_nil;
-        sum += a->data.number;
+        int64_t next;
+        if (!a || a->type != OBJ_NUMBER || __builtin_add_overflow(sum, a->data.number, &next)) break;
+        sum = next;
     }
-    DEBUG_PRINT("DEBUG: builtin_plus result: %ld\n", sum);
-    return make_number((int)sum);
+    if (!is_cons(it)) return make_number(sum);
+    // 桁あふれか整数以外の引数: 残りは遅い経路で足す
+    return fold_numbers(ARITH_ADD, make_number(sum), it);
 }
 
 static Object* builtin_mul(Object* args) {
     DEBUG_PRINT("DEBUG: builtin_mul called\n");
-    long prod = 1;
-    for (Object* it = args; it && it->type == OBJ_CONS; it = it->data.cons.cdr) {
+    int64_t prod = 1;
+    Object* it = args;
+    for (; it && it->type == OBJ_CONS; it = it->data.cons.cdr) {
         Object* a = it->data.cons.car;
-        if (!a || a->type != OBJ_NUMBER) return obj_nil;
-        prod *= a->data.number;
+        int64_t next;
+        if (!a || a->type != OBJ_NUMBER || __builtin_mul_overflow(prod, a->data.number, &next)) break;
+        prod = next;
     }
-    DEBUG_PRINT("DEBUG: builtin_mul result: %ld\n", prod);
-    return make_number((int)prod);
+    if (!is_cons(it)) return make_number(prod);
+    return fold_numbers(ARITH_MUL, make_number(prod), it);
 }
 
 static Object* builtin_minus(Object* args) {
     if (!args || args->type != OBJ_CONS) return obj_nil;
 
     Object* first = args->data.cons.car;
-    if (!first || first->type != OBJ_NUMBER) return obj_nil;
+    if (!is_numeric(first)) return obj_nil;
 
     // 引数が1つの場合は符号反転
     if (!args->data.cons.cdr || args->data.cons.cdr->type == OBJ_NIL) {
-        return make_number(-first->data.number);
+        if (is_real(first)) return make_float(-first->data.real);
+        Object* negated = arith_integers(ARITH_SUB, make_number(0), first);
+        return negated ? negated : obj_nil;
     }
 
     // 複数の引数の場合は最初から順次引く
-    long result = first->data.number;
-    for (Object* it = args->data.cons.cdr; it && it->type == OBJ_CONS; it = it->data.cons.cdr) {
-        Object* a = it->data.cons.car;
-        if (!a || a->type != OBJ_NUMBER) return obj_nil;
-        result -= a->data.number;
+    return fold_numbers(ARITH_SUB, first, args->data.cons.cdr);
+}
+
+// 割り算。整数同士は0方向への切り捨て、浮動小数点数が混じれば double の商。
+// ゼロ除算は nil
+static Object* divide_numbers(Object* a, Object* b) {
+    if (is_real(a) || is_real(b)) {
+        double divisor = to_double(b);
+        if (divisor == 0.0) return obj_nil;  // ゼロ除算エラー
+        return make_float(to_double(a) / divisor);
+    }
+    if (a->type == OBJ_NUMBER && b->type == OBJ_NUMBER) {
+        if (b->data.number == 0) return obj_nil;  // ゼロ除算エラー
+        // INT64_MIN / -1 だけは int64_t からあふれる
+        if (!(a->data.number == INT64_MIN && b->data.number == -1)) {
+            return make_number(a->data.number / b->data.number);
+        }
     }
-    return make_number((int)result);
+    Object* result = bignum_div(a, b);
+    return result ? result : obj_nil;
 }
 
 static Object* builtin_div(Object* args) {
     if (!args || args->type != OBJ_CONS) return obj_nil;
 
     Object* first = args->data.cons.car;
-    if (!first || first->type != OBJ_NUMBER) return obj_nil;
+    if (!is_numeric(first)) return obj_nil;
 
     // 引数が1つの場合は 1/x
     if (!args->data.cons.cdr || args->data.cons.cdr->type == OBJ_NIL) {
-        if (first->data.number == 0) return obj_nil; // ゼロ除算エラー
-        return make_number(1 / first->data.number);
+        return divide_numbers(make_number(1), first);
     }
 
     // 複数の引数の場合は最初から順次割る
-    long result = first->data.number;
+    Object* result = first;
     for (Object* it = args->data.cons.cdr; it && it->type == OBJ_CONS; it = it->data.cons.cdr) {
         Object* a = it->data.cons.car;
-        if (!a || a->type != OBJ_NUMBER || a->data.number == 0) return obj_nil; // ゼロ除算チェック
-        result /= a->data.number;
+        if (!is_numeric(a)) return obj_nil;
+        result = divide_numbers(result, a);
+        if (result == obj_nil) return obj_nil;
     }
-    return make_number((int)result);
+    return result;
 }
 
 // 比較演算子
+// 2引数を取り出し、両方が数値なら大小の符号を *order に返す。
+// 整数同士は正確に比べ、浮動小数点数が混じれば double で比べる（NaN はどれとも比較できない）
+static bool compare_args(Object* args, int* order) {
+    if (!args || args->type != OBJ_CONS || !args->data.cons.cdr || args->data.cons.cdr->type != OBJ_CONS) {
+        return false;
+    }
+    Object* a = args->data.cons.car;
+    Object* b = args->data.cons.cdr->data.cons.car;
+    if (is_integer(a) && is_integer(b)) {
+        *order = bignum_compare(a, b);
+        return true;
+    }
+    if (!is_numeric(a) || !is_numeric(b)) return false;
+    double x = to_double(a), y = to_double(b);
+    if (x != x || y != y) return false;
+    *order = (x > y) - (x < y);
+    return true;
+}
+
 static Object* builtin_eq(Object* args) {
     if (!args || args->type != OBJ_CONS || !args->data.cons.cdr || args->data.cons.cdr->type != OBJ_CONS) {
         return obj_nil;
@@ -290,156 +654,64 @@ static Object* builtin_eq(Object* args) {
     // ポインタが同じ場合は等しい（nil同士、true同士など）
     if (a == b) return obj_true;
 
-    if (a->type == OBJ_NUMBER && b->type == OBJ_NUMBER) {
-        return (a->data.number == b->data.number) ? obj_true : obj_nil;
-    }
-    return obj_nil;
+    int order;
+    return (compare_args(args, &order) && order == 0) ? obj_true : obj_nil;
 }
 
 static Object* builtin_lt(Object* args) {
-    if (!args || args->type != OBJ_CONS || !args->data.cons.cdr || args->data.cons.cdr->type != OBJ_CONS) {
-        return obj_nil;
-    }
-    Object* a = args->data.cons.car;
-    Object* b = args->data.cons.cdr->data.cons.car;
-    if (!a || !b || a->type != OBJ_NUMBER || b->type != OBJ_NUMBER) return obj_nil;
-
-    return (a->data.number < b->data.number) ? obj_true : obj_nil;
+    int order;
+    return (compare_args(args, &order) && order < 0) ? obj_true : obj_nil;
 }
 
 static Object* builtin_gt(Object* args) {
-    if (!args || args->type != OBJ_CONS || !args->data.cons.cdr || args->data.cons.cdr->type != OBJ_CONS) {
-        return obj_nil;
-    }
-    Object* a = args->data.cons.car;
-    Object* b = args->data.cons.cdr->data.cons.car;
-    if (!a || !b || a->type != OBJ_NUMBER || b->type != OBJ_NUMBER) return obj_nil;
-
-    return (a->data.number > b->data.number) ? obj_true : obj_nil;
+    int order;
+    return (compare_args(args, &order) && order > 0) ? obj_true : obj_nil;
 }
 
 static Object* builtin_lte(Object* args) {
-    if (!args || args->type != OBJ_CONS || !args->data.cons.cdr || args->data.cons.cdr->type != OBJ_CONS) {
-        return obj_nil;
-    }
-    Object* a = args->data.cons.car;
-    Object* b = args->data.cons.cdr->data.cons.car;
-    if (!a || !b || a->type != OBJ_NUMBER || b->type != OBJ_NUMBER) return obj_nil;
-
-    return (a->data.number <= b->data.number) ? obj_true : obj_nil;
+    int order;
+    return (compare_args(args, &order) && order <= 0) ? obj_true : obj_nil;
 }
 
 static Object* builtin_gte(Object* args) {
-    if (!args || args->type != OBJ_CONS || !args->data.cons.cdr || args->data.cons.cdr->type != OBJ_CONS) {
-        return obj_nil;
-    }
-    Object* a = args->data.cons.car;
-    Object* b = args->data.cons.cdr->data.cons.car;
-    if (!a || !b || a->type != OBJ_NUMBER || b->type != OBJ_NUMBER) return obj_nil;
-
-    return (a->data.number >= b->data.number) ? obj_true : obj_nil;
+    int order;
+    return (compare_args(args, &order) && order >= 0) ? obj_true : obj_nil;
 }
 
 // ---- 追加: 出力/ユーティリティ系ビルトイン ----
-static void print_object_repr(Object* obj, bool newline) {
-    if (!obj) { printf("nil"); if (newline) printf("\n"); return; }
-    switch (obj->type) {
-        case OBJ_NIL:    printf("nil"); break;
-        case OBJ_BOOL:   printf(obj == obj_true ? "t" : "nil"); break;
-        case OBJ_NUMBER: printf("%d", obj->data.number); break;
-        case OBJ_STRING: printf("%s", obj->data.string.text ? obj->data.string.text : ""); break;
-        case OBJ_SYMBOL: printf("%s", obj->data.symbol.name ? obj->data.symbol.name : ""); break;
-        case OBJ_CONS: {
-            printf("(");
-            Object* it = obj;
-            bool first = true;
-            while (it && it->type == OBJ_CONS) {
-                if (!first) printf(" ");
-                print_object_repr(it->data.cons.car, false);
-                it = it->data.cons.cdr;
-                first = false;
-            }
-            if (it && it != obj_nil) { // ドットリスト
-                printf(" . ");
-                print_object_repr(it, false);
-            }
-            printf(")");
-            break;
-        }
-        case OBJ_FUNCTION: printf("<function>"); break;
-        case OBJ_LAMBDA:   printf("<lambda>"); break;
-        default:           printf("<unknown>"); break;
-    }
-    if (newline) printf("\n");
-}
-
+// 表示は標準出力用のバッファ（printer.c）にためて、改行ごと・あふれたときにまとめて書き出す
 static Object* builtin_print(Object* args) {
     for (Object* it = args; it && it->type == OBJ_CONS; it = it->data.cons.cdr) {
-        print_object_repr(it->data.cons.car, false);
-        if (it->data.cons.cdr && it->data.cons.cdr->type == OBJ_CONS) printf(" ");
+        printer_write_object(it->data.cons.car, PRINT_DISPLAY);
+        if (it->data.cons.cdr && it->data.cons.cdr->type == OBJ_CONS) printer_write_char(' ');
     }
-    printf("\n");
+    printer_write_char('\n');
     return obj_void;
 }
 
 static Object* builtin_println(Object* args) { // alias; ensure newline after each arg
     for (Object* it = args; it && it->type == OBJ_CONS; it = it->data.cons.cdr) {
-        print_object_repr(it->data.cons.car, true);
+        printer_write_object(it->data.cons.car, PRINT_DISPLAY);
+        printer_write_char('\n');
     }
     return obj_void;
 }
 
 static Object* builtin_str(Object* args) { // 連結して文字列化
-    // まず合計長計算
-    size_t total = 0;
-    for (Object* it = args; it && it->type == OBJ_CONS; it = it->data.cons.cdr) {
-        Object* a = it->data.cons.car;
-        if (!a) continue;
-        switch (a->type) {
-            case OBJ_NUMBER: {
-                char buf[32];
-                snprintf(buf, sizeof(buf), "%d", a->data.number);
-                total += strlen(buf);
-                break;
-            }
-            case OBJ_STRING: if (a->data.string.text) total += a->data.string.length; break;
-            case OBJ_SYMBOL: if (a->data.symbol.name) total += a->data.symbol.length; break;
-            case OBJ_NIL: total += 3; break; // "nil"
-            case OBJ_BOOL: total += (a == obj_true) ? 1 : 3; break; // t/nil
-            default: total += 9; break; // <unknown>
-        }
-    }
-    if (total == 0) return make_string("");
-    char *buf = (char*)heap_alloc(total + 1);
-    if (!buf) return obj_nil;
-    size_t pos = 0;
+    // 1回の走査で heap 上のバッファへ書き、そのまま文字列の本体にする
+    StrBuf sb;
+    strbuf_init(&sb);
     for (Object* it = args; it && it->type == OBJ_CONS; it = it->data.cons.cdr) {
-        Object* a = it->data.cons.car;
-        if (!a) continue;
-        if (a->type == OBJ_NUMBER) {
-            char nbuf[32];
-            int n = snprintf(nbuf, sizeof(nbuf), "%d", a->data.number);
-            memcpy(buf + pos, nbuf, n); pos += n;
-        } else if (a->type == OBJ_STRING && a->data.string.text) {
-            memcpy(buf + pos, a->data.string.text, a->data.string.length); pos += a->data.string.length;
-        } else if (a->type == OBJ_SYMBOL && a->data.symbol.name) {
-            memcpy(buf + pos, a->data.symbol.name, a->data.symbol.length); pos += a->data.symbol.length;
-        } else if (a == obj_nil) {
-            memcpy(buf + pos, "nil", 3); pos += 3;
-        } else if (a->type == OBJ_BOOL) {
-            if (a == obj_true) { memcpy(buf + pos, "t", 1); pos += 1; }
-            else { memcpy(buf + pos, "nil", 3); pos += 3; }
-        } else {
-            memcpy(buf + pos, "<unknown>", 9); pos += 9;
-        }
+        printer_append(&sb, it->data.cons.car, PRINT_DISPLAY);
     }
-    buf[pos] = '\0';
-    return make_string(buf);
+    Object* result = strbuf_to_string(&sb);
+    return result ? result : obj_nil;
 }
 
 static Object* builtin_length(Object* args) {
     if (!args || args->type != OBJ_CONS) return obj_nil;
     Object* target = args->data.cons.car;
+    if (is_vector(target)) return make_number((int64_t)target->data.vector.length);
     int count = 0;
     while (target && target->type == OBJ_CONS) {
         count++;
@@ -460,8 +732,8 @@ static Object* builtin_now(Object* args) {
     // 現在時刻をミリ秒で取得
     struct timeval tv;
     gettimeofday(&tv, NULL);
-    long long milliseconds = (long long)tv.tv_sec * 1000 + tv.tv_usec / 1000;
-    return make_number((int)(milliseconds % INT_MAX)); // オーバーフロー対策
+    int64_t milliseconds = (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+    return make_number(milliseconds);
 }
 
 static Object* builtin_sleep(Object* args) {
@@ -470,9 +742,10 @@ static Object* builtin_sleep(Object* args) {
     if (!duration || duration->type != OBJ_NUMBER) return obj_nil;
 
     // 秒数で指定（小数点は切り捨て）
-    int seconds = duration->data.number;
+    int64_t seconds = duration->data.number;
     if (seconds > 0) {
-        sleep(seconds);
+        printer_flush();   // 待っている間もそれまでの出力が見えるように
+        sleep((unsigned int)seconds);
     }
     return obj_nil;
 }
@@ -481,21 +754,579 @@ static Object* builtin_time_diff(Object* args) {
     // 2つの時刻の差を計算（ミリ秒）
     if (!args || args->type != OBJ_CONS) return obj_nil;
     Object* time1 = args->data.cons.car;
-    if (!time1 || time1->type != OBJ_NUMBER) return obj_nil;
+    if (!is_integer(time1)) return obj_nil;
 
     Object* rest = args->data.cons.cdr;
     if (!rest || rest->type != OBJ_CONS) return obj_nil;
     Object* time2 = rest->data.cons.car;
-    if (!time2 || time2->type != OBJ_NUMBER) return obj_nil;
+    if (!is_integer(time2)) return obj_nil;
 
-    int diff = time2->data.number - time1->data.number;
-    return make_number(diff);
+    Object* diff = arith_integers(ARITH_SUB, time2, time1);
+    return diff ? diff : obj_nil;
 }
 
-// ---- ループ制御関数 ----
+// ---- ベクタ ----
+// 要素は heap 上の連続した配列に持ち、添字アクセスと長さの取得は O(1)。
+
+// 引数の n 番目
+static Object* nth_arg(Object* args, int n) {
+    for (; n > 0 && is_cons(args); n--) args = args->data.cons.cdr;
+    return is_cons(args) ? args->data.cons.car : NULL;
+}
+
+// 添字を取り出す。ベクタの範囲外なら false
+static bool vector_index(Object* vector, Object* index, size_t* out) {
+    if (!is_vector(vector) || !index || index->type != OBJ_NUMBER) return false;
+    if (index->data.number < 0 || (uint64_t)index->data.number >= vector->data.vector.length) return false;
+    *out = (size_t)index->data.number;
+    return true;
+}
+
+// (make-vector n [fill])
+static Object* builtin_make_vector(Object* args) {
+    Object* length = nth_arg(args, 0);
+    if (!length || length->type != OBJ_NUMBER || length->data.number < 0) return obj_nil;
+    if (length->data.number > VECTOR_MAX_LENGTH) return obj_nil;
+    Object* fill = nth_arg(args, 1);
+    Object* vector = make_vector((size_t)length->data.number, fill ? fill : obj_nil);
+    return vector ? vector : obj_nil;
+}
+
+// (vector-ref v i) 範囲外なら nil
+static Object* builtin_vector_ref(Object* args) {
+    Object* vector = nth_arg(args, 0);
+    size_t i;
+    if (!vector_index(vector, nth_arg(args, 1), &i)) return obj_nil;
+    return vector->data.vector.items[i];
+}
+
+// (vector-set! v i x) 格納した値を返す。範囲外なら nil
+static Object* builtin_vector_set(Object* args) {
+    Object* vector = nth_arg(args, 0);
+    Object* value = nth_arg(args, 2);
+    size_t i;
+    if (!value || !vector_index(vector, nth_arg(args, 1), &i)) return obj_nil;
+    vector->data.vector.items[i] = value;
+    return value;
+}
+
+// (vector-length v)
+static Object* builtin_vector_length(Object* args) {
+    Object* vector = nth_arg(args, 0);
+    if (!is_vector(vector)) return obj_nil;
+    return make_number((int64_t)vector->data.vector.length);
+}
+
+// (vector->list v)
+static Object* builtin_vector_to_list(Object* args) {
+    Object* vector = nth_arg(args, 0);
+    if (!is_vector(vector)) return obj_nil;
+    Object* list = obj_nil;
+    for (size_t i = vector->data.vector.length; i-- > 0; ) {
+        list = make_cons(vector->data.vector.items[i], list);
+    }
+    return list;
+}
+
+// (list->vector list)
+static Object* builtin_list_to_vector(Object* args) {
+    Object* list = nth_arg(args, 0);
+    size_t n = 0;
+    for (Object* it = list; is_cons(it); it = it->data.cons.cdr) n++;
+    Object* vector = make_vector(n, obj_nil);
+    if (!vector) return obj_nil;
+    size_t i = 0;
+    for (Object* it = list; is_cons(it); it = it->data.cons.cdr) {
+        vector->data.vector.items[i++] = it->data.cons.car;
+    }
+    return vector;
+}
+
+// ---- ハッシュテーブル ----
+// オープンアドレス法のテーブル（hashtable.c）。キーの比較は make-hash-table が equal、
+// make-hash-table-eq が eq（シンボルと整数は値で比べる）。
+
+// (make-hash-table)
+static Object* builtin_make_hash_table(Object* args) {
+    (void)args;
+    Object* table = make_hashtable(HASH_EQUAL);
+    return table ? table : obj_nil;
+}
+
+// (make-hash-table-eq)
+static Object* builtin_make_hash_table_eq(Object* args) {
+    (void)args;
+    Object* table = make_hashtable(HASH_EQ);
+    return table ? table : obj_nil;
+}
+
+// (hash-ref h key [default]) なければ default（省略時は nil）
+static Object* builtin_hash_ref(Object* args) {
+    Object* table = nth_arg(args, 0);
+    Object* key = nth_arg(args, 1);
+    Object* fallback = nth_arg(args, 2);
+    if (!fallback) fallback = obj_nil;
+    if (!is_hashtable(table) || !key) return fallback;
+    Object* value = hashtable_get(table->data.hashtable.table, key);
+    return value ? value : fallback;
+}
+
+// (hash-set! h key value) 格納した値を返す。容量の上限で入らなければ nil
+static Object* builtin_hash_set(Object* args) {
+    Object* table = nth_arg(args, 0);
+    Object* key = nth_arg(args, 1);
+    Object* value = nth_arg(args, 2);
+    if (!is_hashtable(table) || !key || !value) return obj_nil;
+    if (!hashtable_put(table->data.hashtable.table, key, value)) return obj_nil;
+    return value;
+}
+
+// (hash-remove! h key) 削除したら t
+static Object* builtin_hash_remove(Object* args) {
+    Object* table = nth_arg(args, 0);
+    Object* key = nth_arg(args, 1);
+    if (!is_hashtable(table) || !key) return obj_nil;
+    return hashtable_remove(table->data.hashtable.table, key) ? obj_true : obj_nil;
+}
+
+// (hash-count h)
+static Object* builtin_hash_count(Object* args) {
+    Object* table = nth_arg(args, 0);
+    if (!is_hashtable(table)) return obj_nil;
+    return make_number((int64_t)table->data.hashtable.table->count);
+}
+
+// (hash-keys h) キーのリスト（順序は不定）
+static Object* builtin_hash_keys(Object* args) {
+    Object* table = nth_arg(args, 0);
+    if (!is_hashtable(table)) return obj_nil;
+    HashTable* t = table->data.hashtable.table;
+    Object* keys = obj_nil;
+    for (size_t i = 0; i < t->capacity; i++) {
+        if (hashtable_slot_full(t->ctrl[i])) keys = make_cons(t->slots[i].key, keys);
+    }
+    for (size_t i = 0; t->old_ctrl && i < t->old_capacity; i++) {
+        if (hashtable_slot_full(t->old_ctrl[i])) keys = make_cons(t->old_slots[i].key, keys);
+    }
+    return keys;
+}
+
+// ---- 永続マップ ----
+// 変更は元のマップと節点を共有した新しいマップを返す（map.c）。
+
+// (make-map k1 v1 k2 v2 ...) キーと値を交互に並べる。値のないキーがあれば nil
+static Object* builtin_make_map(Object* args) {
+    Object* map = make_map();
+    for (Object* it = args; map && is_cons(it); it = obj_cdr(obj_cdr(it))) {
+        if (!is_cons(obj_cdr(it))) return obj_nil;
+        map = map_assoc(map, obj_car(it), obj_car(obj_cdr(it)));
+    }
+    return map ? map : obj_nil;
+}
+
+// (map-assoc m key value) key を value にした新しいマップ
+static Object* builtin_map_assoc(Object* args) {
+    Object* map = map_assoc(nth_arg(args, 0), nth_arg(args, 1), nth_arg(args, 2));
+    return map ? map : obj_nil;
+}
+
+// (map-dissoc m key) key を除いた新しいマップ
+static Object* builtin_map_dissoc(Object* args) {
+    Object* map = map_dissoc(nth_arg(args, 0), nth_arg(args, 1));
+    return map ? map : obj_nil;
+}
+
+// (map-get m key [default]) なければ default（省略時は nil）
+static Object* builtin_map_get(Object* args) {
+    Object* fallback = nth_arg(args, 2);
+    Object* value = map_get(nth_arg(args, 0), nth_arg(args, 1));
+    if (value) return value;
+    return fallback ? fallback : obj_nil;
+}
+
+// (map-count m)
+static Object* builtin_map_count(Object* args) {
+    Object* map = nth_arg(args, 0);
+    if (!is_map(map)) return obj_nil;
+    return make_number((int64_t)map->data.map.count);
+}
+
+// (map-keys m) キーのリスト（順序はハッシュ順）
+static Object* builtin_map_keys(Object* args) {
+    MapIter it;
+    Object* key;
+    Object* value;
+    Object* keys = obj_nil;
+    map_iter_init(&it, nth_arg(args, 0));
+    while (keys && map_iter_next(&it, &key, &value)) keys = make_cons(key, keys);
+    return keys ? keys : obj_nil;
+}
+
+// (map->list m) ((key . value) ...)
+static Object* builtin_map_to_list(Object* args) {
+    MapIter it;
+    Object* key;
+    Object* value;
+    Object* pairs = obj_nil;
+    map_iter_init(&it, nth_arg(args, 0));
+    while (pairs && map_iter_next(&it, &key, &value)) {
+        Object* pair = make_cons(key, value);
+        pairs = pair ? make_cons(pair, pairs) : NULL;
+    }
+    return pairs ? pairs : obj_nil;
+}
+
+// ---- メモ化 ----
+// 純粋な関数の結果を引数ごとに覚える（memo.c）。結果は GC で弱参照として扱う。
+
+// (memoize f [size]) size は LRU で保持するエントリ数（省略時・上限は MEMO_CAPACITY）。
+// 組み込み関数は登録表で純粋とされたものだけを受け付ける
+static Object* builtin_memoize(Object* args) {
+    Object* function = nth_arg(args, 0);
+    Object* size = nth_arg(args, 1);
+    if (!function) return obj_nil;
+    function = normalize_callee(function);
+    if (function->type != OBJ_LAMBDA && function->type != OBJ_FUNCTION) return obj_nil;
+    if (function->type == OBJ_FUNCTION && !(function->data.function.spec && function->data.function.spec->pure)) {
+        return obj_nil;
+    }
+    size_t capacity = MEMO_CAPACITY;
+    if (size) {
+        if (size->type != OBJ_NUMBER || size->data.number <= 0) return obj_nil;
+        if (size->data.number < MEMO_CAPACITY) capacity = (size_t)size->data.number;
+    }
+    Object* memo = make_memo(function, capacity);
+    return memo ? memo : obj_nil;
+}
+
+// (memo-stats f) => (ヒット数 ミス数 エントリ数)
+static Object* builtin_memo_stats(Object* args) {
+    Object* memo = nth_arg(args, 0);
+    if (!memo || memo->type != OBJ_MEMO) return obj_nil;
+    MemoCache* cache = memo->data.memo.cache;
+    return make_cons(make_number((int64_t)cache->stats.hits),
+           make_cons(make_number((int64_t)cache->stats.misses),
+           make_cons(make_number((int64_t)cache->count), obj_nil)));
+}
+
+// ---- リスト操作 ----
+// マクロ本体で展開形の式を組み立てるのに使う。
+
+// (list x...) 引数リストは呼び出し側のスタック上にあることもあるのでコピーする
+static Object* builtin_list(Object* args) {
+    Object* list = obj_nil;
+    Object** tail = &list;
+    for (Object* it = args; is_cons(it); it = it->data.cons.cdr) {
+        Object* cell = make_cons(it->data.cons.car, obj_nil);
+        if (!cell) return obj_nil;
+        *tail = cell;
+        tail = &cell->data.cons.cdr;
+    }
+    return list;
+}
+
+// (cons x list)
+static Object* builtin_cons(Object* args) {
+    Object* car = nth_arg(args, 0);
+    Object* cdr = nth_arg(args, 1);
+    Object* cell = make_cons(car ? car : obj_nil, cdr ? cdr : obj_nil);
+    return cell ? cell : obj_nil;
+}
+
+// (car list) 空リストや非リストには nil
+static Object* builtin_car(Object* args) {
+    Object* list = nth_arg(args, 0);
+    return is_cons(list) ? list->data.cons.car : obj_nil;
+}
+
+// (cdr list)
+static Object* builtin_cdr(Object* args) {
+    Object* list = nth_arg(args, 0);
+    return is_cons(list) ? list->data.cons.cdr : obj_nil;
+}
+
+// ---- イメージ ----
+
+// (save-image "path") グローバル環境ごと処理系の状態を保存する（--image で起動すると評価なしで戻る）。
+// 保存できれば t、できなければ nil
+static Object* builtin_save_image(Object* args) {
+    Object* path = nth_arg(args, 0);
+    if (!path || path->type != OBJ_STRING) return obj_nil;
+    return image_save(path->data.string.text) ? obj_true : obj_nil;
+}
+
+// ---- 数値リストの一括演算 ----
+// リスト（またはベクタ）を一度 double 配列に展開し、numkernel.c の SIMD カーネルで計算する。
+// 途中の値は箱にせず、結果だけを浮動小数点数にする。
+
+// 数値のリストかベクタを double 配列（heap上）にする。数値以外が混じれば false。
+// 空なら *values は NULL
+static bool list_to_doubles(Object* list, double** values, size_t* count) {
+    if (is_vector(list)) {
+        size_t n = list->data.vector.length;
+        for (size_t i = 0; i < n; i++) {
+            if (!is_numeric(list->data.vector.items[i])) return false;
+        }
+        *values = NULL;
+        *count = n;
+        if (n == 0) return true;
+        double* buf = heap_alloc(sizeof(double) * n);
+        if (!buf) return false;
+        for (size_t i = 0; i < n; i++) buf[i] = to_double(list->data.vector.items[i]);
+        *values = buf;
+        return true;
+    }
+
+    size_t n = 0;
+    Object* it = list;
+    for (; is_cons(it); it = it->data.cons.cdr) {
+        if (!is_numeric(it->data.cons.car)) return false;
+        n++;
+    }
+    if (it && it != obj_nil) return false;  // ドットリスト
+
+    *values = NULL;
+    *count = n;
+    if (n == 0) return true;
+    double* buf = heap_alloc(sizeof(double) * n);
+    if (!buf) return false;
+    size_t i = 0;
+    for (it = list; is_cons(it); it = it->data.cons.cdr) buf[i++] = to_double(it->data.cons.car);
+    *values = buf;
+    return true;
+}
+
+// 先頭の引数を double 配列にする
+static bool first_arg_doubles(Object* args, double** values, size_t* count) {
+    if (!is_cons(args)) return false;
+    return list_to_doubles(args->data.cons.car, values, count);
+}
+
+// (vec-sum list)
+static Object* builtin_vec_sum(Object* args) {
+    double* values;
+    size_t n;
+    if (!first_arg_doubles(args, &values, &n)) return obj_nil;
+    double sum = numkernel_sum(values, n);
+    if (values) heap_free(values);
+    return make_float(sum);
+}
+
+// (vec-dot list1 list2) 長さが違えば nil
+static Object* builtin_vec_dot(Object* args) {
+    if (!is_cons(args) || !is_cons(args->data.cons.cdr)) return obj_nil;
+    double *x, *y;
+    size_t xn, yn;
+    if (!list_to_doubles(args->data.cons.car, &x, &xn)) return obj_nil;
+    if (!list_to_doubles(args->data.cons.cdr->data.cons.car, &y, &yn)) {
+        if (x) heap_free(x);
+        return obj_nil;
+    }
+    Object* result = (xn == yn) ? make_float(numkernel_dot(x, y, xn)) : obj_nil;
+    if (x) heap_free(x);
+    if (y) heap_free(y);
+    return result;
+}
+
+// (vec-scale seq k) 各要素を k 倍したリスト（ベクタを渡せばベクタ）
+static Object* builtin_vec_scale(Object* args) {
+    if (!is_cons(args) || !is_cons(args->data.cons.cdr)) return obj_nil;
+    Object* k = args->data.cons.cdr->data.cons.car;
+    if (!is_numeric(k)) return obj_nil;
+    double* values;
+    size_t n;
+    if (!first_arg_doubles(args, &values, &n)) return obj_nil;
+    numkernel_scale(values, values, to_double(k), n);
+    Object* result = obj_nil;
+    if (is_vector(args->data.cons.car)) {
+        result = make_vector(n, obj_nil);
+        for (size_t i = 0; result && i < n; i++) result->data.vector.items[i] = make_float(values[i]);
+        if (!result) result = obj_nil;
+    } else {
+        for (size_t i = n; i-- > 0; ) result = make_cons(make_float(values[i]), result);
+    }
+    if (values) heap_free(values);
+    return result;
+}
+
+// (vec-min list) / (vec-max list) 空リストなら nil
+static Object* builtin_vec_min(Object* args) {
+    double* values;
+    size_t n;
+    if (!first_arg_doubles(args, &values, &n) || n == 0) return obj_nil;
+    double m = numkernel_min(values, n);
+    heap_free(values);
+    return make_float(m);
+}
+
+static Object* builtin_vec_max(Object* args) {
+    double* values;
+    size_t n;
+    if (!first_arg_doubles(args, &values, &n) || n == 0) return obj_nil;
+    double m = numkernel_max(values, n);
+    heap_free(values);
+    return make_float(m);
+}
+
+// ---- 特殊形式 ----
+
+// (quote expr)
+static Object* eval_quote(Object* args, Object* env) {
+    (void)env;
+    return obj_car(args);
+}
+
+// (if cond then [else])
+static Object* eval_if(Object* args, Object* env) {
+    Object* cond = eval_with_env(obj_car(args), env);
+    Object* rest = obj_cdr(args);
+    if (is_truthy(cond)) {
+        return eval_with_env(obj_car(rest), env);
+    }
+    Object* else_part = obj_cdr(rest);
+    return is_cons(else_part) ? eval_with_env(obj_car(else_part), env) : obj_nil;
+}
+
+// (define name expr) - 常にグローバル環境へ束縛する
+static Object* eval_define(Object* args, Object* env) {
+    Object* name = obj_car(args);
+    if (!is_symbol(name)) {
+        DEBUG_PRINT("DEBUG: define: name must be symbol\n");
+        return obj_nil;
+    }
+    Object* value = eval_with_env(obj_car(obj_cdr(args)), env);
+    return evaluator_define(name, value);
+}
+
+// (set! name expr) - 既存の束縛（ローカル優先）を書き換える
+static Object* eval_set(Object* args, Object* env) {
+    Object* name = obj_car(args);
+    if (!is_symbol(name)) {
+        DEBUG_PRINT("DEBUG: set!: name must be symbol\n");
+        return obj_nil;
+    }
+    // クロージャ変換済みの参照はフレームのスロットを書き換える
+    if (name->data.symbol.slot) {
+        Object** slot = frame_slot(env, name->data.symbol.slot - 1);
+        if (slot) {
+            *slot = eval_with_env(obj_car(obj_cdr(args)), env);
+            return *slot;
+        }
+    }
+    Object* pair = env_find_binding(env, name->data.symbol.name, NULL);
+    if (!pair) {
+        DEBUG_PRINT("DEBUG: set!: unbound variable '%s'\n", name->data.symbol.name);
+        return obj_nil;
+    }
+    Object* value = eval_with_env(obj_car(obj_cdr(args)), env);
+    env_set(pair, value);
+    return value;
+}
+
+// (lambda (params...) body...)
+// フラットクロージャ: 生成時にローカル変数の値をフレームへコピーして捕捉する。
+// 自由変数の解析とスロット割り当ては各ラムダ式の初回評価時に一度だけ行い、
+// 捕捉する名前のリストを引数セルのキャッシュに保持する。
+static Object* eval_lambda(Object* args, Object* env) {
+    Object* params = obj_car(args);
+    Object* body   = obj_cdr(args);
+
+    if (!args->data.cons.cache) {
+        Object* names = obj_nil;
+        Object** tail = &names;
+        for (Object* it = closure_free_variables(params, body); is_cons(it); it = it->data.cons.cdr) {
+            Object* sym = it->data.cons.car;
+            if (!env_find_local(env, sym->data.symbol.name)) continue;  // グローバル参照
+            *tail = make_cons(sym, obj_nil);
+            if (!*tail) return obj_nil;
+            tail = &(*tail)->data.cons.cdr;
+        }
+        closure_assign_slots(params, names, body);
+        args->data.cons.cache = names;
+    }
+
+    Object* names = args->data.cons.cache;
+    Object* captured = NULL;
+    size_t count = 0;
+    for (Object* it = names; is_cons(it); it = it->data.cons.cdr) count++;
+    if (count > 0) {
+        captured = make_frame(count, names);
+        if (!captured) return obj_nil;
+        size_t i = 0;
+        for (Object* it = names; is_cons(it); it = it->data.cons.cdr, i++) {
+            Object** value = env_find_local(env, it->data.cons.car->data.symbol.name);
+            captured->data.frame.slots[i] = value ? *value : obj_nil;
+        }
+    }
+
+    Object* lambda = make_closure(params, body, captured);
+    return lambda ? lambda : obj_nil;
+}
+
+// (defmacro name (params...) body...) - 常にグローバル環境へ束縛する。
+// 本体は呼び出しの引数の式（評価前）を受け取り、呼び出しと置き換える式を返す
+static Object* eval_defmacro(Object* args, Object* env) {
+    (void)env;
+    Object* name = obj_car(args);
+    if (!is_symbol(name) || !is_cons(obj_cdr(args))) {
+        DEBUG_PRINT("DEBUG: defmacro: name must be symbol\n");
+        return obj_nil;
+    }
+    // 変換関数はグローバル環境で作る（展開結果が呼び出し位置に左右されないように）
+    Object* transformer = eval_lambda(obj_cdr(args), obj_nil);
+    if (!is_lambda(transformer)) return obj_nil;
+    Object* macro = make_macro(transformer);
+    if (!macro) return obj_nil;
+    return evaluator_define(name, macro);
+}
+
+// (macro-expansion original . expansion) - マクロ呼び出しを書き換えた形。
+// キャッシュした展開結果を評価する（マクロが再定義されていれば展開し直す）
+static Object* eval_expansion(Object* args, Object* env) {
+    return eval_with_env(macro_expansion(args), env);
+}
+
+// (loop (var init) condition update body...)
+// var を init で束縛し、condition が真の間 body を実行して var を update の値で更新する
+static Object* eval_loop(Object* args, Object* env) {
+    Object* binding = obj_car(args);
+    Object* var = obj_car(binding);
+    if (!is_symbol(var)) {
+        DEBUG_PRINT("DEBUG: loop: first argument must be (var init)\n");
+        return obj_nil;
+    }
+    Object* condition = obj_car(obj_cdr(args));
+    Object* update    = obj_car(obj_cdr(obj_cdr(args)));
+    Object* body      = obj_cdr(obj_cdr(obj_cdr(args)));
+
+    // 変数はループ全体で一度だけ束縛し、反復ごとに束縛の値を書き換える
+    Object* init = eval_with_env(obj_car(obj_cdr(binding)), env);
+    Object* scoped_env = env_push_scope(env, var->data.symbol.name, init);
+    if (!scoped_env) return obj_nil;
+    Object* slot = scoped_env->data.cons.car;
+
+    // 変数の値がどこにも保存されず、更新式が演算子の呼び出し（毎回新しい値を返す）なら、
+    // 前回の更新で作った値は置き換えた時点で不要なのですぐにプールへ返す
+    bool release = !closure_value_escapes(var->data.symbol.name, obj_cdr(args))
+                   && is_cons(update) && is_operator(obj_car(update));
+    bool owned = false;  // 束縛中の値が更新式の結果か（初期値は他から参照されうる）
+
+    Object* last_result = obj_nil;
+    while (is_truthy(eval_with_env(condition, scoped_env))) {
+        for (Object* it = body; is_cons(it); it = it->data.cons.cdr) {
+            last_result = eval_with_env(it->data.cons.car, scoped_env);
+        }
+        Object* next = eval_with_env(update, scoped_env);
+        if (owned && object_pool_is_valid(slot->data.cons.cdr)) object_pool_free(slot->data.cons.cdr);
+        slot->data.cons.cdr = next;
+        owned = release;
+        gc_safepoint();  // 反復で作った値を回収する（束縛と評価途中の値はCスタックから辿れる）
+    }
+    return last_result;
+}
 
 // dotimes引数パースのヘルパー関数
-static bool parse_dotimes_args(Object* args, const char** var_name, int* count, Object** expressions) {
+static bool parse_dotimes_args(Object* args, Object* env, const char** var_name, int64_t* count, Object** expressions) {
     // 基本構造チェック: (dotimes (var count) expr1 expr2 ...)
     if (!args || args->type != OBJ_CONS) {
         DEBUG_PRINT("DEBUG: dotimes: invalid arguments structure\n");
@@ -524,7 +1355,7 @@ static bool parse_dotimes_args(Object* args, const char** var_name, int* count,
         return false;
     }
 
-    Object* count_obj = eval(count_list->data.cons.car);
+    Object* count_obj = eval_with_env(count_list->data.cons.car, env);
     if (!count_obj || count_obj->type != OBJ_NUMBER) {
         DEBUG_PRINT("DEBUG: dotimes: count must evaluate to number\n");
         return false;
@@ -532,7 +1363,7 @@ static bool parse_dotimes_args(Object* args, const char** var_name, int* count,
 
     *count = count_obj->data.number;
     if (*count < 0) {
-        DEBUG_PRINT("DEBUG: dotimes: negative count not allowed: %d\n", *count);
+        DEBUG_PRINT("DEBUG: dotimes: negative count not allowed: %" PRId64 "\n", *count);
         return false;
     }
 
@@ -542,41 +1373,54 @@ static bool parse_dotimes_args(Object* args, const char** var_name, int* count,
 }
 
 // dotimesループ実行のヘルパー関数
-static Object* execute_dotimes_loop(const char* var_name, int count, Object* expressions) {
+// 変数はループ全体で一度だけ束縛し、反復ごとに束縛の値を書き換える。
+// 本体が変数を演算子の引数としてしか使わなければ、カウンタの箱も1つをその場で書き換える
+static Object* execute_dotimes_loop(const char* var_name, int64_t count, Object* expressions, Object* env) {
     Object* last_result = obj_nil;
 
-    DEBUG_PRINT("DEBUG: dotimes starting loop, count=%d, var=%s\n", count, var_name);
+    DEBUG_PRINT("DEBUG: dotimes starting loop, count=%" PRId64 ", var=%s\n", count, var_name);
 
-    // 0からcount-1まで実行（Common Lisp標準）
-    for (int i = 0; i < count; i++) {
-        DEBUG_PRINT("DEBUG: dotimes iteration %d\n", i);
+    bool reuse = !closure_value_escapes(var_name, expressions);
+    Object* counter = make_number(0);
+    Object* scoped_env = counter ? env_push_scope(env, var_name, counter) : NULL;
+    if (!scoped_env) return obj_nil;
+    Object* slot = scoped_env->data.cons.car;
 
-        // 新しいスコープを作成して変数をバインド
-        Object* scoped_env = env_push_scope(g_env, var_name, make_number(i));
+    // 0からcount-1まで実行（Common Lisp標準）
+    for (int64_t i = 0; i < count; i++) {
+        DEBUG_PRINT("DEBUG: dotimes iteration %" PRId64 "\n", i);
+
+        if (i > 0) {
+            if (reuse) {
+                counter->data.number = i;
+            } else {
+                counter = make_number(i);
+                if (!counter) return obj_nil;
+            }
+            slot->data.cons.cdr = counter;
+            gc_safepoint();  // 前の反復で作った値を回収する（束縛と評価途中の値はCスタックから辿れる）
+        }
 
         // 式を実行
         for (Object* it = expressions; it && it->type == OBJ_CONS; it = it->data.cons.cdr) {
-            DEBUG_PRINT("DEBUG: evaluating expression in iteration %d\n", i);
+            DEBUG_PRINT("DEBUG: evaluating expression in iteration %" PRId64 "\n", i);
             last_result = eval_with_env(it->data.cons.car, scoped_env);
         }
-
-        // スコープは自動的に破棄される（GCが回収）
     }
 
     DEBUG_PRINT("DEBUG: dotimes completed\n");
     return last_result;
 }
 
-static Object* eval_dotimes_special(Object* args) {
-    // (dotimes (var count) expr1 expr2 ...)
-    // Common Lisp標準形式：0からcount-1まで変数varをインクリメントしながら実行
-
+// (dotimes (var count) expr1 expr2 ...)
+// Common Lisp標準形式：0からcount-1まで変数varをインクリメントしながら実行
+static Object* eval_dotimes(Object* args, Object* env) {
     const char* var_name;
-    int count;
+    int64_t count;
     Object* expressions;
 
     // 引数をパース
-    if (!parse_dotimes_args(args, &var_name, &count, &expressions)) {
+    if (!parse_dotimes_args(args, env, &var_name, &count, &expressions)) {
         return obj_nil;
     }
 
@@ -587,16 +1431,12 @@ static Object* eval_dotimes_special(Object* args) {
     }
 
     // ループを実行
-    return execute_dotimes_loop(var_name, count, expressions);
-}
-
-static Object* builtin_dotimes(Object* args) {
-    // 通常の関数呼び出しの場合（引数は既に評価済み）
-    return eval_dotimes_special(args);
+    return execute_dotimes_loop(var_name, count, expressions, env);
 }
 
 // メモリ統計表示
 void evaluator_show_memory_stats(void) {
+    printer_flush();
     printf("\n=== Memory Statistics ===\n");
 
     // オブジェクトプールの統計
@@ -631,26 +1471,57 @@ void evaluator_show_memory_stats(void) {
         printf("  Avg per collection: %.1f objects\n", avg_collected);
     }
 
+    // メモ化関数の統計
+    const MemoStats* memo = memo_total_stats();
+    printf("\nMemoization:\n");
+    printf("  Hits:      %zu\n", memo->hits);
+    printf("  Misses:    %zu\n", memo->misses);
+    printf("  Evictions: %zu\n", memo->evictions);
+
+    printf("\nMacros:\n");
+    printf("  Expansions: %zu\n", macro_expansion_count());
+
     printf("========================\n\n");
 }
 
 // 公開関数: 文字列入力をパースして評価
 Object* eval_string(const char* src) {
-    gc_add_root(&g_env);
     Object* ast = parse(src);
     if (!ast) {
         DEBUG_PRINT("DEBUG: parse() returned NULL\n");
-        gc_remove_root(&g_env);
         return obj_nil;
     }
+    return eval_form(ast);
+}
+
+// 公開関数: パース済みの式を評価（マクロ展開・最適化・VM/構文木評価の後にGCを1回走らせる）
+static int form_depth = 0;   // eval_form の入れ子の深さ
+
+Object* eval_form(Object* ast) {
+    // ループの安全点での回収は、ここから下の C スタックにある評価途中の値も生きているとみなす
+    char stack_base;
+    if (form_depth++ == 0) gc_set_stack_base(&stack_base);
+    gc_add_root(&g_env);
     if (debug_mode) {
+        char where[256];
+        if (srcloc_format(ast, where, sizeof(where)) > 0) printf("DEBUG: %s\n", where);
         printf("DEBUG: parsed AST: ");
         object_dump(ast);
         printf("\n");
     }
 
     gc_add_root(&ast);
-    Object* result = eval(ast);
+    ast = macro_expand_all(ast);
+    ast = optimize(ast);
+    // バイトコードにできる式はVMで、それ以外は構文木のまま評価する
+    Object* result;
+    VmCode* code = vm_compile(ast);
+    if (code) {
+        result = vm_execute(code);
+        vm_free(code);
+    } else {
+        result = eval(ast);
+    }
     if (debug_mode) {
         printf("DEBUG: eval result: ");
         if (result) {
@@ -667,9 +1538,215 @@ Object* eval_string(const char* src) {
     gc_remove_root(&result);
     gc_remove_root(&ast);
     gc_remove_root(&g_env);
+    if (--form_depth == 0) {
+        gc_set_stack_base(NULL);
+        printer_flush();   // トップレベルの式ごとに出力を書き出す（パイプでも終了まで待たせない）
+    }
     return result ? result : obj_nil;
 }
 
+// パイプなど mmap できない入力はリーダーで式ごとに読み込んで評価する
+static bool eval_stream(int fd) {
+    Reader reader;
+    reader_init_fd(&reader, fd);
+    const char* form;
+    while ((form = reader_next(&reader)) != NULL) {
+        eval_string(form);
+    }
+    reader_free(&reader);
+    return true;
+}
+
+// 通常のファイルを読み取り専用で mmap して *text と *size に入れる（空なら *text は NULL）。
+// 通常のファイルでなければ開いた記述子を *fd に残す（それ以外では *fd は -1）。
+// 開けない・対応付けられなければ false
+static bool map_file(const char* path, const char** text, size_t* size, int* fd) {
+    *text = NULL;
+    *size = 0;
+    *fd = open(path, O_RDONLY);
+    if (*fd < 0) return false;
+    struct stat st;
+    if (fstat(*fd, &st) < 0 || !S_ISREG(st.st_mode)) return true;
+
+    bool ok = true;
+    if ((uint64_t)st.st_size > UINT32_MAX) {
+        // トークンの位置は32bitなので、それより大きいファイルは読まない
+        errno = EFBIG;
+        ok = false;
+    } else if (st.st_size > 0) {
+        void* mapped = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, *fd, 0);
+        if (mapped == MAP_FAILED) {
+            ok = false;
+        } else {
+            *text = mapped;
+            *size = (size_t)st.st_size;
+        }
+    }
+    close(*fd);  // 対応付けはファイルを閉じても残る
+    *fd = -1;
+    return ok;
+}
+
+// ソースに対応する FASL キャッシュがあれば、それを読んで評価する。使えなければ false
+static bool eval_cached(const char* cache, const char* source, size_t length, uint16_t file) {
+    const char* data;
+    size_t size;
+    int fd;
+    bool mapped = map_file(cache, &data, &size, &fd);
+    if (fd >= 0) close(fd);
+    if (!mapped || !data) return false;
+    FaslReader reader;
+    if (!fasl_reader_open(&reader, data, size, source, length)) {
+        munmap((void*)data, size);
+        return false;
+    }
+    reader.file = file;
+    Object* ast;
+    while ((ast = fasl_next(&reader)) != NULL) {
+        eval_form(ast);
+    }
+    if (reader.error) fprintf(stderr, "%s: broken cache\n", cache);
+    munmap((void*)data, size);
+    return true;
+}
+
+// 公開関数: スクリプトファイルを読み取り専用で mmap し、コピーせずにその場で1式ずつパースして評価する。
+// 構文木は式ごとに作って評価後のGCで回収するので、ファイル全体の構文木は持たない。
+// パースした式はソースの隣の FASL キャッシュ（"<path>.fasl"）にも書き出し、
+// 次回からは内容が同じならパースせずにキャッシュから読む
+bool eval_file(const char* path) {
+    const char* text;
+    size_t size;
+    int fd;
+    if (!map_file(path, &text, &size, &fd)) {
+        perror(path);
+        return false;
+    }
+    if (fd >= 0) {
+        bool ok = eval_stream(fd);
+        close(fd);
+        return ok;
+    }
+    if (!text) return true;  // 空のファイル
+    madvise((void*)text, size, MADV_SEQUENTIAL);
+
+    uint16_t file = srcloc_file(path);
+    char* cache = fasl_cache_path(path);
+    if (cache && eval_cached(cache, text, size, file)) {
+        free(cache);
+        munmap((void*)text, size);
+        return true;
+    }
+
+    FaslWriter writer;
+    fasl_writer_init(&writer, text, size);
+    Lexer lexer;
+    lexer_init_len(&lexer, text, size);
+    lexer.file = file;
+    Object* ast;
+    while ((ast = parse_next(&lexer)) != NULL) {
+        // マクロ展開で書き換えられる前に書き出す
+        fasl_write_form(&writer, ast);
+        eval_form(ast);
+    }
+    bool ok = !lexer.error && !lexer.exhausted;
+    if (ok && cache) fasl_writer_save(&writer, cache);
+    fasl_writer_free(&writer);
+    free(cache);
+    munmap((void*)text, size);
+    if (lexer.error) fprintf(stderr, "%s: unterminated string literal\n", path);
+    if (lexer.exhausted) fprintf(stderr, "%s: memory exhausted while parsing\n", path);
+    return ok;
+}
+
+// バイトコードVM用: 環境バージョン（グローバル束縛のキャッシュ検証に使う）
+uint32_t evaluator_env_version(void) {
+    return g_env_version;
+}
+
+// グローバル環境への define。既存の束縛は上書きし、alistが伸び続けないようにする
+Object* evaluator_define(Object* name, Object* value) {
+    for (Object* it = g_env; is_cons(it); it = it->data.cons.cdr) {
+        Object* pair = it->data.cons.car;
+        if (is_cons(pair) && strcmp(obj_symbol_name(pair->data.cons.car), name->data.symbol.name) == 0) {
+            env_set(pair, value);
+            return obj_void;
+        }
+    }
+    env_bind(&g_env, name->data.symbol.name, value);
+    return obj_void;
+}
+
+// バイトコードVM用: グローバル束縛への set!（未束縛なら nil）
+Object* evaluator_set_global(Object* name, Object* value) {
+    Object* pair = env_find_binding(g_env, name->data.symbol.name, NULL);
+    if (!pair) {
+        DEBUG_PRINT("DEBUG: set!: unbound variable '%s'\n", name->data.symbol.name);
+        return obj_nil;
+    }
+    env_set(pair, value);
+    return value;
+}
+
+// バイトコードVM用: 評価済みの引数リストで関数を呼び出す
+Object* evaluator_apply(Object* func, Object* args) {
+    if (!func) return obj_nil;
+    func = normalize_callee(func);
+    if (func->type == OBJ_FUNCTION && func->data.function.native_func) {
+        if (!arity_ok(func, list_length(args))) return obj_nil;
+        return func->data.function.native_func(args);
+    }
+    if (func->type == OBJ_LAMBDA) {
+        return apply_lambda(func, args);
+    }
+    if (func->type == OBJ_MEMO) {
+        return apply_memo(func, args);
+    }
+    return obj_nil;
+}
+
+// バイトコードVM用: コンパイルできない式を構文木のまま評価する（ローカル環境なし）
+Object* evaluator_eval(Object* expr) {
+    return eval(expr);
+}
+
+// 最適化パス用: 演算子/組み込み関数オブジェクトをネイティブ関数オブジェクトへ
+Object* evaluator_native_callee(Object* callee) {
+    return callee ? normalize_callee(callee) : NULL;
+}
+
+// 最適化パス用: グローバル束縛の値（未束縛ならNULL）
+Object* evaluator_global_value(const char* name) {
+    return env_lookup(g_env, name);
+}
+
+// バイトコードVM用: グローバル束縛のセル (sym . value)（未束縛ならNULL）
+Object* evaluator_global_binding(const char* name) {
+    return env_find_binding(g_env, name, NULL);
+}
+
+Object* evaluator_fixed_callee(Object* value) {
+    if (value >= OPERATOR_FUNC(0) && value < OPERATOR_FUNC(OP_COUNT)) {
+        return get_operator((OperatorType)(value - OPERATOR_FUNC(0)));
+    }
+    if (value >= BUILTIN_FUNC(0) && value < BUILTIN_FUNC(BUILTIN_COUNT)) {
+        return get_builtin((BuiltinType)(value - BUILTIN_FUNC(0)));
+    }
+    return NULL;
+}
+
+const BuiltinSpec* evaluator_callee_spec(Object* callee) {
+    if (!callee) return NULL;
+    callee = normalize_callee(callee);
+    return callee->type == OBJ_FUNCTION ? callee->data.function.spec : NULL;
+}
+
+bool evaluator_arity_ok(Object* callee, size_t argc) {
+    if (!callee) return false;
+    callee = normalize_callee(callee);
+    return callee->type != OBJ_FUNCTION || arity_ok(callee, argc);
+}
+
 // 初期化/終了
 void evaluator_init(void) {
     // オブジェクトシステム全体を初期化
@@ -681,37 +1758,31 @@ void evaluator_init(void) {
     gc_add_root(&g_env);    // ビルトイン登録
     DEBUG_PRINT("DEBUG: Registering builtin functions\n");
 
-    env_bind(&g_env, "+", make_function(builtin_plus));
-    env_bind(&g_env, "*", make_function(builtin_mul));
-    env_bind(&g_env, "-", make_function(builtin_minus));
-    env_bind(&g_env, "/", make_function(builtin_div));
-
-    // 比較演算子の登録
-    env_bind(&g_env, "=", make_function(builtin_eq));
-    env_bind(&g_env, "<", make_function(builtin_lt));
-    env_bind(&g_env, ">", make_function(builtin_gt));
-    env_bind(&g_env, "<=", make_function(builtin_lte));
-    env_bind(&g_env, ">=", make_function(builtin_gte));
-    env_bind(&g_env, "print", make_function(builtin_print));
-    env_bind(&g_env, "println", make_function(builtin_println));
-    env_bind(&g_env, "str", make_function(builtin_str));
-    env_bind(&g_env, "length", make_function(builtin_length));
-    env_bind(&g_env, "bool?", make_function(builtin_boolp));
-
-    // タイマー関数の登録
-    env_bind(&g_env, "now", make_function(builtin_now));
-    env_bind(&g_env, "sleep", make_function(builtin_sleep));
-    env_bind(&g_env, "time-diff", make_function(builtin_time_diff));
-
-    // ループ制御関数の登録
-    env_bind(&g_env, "dotimes", make_function(builtin_dotimes));
+    // 登録表の演算子・組み込み関数をすべて束縛する
+    for (int i = 0; i < OP_COUNT; i++) {
+        env_bind(&g_env, operator_specs[i].name, OPERATOR_FUNC(i));
+    }
+    for (int i = 0; i < BUILTIN_COUNT; i++) {
+        env_bind(&g_env, builtin_specs[i].name, BUILTIN_FUNC(i));
+    }
 
     gc_remove_root(&g_env);
 }
 
+Object* evaluator_global_env(void) {
+    return g_env;
+}
+
+void evaluator_restore(Object* env, uint32_t env_version) {
+    g_env = env;
+    g_env_version = env_version;
+}
+
 // デバッグモード設定
 void evaluator_set_debug(bool enable) {
     debug_mode = enable;
+    // デバッグ出力（printf）と print の出力の順序が入れ替わらないよう、行ごとに書き出す
+    if (enable) printer_set_mode(PRINTER_LINE);
 }
 
 void evaluator_shutdown(void) {
@@ -5,6 +5,7 @@
 #define EVAL_H
 
 #include "object.h"
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -14,6 +15,11 @@ extern "C" {
 void evaluator_init(void);
 void evaluator_shutdown(void);
 
+// イメージの保存・復元用: グローバル環境（環境バージョンは evaluator_env_version）
+Object* evaluator_global_env(void);
+// 復元したグローバル環境に差し替える（evaluator_init の代わりに使う）
+void evaluator_restore(Object* env, uint32_t env_version);
+
 // デバッグモード制御
 void evaluator_set_debug(bool enable);
 
@@ -22,6 +28,35 @@ void evaluator_show_memory_stats(void);
 
 // 文字列のS式を評価して結果のObjectを返す
 Object* eval_string(const char* src);
+// パース済みの式を評価して結果のObjectを返す（式はこの呼び出しの間だけGCから守られる）
+Object* eval_form(Object* ast);
+// スクリプトファイルのトップレベルの式を先頭から順に評価する。読めなければ false
+bool eval_file(const char* path);
+
+// バイトコードVM用: 環境バージョン（束縛が変わるたびに進む）
+uint32_t evaluator_env_version(void);
+// バイトコードVM用: グローバル環境への define（obj_void を返す）
+Object* evaluator_define(Object* name, Object* value);
+// バイトコードVM用: グローバル束縛への set!（未束縛なら nil を返す）
+Object* evaluator_set_global(Object* name, Object* value);
+// バイトコードVM用: 評価済みの引数リストで関数を呼び出す
+Object* evaluator_apply(Object* func, Object* args);
+// バイトコードVM用: 構文木のまま評価する（ローカル環境なし）
+Object* evaluator_eval(Object* expr);
+
+// 最適化パス用: 演算子/組み込み関数オブジェクトに対応するネイティブ関数オブジェクト
+Object* evaluator_native_callee(Object* callee);
+// 最適化パス用: グローバル束縛の値（未束縛ならNULL）
+Object* evaluator_global_value(const char* name);
+// バイトコードVM用: グローバル束縛のセル (sym . value)。set! はセルの値を書き換えるだけなので、
+// 新しい束縛ができる（環境バージョンが変わる）まで同じセルを使い続けられる（未束縛ならNULL）
+Object* evaluator_global_binding(const char* name);
+// 最適化パス用: ネイティブ関数オブジェクトに対応する演算子/組み込み関数の定数オブジェクト（なければNULL）
+Object* evaluator_fixed_callee(Object* value);
+// 呼び出し先の登録情報（登録表の演算子・組み込み関数でなければNULL）
+const BuiltinSpec* evaluator_callee_spec(Object* callee);
+// 呼び出し先が argc 個の引数を受け付けるか（登録表にない関数は常に true）
+bool evaluator_arity_ok(Object* callee, size_t argc);
 
 #ifdef __cplusplus
 }
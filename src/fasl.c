@@ -0,0 +1,469 @@
+// fasl.c
+// FASL 形式の書き出しと読み込みの実装。
+//
+// ファイルの並び: ヘッダ / シンボル表（(位置, 長さ) の u32 の組）/ シンボル名 / 式の列
+// 式はタグ1バイトに続けて中身を置く。整数・長さ・添字は可変長（LEB128）で書く。
+// 読み込みは mmap した領域をそのまま読み、シンボル名や文字列は領域から直接オブジェクトにする。
+
+#include "fasl.h"
+#include "chibi_lisp.h"
+#include "bignum.h"
+#include "srcloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FASL_MAGIC      "CHIFASL"
+#define FASL_BYTE_ORDER 0x01020304u  // 書いた環境とバイト順が違えば使わない
+#define FASL_MAX_DEPTH  1024         // 入れ子の上限（パーサの上限より十分大きい）
+
+typedef struct {
+    char     magic[8];
+    uint32_t format;
+    uint32_t byte_order;
+    char     version[16];      // CHIBI_LISP_VERSION
+    uint64_t source_hash;
+    uint64_t source_length;
+    uint64_t payload_hash;     // ヘッダより後ろ全体のハッシュ（壊れたファイルを読まないため）
+    uint32_t symbol_count;
+    uint32_t names_length;
+    uint32_t code_length;
+    uint32_t form_count;
+} FaslHeader;
+
+typedef enum {
+    FASL_NIL = 0,
+    FASL_TRUE,
+    FASL_INT,       // zigzag 符号化した可変長整数
+    FASL_FLOAT,     // double の8バイト
+    FASL_BIGNUM,    // 符号1バイト, limb 数, limb（u32）
+    FASL_STRING,    // 長さ, バイト列
+    FASL_SYMBOL,    // シンボル表の添字
+    FASL_SPECIAL,   // 特殊形式の番号1バイト
+    FASL_CALLEE,    // 演算子・組み込み関数（名前をシンボル表の添字で）
+    FASL_LIST,      // 要素数, 行, 桁（位置がなければ 0）, 要素, 末尾（真リストなら FASL_NIL）
+} FaslTag;
+
+//------------------------------------------
+// ハッシュ
+//------------------------------------------
+
+static uint64_t hash_update(uint64_t h, const void* data, size_t length) {
+    const uint8_t* p = data;
+    for (size_t i = 0; i < length; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+#define HASH_INIT 0xcbf29ce484222325ull
+
+uint64_t fasl_hash(const void* data, size_t length) {
+    return hash_update(HASH_INIT, data, length);
+}
+
+//------------------------------------------
+// 書き出し
+//------------------------------------------
+
+void fasl_writer_init(FaslWriter* writer, const char* source, size_t length) {
+    memset(writer, 0, sizeof(FaslWriter));
+    writer->source_hash   = fasl_hash(source, length);
+    writer->source_length = length;
+}
+
+void fasl_writer_free(FaslWriter* writer) {
+    free(writer->code);
+    free(writer->names);
+    free(writer->symbols);
+    free(writer->index);
+    memset(writer, 0, sizeof(FaslWriter));
+}
+
+// *buf に extra バイト足せるようにする（倍々で伸ばす）
+static bool grow(FaslWriter* writer, void** buf, size_t* capacity, size_t length, size_t extra) {
+    if (length + extra <= *capacity) return true;
+    size_t cap = *capacity ? *capacity : 256;
+    while (cap < length + extra) cap *= 2;
+    void* grown = realloc(*buf, cap);
+    if (!grown) {
+        writer->failed = true;
+        return false;
+    }
+    *buf = grown;
+    *capacity = cap;
+    return true;
+}
+
+static void emit_bytes(FaslWriter* writer, const void* data, size_t length) {
+    if (!grow(writer, (void**)&writer->code, &writer->code_capacity, writer->code_length, length)) return;
+    memcpy(writer->code + writer->code_length, data, length);
+    writer->code_length += length;
+}
+
+static void emit_byte(FaslWriter* writer, uint8_t byte) {
+    emit_bytes(writer, &byte, 1);
+}
+
+static void emit_varint(FaslWriter* writer, uint64_t value) {
+    uint8_t buf[10];
+    size_t n = 0;
+    do {
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        buf[n++] = value ? (byte | 0x80) : byte;
+    } while (value);
+    emit_bytes(writer, buf, n);
+}
+
+// 開番地法の表を作り直す（要素数の2倍以上の2のべき乗）
+static bool rehash(FaslWriter* writer, uint32_t capacity) {
+    uint32_t* index = calloc(capacity, sizeof(uint32_t));
+    if (!index) {
+        writer->failed = true;
+        return false;
+    }
+    for (uint32_t s = 0; s < writer->symbol_count; s++) {
+        const char* name = writer->names + writer->symbols[2 * s];
+        uint32_t slot = (uint32_t)fasl_hash(name, writer->symbols[2 * s + 1]) & (capacity - 1);
+        while (index[slot]) slot = (slot + 1) & (capacity - 1);
+        index[slot] = s + 1;
+    }
+    free(writer->index);
+    writer->index = index;
+    writer->index_capacity = capacity;
+    return true;
+}
+
+// シンボル名を表に入れて添字を返す（同じ名前は同じ添字）。失敗したら UINT32_MAX
+static uint32_t intern(FaslWriter* writer, const char* name, size_t length) {
+    if ((writer->symbol_count + 1) * 2 > writer->index_capacity) {
+        if (!rehash(writer, writer->index_capacity ? writer->index_capacity * 2 : 64)) return UINT32_MAX;
+    }
+    uint32_t mask = writer->index_capacity - 1;
+    uint32_t slot = (uint32_t)fasl_hash(name, length) & mask;
+    for (; writer->index[slot]; slot = (slot + 1) & mask) {
+        uint32_t s = writer->index[slot] - 1;
+        if (writer->symbols[2 * s + 1] == length && memcmp(writer->names + writer->symbols[2 * s], name, length) == 0) {
+            return s;
+        }
+    }
+
+    if (writer->symbol_count == writer->symbol_capacity) {
+        uint32_t cap = writer->symbol_capacity ? writer->symbol_capacity * 2 : 64;
+        uint32_t* grown = realloc(writer->symbols, sizeof(uint32_t) * 2 * cap);
+        if (!grown) {
+            writer->failed = true;
+            return UINT32_MAX;
+        }
+        writer->symbols = grown;
+        writer->symbol_capacity = cap;
+    }
+    if (!grow(writer, (void**)&writer->names, &writer->names_capacity, writer->names_length, length)) return UINT32_MAX;
+    memcpy(writer->names + writer->names_length, name, length);
+    uint32_t s = writer->symbol_count++;
+    writer->symbols[2 * s]     = (uint32_t)writer->names_length;
+    writer->symbols[2 * s + 1] = (uint32_t)length;
+    writer->names_length += length;
+    writer->index[slot] = s + 1;
+    return s;
+}
+
+static void emit_name(FaslWriter* writer, FaslTag tag, const char* name) {
+    uint32_t s = intern(writer, name, strlen(name));
+    if (s == UINT32_MAX) return;
+    emit_byte(writer, tag);
+    emit_varint(writer, s);
+}
+
+static void encode(FaslWriter* writer, Object* obj, int depth) {
+    if (writer->failed) return;
+    if (!obj || depth > FASL_MAX_DEPTH) {
+        writer->failed = true;
+        return;
+    }
+    switch (obj->type) {
+        case OBJ_NIL:
+            emit_byte(writer, FASL_NIL);
+            break;
+        case OBJ_BOOL:
+            emit_byte(writer, obj->data.number ? FASL_TRUE : FASL_NIL);
+            break;
+        case OBJ_NUMBER: {
+            uint64_t v = (uint64_t)obj->data.number;
+            emit_byte(writer, FASL_INT);
+            emit_varint(writer, (v << 1) ^ (uint64_t)(obj->data.number >> 63));
+            break;
+        }
+        case OBJ_FLOAT:
+            emit_byte(writer, FASL_FLOAT);
+            emit_bytes(writer, &obj->data.real, sizeof(double));
+            break;
+        case OBJ_BIGNUM:
+            emit_byte(writer, FASL_BIGNUM);
+            emit_byte(writer, obj->data.bignum.negative ? 1 : 0);
+            emit_varint(writer, obj->data.bignum.count);
+            emit_bytes(writer, obj->data.bignum.limbs, sizeof(uint32_t) * obj->data.bignum.count);
+            break;
+        case OBJ_STRING:
+            emit_byte(writer, FASL_STRING);
+            emit_varint(writer, obj->data.string.length);
+            emit_bytes(writer, obj->data.string.text, obj->data.string.length);
+            break;
+        case OBJ_SYMBOL: {
+            SpecialFormType special = obj_special_form(obj);
+            if (special != SF_NONE) {
+                emit_byte(writer, FASL_SPECIAL);
+                emit_byte(writer, (uint8_t)special);
+            } else {
+                emit_name(writer, FASL_SYMBOL, obj->data.symbol.name);
+            }
+            break;
+        }
+        case OBJ_OPERATOR:
+            emit_name(writer, FASL_CALLEE, obj_operator_name(obj));
+            break;
+        case OBJ_BUILTIN:
+            emit_name(writer, FASL_CALLEE, obj_builtin_name(obj));
+            break;
+        case OBJ_CONS: {
+            size_t count = 0;
+            Object* it = obj;
+            for (; it && it->type == OBJ_CONS; it = it->data.cons.cdr) count++;
+            emit_byte(writer, FASL_LIST);
+            emit_varint(writer, count);
+            SrcLoc loc = {0, 0, 0};
+            srcloc_get(obj, &loc);
+            emit_varint(writer, loc.line);
+            emit_varint(writer, loc.column);
+            for (it = obj; it && it->type == OBJ_CONS; it = it->data.cons.cdr) {
+                encode(writer, it->data.cons.car, depth + 1);
+            }
+            encode(writer, it, depth + 1);
+            break;
+        }
+        default:
+            // パーサが作らない種類（クロージャ・ベクタなど）は書き出さない
+            writer->failed = true;
+            break;
+    }
+}
+
+bool fasl_write_form(FaslWriter* writer, Object* form) {
+    encode(writer, form, 0);
+    if (writer->failed) return false;
+    writer->form_count++;
+    return true;
+}
+
+bool fasl_writer_save(FaslWriter* writer, const char* path) {
+    if (writer->failed || writer->code_length > UINT32_MAX || writer->names_length > UINT32_MAX) return false;
+
+    FaslHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FASL_MAGIC, sizeof(FASL_MAGIC));
+    header.format        = FASL_FORMAT;
+    header.byte_order    = FASL_BYTE_ORDER;
+    strncpy(header.version, CHIBI_LISP_VERSION, sizeof(header.version) - 1);
+    header.source_hash   = writer->source_hash;
+    header.source_length = writer->source_length;
+    header.symbol_count  = writer->symbol_count;
+    header.names_length  = (uint32_t)writer->names_length;
+    header.code_length   = (uint32_t)writer->code_length;
+    header.form_count    = writer->form_count;
+    size_t symbols_size  = sizeof(uint32_t) * 2 * writer->symbol_count;
+    uint64_t h = hash_update(HASH_INIT, writer->symbols, symbols_size);
+    h = hash_update(h, writer->names, writer->names_length);
+    header.payload_hash  = hash_update(h, writer->code, writer->code_length);
+
+    // 書きかけのファイルを読まれないよう、一時ファイルに書いてから置き換える
+    size_t length = strlen(path);
+    char* temp = malloc(length + 32);
+    if (!temp) return false;
+    snprintf(temp, length + 32, "%s.%ld.tmp", path, (long)getpid());
+    FILE* file = fopen(temp, "wb");
+    if (!file) {
+        free(temp);
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              (symbols_size == 0 || fwrite(writer->symbols, symbols_size, 1, file) == 1) &&
+              (writer->names_length == 0 || fwrite(writer->names, writer->names_length, 1, file) == 1) &&
+              (writer->code_length == 0 || fwrite(writer->code, writer->code_length, 1, file) == 1);
+    ok = (fclose(file) == 0) && ok;
+    if (ok) ok = rename(temp, path) == 0;
+    if (!ok) remove(temp);
+    free(temp);
+    return ok;
+}
+
+//------------------------------------------
+// 読み込み
+//------------------------------------------
+
+bool fasl_reader_open(FaslReader* reader, const void* data, size_t size, const char* source, size_t length) {
+    memset(reader, 0, sizeof(FaslReader));
+    FaslHeader header;
+    if (size < sizeof(header)) return false;
+    memcpy(&header, data, sizeof(header));
+    char version[sizeof(header.version)] = {0};
+    strncpy(version, CHIBI_LISP_VERSION, sizeof(version) - 1);
+    if (memcmp(header.magic, FASL_MAGIC, sizeof(FASL_MAGIC)) != 0 ||
+        header.format != FASL_FORMAT || header.byte_order != FASL_BYTE_ORDER ||
+        memcmp(header.version, version, sizeof(version)) != 0) {
+        return false;
+    }
+    size_t symbols_size = sizeof(uint32_t) * 2 * (size_t)header.symbol_count;
+    if (size - sizeof(header) != symbols_size + header.names_length + header.code_length) return false;
+    if (header.source_length != length || header.source_hash != fasl_hash(source, length)) return false;
+
+    const uint8_t* payload = (const uint8_t*)data + sizeof(header);
+    if (fasl_hash(payload, size - sizeof(header)) != header.payload_hash) return false;
+
+    reader->data         = data;
+    reader->size         = size;
+    reader->symbols      = payload;
+    reader->names        = (const char*)payload + symbols_size;
+    reader->symbol_count = header.symbol_count;
+    reader->names_length = header.names_length;
+    reader->cursor       = payload + symbols_size + header.names_length;
+    reader->code_end     = reader->cursor + header.code_length;
+    reader->forms_left   = header.form_count;
+    return true;
+}
+
+static bool read_byte(FaslReader* reader, uint8_t* byte) {
+    if (reader->cursor >= reader->code_end) return false;
+    *byte = *reader->cursor++;
+    return true;
+}
+
+static bool read_varint(FaslReader* reader, uint64_t* value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        uint8_t byte;
+        if (!read_byte(reader, &byte)) return false;
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+// count 個の要素がまだ残りに収まりうるか（壊れた長さで大きなループや読み過ぎをしない）
+static bool has_bytes(FaslReader* reader, uint64_t count) {
+    return count <= (uint64_t)(reader->code_end - reader->cursor);
+}
+
+// シンボル表の s 番目の名前
+static bool read_name(FaslReader* reader, const char** name, uint32_t* length) {
+    uint64_t s;
+    if (!read_varint(reader, &s) || s >= reader->symbol_count) return false;
+    uint32_t entry[2];
+    memcpy(entry, reader->symbols + sizeof(entry) * s, sizeof(entry));
+    if ((uint64_t)entry[0] + entry[1] > reader->names_length) return false;
+    *name = reader->names + entry[0];
+    *length = entry[1];
+    return true;
+}
+
+static Object* decode(FaslReader* reader, int depth) {
+    uint8_t tag;
+    if (depth > FASL_MAX_DEPTH || !read_byte(reader, &tag)) return NULL;
+    switch (tag) {
+        case FASL_NIL:  return obj_nil;
+        case FASL_TRUE: return obj_true;
+        case FASL_INT: {
+            uint64_t v;
+            if (!read_varint(reader, &v)) return NULL;
+            return make_number((int64_t)((v >> 1) ^ (0 - (v & 1))));
+        }
+        case FASL_FLOAT: {
+            double real;
+            if (!has_bytes(reader, sizeof(real))) return NULL;
+            memcpy(&real, reader->cursor, sizeof(real));
+            reader->cursor += sizeof(real);
+            return make_float(real);
+        }
+        case FASL_BIGNUM: {
+            uint8_t negative;
+            uint64_t count;
+            uint32_t limbs[BIGNUM_MAX_LIMBS];
+            if (!read_byte(reader, &negative) || !read_varint(reader, &count)) return NULL;
+            if (count == 0 || count > BIGNUM_MAX_LIMBS || !has_bytes(reader, sizeof(uint32_t) * count)) return NULL;
+            memcpy(limbs, reader->cursor, sizeof(uint32_t) * count);
+            reader->cursor += sizeof(uint32_t) * count;
+            return make_bignum(limbs, (size_t)count, negative != 0);
+        }
+        case FASL_STRING: {
+            uint64_t length;
+            if (!read_varint(reader, &length) || !has_bytes(reader, length)) return NULL;
+            Object* str = make_string_len((const char*)reader->cursor, (size_t)length);
+            reader->cursor += length;
+            return str;
+        }
+        case FASL_SYMBOL: {
+            const char* name;
+            uint32_t length;
+            if (!read_name(reader, &name, &length)) return NULL;
+            return make_symbol_len(name, length);
+        }
+        case FASL_SPECIAL: {
+            uint8_t special;
+            if (!read_byte(reader, &special) || special == SF_NONE || special >= SF_EXPANSION) return NULL;
+            return get_special_symbol((SpecialFormType)special);
+        }
+        case FASL_CALLEE: {
+            const char* name;
+            uint32_t length;
+            if (!read_name(reader, &name, &length)) return NULL;
+            Object* callee = get_fixed_callee_len(name, length);
+            return callee ? callee : make_symbol_len(name, length);
+        }
+        case FASL_LIST: {
+            uint64_t count, line, column;
+            if (!read_varint(reader, &count) || !has_bytes(reader, count)) return NULL;
+            if (!read_varint(reader, &line) || !read_varint(reader, &column)) return NULL;
+            Object* head = obj_nil;
+            Object** tail = &head;
+            for (uint64_t i = 0; i < count; i++) {
+                Object* item = decode(reader, depth + 1);
+                Object* cell = item ? make_cons(item, obj_nil) : NULL;
+                if (!cell) return NULL;
+                *tail = cell;
+                tail = &cell->data.cons.cdr;
+            }
+            Object* rest = decode(reader, depth + 1);
+            if (!rest) return NULL;
+            *tail = rest;
+            if (line > 0 && line <= UINT32_MAX) srcloc_set(head, reader->file, (uint32_t)line, (uint32_t)column);
+            return head;
+        }
+        default:
+            return NULL;
+    }
+}
+
+Object* fasl_next(FaslReader* reader) {
+    if (reader->error || reader->forms_left == 0) return NULL;
+    Object* form = decode(reader, 0);
+    if (!form) {
+        reader->error = true;
+        return NULL;
+    }
+    reader->forms_left--;
+    return form;
+}
+
+char* fasl_cache_path(const char* source_path) {
+    size_t length = strlen(source_path);
+    char* path = malloc(length + sizeof(FASL_SUFFIX));
+    if (!path) return NULL;
+    memcpy(path, source_path, length);
+    memcpy(path + length, FASL_SUFFIX, sizeof(FASL_SUFFIX));
+    return path;
+}
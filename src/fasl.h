@@ -0,0 +1,71 @@
+// fasl.h
+// パース済みの式をバイナリ形式（FASL）に書き出し、読み戻す。
+// シンボル名は表に1回だけ置いて添字で参照し、リテラルは種類のタグ付きで、
+// リストは要素数・ソース上の位置・要素を並べる（ポインタを含まないので、どこに読み込んでもそのまま使える）。
+// ファイルはソースの内容のハッシュと処理系のバージョンを持ち、どちらかが違えば使わない。
+
+#ifndef FASL_H
+#define FASL_H
+
+#include "object.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define FASL_FORMAT 2         // 形式を変えたら上げる
+#define FASL_SUFFIX ".fasl"   // ソースファイルの隣に置くキャッシュの拡張子
+
+// 書き出し: 式を1つずつ符号化してため、最後にファイルへ書く
+typedef struct {
+    uint64_t source_hash;
+    uint64_t source_length;
+    uint8_t* code;            // 式の列（malloc）
+    size_t   code_length;
+    size_t   code_capacity;
+    char*    names;           // シンボル名を並べた領域（malloc）
+    size_t   names_length;
+    size_t   names_capacity;
+    uint32_t* symbols;        // シンボルごとの (names 内の位置, 長さ)（malloc）
+    uint32_t symbol_count;
+    uint32_t symbol_capacity;
+    uint32_t* index;          // シンボル名 → 添字+1 の開番地法の表（0 は空き）
+    uint32_t index_capacity;
+    uint32_t form_count;
+    bool     failed;          // 符号化できない式があった・確保に失敗した
+} FaslWriter;
+
+// 読み込み: 読み込んだ（mmap した）ファイルの中身から式を1つずつ作る
+typedef struct {
+    const uint8_t* data;
+    size_t   size;
+    const uint8_t* cursor;
+    const uint8_t* code_end;
+    const uint8_t* symbols;   // (位置, 長さ) の表（ファイル内。整列していないことがある）
+    const char*    names;
+    uint32_t symbol_count;
+    uint32_t names_length;
+    uint32_t forms_left;
+    uint16_t file;            // 読み込んだリストの位置を記録するファイル番号（srcloc_file）
+    bool     error;           // 壊れたデータで止まった
+} FaslReader;
+
+// ソースの内容のハッシュ（FNV-1a 64bit）
+uint64_t fasl_hash(const void* data, size_t length);
+
+// source はキャッシュを照合するためのソースの内容
+void fasl_writer_init(FaslWriter* writer, const char* source, size_t length);
+void fasl_writer_free(FaslWriter* writer);
+// パース直後の式を符号化して追加する。符号化できない式なら false（以後の書き出しもしない）
+bool fasl_write_form(FaslWriter* writer, Object* form);
+// ためた式をファイルに書く（一時ファイルに書いてから置き換える）。失敗したら false
+bool fasl_writer_save(FaslWriter* writer, const char* path);
+
+// data がソース source に対応する正しい FASL なら読み込みを始めて true
+bool fasl_reader_open(FaslReader* reader, const void* data, size_t size, const char* source, size_t length);
+// 次の式（もうないか、壊れていれば NULL。壊れていれば error が立つ）
+Object* fasl_next(FaslReader* reader);
+
+// source_path に対応するキャッシュファイルのパス（malloc。呼び出し側で free）
+char* fasl_cache_path(const char* source_path);
+
+#endif // FASL_H
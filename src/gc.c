@@ -1,8 +1,19 @@
 // gc.c - Mark-and-sweep garbage collector
 #include "gc.h"
 #include "chibi_lisp.h"
+#include "hashtable.h"
+#include "memo.h"
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
+#include <setjmp.h>
+
+// ێIȃX^bN̓X^bNt[̌Ԃǂނ̂ŁAASan ̌O
+#if defined(__GNUC__)
+#define GC_NO_SANITIZE __attribute__((no_sanitize_address))
+#else
+#define GC_NO_SANITIZE
+#endif
 
 //------------------------------------------
 // GCf[^
@@ -13,6 +24,11 @@ static size_t gc_collections = 0;
 static size_t gc_last_collected = 0;
 static size_t gc_total_collected = 0;
 
+// S_i]r̉jp
+static void* gc_stack_base = NULL;    //  C X^bN̒iNULL ȂS_ł͉Ȃj
+static size_t gc_alloc_mark = 0;      // Ỏ_̊mۉ
+static size_t gc_free_after = 0;      // Ỏ̋󂫃IuWFNg
+
 //------------------------------------------
 // GC
 //------------------------------------------
@@ -21,6 +37,9 @@ void gc_init(void) {
     gc_collections = 0;
     gc_last_collected = 0;
     gc_total_collected = 0;
+    gc_stack_base = NULL;
+    gc_alloc_mark = 0;
+    gc_free_after = 0;
     memset(gc_roots, 0, sizeof(gc_roots));
 }
 
@@ -59,6 +78,12 @@ static void gc_mark_object(Object* obj) {
 
     stack[sp++] = obj;
 
+    // X^bNꍇ͍ċAŃ}[N
+#define GC_PUSH(child) do { \
+        if (sp < MAX_GC_MARK_STACK) stack[sp++] = (child); \
+        else gc_mark_object(child); \
+    } while (0)
+
     while (sp > 0) {
         Object* current = stack[--sp];
         if (!current) continue;
@@ -70,19 +95,76 @@ static void gc_mark_object(Object* obj) {
 
         switch (current->type) {
             case OBJ_CONS:
-                if (current->data.cons.car) stack[sp++] = current->data.cons.car;
-                if (current->data.cons.cdr) stack[sp++] = current->data.cons.cdr;
+                if (current->data.cons.car) GC_PUSH(current->data.cons.car);
+                if (current->data.cons.cdr) GC_PUSH(current->data.cons.cdr);
+                // R[TCgLbV̌Ăяo
+                if (current->data.cons.cache) GC_PUSH(current->data.cons.cache);
                 break;
-            case OBJ_FUNCTION:
             case OBJ_LAMBDA:
-                if (current->data.function.params) stack[sp++] = current->data.function.params;
-                if (current->data.function.body) stack[sp++] = current->data.function.body;
+                if (current->data.lambda.params) GC_PUSH(current->data.lambda.params);
+                if (current->data.lambda.body) GC_PUSH(current->data.lambda.body);
+                if (current->data.lambda.captured) GC_PUSH(current->data.lambda.captured);
+                break;
+            case OBJ_FRAME:
+                for (size_t i = 0; i < current->data.frame.count; i++) {
+                    if (current->data.frame.slots[i]) GC_PUSH(current->data.frame.slots[i]);
+                }
+                if (current->data.frame.link) GC_PUSH(current->data.frame.link);
+                break;
+            case OBJ_VECTOR: {
+                // vf͘AĂ̂Ŕzɐςނ
+                Object** items = current->data.vector.items;
+                for (size_t i = 0, n = current->data.vector.length; i < n; i++) {
+                    if (items[i]) GC_PUSH(items[i]);
+                }
+                break;
+            }
+            case OBJ_HASHTABLE: {
+                // nbVrȂ狌zɎcĂvfǂ
+                HashTable* table = current->data.hashtable.table;
+                for (size_t i = 0; i < table->capacity; i++) {
+                    if (!hashtable_slot_full(table->ctrl[i])) continue;
+                    GC_PUSH(table->slots[i].key);
+                    GC_PUSH(table->slots[i].value);
+                }
+                for (size_t i = 0; table->old_ctrl && i < table->old_capacity; i++) {
+                    if (!hashtable_slot_full(table->old_ctrl[i])) continue;
+                    GC_PUSH(table->old_slots[i].key);
+                    GC_PUSH(table->old_slots[i].value);
+                }
+                break;
+            }
+            case OBJ_MAP:
+                if (current->data.map.root) GC_PUSH(current->data.map.root);
+                break;
+            case OBJ_MAPNODE: {
+                // ߓ_͕̃}bvŋL邪A}[Nς݂Ȃœǂݔ΂
+                Object** slots = current->data.map_node.slots;
+                for (uint32_t i = 0, n = 2 * current->data.map_node.count; i < n; i++) {
+                    if (slots[i]) GC_PUSH(slots[i]);
+                }
+                break;
+            }
+            case OBJ_MEMO: {
+                // ʂ͎QƂȂ̂Őς܂Ȃi}[N gc() Őj
+                MemoCache* cache = current->data.memo.cache;
+                if (current->data.memo.function) GC_PUSH(current->data.memo.function);
+                for (int16_t i = cache->newest; i >= 0; i = cache->entries[i].older) {
+                    GC_PUSH(cache->entries[i].args);
+                }
+                break;
+            }
+            case OBJ_MACRO:
+                if (current->data.macro.transformer) GC_PUSH(current->data.macro.transformer);
                 break;
             case OBJ_NIL:
             case OBJ_BOOL:
             case OBJ_NUMBER:
+            case OBJ_BIGNUM:
+            case OBJ_FLOAT:
             case OBJ_STRING:
             case OBJ_SYMBOL:
+            case OBJ_FUNCTION:
             case OBJ_OPERATOR:
             case OBJ_BUILTIN:
             case OBJ_VOID:
@@ -90,12 +172,34 @@ static void gc_mark_object(Object* obj) {
                 break;
         }
     }
+#undef GC_PUSH
+}
+
+// C X^bN top ܂łɂl̂Amۍς݂̃IuWFNgi̓jŵ}[NB
+// ]r̊EXgEVM̃[JƃX^bN͂猩
+GC_NO_SANITIZE static void gc_mark_stack(void* top) {
+    uintptr_t low = (uintptr_t)top;
+    uintptr_t high = (uintptr_t)gc_stack_base;
+    if (low > high) {
+        uintptr_t swap = low;
+        low = high;
+        high = swap;
+    }
+    uintptr_t first = (uintptr_t)object_pool;
+    uintptr_t last = (uintptr_t)(object_pool + OBJECT_POOL_SIZE);
+    for (uintptr_t p = low & ~(uintptr_t)(sizeof(void*) - 1); p < high; p += sizeof(void*)) {
+        uintptr_t value = *(const uintptr_t*)p;
+        if (value < first || value >= last) continue;
+        int index = (int)((value - first) / sizeof(Object));
+        if (object_pool_is_allocated(index)) gc_mark_object(&object_pool[index]);
+    }
 }
 
 //------------------------------------------
 // Kx[WRNVs
 //------------------------------------------
-void gc(void) {
+// stack_top  NULL łȂ΁A[gɉ C X^bN
+static void gc_run(void* stack_top) {
     gc_collections++;
     gc_last_collected = 0;
 
@@ -108,8 +212,18 @@ void gc(void) {
             gc_mark_object(*gc_roots[i]);
         }
     }
+    if (stack_top && gc_stack_base) gc_mark_stack(stack_top);
+
+    // QƂ̐: LbVA錋ʂ̃GgO
+    for (int i = 0; i < OBJECT_POOL_SIZE; i++) {
+        if (object_pool_is_allocated(i) && object_pool_is_marked(i)) {
+            Object* obj = object_pool_get_object(i);
+            if (obj->type == OBJ_MEMO) memo_cache_drop_unmarked(obj->data.memo.cache);
+        }
+    }
 
     // XC[vtF[Y: }[NĂȂIuWFNg
+    size_t live = 0;
     for (int i = 0; i < OBJECT_POOL_SIZE; i++) {
         if (object_pool_is_allocated(i)) {
             Object* obj = object_pool_get_object(i);
@@ -118,11 +232,40 @@ void gc(void) {
             if (!object_pool_is_marked(i)) {
                 object_pool_free(obj);
                 gc_last_collected++;
+            } else {
+                live++;
             }
         }
     }
 
     gc_total_collected += gc_last_collected;
+    gc_alloc_mark = object_pool_alloc_count();
+    gc_free_after = OBJECT_POOL_SIZE - live;
+}
+
+void gc(void) {
+    gc_run(NULL);
+}
+
+//------------------------------------------
+// S_
+//------------------------------------------
+void gc_set_stack_base(void* base) {
+    gc_stack_base = base;
+}
+
+void gc_safepoint(void) {
+    if (!gc_stack_base) return;
+    // Ỏɋ󂢂Ă̔g܂ł͉Ȃ
+    if (object_pool_alloc_count() - gc_alloc_mark < gc_free_after / 2) return;
+
+    // WX^ɂlX^bN֏oĂ瑖
+    jmp_buf registers;
+#if defined(__GNUC__)
+    __builtin_unwind_init();
+#endif
+    setjmp(registers);
+    gc_run(&registers);
 }
 
 //------------------------------------------
@@ -11,6 +11,12 @@
 void gc_init(void);
 void gc_collect(void);
 
+// 評価途中の安全点（ループの反復の境目）。前回の回収後に十分確保していれば、
+// ルートに加えて C スタック上の値が指すオブジェクトも生きているとみなして回収する
+void gc_safepoint(void);
+// 安全点で走査する C スタックの底（最も外側の eval_form が設定する。NULL なら安全点では回収しない）
+void gc_set_stack_base(void* base);
+
 // ルートセットの管理
 void gc_add_root(Object** root);
 void gc_remove_root(Object** root);
@@ -0,0 +1,407 @@
+// hashtable.c
+// ハッシュテーブルの実装。
+// 制御バイトは 8 スロットを1グループとして 64bit 整数に読み込み、ビット演算で
+// 「ハッシュ下位7bitが一致するスロット」「空きスロット」をまとめて求める。
+// 探索はグループ単位の三角数プロービング（グループ数が2のべきなら全グループを巡る）。
+
+#include "hashtable.h"
+#include "map.h"
+#include "object_pool.h"
+#include "heap.h"
+#include "bignum.h"
+#include <string.h>
+#include <stdint.h>
+
+#define GROUP_WIDTH   8
+#define MIN_CAPACITY  8
+#define MIGRATE_STEP  16   // 1回の書き込みで旧配列から移すスロット数
+#define HASH_DEPTH    4    // リスト・ベクタの中身をハッシュに含める深さ
+#define HASH_ELEMENTS 16   // リスト・ベクタの先頭から何要素をハッシュに含めるか
+
+//------------------------------------------
+// ハッシュ関数
+//------------------------------------------
+
+static uint32_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return (uint32_t)x;
+}
+
+// FNV-1a
+static uint32_t hash_bytes(const void* data, size_t length) {
+    const uint8_t* p = data;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// 文字列・シンボルのハッシュはオブジェクトのヘッダに覚えておく（0 は未計算）。
+// 特殊形式シンボルなどの固定オブジェクトは読み取り専用なので毎回計算する
+static uint32_t cached_text_hash(Object* obj, const char* text, size_t length) {
+    if (obj->hash != 0) return obj->hash;
+    uint32_t h = hash_bytes(text, length);
+    if (h == 0) h = 1;
+    if (object_pool_is_valid(obj)) obj->hash = h;
+    return h;
+}
+
+static uint32_t hash_value(Object* key, HashKind kind, int depth) {
+    if (!key) return 0;
+    switch (key->type) {
+        case OBJ_SYMBOL: return cached_text_hash(key, key->data.symbol.name, key->data.symbol.length);
+        case OBJ_NUMBER: return mix64((uint64_t)key->data.number);
+        default:         break;
+    }
+    if (kind == HASH_EQ) return mix64((uint64_t)(uintptr_t)key);
+
+    switch (key->type) {
+        case OBJ_STRING:
+            return cached_text_hash(key, key->data.string.text, key->data.string.length);
+        case OBJ_FLOAT: {
+            double value = key->data.real == 0.0 ? 0.0 : key->data.real;  // -0.0 と 0.0 をそろえる
+            uint64_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            return mix64(bits ^ 0x9e3779b97f4a7c15ULL);
+        }
+        case OBJ_BIGNUM: {
+            uint32_t h = hash_bytes(key->data.bignum.limbs, sizeof(uint32_t) * key->data.bignum.count);
+            return key->data.bignum.negative ? ~h : h;
+        }
+        case OBJ_CONS: {
+            if (depth >= HASH_DEPTH) return 0x6c697374u;
+            uint32_t h = 0x636f6e73u;
+            int n = 0;
+            for (Object* it = key; is_cons(it) && n < HASH_ELEMENTS; it = it->data.cons.cdr, n++) {
+                h = h * 31 + hash_value(it->data.cons.car, kind, depth + 1);
+            }
+            return h;
+        }
+        case OBJ_VECTOR: {
+            if (depth >= HASH_DEPTH) return 0x76656374u;
+            uint32_t h = (uint32_t)key->data.vector.length;
+            for (size_t i = 0; i < key->data.vector.length && i < HASH_ELEMENTS; i++) {
+                h = h * 31 + hash_value(key->data.vector.items[i], kind, depth + 1);
+            }
+            return h;
+        }
+        case OBJ_MAP: {
+            // 要素の並びは挿入順によらないが、衝突節点の中の順は変わりうるので足し合わせる
+            if (depth >= HASH_DEPTH) return 0x6d617073u;
+            uint32_t h = (uint32_t)key->data.map.count;
+            MapIter it;
+            Object* k;
+            Object* v;
+            map_iter_init(&it, key);
+            while (map_iter_next(&it, &k, &v)) {
+                h += hash_value(k, kind, depth + 1) * 31 + hash_value(v, kind, depth + 1);
+            }
+            return h;
+        }
+        default:
+            return mix64((uint64_t)(uintptr_t)key);
+    }
+}
+
+uint32_t hashtable_hash(Object* key, HashKind kind) {
+    return hash_value(key, kind, 0);
+}
+
+bool hashtable_keys_equal(Object* a, Object* b, HashKind kind) {
+    if (a == b) return true;
+    if (!a || !b || a->type != b->type) return false;
+    switch (a->type) {
+        // シンボルは名前ごとに1つとは限らないので、eq でも名前で比べる
+        case OBJ_SYMBOL:
+            return a->data.symbol.length == b->data.symbol.length &&
+                   memcmp(a->data.symbol.name, b->data.symbol.name, a->data.symbol.length) == 0;
+        case OBJ_NUMBER:
+            return a->data.number == b->data.number;
+        default:
+            break;
+    }
+    if (kind == HASH_EQ) return false;
+
+    switch (a->type) {
+        case OBJ_STRING:
+            return a->data.string.length == b->data.string.length &&
+                   memcmp(a->data.string.text, b->data.string.text, a->data.string.length) == 0;
+        case OBJ_FLOAT:
+            return a->data.real == b->data.real;
+        case OBJ_BIGNUM:
+            return bignum_compare(a, b) == 0;
+        case OBJ_CONS:
+            while (is_cons(a) && is_cons(b)) {
+                if (!hashtable_keys_equal(a->data.cons.car, b->data.cons.car, kind)) return false;
+                a = a->data.cons.cdr;
+                b = b->data.cons.cdr;
+            }
+            return hashtable_keys_equal(a, b, kind);
+        case OBJ_VECTOR:
+            if (a->data.vector.length != b->data.vector.length) return false;
+            for (size_t i = 0; i < a->data.vector.length; i++) {
+                if (!hashtable_keys_equal(a->data.vector.items[i], b->data.vector.items[i], kind)) return false;
+            }
+            return true;
+        case OBJ_MAP:
+            return map_equal(a, b);
+        default:
+            return false;
+    }
+}
+
+//------------------------------------------
+// 制御バイトのグループ演算
+//------------------------------------------
+
+#define LSBS 0x0101010101010101ULL
+#define MSBS 0x8080808080808080ULL
+
+static uint64_t load_group(const uint8_t* ctrl) {
+    uint64_t group;
+    memcpy(&group, ctrl, sizeof(group));
+    return group;
+}
+
+// h2 と一致する制御バイトの位置（最上位bitが立つ）。まれに偽陽性があるので呼び出し側でキーを比べる
+static uint64_t match_h2(uint64_t group, uint8_t h2) {
+    uint64_t x = group ^ (LSBS * h2);
+    return (x - LSBS) & ~x & MSBS;
+}
+
+// 空き (0x80) の位置。削除済み (0xFE) と使用中 (0..127) は含まない
+static uint64_t match_empty(uint64_t group) {
+    return group & ~(group << 6) & MSBS;
+}
+
+// 空きか削除済みの位置
+static uint64_t match_free(uint64_t group) {
+    return group & MSBS;
+}
+
+// mask の先頭の位置（グループ内のスロット番号）を取り出して mask から消す
+static size_t mask_next(uint64_t* mask) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    int bit = 63 - __builtin_clzll(*mask);
+    *mask &= ~((uint64_t)1 << bit);
+    return (size_t)(7 - bit / 8);
+#else
+    int bit = __builtin_ctzll(*mask);
+    *mask &= *mask - 1;
+    return (size_t)(bit / 8);
+#endif
+}
+
+static uint8_t hash_h2(uint32_t hash) {
+    return (uint8_t)(hash >> 25);
+}
+
+//------------------------------------------
+// 配列の探索と挿入
+//------------------------------------------
+
+// キーのスロット番号（なければ -1）
+static long find_slot(const uint8_t* ctrl, const HashSlot* slots, size_t capacity,
+                      Object* key, uint32_t hash, HashKind kind) {
+    size_t groups = capacity / GROUP_WIDTH;
+    size_t g = hash & (groups - 1);
+    uint8_t h2 = hash_h2(hash);
+    for (size_t probe = 0; probe < groups; probe++) {
+        uint64_t group = load_group(ctrl + g * GROUP_WIDTH);
+        uint64_t match = match_h2(group, h2);
+        while (match) {
+            size_t i = g * GROUP_WIDTH + mask_next(&match);
+            if (ctrl[i] == h2 && hashtable_keys_equal(slots[i].key, key, kind)) return (long)i;
+        }
+        // 空きのあるグループで見つからなければ、この先にもない
+        if (match_empty(group)) return -1;
+        g = (g + probe + 1) & (groups - 1);
+    }
+    return -1;
+}
+
+// 挿入できる最初のスロット（空きか削除済み）
+static size_t find_free(const uint8_t* ctrl, size_t capacity, uint32_t hash) {
+    size_t groups = capacity / GROUP_WIDTH;
+    size_t g = hash & (groups - 1);
+    for (size_t probe = 0; probe < groups; probe++) {
+        uint64_t match = match_free(load_group(ctrl + g * GROUP_WIDTH));
+        if (match) return g * GROUP_WIDTH + mask_next(&match);
+        g = (g + probe + 1) & (groups - 1);
+    }
+    return 0;  // 負荷率を 7/8 以下に保つので到達しない
+}
+
+// 現在の配列へキーが無いと分かっている要素を入れる
+static void insert_slot(HashTable* table, Object* key, Object* value, uint32_t hash) {
+    size_t i = find_free(table->ctrl, table->capacity, hash);
+    if (table->ctrl[i] == HASH_CTRL_EMPTY) table->used++;
+    table->ctrl[i] = hash_h2(hash);
+    table->slots[i].key = key;
+    table->slots[i].value = value;
+}
+
+static bool alloc_arrays(size_t capacity, uint8_t** ctrl, HashSlot** slots) {
+    *ctrl = heap_alloc(capacity);
+    *slots = heap_alloc(sizeof(HashSlot) * capacity);
+    if (!*ctrl || !*slots) {
+        if (*ctrl) heap_free(*ctrl);
+        if (*slots) heap_free(*slots);
+        return false;
+    }
+    memset(*ctrl, HASH_CTRL_EMPTY, capacity);
+    return true;
+}
+
+//------------------------------------------
+// 漸進的リハッシュ
+//------------------------------------------
+
+// 旧配列から最大 steps スロット分を現在の配列へ移す
+static void migrate(HashTable* table, size_t steps) {
+    if (!table->old_ctrl) return;
+    while (steps-- > 0 && table->migrated < table->old_capacity) {
+        size_t i = table->migrated++;
+        if (hashtable_slot_full(table->old_ctrl[i])) {
+            HashSlot* slot = &table->old_slots[i];
+            insert_slot(table, slot->key, slot->value, hashtable_hash(slot->key, table->kind));
+            table->old_ctrl[i] = HASH_CTRL_DELETED;
+        }
+    }
+    if (table->migrated == table->old_capacity) {
+        heap_free(table->old_ctrl);
+        heap_free(table->old_slots);
+        table->old_ctrl = NULL;
+        table->old_slots = NULL;
+        table->old_capacity = 0;
+    }
+}
+
+// 新しい配列に切り替えてリハッシュを始める。容量の上限で入らなければ false
+static bool grow(HashTable* table) {
+    // 前回のリハッシュが残っていれば先に終わらせる
+    migrate(table, SIZE_MAX);
+
+    // 要素数の2倍以上（負荷率1/2以下）の容量を選ぶ。削除済みが多ければ同じ大きさで作り直す
+    size_t capacity = MIN_CAPACITY;
+    while (capacity < HASHTABLE_MAX_CAPACITY && capacity < (table->count + 1) * 2) capacity *= 2;
+    if (table->count + 1 > capacity * 7 / 8) return false;
+
+    uint8_t* ctrl;
+    HashSlot* slots;
+    if (!alloc_arrays(capacity, &ctrl, &slots)) return false;
+
+    table->old_ctrl     = table->ctrl;
+    table->old_slots    = table->slots;
+    table->old_capacity = table->capacity;
+    table->migrated     = 0;
+    table->ctrl         = ctrl;
+    table->slots        = slots;
+    table->capacity     = capacity;
+    table->used         = 0;
+    migrate(table, MIGRATE_STEP);
+    return true;
+}
+
+//------------------------------------------
+// 公開関数
+//------------------------------------------
+
+HashTable* hashtable_create(HashKind kind) {
+    HashTable* table = heap_alloc(sizeof(HashTable));
+    if (!table) return NULL;
+    memset(table, 0, sizeof(HashTable));
+    if (!alloc_arrays(MIN_CAPACITY, &table->ctrl, &table->slots)) {
+        heap_free(table);
+        return NULL;
+    }
+    table->capacity = MIN_CAPACITY;
+    table->kind = kind;
+    return table;
+}
+
+void hashtable_destroy(HashTable* table) {
+    if (!table) return;
+    heap_free(table->ctrl);
+    heap_free(table->slots);
+    if (table->old_ctrl) {
+        heap_free(table->old_ctrl);
+        heap_free(table->old_slots);
+    }
+    heap_free(table);
+}
+
+Object* hashtable_get(HashTable* table, Object* key) {
+    uint32_t hash = hashtable_hash(key, table->kind);
+    long i = find_slot(table->ctrl, table->slots, table->capacity, key, hash, table->kind);
+    if (i >= 0) return table->slots[i].value;
+    if (table->old_ctrl) {
+        i = find_slot(table->old_ctrl, table->old_slots, table->old_capacity, key, hash, table->kind);
+        if (i >= 0) return table->old_slots[i].value;
+    }
+    return NULL;
+}
+
+bool hashtable_put(HashTable* table, Object* key, Object* value) {
+    migrate(table, MIGRATE_STEP);
+    uint32_t hash = hashtable_hash(key, table->kind);
+    long i = find_slot(table->ctrl, table->slots, table->capacity, key, hash, table->kind);
+    if (i >= 0) {
+        table->slots[i].value = value;
+        return true;
+    }
+    if (table->used + 1 > table->capacity * 7 / 8) {
+        if (!grow(table)) return false;
+        return hashtable_put(table, key, value);  // 旧配列にあったキーは grow で移っている
+    }
+    // まだ移していない旧配列の要素なら、そこから外して現在の配列へ入れる
+    if (table->old_ctrl) {
+        i = find_slot(table->old_ctrl, table->old_slots, table->old_capacity, key, hash, table->kind);
+        if (i >= 0) {
+            table->old_ctrl[i] = HASH_CTRL_DELETED;
+            table->count--;
+        }
+    }
+    insert_slot(table, key, value, hash);
+    table->count++;
+    return true;
+}
+
+bool hashtable_remove(HashTable* table, Object* key) {
+    migrate(table, MIGRATE_STEP);
+    uint32_t hash = hashtable_hash(key, table->kind);
+    long i = find_slot(table->ctrl, table->slots, table->capacity, key, hash, table->kind);
+    if (i >= 0) {
+        table->ctrl[i] = HASH_CTRL_DELETED;
+        table->count--;
+        return true;
+    }
+    if (table->old_ctrl) {
+        i = find_slot(table->old_ctrl, table->old_slots, table->old_capacity, key, hash, table->kind);
+        if (i >= 0) {
+            table->old_ctrl[i] = HASH_CTRL_DELETED;
+            table->count--;
+            return true;
+        }
+    }
+    return false;
+}
+
+Object* make_hashtable(HashKind kind) {
+    Object* obj = object_pool_alloc();
+    if (!obj) return NULL;
+    memset(obj, 0, sizeof(Object));  // 全体をゼロクリア
+    obj->type = OBJ_HASHTABLE;
+    obj->data.hashtable.table = hashtable_create(kind);
+    if (!obj->data.hashtable.table) {
+        object_pool_free(obj);
+        return NULL;
+    }
+    return obj;
+}
@@ -0,0 +1,65 @@
+// hashtable.h
+// ハッシュテーブル（OBJ_HASHTABLE）の実装。
+// オープンアドレス法で、各スロットに1バイトの制御バイト（空き / 削除済み / ハッシュ下位7bit）を持ち、
+// 8スロット分の制御バイトをまとめて比較して候補を絞る（SwissTable 方式）。
+// 拡張時は新しい配列を確保したあと、以後の書き込みのたびに少しずつ旧配列から移す（漸進的リハッシュ）。
+
+#ifndef HASHTABLE_H
+#define HASHTABLE_H
+
+#include "object.h"
+
+// 最大スロット数（スロット配列が heap_alloc の1回の上限に収まる大きさ）
+#define HASHTABLE_MAX_CAPACITY 256
+
+// キーの比較方法
+typedef enum {
+    HASH_EQ,     // 同一オブジェクト（シンボルは名前、整数は値で比べる）
+    HASH_EQUAL,  // 構造の等しさ（文字列・数値・リスト・ベクタの中身で比べる）
+} HashKind;
+
+typedef struct {
+    Object* key;
+    Object* value;
+} HashSlot;
+
+typedef struct HashTable {
+    uint8_t*  ctrl;          // 制御バイト（capacity 個）
+    HashSlot* slots;
+    size_t    capacity;      // 8 の倍数
+    size_t    used;          // 使用中 + 削除済みのスロット数（拡張の判定用）
+    // 漸進的リハッシュ中の旧配列（なければ NULL）
+    uint8_t*  old_ctrl;
+    HashSlot* old_slots;
+    size_t    old_capacity;
+    size_t    migrated;      // 旧配列のうち移し終えたスロット数
+    size_t    count;         // 新旧合わせた要素数
+    HashKind  kind;
+} HashTable;
+
+// 制御バイトの値（0..127 は使用中のスロットのハッシュ下位7bit）
+#define HASH_CTRL_EMPTY   0x80
+#define HASH_CTRL_DELETED 0xFE
+
+static inline bool hashtable_slot_full(uint8_t ctrl) {
+    return (ctrl & 0x80) == 0;
+}
+
+HashTable* hashtable_create(HashKind kind);
+void hashtable_destroy(HashTable* table);
+
+// キーの値を返す（なければ NULL）
+Object* hashtable_get(HashTable* table, Object* key);
+// キーに値を設定する。容量の上限で入らなければ false
+bool hashtable_put(HashTable* table, Object* key, Object* value);
+// キーを削除する。なければ false
+bool hashtable_remove(HashTable* table, Object* key);
+
+// キーのハッシュ値と等しさ（テーブルの比較方法に従う）
+uint32_t hashtable_hash(Object* key, HashKind kind);
+bool hashtable_keys_equal(Object* a, Object* b, HashKind kind);
+
+// ハッシュテーブルオブジェクトを作る（確保できなければ NULL）
+Object* make_hashtable(HashKind kind);
+
+#endif // HASHTABLE_H
@@ -201,4 +201,19 @@ bool heap_validate(void) {
         }
     }
     return true;
+}
+
+//------------------------------------------
+// C[W̕ۑEpiimage.cj
+//------------------------------------------
+uint8_t* heap_region(void) {
+    return heap;
+}
+
+uint8_t* heap_allocation_map(void) {
+    return allocation_bitmap;
+}
+
+uint8_t* heap_size_map(void) {
+    return size_info;
 }
\ No newline at end of file
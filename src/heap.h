@@ -2,6 +2,7 @@
 #define __HEAP_H__
 
 #include <stddef.h>
+#include <stdint.h>
 
 // ヒープ関数の宣言
 void heap_init(void);
@@ -18,4 +19,9 @@ size_t heap_free_size(void);
 size_t heap_allocated_chunks(void);
 size_t heap_free_chunks(void);
 
+// イメージの保存・復元用: ヒープ本体と、チャンクごとの使用中フラグ・ブロックのサイズ（チャンク数）
+uint8_t* heap_region(void);
+uint8_t* heap_allocation_map(void);
+uint8_t* heap_size_map(void);
+
 #endif // __HEAP_H__
\ No newline at end of file
@@ -11,6 +11,16 @@ bool bitmap_test(const uint8_t *bitmap, size_t bit);
 void bitmap_clear_all(uint8_t *bitmap, size_t num_bits);
 void bitmap_set_all(uint8_t *bitmap, size_t num_bits);
 
+// 32bitワードのビットマップ（HAMT の節点の分岐表など）
+static inline uint32_t bitmap_popcount32(uint32_t word) {
+    return (uint32_t)__builtin_popcount(word);
+}
+
+// word のうち bit より下位の立っているビットの数（立っているビットだけを詰めた配列での bit の位置）
+static inline uint32_t bitmap_rank32(uint32_t word, uint32_t bit) {
+    return bitmap_popcount32(word & ((1u << bit) - 1));
+}
+
 // 互換API（以前のテストコード用）: リンク時に解決される通常関数として提供
 void bitmap_set_bit(uint8_t *bitmap, size_t bit);
 void bitmap_clear_bit(uint8_t *bitmap, size_t bit);
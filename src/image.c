@@ -0,0 +1,475 @@
+// image.c
+// イメージの保存と復元の実装。
+//
+// ファイルの並び: ヘッダ / オブジェクトプール / ヒープ（使用中の最後のチャンクまで）/
+// プールの使用中ビットマップ / ヒープのチャンクごとの使用中フラグ / ブロックのサイズ
+// 保存は複製を作ってその中のポインタを符号に置き換え、復元は読み込んだ内容をプールとヒープへ
+// そのまま写してから符号をポインタに戻す（どちらも同じ走査関数 relocate_object で行う）。
+// ヒープのブロックの中のポインタは、ブロックを持つプールのオブジェクトの型からたどって書き換える。
+
+#include "image.h"
+#include "chibi_lisp.h"
+#include "object_pool.h"
+#include "heap.h"
+#include "hashtable.h"
+#include "memo.h"
+#include "macro.h"
+#include "eval.h"
+#include "fasl.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define IMAGE_MAGIC      "CHIIMG"
+#define IMAGE_BYTE_ORDER 0x01020304u  // 書いた環境とバイト順が違えば使わない
+
+typedef struct {
+    char     magic[8];
+    uint32_t format;
+    uint32_t byte_order;
+    char     version[16];      // CHIBI_LISP_VERSION
+    uint32_t pointer_size;     // sizeof(void*)
+    uint32_t object_size;      // sizeof(Object)
+    uint32_t pool_size;        // OBJECT_POOL_SIZE
+    uint32_t chunk_size;       // CHUNK_SIZE
+    uint32_t heap_chunks;      // 保存したチャンク数
+    uint32_t env_version;
+    uint32_t macro_version;
+    uint32_t macros_defined;
+    uint64_t registry_hash;    // 登録表（builtins.inc）の名前と順序のハッシュ
+    uint64_t env;              // グローバル環境（符号化したポインタ）
+    uint64_t payload_hash;     // ヘッダより後ろ全体のハッシュ
+} ImageHeader;
+
+//------------------------------------------
+// ポインタの符号化
+//------------------------------------------
+
+// 上位4ビットが種類、残りが添字・位置（0 は NULL）
+#define TAG_SHIFT (sizeof(uintptr_t) * 8 - 4)
+#define TAG_MASK  (((uintptr_t)1 << TAG_SHIFT) - 1)
+
+typedef enum {
+    TAG_NULL = 0,
+    TAG_POOL,    // object_pool の添字
+    TAG_HEAP,    // ヒープの先頭からの位置
+    TAG_FIXED,   // 固定オブジェクトの通し番号
+} PointerTag;
+
+// 固定オブジェクト（static 領域の定数）の範囲。通し番号はこの順に振る
+typedef struct {
+    Object* base;
+    size_t  count;
+} FixedRange;
+
+#define FIXED_RANGES 9
+#define CALLEE_COUNT (OP_COUNT + BUILTIN_COUNT)
+
+// 登録表の k 番目のネイティブ関数オブジェクト（演算子、組み込み関数の順）
+static Object* callee_function(size_t k) {
+    if (k < OP_COUNT) return evaluator_native_callee(get_operator((OperatorType)k));
+    return evaluator_native_callee(get_builtin((BuiltinType)(k - OP_COUNT)));
+}
+
+static void fixed_ranges(FixedRange ranges[FIXED_RANGES]) {
+    ranges[0] = (FixedRange){get_nil(), 1};
+    ranges[1] = (FixedRange){get_true(), 1};
+    ranges[2] = (FixedRange){get_false(), 1};
+    ranges[3] = (FixedRange){get_void(), 1};
+    ranges[4] = (FixedRange){get_operator(0), OP_COUNT};
+    ranges[5] = (FixedRange){get_builtin(0), BUILTIN_COUNT};
+    ranges[6] = (FixedRange){get_special_symbol(SF_QUOTE), SF_COUNT - SF_QUOTE};
+    ranges[7] = (FixedRange){callee_function(0), OP_COUNT};
+    ranges[8] = (FixedRange){callee_function(OP_COUNT), BUILTIN_COUNT};
+}
+
+// 登録表の名前と順序のハッシュ（添字で保存したネイティブ関数が同じ関数を指すかの照合に使う）
+static uint64_t registry_hash(void) {
+    uint64_t h = 0;
+    for (size_t k = 0; k < CALLEE_COUNT; k++) {
+        const char* name = evaluator_callee_spec(callee_function(k))->name;
+        h = (h ^ fasl_hash(name, strlen(name))) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+typedef struct {
+    bool       saving;
+    uint8_t*   heap;         // 書き換えるヒープ（保存時は複製、復元時はヒープ本体）
+    size_t     heap_length;  // 保存したチャンクの範囲
+    FixedRange fixed[FIXED_RANGES];
+    bool       failed;       // 保存できないポインタ・壊れた符号があった
+} Relocator;
+
+static void relocator_init(Relocator* r, bool saving, uint8_t* heap, size_t heap_length) {
+    r->saving      = saving;
+    r->heap        = heap;
+    r->heap_length = heap_length;
+    r->failed      = false;
+    fixed_ranges(r->fixed);
+}
+
+static uintptr_t encode_object(Relocator* r, Object* obj) {
+    if (!obj) return 0;
+    int index = object_pool_get_index(obj);
+    if (index >= 0) return (uintptr_t)TAG_POOL << TAG_SHIFT | (uintptr_t)index;
+    uintptr_t id = 0;
+    for (int i = 0; i < FIXED_RANGES; i++) {
+        if (obj >= r->fixed[i].base && obj < r->fixed[i].base + r->fixed[i].count) {
+            return (uintptr_t)TAG_FIXED << TAG_SHIFT | (id + (uintptr_t)(obj - r->fixed[i].base));
+        }
+        id += r->fixed[i].count;
+    }
+    r->failed = true;  // プールの外（スタック上のセルなど）は保存できない
+    return 0;
+}
+
+static Object* decode_object(Relocator* r, uintptr_t code) {
+    uintptr_t index = code & TAG_MASK;
+    switch ((PointerTag)(code >> TAG_SHIFT)) {
+        case TAG_NULL:
+            if (index == 0) return NULL;
+            break;
+        case TAG_POOL:
+            if (index < OBJECT_POOL_SIZE) return &object_pool[index];
+            break;
+        case TAG_FIXED:
+            for (int i = 0; i < FIXED_RANGES; i++) {
+                if (index < r->fixed[i].count) return r->fixed[i].base + index;
+                index -= r->fixed[i].count;
+            }
+            break;
+        default:
+            break;
+    }
+    r->failed = true;
+    return NULL;
+}
+
+static void fix_object(Relocator* r, Object** field) {
+    if (r->saving) *field = (Object*)encode_object(r, *field);
+    else           *field = decode_object(r, (uintptr_t)*field);
+}
+
+// ヒープ上の count 個 × size バイトのブロックを指すフィールド field を書き換え、
+// 書き換える側のヒープでのブロックの位置を返す（NULL なら NULL。範囲外なら failed を立てて NULL）
+static void* fix_block(Relocator* r, void* field, size_t count, size_t size) {
+    uintptr_t value;
+    memcpy(&value, field, sizeof(value));
+    if (value == 0) return NULL;
+
+    uintptr_t offset;
+    if (r->saving) {
+        offset = value - (uintptr_t)heap_region();  // ヒープより前なら大きな値になって範囲外
+    } else {
+        offset = (value >> TAG_SHIFT) == TAG_HEAP ? (value & TAG_MASK) : r->heap_length;
+    }
+    if (offset >= r->heap_length || count > (r->heap_length - offset) / size) {
+        r->failed = true;
+        return NULL;
+    }
+
+    value = r->saving ? ((uintptr_t)TAG_HEAP << TAG_SHIFT | offset) : (uintptr_t)(heap_region() + offset);
+    memcpy(field, &value, sizeof(value));
+    return r->heap + offset;
+}
+
+// ネイティブ関数は登録表の添字+1 で保存する（登録表にない関数は保存できない）
+static void fix_native(Relocator* r, Object* obj) {
+    if (r->saving) {
+        uintptr_t func = 0, spec = 0;
+        for (size_t k = 0; k < CALLEE_COUNT; k++) {
+            Object* callee = callee_function(k);
+            if (callee->data.function.native_func == obj->data.function.native_func) func = k + 1;
+            if (callee->data.function.spec == obj->data.function.spec) spec = k + 1;
+        }
+        if (func == 0 || (spec == 0 && obj->data.function.spec)) r->failed = true;
+        obj->data.function.native_func = (Object* (*)(Object*))func;
+        obj->data.function.spec        = (const BuiltinSpec*)spec;
+    } else {
+        uintptr_t func = (uintptr_t)obj->data.function.native_func;
+        uintptr_t spec = (uintptr_t)obj->data.function.spec;
+        if (func == 0 || func > CALLEE_COUNT || spec > CALLEE_COUNT) {
+            r->failed = true;
+            return;
+        }
+        obj->data.function.native_func = callee_function(func - 1)->data.function.native_func;
+        obj->data.function.spec        = spec ? callee_function(spec - 1)->data.function.spec : NULL;
+    }
+}
+
+// ハッシュテーブルの制御バイトとスロットの配列。保存時は使用中でないスロットを空にして書く
+static void fix_hash_slots(Relocator* r, uint8_t** ctrl_field, HashSlot** slots_field, size_t capacity) {
+    uint8_t*  ctrl  = fix_block(r, ctrl_field, capacity, 1);
+    HashSlot* slots = fix_block(r, slots_field, capacity, sizeof(HashSlot));
+    if (!ctrl || !slots) return;
+    for (size_t i = 0; i < capacity; i++) {
+        if (r->saving && !hashtable_slot_full(ctrl[i])) {
+            slots[i].key = slots[i].value = NULL;
+            continue;
+        }
+        fix_object(r, &slots[i].key);
+        fix_object(r, &slots[i].value);
+    }
+}
+
+// プールのオブジェクト obj と、obj が持つヒープのブロックの中のポインタを書き換える（GC のマークと同じ分類）
+static void relocate_object(Relocator* r, Object* obj) {
+    switch (obj->type) {
+        case OBJ_STRING:
+            fix_block(r, &obj->data.string.text, obj->data.string.length + 1, 1);
+            break;
+        case OBJ_SYMBOL:
+            fix_block(r, &obj->data.symbol.name, obj->data.symbol.length + 1, 1);
+            break;
+        case OBJ_BIGNUM:
+            fix_block(r, &obj->data.bignum.limbs, obj->data.bignum.count, sizeof(uint32_t));
+            break;
+        case OBJ_CONS:
+            fix_object(r, &obj->data.cons.car);
+            fix_object(r, &obj->data.cons.cdr);
+            fix_object(r, &obj->data.cons.cache);
+            break;
+        case OBJ_FUNCTION:
+            fix_native(r, obj);
+            break;
+        case OBJ_LAMBDA:
+            fix_object(r, &obj->data.lambda.params);
+            fix_object(r, &obj->data.lambda.body);
+            fix_object(r, &obj->data.lambda.captured);
+            break;
+        case OBJ_FRAME: {
+            size_t count = obj->data.frame.count;
+            Object** slots = fix_block(r, &obj->data.frame.slots, count, sizeof(Object*));
+            for (size_t i = 0; slots && i < count; i++) fix_object(r, &slots[i]);
+            fix_object(r, &obj->data.frame.link);
+            break;
+        }
+        case OBJ_VECTOR: {
+            size_t length = obj->data.vector.length;
+            Object** items = fix_block(r, &obj->data.vector.items, length, sizeof(Object*));
+            for (size_t i = 0; items && i < length; i++) fix_object(r, &items[i]);
+            break;
+        }
+        case OBJ_HASHTABLE: {
+            HashTable* table = fix_block(r, &obj->data.hashtable.table, 1, sizeof(HashTable));
+            if (!table) break;
+            fix_hash_slots(r, &table->ctrl, &table->slots, table->capacity);
+            if (table->old_ctrl) fix_hash_slots(r, &table->old_ctrl, &table->old_slots, table->old_capacity);
+            break;
+        }
+        case OBJ_MAP:
+            fix_object(r, &obj->data.map.root);
+            break;
+        case OBJ_MAPNODE: {
+            size_t count = 2 * (size_t)obj->data.map_node.count;
+            Object** slots = fix_block(r, &obj->data.map_node.slots, count, sizeof(Object*));
+            for (size_t i = 0; slots && i < count; i++) fix_object(r, &slots[i]);
+            break;
+        }
+        case OBJ_MEMO: {
+            fix_object(r, &obj->data.memo.function);
+            MemoCache* cache = fix_block(r, &obj->data.memo.cache, 1, sizeof(MemoCache));
+            if (!cache) break;
+            // 保存時は LRU リストにある（使用中の）エントリだけを書き、空きエントリは空にする
+            bool live[MEMO_CAPACITY] = {false};
+            if (r->saving) {
+                int steps = 0;
+                for (int16_t i = cache->newest; i >= 0 && i < MEMO_CAPACITY && steps < MEMO_CAPACITY;
+                     i = cache->entries[i].older, steps++) {
+                    live[i] = true;
+                }
+            }
+            for (int i = 0; i < MEMO_CAPACITY; i++) {
+                MemoEntry* entry = &cache->entries[i];
+                if (r->saving && !live[i]) {
+                    entry->args = entry->value = NULL;
+                    continue;
+                }
+                fix_object(r, &entry->args);
+                fix_object(r, &entry->value);
+            }
+            break;
+        }
+        case OBJ_MACRO:
+            fix_object(r, &obj->data.macro.transformer);
+            break;
+        case OBJ_NIL:
+        case OBJ_BOOL:
+        case OBJ_NUMBER:
+        case OBJ_FLOAT:
+        case OBJ_OPERATOR:
+        case OBJ_BUILTIN:
+        case OBJ_VOID:
+            break;
+        default:
+            r->failed = true;  // 壊れた型
+            break;
+    }
+}
+
+//------------------------------------------
+// 保存
+//------------------------------------------
+
+// 一時ファイルに書いてから置き換える
+static bool write_file(const char* path, const void* data, size_t size) {
+    size_t length = strlen(path);
+    char* temp = malloc(length + 32);
+    if (!temp) return false;
+    snprintf(temp, length + 32, "%s.%ld.tmp", path, (long)getpid());
+    FILE* file = fopen(temp, "wb");
+    if (!file) {
+        free(temp);
+        return false;
+    }
+    bool ok = fwrite(data, size, 1, file) == 1;
+    ok = (fclose(file) == 0) && ok;
+    if (ok) ok = rename(temp, path) == 0;
+    if (!ok) remove(temp);
+    free(temp);
+    return ok;
+}
+
+bool image_save(const char* path) {
+    // ヒープは使用中の最後のチャンクまでを書く
+    const uint8_t* used = heap_allocation_map();
+    size_t chunks = CHUNK_COUNT;
+    while (chunks > 0 && used[chunks - 1] == 0) chunks--;
+    size_t heap_length = chunks * CHUNK_SIZE;
+    size_t size = sizeof(ImageHeader) + sizeof(object_pool) + heap_length + BITMAP_SIZE + 2 * chunks;
+
+    uint8_t* data = malloc(size);
+    if (!data) return false;
+    Object*  pool = (Object*)(data + sizeof(ImageHeader));
+    uint8_t* heap = (uint8_t*)(pool + OBJECT_POOL_SIZE);
+    uint8_t* maps = heap + heap_length;
+    memcpy(pool, object_pool, sizeof(object_pool));
+    memcpy(heap, heap_region(), heap_length);
+    memcpy(maps, allocation_bitmap, BITMAP_SIZE);
+    memcpy(maps + BITMAP_SIZE, used, chunks);
+    memcpy(maps + BITMAP_SIZE + chunks, heap_size_map(), chunks);
+    // 空きチャンクに残っている古い中身は書かない
+    for (size_t i = 0; i < chunks; i++) {
+        if (used[i] == 0) memset(heap + i * CHUNK_SIZE, 0, CHUNK_SIZE);
+    }
+
+    Relocator r;
+    relocator_init(&r, true, heap, heap_length);
+    for (int i = 0; i < OBJECT_POOL_SIZE; i++) {
+        if (object_pool_is_allocated(i)) relocate_object(&r, &pool[i]);
+        else memset(&pool[i], 0, sizeof(Object));
+    }
+    Object* env = evaluator_global_env();
+    fix_object(&r, &env);
+    if (r.failed) {
+        free(data);
+        return false;
+    }
+
+    ImageHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC));
+    header.format         = IMAGE_FORMAT;
+    header.byte_order     = IMAGE_BYTE_ORDER;
+    strncpy(header.version, CHIBI_LISP_VERSION, sizeof(header.version) - 1);
+    header.pointer_size   = sizeof(void*);
+    header.object_size    = sizeof(Object);
+    header.pool_size      = OBJECT_POOL_SIZE;
+    header.chunk_size     = CHUNK_SIZE;
+    header.heap_chunks    = (uint32_t)chunks;
+    header.env_version    = evaluator_env_version();
+    bool defined;
+    header.macro_version  = macro_state(&defined);
+    header.macros_defined = defined;
+    header.registry_hash  = registry_hash();
+    header.env            = (uint64_t)(uintptr_t)env;
+    header.payload_hash   = fasl_hash(data + sizeof(header), size - sizeof(header));
+    memcpy(data, &header, sizeof(header));
+
+    bool ok = write_file(path, data, size);
+    free(data);
+    return ok;
+}
+
+//------------------------------------------
+// 復元
+//------------------------------------------
+
+// 読み込んだイメージ data をプールとヒープへ写してポインタを戻す
+static bool restore(const uint8_t* data, size_t size) {
+    ImageHeader header;
+    if (size < sizeof(header)) return false;
+    memcpy(&header, data, sizeof(header));
+    char version[sizeof(header.version)] = {0};
+    strncpy(version, CHIBI_LISP_VERSION, sizeof(version) - 1);
+    if (memcmp(header.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) != 0 ||
+        header.format != IMAGE_FORMAT || header.byte_order != IMAGE_BYTE_ORDER ||
+        memcmp(header.version, version, sizeof(version)) != 0) {
+        return false;
+    }
+    if (header.pointer_size != sizeof(void*) || header.object_size != sizeof(Object) ||
+        header.pool_size != OBJECT_POOL_SIZE || header.chunk_size != CHUNK_SIZE ||
+        header.heap_chunks > CHUNK_COUNT || header.registry_hash != registry_hash()) {
+        return false;
+    }
+    size_t chunks = header.heap_chunks;
+    size_t heap_length = chunks * CHUNK_SIZE;
+    if (size != sizeof(header) + sizeof(object_pool) + heap_length + BITMAP_SIZE + 2 * chunks) return false;
+    if (fasl_hash(data + sizeof(header), size - sizeof(header)) != header.payload_hash) return false;
+
+    const uint8_t* pool = data + sizeof(header);
+    const uint8_t* maps = pool + sizeof(object_pool) + heap_length;
+    memcpy(object_pool, pool, sizeof(object_pool));
+    memcpy(heap_region(), pool + sizeof(object_pool), heap_length);
+    memcpy(allocation_bitmap, maps, BITMAP_SIZE);
+    memcpy(heap_allocation_map(), maps + BITMAP_SIZE, chunks);
+    memcpy(heap_size_map(), maps + BITMAP_SIZE + chunks, chunks);
+
+    Relocator r;
+    relocator_init(&r, false, heap_region(), heap_length);
+    for (int i = 0; i < OBJECT_POOL_SIZE && !r.failed; i++) {
+        if (object_pool_is_allocated(i)) relocate_object(&r, &object_pool[i]);
+    }
+    Object* env = decode_object(&r, (uintptr_t)header.env);
+    if (r.failed || !env) return false;
+
+    macro_restore(header.macro_version, header.macros_defined != 0);
+    evaluator_restore(env, header.env_version);
+    return true;
+}
+
+bool image_load(const char* path) {
+    object_system_init();
+    int fd = open(path, O_RDONLY);
+    bool ok = fd >= 0;
+
+    // ファイル全体をまとめて読む（通常のファイルなら read は1回で終わる）
+    struct stat st;
+    uint8_t* data = NULL;
+    size_t size = 0;
+    ok = ok && fstat(fd, &st) == 0 && st.st_size > 0;
+    if (ok) {
+        size = (size_t)st.st_size;
+        data = malloc(size);
+        ok = data != NULL;
+    }
+    for (size_t done = 0; ok && done < size;) {
+        ssize_t n = read(fd, data + done, size - done);
+        if (n <= 0) ok = false;
+        else done += (size_t)n;
+    }
+    if (fd >= 0) close(fd);
+    ok = ok && restore(data, size);
+    free(data);
+    if (!ok) {
+        // 途中まで写した状態は使わず、組み込み関数も束縛されていない空の環境にする
+        object_system_init();
+        macro_restore(1, false);
+        evaluator_restore(get_nil(), 1);
+    }
+    return ok;
+}
@@ -0,0 +1,22 @@
+// image.h
+// 処理系の状態（オブジェクトプール・可変長データのヒープ・グローバル環境）をファイルに保存し、
+// 起動時に読み戻す（イメージ）。復元は1回の読み込みとポインタの付け替えだけで、式は評価しない。
+// ポインタはプールの添字・ヒープ内の位置・固定オブジェクトの番号に、ネイティブ関数は登録表の添字に
+// 置き換えて書くので、アドレス空間の配置が違うプロセスでも読める。
+
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stdbool.h>
+
+#define IMAGE_FORMAT 1   // 形式を変えたら上げる
+
+// 現在の状態を path に書く（一時ファイルに書いてから置き換える）。
+// 保存できないオブジェクト（登録表にないネイティブ関数など）があれば書かずに false
+bool image_save(const char* path);
+
+// path のイメージで処理系を初期化する（evaluator_init の代わりに呼ぶ）。
+// 読めない・壊れている・処理系の版や構成が違うときは、空の状態に戻して false
+bool image_load(const char* path);
+
+#endif // IMAGE_H
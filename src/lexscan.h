@@ -0,0 +1,52 @@
+// lexscan.h
+// 字句解析の内側のループ（空白の読み飛ばし・シンボルの終わり・区切り文字の検索）。
+// 字句はたいてい数バイトなので、1バイトずつ調べるループを呼び出し側にインライン展開する
+// （16 / 32 バイト単位の SIMD 版は呼び出しと準備の手間で bench_lexer でも速くならなかった）。
+// どの関数も [p, end) の範囲だけを読む。
+
+#ifndef LEXSCAN_H
+#define LEXSCAN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+static inline bool lexscan_is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\t';
+}
+
+static inline bool lexscan_is_symbol(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+           c == '_' || c == '?' || c == '!' || c == '-' || c == '=' || c == '<' || c == '>';
+}
+
+static inline bool lexscan_is_delimiter(char c) {
+    return lexscan_is_space(c) || c == '\r' || c == '(' || c == ')' || c == '"' || c == ';';
+}
+
+// 最初の空白（' ' '\n' '\t'）でない文字の位置（なければ end）
+static inline const char* lexscan_skip_space(const char* p, const char* end) {
+    while (p < end && lexscan_is_space(*p)) p++;
+    return p;
+}
+
+// p から続くシンボル文字（英数字と _ ? ! - = < >）の終わり
+static inline const char* lexscan_symbol_end(const char* p, const char* end) {
+    while (p < end && lexscan_is_symbol(*p)) p++;
+    return p;
+}
+
+// 最初の区切り文字（空白・'\r'・括弧・'"'・';'）の位置（なければ end）
+static inline const char* lexscan_next_delimiter(const char* p, const char* end) {
+    while (p < end && !lexscan_is_delimiter(*p)) p++;
+    return p;
+}
+
+// 最初の c の位置（なければ end）。コメントと文字列の本体の読み飛ばしに使う。
+// libc の memchr はどの環境でもベクトル化されているのでそのまま使う
+static inline const char* lexscan_find(const char* p, const char* end, char c) {
+    const char* found = memchr(p, c, (size_t)(end - p));
+    return found ? found : end;
+}
+
+#endif // LEXSCAN_H
@@ -0,0 +1,206 @@
+// macro.c
+// マクロ展開とコールサイトへの展開結果のキャッシュの実装。
+
+#include "macro.h"
+#include "eval.h"
+#include "object_pool.h"
+#include <string.h>
+
+// 内側の束縛形式で隠される名前の最大数
+#define MAX_SHADOW 64
+
+// マクロの版: マクロの束縛が変わるたびに進める
+// (0 はゼロクリアされたセルと区別するため使わない)
+static uint32_t macro_version = 1;
+static size_t expansion_count = 0;
+// マクロが1つでも作られたか（作られていなければ展開の走査を省く）
+static bool macros_defined = false;
+
+typedef struct {
+    const char* shadow[MAX_SHADOW];  // lambda / dotimes / loop で束縛された名前
+    int nshadow;
+    int depth;                       // 展開の入れ子の深さ
+} Expander;
+
+Object* make_macro(Object* transformer) {
+    Object* obj = object_pool_alloc();
+    if (!obj) return NULL;
+    memset(obj, 0, sizeof(Object));  // 全体をゼロクリア
+    obj->type = OBJ_MACRO;
+    obj->data.macro.transformer = transformer;
+    macros_defined = true;
+    return obj;
+}
+
+void macro_invalidate(void) {
+    macro_version++;
+}
+
+size_t macro_expansion_count(void) {
+    return expansion_count;
+}
+
+uint32_t macro_state(bool* defined) {
+    *defined = macros_defined;
+    return macro_version;
+}
+
+void macro_restore(uint32_t version, bool defined) {
+    macro_version  = version;
+    macros_defined = defined;
+}
+
+//------------------------------------------
+// 展開
+//------------------------------------------
+
+// 展開結果の構文木をコピーする。展開結果はマクロ本体の定数や他のコールサイトと
+// 構造を共有しうるので、コールサイトごとに書き換えてよい専用のセルとシンボルを作る。
+// シンボルのスロット番号はコピー元（呼び出し側の引数の式）のものを引き継ぐ
+static Object* copy_tree(Object* expr) {
+    if (is_symbol(expr)) {
+        if (expr->data.symbol.special != SF_NONE) return expr;
+        Object* sym = make_symbol(expr->data.symbol.name);
+        if (sym) sym->data.symbol.slot = expr->data.symbol.slot;
+        return sym;
+    }
+    if (!is_cons(expr)) return expr;
+
+    Object* head = obj_nil;
+    Object** tail = &head;
+    Object* it = expr;
+    for (; is_cons(it); it = obj_cdr(it)) {
+        Object* car = copy_tree(obj_car(it));
+        Object* cell = car ? make_cons(car, obj_nil) : NULL;
+        if (!cell) return NULL;
+        *tail = cell;
+        tail = &cell->data.cons.cdr;
+    }
+    if (it != obj_nil) {
+        // ドットリストの末尾
+        *tail = copy_tree(it);
+        if (!*tail) return NULL;
+    }
+    return head;
+}
+
+// 変換関数に引数の式（評価しない）を渡して展開形を作る
+static Object* expand(Object* macro, Object* form) {
+    Object* expansion = evaluator_apply(macro->data.macro.transformer, obj_cdr(form));
+    expansion_count++;
+    return copy_tree(expansion ? expansion : obj_nil);
+}
+
+bool macro_rewrite(Object* form, Object* macro) {
+    Object* expansion = expand(macro, form);
+    if (!expansion) return false;
+    Object* original = make_cons(form->data.cons.car, form->data.cons.cdr);
+    Object* args = original ? make_cons(original, expansion) : NULL;
+    if (!args) return false;
+    args->cache_stamp = macro_version;
+
+    form->data.cons.car   = get_special_symbol(SF_EXPANSION);
+    form->data.cons.cdr   = args;
+    form->data.cons.cache = NULL;
+    return true;
+}
+
+Object* macro_expansion(Object* args) {
+    if (args->cache_stamp == macro_version) return obj_cdr(args);
+
+    // マクロが再定義された: 元の呼び出しから展開し直す。
+    // マクロでなくなっていれば元の呼び出しをそのまま評価する
+    Object* original = obj_car(args);
+    Object* head = obj_car(original);
+    Object* macro = is_symbol(head) ? evaluator_global_value(head->data.symbol.name) : NULL;
+    Object* expansion = is_macro(macro) ? expand(macro, original) : original;
+    if (!expansion) return obj_nil;
+    args->data.cons.cdr = expansion;
+    args->cache_stamp   = macro_version;
+    return expansion;
+}
+
+//------------------------------------------
+// 評価前の一括展開
+//------------------------------------------
+
+static bool is_shadowed(const Expander* x, const char* name) {
+    for (int i = x->nshadow - 1; i >= 0; i--) {
+        if (strcmp(x->shadow[i], name) == 0) return true;
+    }
+    return false;
+}
+
+static void push_shadow(Expander* x, Object* sym) {
+    if (is_symbol(sym) && x->nshadow < MAX_SHADOW) {
+        x->shadow[x->nshadow++] = sym->data.symbol.name;
+    }
+}
+
+// 先頭の head がローカルに隠されていないマクロの名前なら、そのマクロ
+static Object* global_macro(const Expander* x, Object* head) {
+    if (!is_symbol(head) || head->data.symbol.special != SF_NONE) return NULL;
+    if (is_shadowed(x, head->data.symbol.name)) return NULL;
+    Object* value = evaluator_global_value(head->data.symbol.name);
+    return is_macro(value) ? value : NULL;
+}
+
+static void expand_in(Expander* x, Object* expr);
+
+static void expand_list(Expander* x, Object* list) {
+    for (Object* it = list; is_cons(it); it = obj_cdr(it)) {
+        expand_in(x, obj_car(it));
+    }
+}
+
+static void expand_in(Expander* x, Object* expr) {
+    if (!is_cons(expr)) return;
+
+    Object* args = obj_cdr(expr);
+    int saved = x->nshadow;
+    switch (obj_special_form(obj_car(expr))) {
+        case SF_QUOTE:
+        case SF_DEFMACRO:
+            // マクロ本体は展開時に評価されるのでここでは触らない
+            return;
+        case SF_LAMBDA:
+            for (Object* it = obj_car(args); is_cons(it); it = obj_cdr(it)) push_shadow(x, obj_car(it));
+            expand_list(x, obj_cdr(args));
+            break;
+        case SF_DOTIMES:
+        case SF_LOOP:
+            expand_list(x, obj_cdr(obj_car(args)));
+            push_shadow(x, obj_car(obj_car(args)));
+            expand_list(x, obj_cdr(args));
+            break;
+        case SF_DEFINE:
+        case SF_SET:
+            expand_list(x, obj_cdr(args));
+            break;
+        case SF_EXPANSION:
+            // 展開結果の中のマクロ呼び出しも展開する
+            if (x->depth >= MACRO_MAX_DEPTH) break;
+            x->depth++;
+            expand_in(x, obj_cdr(args));
+            x->depth--;
+            break;
+        default: {
+            Object* macro = global_macro(x, obj_car(expr));
+            if (macro && x->depth < MACRO_MAX_DEPTH && macro_rewrite(expr, macro)) {
+                expand_in(x, expr);
+            } else {
+                expand_list(x, expr);
+            }
+            break;
+        }
+    }
+    x->nshadow = saved;
+}
+
+Object* macro_expand_all(Object* expr) {
+    if (!macros_defined) return expr;
+    Expander x;
+    memset(&x, 0, sizeof(x));
+    expand_in(&x, expr);
+    return expr;
+}
@@ -0,0 +1,39 @@
+// macro.h
+// マクロ（OBJ_MACRO）の展開とコールサイトへの展開結果のキャッシュ。
+// マクロ呼び出し (name args...) は初回の展開時に (macro-expansion original . expansion)
+// の形へその場で書き換え、以降は展開結果をそのまま評価する。
+// マクロが再定義されたら版を進め、古い版で作った展開結果は次の評価時に作り直す。
+
+#ifndef MACRO_H
+#define MACRO_H
+
+#include "object.h"
+
+// マクロの展開がこれより深く入れ子になったら展開をやめる（自分自身へ展開するマクロ対策）
+#define MACRO_MAX_DEPTH 64
+
+// 変換関数 transformer のマクロ（確保できなければ NULL）
+Object* make_macro(Object* transformer);
+
+// マクロの束縛が変わったときに呼ぶ: キャッシュ済みの展開結果をすべて古くする
+void macro_invalidate(void);
+
+// マクロ呼び出し form を展開し、展開済みの印の付いた形へその場で書き換える。
+// 書き換えられなければ false
+bool macro_rewrite(Object* form, Object* macro);
+
+// 展開済みの形の引数部 (original . expansion) から現在の展開結果を返す。
+// マクロが再定義されていれば元の呼び出しから展開し直す
+Object* macro_expansion(Object* args);
+
+// パース直後の構文木を走査し、グローバルに束縛されたマクロの呼び出しを展開しておく
+Object* macro_expand_all(Object* expr);
+
+// これまでにマクロを展開した回数（:mem とテスト用）
+size_t macro_expansion_count(void);
+
+// イメージの保存・復元用: マクロの版（展開結果に記録される）と、マクロが作られたか
+uint32_t macro_state(bool* defined);
+void macro_restore(uint32_t version, bool defined);
+
+#endif // MACRO_H
@@ -7,76 +7,34 @@
 #include "chibi_lisp.h"
 #include "object.h"
 #include "eval.h"
+#include "reader.h"
+#include "image.h"
+#include "printer.h"
 
 static void print_help() {
     printf("chibi-lisp - A minimal Lisp interpreter\n");
-    printf("Usage: chibi-lisp [options]\n");
+    printf("Usage: chibi-lisp [options] [script]\n");
     printf("Options:\n");
     printf("  --debug, -d    Enable debug mode\n");
     printf("  --help, -h     Show this help message\n");
+    printf("  --image FILE   Start from an image written by save-image\n");
+    printf("  script         Evaluate the forms in the file instead of starting the REPL\n");
     printf("\nREPL Commands:\n");
     printf("  :quit          Exit the REPL\n");
     printf("  :mem           Show memory statistics\n");
 }
 
-static void print_obj(Object* obj) {
-    if (!obj) {
-        printf("NULL");
-        return;
-    }
-
-    switch (obj->type) {
-        case OBJ_NIL:
-            printf("nil");
-            break;
-        case OBJ_BOOL:
-            printf(obj->data.number ? "t" : "nil");
-            break;
-        case OBJ_NUMBER:
-            printf("%d", obj->data.number);
-            break;
-        case OBJ_SYMBOL:
-            printf("%s", obj->data.symbol.name ? obj->data.symbol.name : "");
-            break;
-        case OBJ_STRING:
-            printf("\"%s\"", obj->data.string.text ? obj->data.string.text : "");
-            break;
-        case OBJ_CONS:
-            printf("(");
-            Object* current = obj;
-            while (current && current->type == OBJ_CONS) {
-                print_obj(current->data.cons.car);
-                current = current->data.cons.cdr;
-                if (current && current->type == OBJ_CONS) {
-                    printf(" ");
-                } else if (current && current->type != OBJ_NIL) {
-                    printf(" . ");
-                    print_obj(current);
-                    break;
-                }
-            }
-            printf(")");
-            break;
-        case OBJ_FUNCTION:
-            printf("<function>");
-            break;
-        case OBJ_LAMBDA:
-            printf("<lambda>");
-            break;
-        case OBJ_OPERATOR:
-            printf("%s", obj_operator_name(obj));
-            break;
-        case OBJ_BUILTIN:
-            printf("%s", obj_builtin_name(obj));
-            break;
-        default:
-            printf("<unknown>");
-            break;
-    }
+// 入力を待つ前のプロンプト（式の途中なら続きの行のプロンプト）
+static void print_prompt(Reader* reader) {
+    printer_flush();   // ためてある結果を先に出す
+    printf(reader_in_form(reader) ? "... " : "> ");
+    fflush(stdout);
 }
 
 int main(int argc, char* argv[]) {
     int debug_enabled = 0;
+    const char* script = NULL;
+    const char* image = NULL;
 
     // ???????????
     for (int i = 1; i < argc; i++) {
@@ -85,47 +43,58 @@ int main(int argc, char* argv[]) {
         } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
             print_help();
             return 0;
+        } else if (strcmp(argv[i], "--image") == 0 && i + 1 < argc) {
+            image = argv[++i];
+        } else {
+            script = argv[i];
         }
     }
 
     // evaluator???
-    evaluator_init();
+    if (image) {
+        // 保存した環境をそのまま使う（組み込み関数の登録もユーザー定義も評価し直さない）
+        if (!image_load(image)) {
+            fprintf(stderr, "%s: cannot load image\n", image);
+            return 1;
+        }
+    } else {
+        evaluator_init();
+    }
     evaluator_set_debug(debug_enabled);
 
     if (debug_enabled) {
         printf("Debug mode enabled.\n");
     }
 
-    // REPL
-    char line[1024];
-    printf("chibi-lisp REPL. Type :quit to exit, :mem for memory stats.\n");
-    while (1) {
-        printf("> ");
-
-        if (!fgets(line, sizeof(line), stdin)) {
-            break;
-        }
-
-        // ?????
-        size_t len = strlen(line);
-        if (len > 0 && line[len - 1] == '\n') {
-            line[len - 1] = '\0';
-        }
+    if (script) {
+        // 結果もプロンプトも表示せず、トップレベルの式を順に評価する
+        int status = eval_file(script) ? 0 : 1;
+        evaluator_shutdown();
+        return status;
+    }
 
+    // REPL（複数行にまたがる式は閉じるまで読み、1行に複数の式があれば順に評価する）
+    Reader reader;
+    reader_init_file(&reader, stdin);
+    reader.prompt = print_prompt;
+    printf("chibi-lisp REPL. Type :quit to exit, :mem for memory stats.\n");
+    const char* form;
+    while ((form = reader_next(&reader)) != NULL) {
         // REPL??????
-        if (strncmp(line, ":quit", 5) == 0) {
+        if (strncmp(form, ":quit", 5) == 0) {
             break;
         }
-        if (strncmp(line, ":mem", 4) == 0) {
+        if (strncmp(form, ":mem", 4) == 0) {
             evaluator_show_memory_stats();
             continue;
         }
 
         // S???
-        Object* res = eval_string(line);
-        print_obj(res);
-        printf("\n");
+        Object* res = eval_string(form);
+        printer_write_object(res, PRINT_WRITE);
+        printer_write_char('\n');
     }
+    reader_free(&reader);
 
     evaluator_shutdown();
     return 0;
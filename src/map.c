@@ -0,0 +1,316 @@
+// map.c
+// 永続マップ（HAMT）の実装。
+// 節点の配列 slots は (キー, 値) の組を並べたもので、キーが NULL の組は値が子の節点を表す。
+// ビットマップ節点はビットの立っている順に組を持ち、衝突節点（ハッシュを使い切った段。bitmap は 0）は
+// ハッシュが完全に一致するキーの組を並べる。節点は作ったあとは書き換えないので、何世代のマップからでも共有できる。
+// キーは hashtable と同じ equal のハッシュと比較で扱う。
+
+#include "map.h"
+#include "hashtable.h"
+#include "helper.h"
+#include "object_pool.h"
+#include "heap.h"
+#include <string.h>
+
+// 削除で節点が空になったことを表す印（確保に失敗したときの NULL と区別する）
+#define EMPTY_NODE obj_nil
+
+static uint32_t key_hash(Object* key) {
+    return hashtable_hash(key, HASH_EQUAL);
+}
+
+static bool keys_equal(Object* a, Object* b) {
+    return hashtable_keys_equal(a, b, HASH_EQUAL);
+}
+
+// shift 段目で hash が進む分岐の番号
+static uint32_t branch_of(uint32_t hash, int shift) {
+    return (hash >> shift) & (MAP_WIDTH - 1);
+}
+
+//------------------------------------------
+// 節点の確保とコピー
+//------------------------------------------
+
+// count 組分の配列を持つ節点（配列の中身は呼び出し側で埋める）
+static Object* make_node(uint32_t bitmap, uint32_t count) {
+    Object* obj = object_pool_alloc();
+    if (!obj) return NULL;
+    memset(obj, 0, sizeof(Object));  // 全体をゼロクリア
+    obj->type = OBJ_MAPNODE;
+    obj->data.map_node.bitmap = bitmap;
+    obj->data.map_node.count  = count;
+    obj->data.map_node.slots  = heap_alloc(sizeof(Object*) * 2 * count);
+    if (!obj->data.map_node.slots) {
+        object_pool_free(obj);
+        return NULL;
+    }
+    return obj;
+}
+
+// 組 i を (key, value) に置き換えたコピー
+static Object* node_set(Object* node, uint32_t i, Object* key, Object* value) {
+    uint32_t n = node->data.map_node.count;
+    Object* copy = make_node(node->data.map_node.bitmap, n);
+    if (!copy) return NULL;
+    Object** slots = copy->data.map_node.slots;
+    memcpy(slots, node->data.map_node.slots, sizeof(Object*) * 2 * n);
+    slots[2 * i]     = key;
+    slots[2 * i + 1] = value;
+    return copy;
+}
+
+// 位置 i に組 (key, value) を差し込んだコピー
+static Object* node_insert(Object* node, uint32_t bitmap, uint32_t i, Object* key, Object* value) {
+    uint32_t n = node->data.map_node.count;
+    Object* copy = make_node(bitmap, n + 1);
+    if (!copy) return NULL;
+    Object** src = node->data.map_node.slots;
+    Object** dst = copy->data.map_node.slots;
+    memcpy(dst, src, sizeof(Object*) * 2 * i);
+    dst[2 * i]     = key;
+    dst[2 * i + 1] = value;
+    memcpy(dst + 2 * (i + 1), src + 2 * i, sizeof(Object*) * 2 * (n - i));
+    return copy;
+}
+
+// 組 i を除いたコピー（最後の1組なら EMPTY_NODE）
+static Object* node_remove(Object* node, uint32_t bitmap, uint32_t i) {
+    uint32_t n = node->data.map_node.count;
+    if (n == 1) return EMPTY_NODE;
+    Object* copy = make_node(bitmap, n - 1);
+    if (!copy) return NULL;
+    Object** src = node->data.map_node.slots;
+    Object** dst = copy->data.map_node.slots;
+    memcpy(dst, src, sizeof(Object*) * 2 * i);
+    memcpy(dst + 2 * i, src + 2 * (i + 1), sizeof(Object*) * 2 * (n - i - 1));
+    return copy;
+}
+
+// 2組だけを持つ shift 段目以下の部分木（ハッシュの分岐が分かれる段まで1組の節点を重ねる）
+static Object* make_pair_node(int shift, Object* k1, Object* v1, uint32_t h1,
+                              Object* k2, Object* v2, uint32_t h2) {
+    if (shift >= MAP_MAX_SHIFT) {
+        Object* node = make_node(0, 2);
+        if (!node) return NULL;
+        Object** slots = node->data.map_node.slots;
+        slots[0] = k1; slots[1] = v1;
+        slots[2] = k2; slots[3] = v2;
+        return node;
+    }
+    uint32_t b1 = branch_of(h1, shift);
+    uint32_t b2 = branch_of(h2, shift);
+    if (b1 == b2) {
+        Object* child = make_pair_node(shift + MAP_BITS, k1, v1, h1, k2, v2, h2);
+        Object* node = child ? make_node(1u << b1, 1) : NULL;
+        if (!node) return NULL;
+        node->data.map_node.slots[0] = NULL;
+        node->data.map_node.slots[1] = child;
+        return node;
+    }
+    Object* node = make_node((1u << b1) | (1u << b2), 2);
+    if (!node) return NULL;
+    Object** slots = node->data.map_node.slots;
+    int first = b1 < b2 ? 0 : 2;  // ビットの小さい方が先
+    slots[first]     = k1; slots[first + 1]     = v1;
+    slots[2 - first] = k2; slots[2 - first + 1] = v2;
+    return node;
+}
+
+static Object* make_map_with(Object* root, size_t count) {
+    Object* obj = object_pool_alloc();
+    if (!obj) return NULL;
+    memset(obj, 0, sizeof(Object));  // 全体をゼロクリア
+    obj->type = OBJ_MAP;
+    obj->data.map.root  = root;
+    obj->data.map.count = count;
+    return obj;
+}
+
+Object* make_map(void) {
+    return make_map_with(NULL, 0);
+}
+
+//------------------------------------------
+// 参照
+//------------------------------------------
+
+Object* map_get(Object* map, Object* key) {
+    if (!is_map(map) || !key) return NULL;
+    uint32_t hash = key_hash(key);
+    Object* node = map->data.map.root;
+    for (int shift = 0; node; shift += MAP_BITS) {
+        Object** slots = node->data.map_node.slots;
+        if (shift >= MAP_MAX_SHIFT) {
+            for (uint32_t i = 0; i < node->data.map_node.count; i++) {
+                if (keys_equal(slots[2 * i], key)) return slots[2 * i + 1];
+            }
+            return NULL;
+        }
+        uint32_t bit = branch_of(hash, shift);
+        uint32_t bitmap = node->data.map_node.bitmap;
+        if (!(bitmap & (1u << bit))) return NULL;
+        uint32_t i = bitmap_rank32(bitmap, bit);
+        if (slots[2 * i]) return keys_equal(slots[2 * i], key) ? slots[2 * i + 1] : NULL;
+        node = slots[2 * i + 1];
+    }
+    return NULL;
+}
+
+//------------------------------------------
+// 追加・更新
+//------------------------------------------
+
+// node 以下に (key, value) を入れた部分木。変わらなければ node、確保できなければ NULL
+static Object* node_assoc(Object* node, int shift, uint32_t hash, Object* key, Object* value, bool* added) {
+    Object** slots = node->data.map_node.slots;
+    uint32_t n = node->data.map_node.count;
+    if (shift >= MAP_MAX_SHIFT) {
+        for (uint32_t i = 0; i < n; i++) {
+            if (!keys_equal(slots[2 * i], key)) continue;
+            return slots[2 * i + 1] == value ? node : node_set(node, i, slots[2 * i], value);
+        }
+        *added = true;
+        return node_insert(node, 0, n, key, value);
+    }
+
+    uint32_t bit = branch_of(hash, shift);
+    uint32_t bitmap = node->data.map_node.bitmap;
+    uint32_t i = bitmap_rank32(bitmap, bit);
+    if (!(bitmap & (1u << bit))) {
+        *added = true;
+        return node_insert(node, bitmap | (1u << bit), i, key, value);
+    }
+
+    Object* k = slots[2 * i];
+    Object* v = slots[2 * i + 1];
+    if (!k) {
+        Object* child = node_assoc(v, shift + MAP_BITS, hash, key, value, added);
+        if (!child) return NULL;
+        return child == v ? node : node_set(node, i, NULL, child);
+    }
+    if (keys_equal(k, key)) return v == value ? node : node_set(node, i, k, value);
+
+    // 同じ分岐に別のキーがある: 2つのキーを持つ子の節点に押し下げる
+    *added = true;
+    Object* child = make_pair_node(shift + MAP_BITS, k, v, key_hash(k), key, value, hash);
+    return child ? node_set(node, i, NULL, child) : NULL;
+}
+
+Object* map_assoc(Object* map, Object* key, Object* value) {
+    if (!is_map(map) || !key || !value) return NULL;
+    uint32_t hash = key_hash(key);
+    Object* root = map->data.map.root;
+    bool added = false;
+    Object* new_root;
+    if (root) {
+        new_root = node_assoc(root, 0, hash, key, value, &added);
+    } else {
+        added = true;
+        new_root = make_node(1u << branch_of(hash, 0), 1);
+        if (new_root) {
+            new_root->data.map_node.slots[0] = key;
+            new_root->data.map_node.slots[1] = value;
+        }
+    }
+    if (!new_root) return NULL;
+    if (new_root == root) return map;
+    return make_map_with(new_root, map->data.map.count + (added ? 1 : 0));
+}
+
+//------------------------------------------
+// 削除
+//------------------------------------------
+
+// node 以下から key を除いた部分木。変わらなければ node、空になれば EMPTY_NODE、確保できなければ NULL
+static Object* node_dissoc(Object* node, int shift, uint32_t hash, Object* key) {
+    Object** slots = node->data.map_node.slots;
+    if (shift >= MAP_MAX_SHIFT) {
+        for (uint32_t i = 0; i < node->data.map_node.count; i++) {
+            if (keys_equal(slots[2 * i], key)) return node_remove(node, 0, i);
+        }
+        return node;
+    }
+
+    uint32_t bit = branch_of(hash, shift);
+    uint32_t bitmap = node->data.map_node.bitmap;
+    if (!(bitmap & (1u << bit))) return node;
+    uint32_t i = bitmap_rank32(bitmap, bit);
+
+    Object* k = slots[2 * i];
+    Object* v = slots[2 * i + 1];
+    if (k) return keys_equal(k, key) ? node_remove(node, bitmap & ~(1u << bit), i) : node;
+
+    Object* child = node_dissoc(v, shift + MAP_BITS, hash, key);
+    if (!child) return NULL;
+    if (child == v) return node;
+    if (child == EMPTY_NODE) return node_remove(node, bitmap & ~(1u << bit), i);
+    // 子に組が1つしか残らなければ、その組をこの節点に引き上げて段を減らす
+    if (child->data.map_node.count == 1 && child->data.map_node.slots[0]) {
+        return node_set(node, i, child->data.map_node.slots[0], child->data.map_node.slots[1]);
+    }
+    return node_set(node, i, NULL, child);
+}
+
+Object* map_dissoc(Object* map, Object* key) {
+    if (!is_map(map) || !key) return NULL;
+    Object* root = map->data.map.root;
+    if (!root) return map;
+    Object* new_root = node_dissoc(root, 0, key_hash(key), key);
+    if (!new_root) return NULL;
+    if (new_root == root) return map;
+    if (new_root == EMPTY_NODE) return make_map_with(NULL, 0);
+    return make_map_with(new_root, map->data.map.count - 1);
+}
+
+//------------------------------------------
+// 走査と比較
+//------------------------------------------
+
+void map_iter_init(MapIter* it, Object* map) {
+    it->depth = 0;
+    if (is_map(map) && map->data.map.root) {
+        it->nodes[0] = map->data.map.root;
+        it->index[0] = 0;
+        it->depth = 1;
+    }
+}
+
+bool map_iter_next(MapIter* it, Object** key, Object** value) {
+    while (it->depth > 0) {
+        int d = it->depth - 1;
+        Object* node = it->nodes[d];
+        uint32_t i = it->index[d];
+        if (i >= node->data.map_node.count) {
+            it->depth--;
+            continue;
+        }
+        it->index[d] = i + 1;
+        Object* k = node->data.map_node.slots[2 * i];
+        Object* v = node->data.map_node.slots[2 * i + 1];
+        if (k) {
+            *key = k;
+            *value = v;
+            return true;
+        }
+        // 子の節点に降りる
+        it->nodes[it->depth] = v;
+        it->index[it->depth] = 0;
+        it->depth++;
+    }
+    return false;
+}
+
+bool map_equal(Object* a, Object* b) {
+    if (a == b) return true;
+    if (!is_map(a) || !is_map(b) || a->data.map.count != b->data.map.count) return false;
+    MapIter it;
+    Object* key;
+    Object* value;
+    map_iter_init(&it, a);
+    while (map_iter_next(&it, &key, &value)) {
+        Object* other = map_get(b, key);
+        if (!other || !keys_equal(value, other)) return false;
+    }
+    return true;
+}
@@ -0,0 +1,42 @@
+// map.h
+// 永続マップ（OBJ_MAP）の実装。
+// ハッシュ配列マップトライ（HAMT）で、キーのハッシュを5bitずつ区切って32分岐の節点をたどる。
+// 節点（OBJ_MAPNODE）は32bitのビットマップと、立っているビットの数だけの要素の配列を持ち、
+// 要素の位置はビットマップの下位ビットの個数（popcount）で求める。
+// 変更は根から変更箇所までの節点だけをコピーした新しいマップを返し、残りの節点は元のマップと共有する。
+
+#ifndef MAP_H
+#define MAP_H
+
+#include "object.h"
+
+#define MAP_BITS      5                       // 1段で使うハッシュのビット数
+#define MAP_WIDTH     (1u << MAP_BITS)        // 節点の分岐数
+#define MAP_MAX_SHIFT 32                      // これ以上はハッシュが尽きるので衝突節点にする
+#define MAP_MAX_DEPTH (MAP_MAX_SHIFT / MAP_BITS + 2)  // 根から衝突節点までの段数の上限
+
+// 空のマップ（確保できなければ NULL）
+Object* make_map(void);
+
+// キーの値（なければ NULL）
+Object* map_get(Object* map, Object* key);
+// キーに値を設定した新しいマップ。値が同じなら map をそのまま返す。確保できなければ NULL
+Object* map_assoc(Object* map, Object* key, Object* value);
+// キーを除いた新しいマップ。キーがなければ map をそのまま返す。確保できなければ NULL
+Object* map_dissoc(Object* map, Object* key);
+
+// 要素を順にたどるイテレータ（順序はハッシュ順）
+typedef struct {
+    Object*  nodes[MAP_MAX_DEPTH];  // 根からたどっている節点
+    uint32_t index[MAP_MAX_DEPTH];  // 各節点で次に見る要素の位置
+    int      depth;                 // nodes の段数（0 なら終わり）
+} MapIter;
+
+void map_iter_init(MapIter* it, Object* map);
+// 次の要素を key / value に入れる。なければ false
+bool map_iter_next(MapIter* it, Object** key, Object** value);
+
+// 要素がすべて等しい（キーと値を equal で比べる）か
+bool map_equal(Object* a, Object* b);
+
+#endif // MAP_H
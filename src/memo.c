@@ -0,0 +1,156 @@
+// memo.c
+// メモ化関数の結果キャッシュの実装。
+// エントリは固定長の配列に持ち、バケットからの連鎖と LRU の双方向リストを添字でつなぐ。
+
+#include "memo.h"
+#include "hashtable.h"
+#include "object_pool.h"
+#include "heap.h"
+#include <string.h>
+
+static MemoStats total_stats;
+
+//------------------------------------------
+// LRU リストとバケットの操作
+//------------------------------------------
+
+static void lru_unlink(MemoCache* cache, int16_t i) {
+    MemoEntry* e = &cache->entries[i];
+    if (e->newer >= 0) cache->entries[e->newer].older = e->older;
+    else cache->newest = e->older;
+    if (e->older >= 0) cache->entries[e->older].newer = e->newer;
+    else cache->oldest = e->newer;
+    e->newer = e->older = -1;
+}
+
+static void lru_push_newest(MemoCache* cache, int16_t i) {
+    MemoEntry* e = &cache->entries[i];
+    e->newer = -1;
+    e->older = cache->newest;
+    if (cache->newest >= 0) cache->entries[cache->newest].newer = i;
+    cache->newest = i;
+    if (cache->oldest < 0) cache->oldest = i;
+}
+
+static int16_t* bucket_of(MemoCache* cache, uint32_t hash) {
+    return &cache->buckets[hash & (MEMO_BUCKETS - 1)];
+}
+
+// エントリを外して空きリストへ戻す
+static void remove_entry(MemoCache* cache, int16_t i) {
+    MemoEntry* e = &cache->entries[i];
+    for (int16_t* link = bucket_of(cache, e->hash); *link >= 0; link = &cache->entries[*link].chain) {
+        if (*link == i) {
+            *link = e->chain;
+            break;
+        }
+    }
+    lru_unlink(cache, i);
+    e->args = NULL;
+    e->value = NULL;
+    e->chain = cache->free_list;
+    cache->free_list = i;
+    cache->count--;
+    cache->stats.evictions++;
+    total_stats.evictions++;
+}
+
+//------------------------------------------
+// 公開関数
+//------------------------------------------
+
+MemoCache* memo_cache_create(size_t capacity) {
+    MemoCache* cache = heap_alloc(sizeof(MemoCache));
+    if (!cache) return NULL;
+    memset(cache, 0, sizeof(MemoCache));
+    for (int i = 0; i < MEMO_BUCKETS; i++) cache->buckets[i] = -1;
+    for (int i = 0; i < MEMO_CAPACITY; i++) {
+        cache->entries[i].chain = (int16_t)(i + 1 < MEMO_CAPACITY ? i + 1 : -1);
+        cache->entries[i].newer = cache->entries[i].older = -1;
+    }
+    cache->newest = cache->oldest = -1;
+    cache->free_list = 0;
+    cache->capacity = (capacity == 0 || capacity > MEMO_CAPACITY) ? MEMO_CAPACITY : capacity;
+    return cache;
+}
+
+void memo_cache_destroy(MemoCache* cache) {
+    if (cache) heap_free(cache);
+}
+
+Object* memo_cache_lookup(MemoCache* cache, Object* args) {
+    uint32_t hash = hashtable_hash(args, HASH_EQUAL);
+    for (int16_t i = *bucket_of(cache, hash); i >= 0; i = cache->entries[i].chain) {
+        MemoEntry* e = &cache->entries[i];
+        if (e->hash == hash && hashtable_keys_equal(e->args, args, HASH_EQUAL)) {
+            if (cache->newest != i) {
+                lru_unlink(cache, i);
+                lru_push_newest(cache, i);
+            }
+            cache->stats.hits++;
+            total_stats.hits++;
+            return e->value;
+        }
+    }
+    cache->stats.misses++;
+    total_stats.misses++;
+    return NULL;
+}
+
+bool memo_cache_store(MemoCache* cache, Object* args, Object* value) {
+    // 引数リストは呼び出し側のスタック上にあることもあるのでコピーして持つ
+    Object* copy = obj_nil;
+    Object** tail = &copy;
+    for (Object* it = args; is_cons(it); it = it->data.cons.cdr) {
+        Object* cell = make_cons(it->data.cons.car, obj_nil);
+        if (!cell) return false;
+        *tail = cell;
+        tail = &cell->data.cons.cdr;
+    }
+
+    if (cache->count >= cache->capacity) remove_entry(cache, cache->oldest);
+    int16_t i = cache->free_list;
+    MemoEntry* e = &cache->entries[i];
+    cache->free_list = e->chain;
+
+    e->args = copy;
+    e->value = value;
+    e->hash = hashtable_hash(copy, HASH_EQUAL);
+    int16_t* bucket = bucket_of(cache, e->hash);
+    e->chain = *bucket;
+    *bucket = i;
+    lru_push_newest(cache, i);
+    cache->count++;
+    return true;
+}
+
+void memo_cache_drop_unmarked(MemoCache* cache) {
+    int16_t i = cache->oldest;
+    while (i >= 0) {
+        int16_t newer = cache->entries[i].newer;
+        Object* value = cache->entries[i].value;
+        // 固定オブジェクト（nil, t など）はプール外なので常に残る
+        if (object_pool_is_valid(value) && !object_pool_is_marked(object_pool_get_index(value))) {
+            remove_entry(cache, i);
+        }
+        i = newer;
+    }
+}
+
+const MemoStats* memo_total_stats(void) {
+    return &total_stats;
+}
+
+Object* make_memo(Object* function, size_t capacity) {
+    Object* obj = object_pool_alloc();
+    if (!obj) return NULL;
+    memset(obj, 0, sizeof(Object));  // 全体をゼロクリア
+    obj->type = OBJ_MEMO;
+    obj->data.memo.function = function;
+    obj->data.memo.cache = memo_cache_create(capacity);
+    if (!obj->data.memo.cache) {
+        object_pool_free(obj);
+        return NULL;
+    }
+    return obj;
+}
@@ -0,0 +1,57 @@
+// memo.h
+// メモ化関数（OBJ_MEMO）の結果キャッシュ。
+// 引数リストのハッシュと equal 比較で引き、上限を超えたら最も長く使われていないエントリを捨てる（LRU）。
+// GC では引数リストを強参照、結果を弱参照として扱う（結果が他から参照されなければエントリごと消える）。
+
+#ifndef MEMO_H
+#define MEMO_H
+
+#include "object.h"
+
+#define MEMO_CAPACITY 64   // 1関数あたりのエントリ数の上限
+#define MEMO_BUCKETS  128  // ハッシュのバケット数（2のべき）
+
+typedef struct {
+    Object*  args;    // 引数リスト（キャッシュ専用のコピー）
+    Object*  value;   // 結果
+    uint32_t hash;
+    int16_t  chain;   // 同じバケットの次のエントリ / 空きリストの次（-1 で終端）
+    int16_t  newer;   // LRU リストで1つ新しいエントリ（-1 で終端）
+    int16_t  older;   // LRU リストで1つ古いエントリ（-1 で終端）
+} MemoEntry;
+
+// ヒット数などの統計
+typedef struct {
+    size_t hits;
+    size_t misses;
+    size_t evictions;  // 上限または GC で捨てたエントリ数
+} MemoStats;
+
+typedef struct MemoCache {
+    MemoEntry entries[MEMO_CAPACITY];
+    int16_t   buckets[MEMO_BUCKETS];
+    int16_t   newest;     // LRU リストの先頭（-1 で空）
+    int16_t   oldest;     // LRU リストの末尾
+    int16_t   free_list;  // 空きエントリ
+    size_t    count;
+    size_t    capacity;   // エントリ数の上限（MEMO_CAPACITY 以下）
+    MemoStats stats;
+} MemoCache;
+
+MemoCache* memo_cache_create(size_t capacity);
+void memo_cache_destroy(MemoCache* cache);
+
+// 引数リストに対応する結果（なければ NULL）。ヒット / ミスを数える
+Object* memo_cache_lookup(MemoCache* cache, Object* args);
+// 結果を登録する（引数リストはコピーする）。登録できなければ false
+bool memo_cache_store(MemoCache* cache, Object* args, Object* value);
+// GC のマーク後に呼ぶ: マークされなかった結果のエントリを捨てる
+void memo_cache_drop_unmarked(MemoCache* cache);
+
+// 全メモ化関数の統計の合計（:mem 用）
+const MemoStats* memo_total_stats(void);
+
+// 関数 function をメモ化したオブジェクト（確保できなければ NULL）
+Object* make_memo(Object* function, size_t capacity);
+
+#endif // MEMO_H
@@ -0,0 +1,270 @@
+// numkernel.c
+// double 配列の一括演算の実装。
+// スカラー版を基準に、x86 では SSE2 / AVX2 版を用意して関数ポインタの表で切り替える。
+// SIMD 版は複数のアキュムレータで並列に足し、端数はスカラーで処理する。
+
+#include "numkernel.h"
+#include <stdbool.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NUMKERNEL_X86 1
+#include <immintrin.h>
+#else
+#define NUMKERNEL_X86 0
+#endif
+
+typedef struct {
+    double (*sum)(const double* x, size_t n);
+    double (*dot)(const double* x, const double* y, size_t n);
+    void   (*scale)(double* out, const double* x, double k, size_t n);
+    double (*min)(const double* x, size_t n);
+    double (*max)(const double* x, size_t n);
+} Kernels;
+
+//------------------------------------------
+// スカラー版
+//------------------------------------------
+
+static double scalar_sum(const double* x, size_t n) {
+    double sum = 0.0;
+    for (size_t i = 0; i < n; i++) sum += x[i];
+    return sum;
+}
+
+static double scalar_dot(const double* x, const double* y, size_t n) {
+    double sum = 0.0;
+    for (size_t i = 0; i < n; i++) sum += x[i] * y[i];
+    return sum;
+}
+
+static void scalar_scale(double* out, const double* x, double k, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = x[i] * k;
+}
+
+static double scalar_min(const double* x, size_t n) {
+    double m = x[0];
+    for (size_t i = 1; i < n; i++) if (x[i] < m) m = x[i];
+    return m;
+}
+
+static double scalar_max(const double* x, size_t n) {
+    double m = x[0];
+    for (size_t i = 1; i < n; i++) if (x[i] > m) m = x[i];
+    return m;
+}
+
+static const Kernels scalar_kernels = {
+    scalar_sum, scalar_dot, scalar_scale, scalar_min, scalar_max,
+};
+
+#if NUMKERNEL_X86
+
+//------------------------------------------
+// SSE2 版（2要素ずつ、アキュムレータ2本）
+//------------------------------------------
+
+#define SSE2 __attribute__((target("sse2")))
+
+SSE2 static double sse2_hsum(__m128d v) {
+    return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+}
+
+SSE2 static double sse2_sum(const double* x, size_t n) {
+    __m128d a0 = _mm_setzero_pd(), a1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        a0 = _mm_add_pd(a0, _mm_loadu_pd(x + i));
+        a1 = _mm_add_pd(a1, _mm_loadu_pd(x + i + 2));
+    }
+    double sum = sse2_hsum(_mm_add_pd(a0, a1));
+    for (; i < n; i++) sum += x[i];
+    return sum;
+}
+
+SSE2 static double sse2_dot(const double* x, const double* y, size_t n) {
+    __m128d a0 = _mm_setzero_pd(), a1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        a0 = _mm_add_pd(a0, _mm_mul_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+        a1 = _mm_add_pd(a1, _mm_mul_pd(_mm_loadu_pd(x + i + 2), _mm_loadu_pd(y + i + 2)));
+    }
+    double sum = sse2_hsum(_mm_add_pd(a0, a1));
+    for (; i < n; i++) sum += x[i] * y[i];
+    return sum;
+}
+
+SSE2 static void sse2_scale(double* out, const double* x, double k, size_t n) {
+    __m128d kv = _mm_set1_pd(k);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) _mm_storeu_pd(out + i, _mm_mul_pd(_mm_loadu_pd(x + i), kv));
+    for (; i < n; i++) out[i] = x[i] * k;
+}
+
+SSE2 static double sse2_min(const double* x, size_t n) {
+    if (n < 2) return x[0];
+    __m128d m = _mm_loadu_pd(x);
+    size_t i = 2;
+    for (; i + 2 <= n; i += 2) m = _mm_min_pd(m, _mm_loadu_pd(x + i));
+    m = _mm_min_sd(m, _mm_unpackhi_pd(m, m));
+    double result = _mm_cvtsd_f64(m);
+    for (; i < n; i++) if (x[i] < result) result = x[i];
+    return result;
+}
+
+SSE2 static double sse2_max(const double* x, size_t n) {
+    if (n < 2) return x[0];
+    __m128d m = _mm_loadu_pd(x);
+    size_t i = 2;
+    for (; i + 2 <= n; i += 2) m = _mm_max_pd(m, _mm_loadu_pd(x + i));
+    m = _mm_max_sd(m, _mm_unpackhi_pd(m, m));
+    double result = _mm_cvtsd_f64(m);
+    for (; i < n; i++) if (x[i] > result) result = x[i];
+    return result;
+}
+
+static const Kernels sse2_kernels = {
+    sse2_sum, sse2_dot, sse2_scale, sse2_min, sse2_max,
+};
+
+//------------------------------------------
+// AVX2 版（4要素ずつ、アキュムレータ2本）
+//------------------------------------------
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static double avx2_hsum(__m256d v) {
+    __m128d lo = _mm256_castpd256_pd128(v);
+    __m128d hi = _mm256_extractf128_pd(v, 1);
+    lo = _mm_add_pd(lo, hi);
+    return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+}
+
+AVX2 static double avx2_sum(const double* x, size_t n) {
+    __m256d a0 = _mm256_setzero_pd(), a1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        a0 = _mm256_add_pd(a0, _mm256_loadu_pd(x + i));
+        a1 = _mm256_add_pd(a1, _mm256_loadu_pd(x + i + 4));
+    }
+    double sum = avx2_hsum(_mm256_add_pd(a0, a1));
+    for (; i < n; i++) sum += x[i];
+    return sum;
+}
+
+AVX2 static double avx2_dot(const double* x, const double* y, size_t n) {
+    __m256d a0 = _mm256_setzero_pd(), a1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        a0 = _mm256_add_pd(a0, _mm256_mul_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+        a1 = _mm256_add_pd(a1, _mm256_mul_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4)));
+    }
+    double sum = avx2_hsum(_mm256_add_pd(a0, a1));
+    for (; i < n; i++) sum += x[i] * y[i];
+    return sum;
+}
+
+AVX2 static void avx2_scale(double* out, const double* x, double k, size_t n) {
+    __m256d kv = _mm256_set1_pd(k);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(x + i), kv));
+    for (; i < n; i++) out[i] = x[i] * k;
+}
+
+AVX2 static double avx2_min(const double* x, size_t n) {
+    if (n < 4) return scalar_min(x, n);
+    __m256d m = _mm256_loadu_pd(x);
+    size_t i = 4;
+    for (; i + 4 <= n; i += 4) m = _mm256_min_pd(m, _mm256_loadu_pd(x + i));
+    double lanes[4];
+    _mm256_storeu_pd(lanes, m);
+    double result = scalar_min(lanes, 4);
+    for (; i < n; i++) if (x[i] < result) result = x[i];
+    return result;
+}
+
+AVX2 static double avx2_max(const double* x, size_t n) {
+    if (n < 4) return scalar_max(x, n);
+    __m256d m = _mm256_loadu_pd(x);
+    size_t i = 4;
+    for (; i + 4 <= n; i += 4) m = _mm256_max_pd(m, _mm256_loadu_pd(x + i));
+    double lanes[4];
+    _mm256_storeu_pd(lanes, m);
+    double result = scalar_max(lanes, 4);
+    for (; i < n; i++) if (x[i] > result) result = x[i];
+    return result;
+}
+
+static const Kernels avx2_kernels = {
+    avx2_sum, avx2_dot, avx2_scale, avx2_min, avx2_max,
+};
+
+#endif // NUMKERNEL_X86
+
+//------------------------------------------
+// 実行時の選択
+//------------------------------------------
+
+static const Kernels* kernels = NULL;
+static NumKernelIsa current_isa = NUMKERNEL_SCALAR;
+
+// CPU が対応している最上位の命令セット
+static NumKernelIsa detect_isa(void) {
+#if NUMKERNEL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return NUMKERNEL_AVX2;
+    if (__builtin_cpu_supports("sse2")) return NUMKERNEL_SSE2;
+#endif
+    return NUMKERNEL_SCALAR;
+}
+
+NumKernelIsa numkernel_set_isa(NumKernelIsa limit) {
+    NumKernelIsa isa = detect_isa();
+    if (isa > limit) isa = limit;
+    switch (isa) {
+#if NUMKERNEL_X86
+        case NUMKERNEL_AVX2: kernels = &avx2_kernels; break;
+        case NUMKERNEL_SSE2: kernels = &sse2_kernels; break;
+#endif
+        default:             kernels = &scalar_kernels; isa = NUMKERNEL_SCALAR; break;
+    }
+    current_isa = isa;
+    return isa;
+}
+
+static const Kernels* get_kernels(void) {
+    if (!kernels) numkernel_set_isa(NUMKERNEL_AVX2);
+    return kernels;
+}
+
+NumKernelIsa numkernel_isa(void) {
+    get_kernels();
+    return current_isa;
+}
+
+const char* numkernel_isa_name(NumKernelIsa isa) {
+    switch (isa) {
+        case NUMKERNEL_AVX2: return "avx2";
+        case NUMKERNEL_SSE2: return "sse2";
+        default:             return "scalar";
+    }
+}
+
+double numkernel_sum(const double* x, size_t n) {
+    return get_kernels()->sum(x, n);
+}
+
+double numkernel_dot(const double* x, const double* y, size_t n) {
+    return get_kernels()->dot(x, y, n);
+}
+
+void numkernel_scale(double* out, const double* x, double k, size_t n) {
+    get_kernels()->scale(out, x, k, n);
+}
+
+double numkernel_min(const double* x, size_t n) {
+    return get_kernels()->min(x, n);
+}
+
+double numkernel_max(const double* x, size_t n) {
+    return get_kernels()->max(x, n);
+}
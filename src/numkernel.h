@@ -0,0 +1,33 @@
+// numkernel.h
+// double 配列に対する一括数値演算（合計・内積・スカラー倍・最小・最大）。
+// x86 では実行時に CPU を調べて AVX2 / SSE2 版を選び、それ以外はスカラー版を使う。
+// SIMD 版は足し合わせる順序がスカラー版と異なるため、丸め誤差の出方が変わることがある。
+
+#ifndef NUMKERNEL_H
+#define NUMKERNEL_H
+
+#include <stddef.h>
+
+typedef enum {
+    NUMKERNEL_SCALAR,
+    NUMKERNEL_SSE2,
+    NUMKERNEL_AVX2,
+} NumKernelIsa;
+
+// 現在使われている命令セット
+NumKernelIsa numkernel_isa(void);
+const char* numkernel_isa_name(NumKernelIsa isa);
+
+// 使う命令セットの上限を設定する（テスト・ベンチ用）。
+// CPU が対応していない分は自動的に下げる。実際に選ばれた命令セットを返す
+NumKernelIsa numkernel_set_isa(NumKernelIsa limit);
+
+double numkernel_sum(const double* x, size_t n);
+double numkernel_dot(const double* x, const double* y, size_t n);
+// out[i] = x[i] * k（out と x は同じ配列でもよい）
+void numkernel_scale(double* out, const double* x, double k, size_t n);
+// n は1以上であること。NaN を含むときの結果は未規定
+double numkernel_min(const double* x, size_t n);
+double numkernel_max(const double* x, size_t n);
+
+#endif // NUMKERNEL_H
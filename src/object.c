@@ -4,6 +4,10 @@
 #include "object_pool.h"
 #include "gc.h"
 #include "heap.h"
+#include "bignum.h"
+#include "hashtable.h"
+#include "memo.h"
+#include "printer.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -16,42 +20,40 @@ static const Object fixed_true  = {.type = OBJ_BOOL, .data.number = 1};
 static const Object fixed_false = {.type = OBJ_BOOL, .data.number = 0};
 static const Object fixed_void  = {.type = OBJ_VOID};
 
-// 演算子シンボル定数オブジェクト
-static const char plus_name[]     = "+";
-static const char minus_name[]    = "-";
-static const char asterisk_name[] = "*";
-static const char slash_name[]    = "/";
-static const char eq_name[]       = "=";
-static const char lt_name[]       = "<";
-static const char gt_name[]       = ">";
-static const char lte_name[]      = "<=";
-static const char gte_name[]      = ">=";
-
-// 演算子定数オブジェクト
-static const Object fixed_plus     = {.type = OBJ_OPERATOR, .data.operator_type = OP_PLUS};
-static const Object fixed_minus    = {.type = OBJ_OPERATOR, .data.operator_type = OP_MINUS};
-static const Object fixed_asterisk = {.type = OBJ_OPERATOR, .data.operator_type = OP_ASTERISK};
-static const Object fixed_slash    = {.type = OBJ_OPERATOR, .data.operator_type = OP_SLASH};
-static const Object fixed_eq       = {.type = OBJ_OPERATOR, .data.operator_type = OP_EQ};
-static const Object fixed_lt       = {.type = OBJ_OPERATOR, .data.operator_type = OP_LT};
-static const Object fixed_gt       = {.type = OBJ_OPERATOR, .data.operator_type = OP_GT};
-static const Object fixed_lte      = {.type = OBJ_OPERATOR, .data.operator_type = OP_LTE};
-static const Object fixed_gte      = {.type = OBJ_OPERATOR, .data.operator_type = OP_GTE};
-
-// 組み込み関数定数オブジェクト
-static const Object fixed_print    = {.type = OBJ_BUILTIN, .data.builtin_type = BUILTIN_PRINT};
-static const Object fixed_println  = {.type = OBJ_BUILTIN, .data.builtin_type = BUILTIN_PRINTLN};
-static const Object fixed_str      = {.type = OBJ_BUILTIN, .data.builtin_type = BUILTIN_STR};
-static const Object fixed_length   = {.type = OBJ_BUILTIN, .data.builtin_type = BUILTIN_LENGTH};
-static const Object fixed_boolp    = {.type = OBJ_BUILTIN, .data.builtin_type = BUILTIN_BOOLP};
-
-// タイマー関数定数オブジェクト
-static const Object fixed_now      = {.type = OBJ_BUILTIN, .data.builtin_type = BUILTIN_NOW};
-static const Object fixed_sleep    = {.type = OBJ_BUILTIN, .data.builtin_type = BUILTIN_SLEEP};
-static const Object fixed_time_diff = {.type = OBJ_BUILTIN, .data.builtin_type = BUILTIN_TIME_DIFF};
-
-// ループ制御関数定数オブジェクト
-static const Object fixed_dotimes   = {.type = OBJ_BUILTIN, .data.builtin_type = BUILTIN_DOTIMES};
+// 演算子・組み込み関数の定数オブジェクト（登録表 builtins.inc から生成）
+static const Object fixed_operators[OP_COUNT] = {
+#define OPERATOR(id, name, func, min_arity, max_arity, pure) [id] = {.type = OBJ_OPERATOR, .data.operator_type = id},
+#include "builtins.inc"
+};
+static const Object fixed_builtins[BUILTIN_COUNT] = {
+#define BUILTIN(id, name, func, min_arity, max_arity, pure) [id] = {.type = OBJ_BUILTIN, .data.builtin_type = id},
+#include "builtins.inc"
+};
+static const char* const operator_names[OP_COUNT] = {
+#define OPERATOR(id, name, func, min_arity, max_arity, pure) [id] = name,
+#include "builtins.inc"
+};
+static const char* const builtin_names[BUILTIN_COUNT] = {
+#define BUILTIN(id, name, func, min_arity, max_arity, pure) [id] = name,
+#include "builtins.inc"
+};
+
+// 特殊形式シンボル定数オブジェクト
+// パーサは特殊形式のキーワードをこれらに置き換えるため、評価器はタグだけで判定できる
+#define SPECIAL_SYMBOL(form, str) \
+    [form] = {.type = OBJ_SYMBOL, .data.symbol = {.name = (char*)(str), .length = sizeof(str) - 1, .special = (form)}}
+static const Object fixed_special_symbols[SF_COUNT] = {
+    SPECIAL_SYMBOL(SF_QUOTE,     "quote"),
+    SPECIAL_SYMBOL(SF_IF,        "if"),
+    SPECIAL_SYMBOL(SF_DEFINE,    "define"),
+    SPECIAL_SYMBOL(SF_SET,       "set!"),
+    SPECIAL_SYMBOL(SF_LAMBDA,    "lambda"),
+    SPECIAL_SYMBOL(SF_LOOP,      "loop"),
+    SPECIAL_SYMBOL(SF_DOTIMES,   "dotimes"),
+    SPECIAL_SYMBOL(SF_DEFMACRO,  "defmacro"),
+    SPECIAL_SYMBOL(SF_EXPANSION, "macro-expansion"),
+};
+#undef SPECIAL_SYMBOL
 
 // 固定オブジェクトへのアクセス関数（const修飾子を適切に処理）
 Object* get_nil(void) { return (Object*)&fixed_nil; }
@@ -60,38 +62,37 @@ Object* get_false(void) { return (Object*)&fixed_false; }
 Object* get_void(void) { return (Object*)&fixed_void; }
 
 // 演算子定数オブジェクトへのアクセス関数
-Object* get_plus(void) { return (Object*)&fixed_plus; }
-Object* get_minus(void) { return (Object*)&fixed_minus; }
-Object* get_asterisk(void) { return (Object*)&fixed_asterisk; }
-Object* get_slash(void) { return (Object*)&fixed_slash; }
-Object* get_eq(void) { return (Object*)&fixed_eq; }
-Object* get_lt(void) { return (Object*)&fixed_lt; }
-Object* get_gt(void) { return (Object*)&fixed_gt; }
-Object* get_lte(void) { return (Object*)&fixed_lte; }
-Object* get_gte(void) { return (Object*)&fixed_gte; }
+Object* get_plus(void) { return get_operator(OP_PLUS); }
+Object* get_minus(void) { return get_operator(OP_MINUS); }
+Object* get_asterisk(void) { return get_operator(OP_ASTERISK); }
+Object* get_slash(void) { return get_operator(OP_SLASH); }
+Object* get_eq(void) { return get_operator(OP_EQ); }
+Object* get_lt(void) { return get_operator(OP_LT); }
+Object* get_gt(void) { return get_operator(OP_GT); }
+Object* get_lte(void) { return get_operator(OP_LTE); }
+Object* get_gte(void) { return get_operator(OP_GTE); }
 
 // 組み込み関数定数オブジェクトへのアクセス関数
-Object* get_print(void) { return (Object*)&fixed_print; }
-Object* get_println(void) { return (Object*)&fixed_println; }
-Object* get_str(void) { return (Object*)&fixed_str; }
-Object* get_length(void) { return (Object*)&fixed_length; }
-Object* get_boolp(void) { return (Object*)&fixed_boolp; }
+Object* get_print(void) { return get_builtin(BUILTIN_PRINT); }
+Object* get_println(void) { return get_builtin(BUILTIN_PRINTLN); }
+Object* get_str(void) { return get_builtin(BUILTIN_STR); }
+Object* get_length(void) { return get_builtin(BUILTIN_LENGTH); }
+Object* get_boolp(void) { return get_builtin(BUILTIN_BOOLP); }
 
 // タイマー関数定数オブジェクトへのアクセス関数
-Object* get_now(void) { return (Object*)&fixed_now; }
-Object* get_sleep(void) { return (Object*)&fixed_sleep; }
-Object* get_time_diff(void) { return (Object*)&fixed_time_diff; }
+Object* get_now(void) { return get_builtin(BUILTIN_NOW); }
+Object* get_sleep(void) { return get_builtin(BUILTIN_SLEEP); }
+Object* get_time_diff(void) { return get_builtin(BUILTIN_TIME_DIFF); }
 
-// ループ制御関数定数オブジェクトへのアクセス関数
-Object* get_dotimes(void) { return (Object*)&fixed_dotimes; }
+Object* get_operator(OperatorType op) { return (Object*)&fixed_operators[op]; }
+Object* get_builtin(BuiltinType builtin) { return (Object*)&fixed_builtins[builtin]; }
 
+// 特殊形式シンボル定数オブジェクトへのアクセス関数
+Object* get_special_symbol(SpecialFormType form) {
+    if (form <= SF_NONE || form >= SF_COUNT) return NULL;
+    return (Object*)&fixed_special_symbols[form];
+}
 
-// 内部定数（このファイルでのみ使用）
-static const char* const NIL_STRING = "nil";
-static const char* const TRUE_STRING = "t";
-static const char* const FALSE_STRING = "nil";
-static const char* const FUNCTION_PREFIX = "#<function>";
-static const char* const LAMBDA_PREFIX = "#<lambda>";
 
 //------------------------------------------
 // オブジェクトシステム初期化
@@ -112,7 +113,7 @@ void object_system_cleanup(void) {
 //------------------------------------------
 // オブジェクト作成関数
 //------------------------------------------
-Object* make_number(int value) {
+Object* make_number(int64_t value) {
     Object* obj = object_pool_alloc();
     if (!obj) return NULL;
     memset(obj, 0, sizeof(Object));  // 全体をゼロクリア
@@ -121,33 +122,81 @@ Object* make_number(int value) {
     return obj;
 }
 
+Object* make_bignum(const uint32_t* limbs, size_t count, bool negative) {
+    Object* obj = object_pool_alloc();
+    if (!obj) return NULL;
+    memset(obj, 0, sizeof(Object));  // 全体をゼロクリア
+    obj->type = OBJ_BIGNUM;
+    obj->data.bignum.limbs = heap_alloc(sizeof(uint32_t) * count);
+    if (!obj->data.bignum.limbs) {
+        object_pool_free(obj);
+        return NULL;
+    }
+    memcpy(obj->data.bignum.limbs, limbs, sizeof(uint32_t) * count);
+    obj->data.bignum.count    = count;
+    obj->data.bignum.negative = negative;
+    return obj;
+}
+
+Object* make_float(double value) {
+    Object* obj = object_pool_alloc();
+    if (!obj) return NULL;
+    memset(obj, 0, sizeof(Object));  // 全体をゼロクリア
+    obj->type      = OBJ_FLOAT;
+    obj->data.real = value;
+    return obj;
+}
+
 Object* make_string(const char* text) {
+    return make_string_len(text, strlen(text));
+}
+
+// text の先頭 length バイト（'\0' 終端でなくてよい）をコピーした文字列
+Object* make_string_len(const char* text, size_t length) {
     Object* obj = object_pool_alloc();
     if (!obj) return NULL;
     memset(obj, 0, sizeof(Object));  // 全体をゼロクリア
     obj->type               = OBJ_STRING;
-    obj->data.string.length = strlen(text);
-    obj->data.string.text   = heap_alloc(obj->data.string.length + 1);
+    obj->data.string.length = length;
+    obj->data.string.text   = heap_alloc(length + 1);
     if (!obj->data.string.text) {
         object_pool_free(obj);
         return NULL;
     }
-    strcpy(obj->data.string.text, text);
+    memcpy(obj->data.string.text, text, length);
+    obj->data.string.text[length] = '\0';
+    return obj;
+}
+
+// heap_alloc で確保済みの text（'\0' 終端）をそのまま本体にする。失敗しても text は解放しない
+Object* make_string_owned(char* text, size_t length) {
+    Object* obj = object_pool_alloc();
+    if (!obj) return NULL;
+    memset(obj, 0, sizeof(Object));  // 全体をゼロクリア
+    obj->type               = OBJ_STRING;
+    obj->data.string.text   = text;
+    obj->data.string.length = length;
     return obj;
 }
 
 Object* make_symbol(const char* name) {
+    return make_symbol_len(name, strlen(name));
+}
+
+// name の先頭 length バイト（'\0' 終端でなくてよい）を名前にしたシンボル
+Object* make_symbol_len(const char* name, size_t length) {
     Object* obj = object_pool_alloc();
     if (!obj) return NULL;
     memset(obj, 0, sizeof(Object));  // 全体をゼロクリア
-    obj->type              = OBJ_SYMBOL;
-    obj->data.symbol.length = strlen(name);
-    obj->data.symbol.name  = heap_alloc(obj->data.symbol.length + 1);
+    obj->type               = OBJ_SYMBOL;
+    obj->data.symbol.length = length;
+    obj->data.symbol.name   = heap_alloc(length + 1);
     if (!obj->data.symbol.name) {
         object_pool_free(obj);
         return NULL;
     }
-    strcpy(obj->data.symbol.name, name);
+    memcpy(obj->data.symbol.name, name, length);
+    obj->data.symbol.name[length] = '\0';
     return obj;
 }
 
@@ -167,19 +216,59 @@ Object* make_function(Object* (*func)(Object*)) {
     memset(obj, 0, sizeof(Object));  // 全体をゼロクリア
     obj->type                      = OBJ_FUNCTION;
     obj->data.function.native_func = func;
-    obj->data.function.params      = NULL;
-    obj->data.function.body        = NULL;
+    obj->data.function.spec        = NULL;
     return obj;
 }
 
 Object* make_lambda(Object* params, Object* body) {
+    return make_closure(params, body, NULL);
+}
+
+Object* make_closure(Object* params, Object* body, Object* captured) {
+    Object* obj = object_pool_alloc();
+    if (!obj) return NULL;
+    memset(obj, 0, sizeof(Object));  // 全体をゼロクリア
+    obj->type                 = OBJ_LAMBDA;
+    obj->data.lambda.params   = params;
+    obj->data.lambda.body     = body;
+    obj->data.lambda.captured = captured;
+    return obj;
+}
+
+Object* make_frame(size_t count, Object* link) {
     Object* obj = object_pool_alloc();
     if (!obj) return NULL;
     memset(obj, 0, sizeof(Object));  // 全体をゼロクリア
-    obj->type                   = OBJ_LAMBDA;
-    obj->data.function.params   = params;
-    obj->data.function.body     = body;
-    obj->data.function.native_func = NULL;
+    obj->type             = OBJ_FRAME;
+    obj->data.frame.count = count;
+    obj->data.frame.link  = link;
+    if (count > 0) {
+        obj->data.frame.slots = heap_alloc(sizeof(Object*) * count);
+        if (!obj->data.frame.slots) {
+            object_pool_free(obj);
+            return NULL;
+        }
+        for (size_t i = 0; i < count; i++) obj->data.frame.slots[i] = obj_nil;
+    }
+    return obj;
+}
+
+// 要素をすべて fill で埋めたベクタ。VECTOR_MAX_LENGTH を超えたら NULL
+Object* make_vector(size_t length, Object* fill) {
+    if (length > VECTOR_MAX_LENGTH) return NULL;
+    Object* obj = object_pool_alloc();
+    if (!obj) return NULL;
+    memset(obj, 0, sizeof(Object));  // 全体をゼロクリア
+    obj->type               = OBJ_VECTOR;
+    obj->data.vector.length = length;
+    if (length > 0) {
+        obj->data.vector.items = heap_alloc(sizeof(Object*) * length);
+        if (!obj->data.vector.items) {
+            object_pool_free(obj);
+            return NULL;
+        }
+        for (size_t i = 0; i < length; i++) obj->data.vector.items[i] = fill;
+    }
     return obj;
 }
 
@@ -216,19 +305,24 @@ Object* make_builtin(BuiltinType builtin_type) {
 //------------------------------------------
 // 演算子定数オブジェクト取得関数
 //------------------------------------------
-Object* get_operator_symbol(const char* op) {
-    if (strcmp(op, "+") == 0) return obj_plus;
-    if (strcmp(op, "-") == 0) return obj_minus;
-    if (strcmp(op, "*") == 0) return obj_asterisk;
-    if (strcmp(op, "/") == 0) return obj_slash;
-    if (strcmp(op, "=") == 0) return obj_eq;
-    if (strcmp(op, "<") == 0) return obj_lt;
-    if (strcmp(op, ">") == 0) return obj_gt;
-    if (strcmp(op, "<=") == 0) return obj_lte;
-    if (strcmp(op, ">=") == 0) return obj_gte;
+static bool name_equals(const char* name, const char* text, size_t length) {
+    return strncmp(name, text, length) == 0 && name[length] == '\0';
+}
+
+Object* get_fixed_callee_len(const char* name, size_t length) {
+    for (int i = 0; i < OP_COUNT; i++) {
+        if (name_equals(operator_names[i], name, length)) return get_operator((OperatorType)i);
+    }
+    for (int i = 0; i < BUILTIN_COUNT; i++) {
+        if (name_equals(builtin_names[i], name, length)) return get_builtin((BuiltinType)i);
+    }
     return NULL;  // 見つからない場合
 }
 
+Object* get_fixed_callee(const char* name) {
+    return get_fixed_callee_len(name, strlen(name));
+}
+
 //------------------------------------------
 // 型チェック関数
 //------------------------------------------
@@ -239,16 +333,33 @@ bool is_symbol(Object* obj) { return obj && obj->type == OBJ_SYMBOL; }
 bool is_cons(Object* obj) { return obj && obj->type == OBJ_CONS; }
 bool is_function(Object* obj) { return obj && obj->type == OBJ_FUNCTION; }
 bool is_lambda(Object* obj) { return obj && obj->type == OBJ_LAMBDA; }
+bool is_frame(Object* obj) { return obj && obj->type == OBJ_FRAME; }
+bool is_vector(Object* obj) { return obj && obj->type == OBJ_VECTOR; }
+bool is_hashtable(Object* obj) { return obj && obj->type == OBJ_HASHTABLE; }
+bool is_map(Object* obj) { return obj && obj->type == OBJ_MAP; }
+bool is_macro(Object* obj) { return obj && obj->type == OBJ_MACRO; }
 bool is_operator(Object* obj) { return obj && obj->type == OBJ_OPERATOR; }
 bool is_builtin(Object* obj) { return obj && obj->type == OBJ_BUILTIN; }
 
 //------------------------------------------
 // アクセサ関数
 //------------------------------------------
-int obj_number_value(Object* obj) {
+int64_t obj_number_value(Object* obj) {
     return is_number(obj) ? obj->data.number : 0;
 }
 
+size_t format_float(double value, char* buf, size_t size) {
+    char tmp[40];
+    int length = snprintf(tmp, sizeof(tmp), "%.15g", value);
+    // 整数に見える表記には ".0" を付けて整数と区別する
+    if (!strpbrk(tmp, ".eEn")) {
+        memcpy(tmp + length, ".0", 3);
+        length += 2;
+    }
+    if (size > 0) snprintf(buf, size, "%s", tmp);
+    return (size_t)length;
+}
+
 const char* obj_string_text(Object* obj) {
     return is_string(obj) ? obj->data.string.text : "";
 }
@@ -270,38 +381,21 @@ OperatorType obj_operator_type(Object* obj) {
 }
 
 const char* obj_operator_name(Object* obj) {
-    if (!is_operator(obj)) return "";
-    switch (obj->data.operator_type) {
-        case OP_PLUS:     return "+";
-        case OP_MINUS:    return "-";
-        case OP_ASTERISK: return "*";
-        case OP_SLASH:    return "/";
-        case OP_EQ:       return "=";
-        case OP_LT:       return "<";
-        case OP_GT:       return ">";
-        case OP_LTE:      return "<=";
-        case OP_GTE:      return ">=";
-        default:          return "";
-    }
+    if (!is_operator(obj) || obj->data.operator_type >= OP_COUNT) return "";
+    return operator_names[obj->data.operator_type];
 }
 
 BuiltinType obj_builtin_type(Object* obj) {
     return is_builtin(obj) ? obj->data.builtin_type : BUILTIN_PRINT; // デフォルト値
 }
 
+SpecialFormType obj_special_form(Object* obj) {
+    return is_symbol(obj) ? obj->data.symbol.special : SF_NONE;
+}
+
 const char* obj_builtin_name(Object* obj) {
-    if (!is_builtin(obj)) return "";
-    switch (obj->data.builtin_type) {
-        case BUILTIN_PRINT:    return "print";
-        case BUILTIN_PRINTLN:  return "println";
-        case BUILTIN_STR:      return "str";
-        case BUILTIN_LENGTH:   return "length";
-        case BUILTIN_BOOLP:    return "bool?";
-        case BUILTIN_NOW:      return "now";
-        case BUILTIN_SLEEP:    return "sleep";
-        case BUILTIN_TIME_DIFF: return "time-diff";
-        default:               return "";
-    }
+    if (!is_builtin(obj) || obj->data.builtin_type >= BUILTIN_COUNT) return "";
+    return builtin_names[obj->data.builtin_type];
 }
 
 //------------------------------------------
@@ -335,48 +429,7 @@ Object* obj_list_append(Object* list1, Object* list2) {
 // デバッグ用関数
 //------------------------------------------
 void object_dump(Object* obj) {
-    if (!obj) {
-        printf("NULL");
-        return;
-    }
-
-    switch (obj->type) {
-        case OBJ_NIL:
-            printf(NIL_STRING);
-            break;
-        case OBJ_BOOL:
-            printf(obj->data.number ? TRUE_STRING : NIL_STRING);
-            break;
-        case OBJ_NUMBER:
-            printf("%d", obj->data.number);
-            break;
-        case OBJ_STRING:
-            printf("\"%s\"", obj->data.string.text);
-            break;
-        case OBJ_SYMBOL:
-            printf("%s", obj->data.symbol.name);
-            break;
-        case OBJ_CONS:
-            printf("(");
-            object_dump(obj->data.cons.car);
-            printf(" . ");
-            object_dump(obj->data.cons.cdr);
-            printf(")");
-            break;
-        case OBJ_FUNCTION:
-            printf(FUNCTION_PREFIX);
-            break;
-        case OBJ_LAMBDA:
-            printf(LAMBDA_PREFIX);
-            break;
-        case OBJ_OPERATOR:
-            printf("%s", obj_operator_name(obj));
-            break;
-        case OBJ_BUILTIN:
-            printf("%s", obj_builtin_name(obj));
-            break;
-        case OBJ_VOID:
-            printf("#<void>");
-            break;
-    }
-}
\ No newline at end of file
+    // 前後の printf と順序が入れ替わらないよう、書いたらすぐ書き出す
+    printer_write_object(obj, PRINT_DUMP);
+    printer_flush();
+}
@@ -19,36 +19,54 @@ typedef enum {
     OBJ_OPERATOR,   // 演算子 (+, -, *, /, =, <, >, <=, >=)
     OBJ_BUILTIN,    // 組み込み関数 (print, println, str, length, bool?)
     OBJ_VOID,       // void (REPLで表示しない戻り値)
+    OBJ_FRAME,      // 変数スロットの配列 (呼び出しフレーム / 捕捉変数)
+    OBJ_BIGNUM,     // 多倍長整数 (int64_t に収まらない整数)
+    OBJ_FLOAT,      // 浮動小数点数 (double)
+    OBJ_VECTOR,     // ベクタ (要素を連続領域に持つ配列)
+    OBJ_HASHTABLE,  // ハッシュテーブル
+    OBJ_MEMO,       // メモ化関数 (結果キャッシュ付きの関数)
+    OBJ_MACRO,      // マクロ (引数の式を受け取って展開形を返す関数)
+    OBJ_MAP,        // 永続マップ (変更すると新しいマップを返す)
+    OBJ_MAPNODE,    // 永続マップの節点 (OBJ_MAP の内部でだけ使う)
 } ObjectType;
 
-// 演算子の種類
+// 演算子の種類 (+, -, *, /, =, <, >, <=, >=。一覧は builtins.inc)
 typedef enum {
-    OP_PLUS,        // +
-    OP_MINUS,       // -
-    OP_ASTERISK,    // *
-    OP_SLASH,       // /
-    OP_EQ,          // =
-    OP_LT,          // <
-    OP_GT,          // >
-    OP_LTE,         // <=
-    OP_GTE,         // >=
+#define OPERATOR(id, name, func, min_arity, max_arity, pure) id,
+#include "builtins.inc"
+    OP_COUNT,
 } OperatorType;
 
-// 組み込み関数の種類
+// 組み込み関数の種類 (一覧は builtins.inc)
 typedef enum {
-    BUILTIN_PRINT,    // print
-    BUILTIN_PRINTLN,  // println
-    BUILTIN_STR,      // str
-    BUILTIN_LENGTH,   // length
-    BUILTIN_BOOLP,    // bool?
-    // タイマー関数
-    BUILTIN_NOW,      // now (現在時刻のミリ秒取得)
-    BUILTIN_SLEEP,    // sleep (指定秒数待機)
-    BUILTIN_TIME_DIFF, // time-diff (時間差計算)
-    // ループ制御関数
-    BUILTIN_DOTIMES,   // dotime (指定回数繰り返し)
+#define BUILTIN(id, name, func, min_arity, max_arity, pure) id,
+#include "builtins.inc"
+    BUILTIN_COUNT,
 } BuiltinType;
 
+// 演算子・組み込み関数の登録情報 (builtins.inc の1行)
+typedef struct BuiltinSpec {
+    const char* name;
+    int min_arity;   // 最小引数数
+    int max_arity;   // 最大引数数 (-1 は可変長)
+    bool pure;       // 副作用がなく結果が引数だけで決まる
+} BuiltinSpec;
+
+// 特殊形式の種類（特殊形式シンボルに付けるタグ）
+typedef enum {
+    SF_NONE = 0,      // 通常のシンボル
+    SF_QUOTE,         // quote
+    SF_IF,            // if
+    SF_DEFINE,        // define
+    SF_SET,           // set!
+    SF_LAMBDA,        // lambda
+    SF_LOOP,          // loop
+    SF_DOTIMES,       // dotimes
+    SF_DEFMACRO,      // defmacro
+    SF_EXPANSION,     // マクロ呼び出しを展開済みの形に書き換えた印 (パーサは生成しない)
+    SF_COUNT,
+} SpecialFormType;
+
 // 前方宣言
 typedef struct Object Object;
 
@@ -56,8 +74,22 @@ typedef struct Object Object;
 typedef struct Object {
     ObjectType type;
     union {
-        // 数値
-        int number;
+        uint32_t cache_stamp;   // コールサイトキャッシュの環境バージョン (OBJ_CONSのみ使用)
+        uint32_t hash;          // ハッシュ値のキャッシュ (OBJ_STRING / OBJ_SYMBOL のみ使用。0は未計算)
+    };
+    union {
+        // 数値 (64bit整数。あふれたら OBJ_BIGNUM に昇格する)
+        int64_t number;
+
+        // 浮動小数点数
+        double real;
+
+        // 多倍長整数
+        struct {
+            uint32_t* limbs;   // 絶対値 (32bit単位で下位から。heap上)
+            size_t count;      // limb の数
+            bool negative;     // 負数か
+        } bignum;
 
         // 文字列
         struct {
@@ -69,21 +101,72 @@ typedef struct Object {
         struct {
             char* name;
             size_t length;
+            SpecialFormType special;  // 特殊形式タグ (通常のシンボルはSF_NONE)
+            int slot;                 // ラムダ本体での変数スロット番号+1 (0は未解決)
         } symbol;
 
         // コンスセル
         struct {
             Object* car;
             Object* cdr;
+            Object* cache;  // コールサイトキャッシュ (解決済みの呼び出し先)
         } cons;
 
         // 関数
         struct {
             Object* (*native_func)(Object* args);  // ネイティブ関数
-            Object* params;                        // パラメータリスト
-            Object* body;                          // 関数本体
+            const BuiltinSpec* spec;               // 登録情報 (登録表にない関数はNULL)
         } function;
 
+        // ラムダ (フラットクロージャ)
+        struct {
+            Object* params;    // パラメータリスト
+            Object* body;      // 本体
+            Object* captured;  // 捕捉変数のフレーム (なければNULL)
+        } lambda;
+
+        // ベクタ
+        struct {
+            Object** items;    // 要素の配列 (heap上)
+            size_t length;     // 要素数
+        } vector;
+
+        // ハッシュテーブル (本体は hashtable.h)
+        struct {
+            struct HashTable* table;
+        } hashtable;
+
+        // 永続マップ (本体は map.h)
+        struct {
+            Object* root;      // 根の節点 (空のマップはNULL)
+            size_t count;      // 要素数
+        } map;
+
+        // 永続マップの節点
+        struct {
+            Object** slots;    // (キー, 値) の組の配列 (heap上)。キーがNULLの組は値が子の節点
+            uint32_t bitmap;   // 組のある分岐のビットマップ (衝突節点は0)
+            uint32_t count;    // 組の数
+        } map_node;
+
+        // メモ化関数 (キャッシュは memo.h)
+        struct {
+            Object* function;          // 元の関数
+            struct MemoCache* cache;
+        } memo;
+
+        // マクロ (展開の処理は macro.h)
+        struct {
+            Object* transformer;       // 引数の式から展開形を作るラムダ
+        } macro;
+
+        // フレーム
+        struct {
+            Object** slots;    // 値の配列 (heap上)
+            size_t count;      // スロット数
+            Object* link;      // 呼び出しフレーム: クロージャ / 捕捉フレーム: 変数名リスト
+        } frame;
+
         // 演算子
         OperatorType operator_type;
 
@@ -119,8 +202,16 @@ Object* get_boolp(void);    // bool?
 Object* get_now(void);      // now
 Object* get_sleep(void);    // sleep
 Object* get_time_diff(void); // time-diff
-// ループ制御関数定数オブジェクトへのアクセス関数
-Object* get_dotimes(void);   // dotime
+
+// 登録表 (builtins.inc) の演算子・組み込み関数の定数オブジェクト
+Object* get_operator(OperatorType op);
+Object* get_builtin(BuiltinType builtin);
+// 名前に対応する演算子・組み込み関数の定数オブジェクト (なければNULL)
+Object* get_fixed_callee(const char* name);
+Object* get_fixed_callee_len(const char* name, size_t length);
+
+// 特殊形式シンボル定数オブジェクトへのアクセス関数
+Object* get_special_symbol(SpecialFormType form);
 
 // 互換性のためのマクロ定義（徐々に関数に移行）
 #define obj_nil get_nil()
@@ -144,19 +235,29 @@ Object* get_dotimes(void);   // dotime
 #define obj_now get_now()
 #define obj_sleep get_sleep()
 #define obj_time_diff get_time_diff()
-#define obj_dotimes get_dotimes()
 
 // オブジェクトシステム初期化
 void object_system_init(void);
 void object_system_cleanup(void);
 
+// ベクタの最大要素数（要素の配列が heap_alloc の1回の上限 255 チャンクに収まる大きさ）
+#define VECTOR_MAX_LENGTH 1020
+
 // オブジェクト作成関数
-Object* make_number(int value);
+Object* make_number(int64_t value);
+Object* make_bignum(const uint32_t* limbs, size_t count, bool negative);
+Object* make_float(double value);
 Object* make_string(const char* text);
+Object* make_string_len(const char* text, size_t length);
+Object* make_string_owned(char* text, size_t length);
 Object* make_symbol(const char* name);
+Object* make_symbol_len(const char* name, size_t length);
 Object* make_cons(Object* car, Object* cdr);
 Object* make_function(Object* (*func)(Object*));
 Object* make_lambda(Object* params, Object* body);
+Object* make_closure(Object* params, Object* body, Object* captured);
+Object* make_frame(size_t count, Object* link);
+Object* make_vector(size_t length, Object* fill);
 Object* make_operator(OperatorType op_type);
 Object* make_builtin(BuiltinType builtin_type);
 
@@ -168,11 +269,16 @@ bool is_symbol(Object* obj);
 bool is_cons(Object* obj);
 bool is_function(Object* obj);
 bool is_lambda(Object* obj);
+bool is_frame(Object* obj);
+bool is_vector(Object* obj);
+bool is_hashtable(Object* obj);
+bool is_map(Object* obj);
+bool is_macro(Object* obj);
 bool is_operator(Object* obj);
 bool is_builtin(Object* obj);
 
 // アクセサ関数
-int obj_number_value(Object* obj);
+int64_t obj_number_value(Object* obj);
 const char* obj_string_text(Object* obj);
 const char* obj_symbol_name(Object* obj);
 Object* obj_car(Object* obj);
@@ -181,12 +287,17 @@ OperatorType obj_operator_type(Object* obj);
 const char* obj_operator_name(Object* obj);
 BuiltinType obj_builtin_type(Object* obj);
 const char* obj_builtin_name(Object* obj);
+SpecialFormType obj_special_form(Object* obj);
 
 // リスト操作
 Object* obj_list_length(Object* list);
 Object* obj_list_nth(Object* list, int n);
 Object* obj_list_append(Object* list1, Object* list2);
 
+// 浮動小数点数を表示用の文字列にする（整数値でも "2.0" のように小数点を付ける）。
+// snprintf と同じく必要な長さを返す
+size_t format_float(double value, char* buf, size_t size);
+
 // デバッグ用
 void object_dump(Object* obj);
 
@@ -3,9 +3,13 @@
 #include "object_pool.h"
 #include "helper.h"
 #include "heap.h"
+#include "hashtable.h"
+#include "memo.h"
+#include "srcloc.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <inttypes.h>
 
 //------------------------------------------
 // v[f[^
@@ -13,6 +17,7 @@
 Object object_pool[OBJECT_POOL_SIZE];
 uint8_t allocation_bitmap[BITMAP_SIZE];  // gp󋵂rbgŊǗ
 uint8_t marked_bitmap[BITMAP_SIZE];      // }[NtOrbgŊǗ
+static size_t alloc_count = 0;           // ܂ł̊mۉ񐔁iGC̈S_̗vۂ߂j
 
 //------------------------------------------
 // v[
@@ -21,6 +26,7 @@ void object_pool_init(void) {
     memset(object_pool, 0, sizeof(object_pool));
     memset(allocation_bitmap, 0, BITMAP_SIZE);
     memset(marked_bitmap, 0, BITMAP_SIZE);
+    srcloc_reset();
 }
 
 //------------------------------------------
@@ -31,6 +37,7 @@ Object* object_pool_alloc(void) {
         if (!bitmap_test(allocation_bitmap, i)) {
             bitmap_set(allocation_bitmap, i);
             memset(&object_pool[i], 0, sizeof(Object));
+            alloc_count++;
             return &object_pool[i];
         }
     }
@@ -49,10 +56,35 @@ void object_pool_free(Object* obj) {
         heap_free(obj->data.symbol.name);
         obj->data.symbol.name = NULL;
     }
+    if (obj->type == OBJ_FRAME && obj->data.frame.slots) {
+        heap_free(obj->data.frame.slots);
+        obj->data.frame.slots = NULL;
+    }
+    if (obj->type == OBJ_VECTOR && obj->data.vector.items) {
+        heap_free(obj->data.vector.items);
+        obj->data.vector.items = NULL;
+    }
+    if (obj->type == OBJ_HASHTABLE && obj->data.hashtable.table) {
+        hashtable_destroy(obj->data.hashtable.table);
+        obj->data.hashtable.table = NULL;
+    }
+    if (obj->type == OBJ_MAPNODE && obj->data.map_node.slots) {
+        heap_free(obj->data.map_node.slots);
+        obj->data.map_node.slots = NULL;
+    }
+    if (obj->type == OBJ_MEMO && obj->data.memo.cache) {
+        memo_cache_destroy(obj->data.memo.cache);
+        obj->data.memo.cache = NULL;
+    }
+    if (obj->type == OBJ_BIGNUM && obj->data.bignum.limbs) {
+        heap_free(obj->data.bignum.limbs);
+        obj->data.bignum.limbs = NULL;
+    }
 
     int index = object_pool_get_index(obj);
     if (index >= 0) {
         bitmap_clear(allocation_bitmap, index);
+        srcloc_forget(index);
         memset(obj, 0, sizeof(Object));
     }
 }
@@ -75,6 +107,10 @@ Object* object_pool_get_object(int index) {
 //------------------------------------------
 // v[ԊǗ
 //------------------------------------------
+size_t object_pool_alloc_count(void) {
+    return alloc_count;
+}
+
 bool object_pool_is_allocated(int index) {
     if (index < 0 || index >= OBJECT_POOL_SIZE) return false;
     return bitmap_test(allocation_bitmap, index);
@@ -139,7 +175,31 @@ void object_pool_dump(void) {
                     printf("BOOL(%s)", object_pool[i].data.number ? "true" : "false");
                     break;
                 case OBJ_NUMBER:
-                    printf("NUMBER(%d)", object_pool[i].data.number);
+                    printf("NUMBER(%" PRId64 ")", object_pool[i].data.number);
+                    break;
+                case OBJ_BIGNUM:
+                    printf("BIGNUM(%zu limbs)", object_pool[i].data.bignum.count);
+                    break;
+                case OBJ_FLOAT:
+                    printf("FLOAT(%g)", object_pool[i].data.real);
+                    break;
+                case OBJ_VECTOR:
+                    printf("VECTOR(%zu items)", object_pool[i].data.vector.length);
+                    break;
+                case OBJ_MEMO:
+                    printf("MEMO(%zu entries)", object_pool[i].data.memo.cache ? object_pool[i].data.memo.cache->count : 0);
+                    break;
+                case OBJ_MACRO:
+                    printf("MACRO");
+                    break;
+                case OBJ_HASHTABLE:
+                    printf("HASHTABLE(%zu entries)", object_pool[i].data.hashtable.table ? object_pool[i].data.hashtable.table->count : 0);
+                    break;
+                case OBJ_MAP:
+                    printf("MAP(%zu entries)", object_pool[i].data.map.count);
+                    break;
+                case OBJ_MAPNODE:
+                    printf("MAPNODE(%u pairs)", object_pool[i].data.map_node.count);
                     break;
                 case OBJ_SYMBOL:
                     printf("SYMBOL(%s)", object_pool[i].data.symbol.name ? object_pool[i].data.symbol.name : "NULL");
@@ -28,6 +28,7 @@ Object* object_pool_get_object(int index);
 bool object_pool_is_allocated(int index);
 size_t object_pool_used_count(void);
 size_t object_pool_free_count(void);
+size_t object_pool_alloc_count(void);   // これまでの確保回数
 bool object_pool_is_valid(Object* obj);
 
 // GCマーク操作
@@ -0,0 +1,182 @@
+// optimizer.c
+// パース直後・評価前に構文木を書き換える最適化パスの実装。
+// - リテラルだけを引数に取る純粋な演算子・組み込み関数の呼び出しを畳み込む
+// - ローカルに隠されていない組み込み関数名のシンボルを固定オブジェクトへ置き換える
+// - 条件がリテラルの if から評価されない分岐を取り除く
+
+#include "optimizer.h"
+#include "eval.h"
+#include <string.h>
+
+// 内側の束縛形式で隠される名前の最大数
+#define MAX_SHADOW 64
+// 式中で define / set! される名前の最大数
+#define MAX_ASSIGNED 64
+
+typedef struct {
+    const char* shadow[MAX_SHADOW];  // lambda / dotimes / loop で束縛された名前
+    int nshadow;
+    int lambda_depth;                // ラムダ本体の内側なら1以上
+    const char* assigned[MAX_ASSIGNED];  // 式中で define / set! される名前
+    int nassigned;
+    bool inline_disabled;            // 書き換えられる名前を把握しきれなかった
+} Optimizer;
+
+static bool is_shadowed(const Optimizer* opt, const char* name) {
+    for (int i = opt->nshadow - 1; i >= 0; i--) {
+        if (strcmp(opt->shadow[i], name) == 0) return true;
+    }
+    return false;
+}
+
+static void push_shadow(Optimizer* opt, Object* sym) {
+    if (is_symbol(sym) && opt->nshadow < MAX_SHADOW) {
+        opt->shadow[opt->nshadow++] = sym->data.symbol.name;
+    }
+}
+
+static bool is_assigned(const Optimizer* opt, const char* name) {
+    for (int i = 0; i < opt->nassigned; i++) {
+        if (strcmp(opt->assigned[i], name) == 0) return true;
+    }
+    return false;
+}
+
+// 式中で define / set! の対象になる名前を集める（その名前はインライン化しない）
+static void collect_assigned(Optimizer* opt, Object* expr) {
+    if (!is_cons(expr)) return;
+    SpecialFormType form = obj_special_form(obj_car(expr));
+    if (form == SF_QUOTE || form == SF_DEFMACRO) return;
+    if (form == SF_EXPANSION) {
+        collect_assigned(opt, obj_cdr(obj_cdr(expr)));
+        return;
+    }
+    if (form == SF_DEFINE || form == SF_SET) {
+        Object* name = obj_car(obj_cdr(expr));
+        if (is_symbol(name)) {
+            if (opt->nassigned < MAX_ASSIGNED) {
+                opt->assigned[opt->nassigned++] = name->data.symbol.name;
+            } else {
+                opt->inline_disabled = true;
+            }
+        }
+    }
+    for (Object* it = expr; is_cons(it); it = obj_cdr(it)) {
+        collect_assigned(opt, obj_car(it));
+    }
+}
+
+// 評価すると常に自分自身になるリテラルか
+static bool is_literal(Object* expr) {
+    if (!expr) return false;
+    switch (expr->type) {
+        case OBJ_NIL:
+        case OBJ_BOOL:
+        case OBJ_NUMBER:
+        case OBJ_BIGNUM:
+        case OBJ_FLOAT:
+        case OBJ_STRING:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// 組み込み関数を指すシンボルを固定オブジェクトに置き換える。
+// ラムダ本体は後から define で再束縛されうるので対象外（コールサイトキャッシュに任せる）。
+static Object* inline_builtin(Optimizer* opt, Object* sym) {
+    if (sym->data.symbol.special != SF_NONE || opt->lambda_depth > 0 || opt->inline_disabled) return sym;
+    if (is_shadowed(opt, sym->data.symbol.name) || is_assigned(opt, sym->data.symbol.name)) return sym;
+
+    Object* value = evaluator_global_value(sym->data.symbol.name);
+    Object* fixed = value ? evaluator_fixed_callee(value) : NULL;
+    return fixed ? fixed : sym;
+}
+
+// (f literal...) を評価済みの値に置き換える。
+// 登録表で純粋とされた演算子・組み込み関数は副作用がないので結果は常に同じ
+static Object* fold_call(Object* expr) {
+    Object* callee = obj_car(expr);
+    if (!callee || (callee->type != OBJ_OPERATOR && callee->type != OBJ_BUILTIN)) return expr;
+    const BuiltinSpec* spec = evaluator_callee_spec(callee);
+    if (!spec || !spec->pure) return expr;
+    size_t argc = 0;
+    for (Object* it = obj_cdr(expr); is_cons(it); it = obj_cdr(it), argc++) {
+        if (!is_literal(obj_car(it))) return expr;
+    }
+    if (!evaluator_arity_ok(callee, argc)) return expr;
+    // 結果がリストなどの場合は、置き換えると式として評価されてしまうので元の呼び出しのままにする
+    Object* result = evaluator_native_callee(callee)->data.function.native_func(obj_cdr(expr));
+    return is_literal(result) ? result : expr;
+}
+
+static Object* optimize_expr(Optimizer* opt, Object* expr);
+
+static void optimize_list(Optimizer* opt, Object* list) {
+    for (Object* it = list; is_cons(it); it = obj_cdr(it)) {
+        it->data.cons.car = optimize_expr(opt, it->data.cons.car);
+    }
+}
+
+// (if cond then [else])
+static Object* optimize_if(Optimizer* opt, Object* expr) {
+    Object* args = obj_cdr(expr);
+    optimize_list(opt, args);
+    Object* cond = obj_car(args);
+    if (!is_literal(cond)) return expr;
+
+    // 条件が定まっているので評価される側だけを残す
+    Object* rest = obj_cdr(args);
+    if (cond != obj_nil && cond != obj_false) return obj_car(rest);
+    Object* else_part = obj_cdr(rest);
+    return is_cons(else_part) ? obj_car(else_part) : obj_nil;
+}
+
+static Object* optimize_expr(Optimizer* opt, Object* expr) {
+    if (is_symbol(expr)) return inline_builtin(opt, expr);
+    if (!is_cons(expr)) return expr;
+
+    Object* args = obj_cdr(expr);
+    int saved = opt->nshadow;
+    switch (obj_special_form(obj_car(expr))) {
+        case SF_QUOTE:
+        case SF_DEFMACRO:
+            return expr;
+        case SF_EXPANSION:
+            // (macro-expansion original . expansion) 展開結果だけを最適化する
+            args->data.cons.cdr = optimize_expr(opt, obj_cdr(args));
+            return expr;
+        case SF_IF:
+            return optimize_if(opt, expr);
+        case SF_DEFINE:
+        case SF_SET:
+            // 束縛先の名前は書き換えない
+            optimize_list(opt, obj_cdr(args));
+            return expr;
+        case SF_LAMBDA:
+            for (Object* it = obj_car(args); is_cons(it); it = obj_cdr(it)) push_shadow(opt, obj_car(it));
+            opt->lambda_depth++;
+            optimize_list(opt, obj_cdr(args));
+            opt->lambda_depth--;
+            opt->nshadow = saved;
+            return expr;
+        case SF_DOTIMES:
+        case SF_LOOP:
+            // (dotimes (var count) body...) / (loop (var init) condition update body...)
+            optimize_list(opt, obj_cdr(obj_car(args)));
+            push_shadow(opt, obj_car(obj_car(args)));
+            optimize_list(opt, obj_cdr(args));
+            opt->nshadow = saved;
+            return expr;
+        default:
+            optimize_list(opt, expr);
+            return fold_call(expr);
+    }
+}
+
+Object* optimize(Object* expr) {
+    Optimizer opt;
+    memset(&opt, 0, sizeof(opt));
+    collect_assigned(&opt, expr);
+    return optimize_expr(&opt, expr);
+}
@@ -0,0 +1,13 @@
+// optimizer.h
+// 構文木の最適化パス（定数畳み込み・組み込み関数のインライン化・死んだ分岐の除去）。
+
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include "object.h"
+
+// 構文木を最適化して返す（部分木はその場で書き換える）。
+// 評価結果は最適化前と変わらない。
+Object* optimize(Object* expr);
+
+#endif // OPTIMIZER_H
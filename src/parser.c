@@ -1,59 +1,117 @@
 // parser.c
-// トークン列からS式（構文木）を構築するパーサの実装。
+// 入力からS式（構文木）を構築するパーサの実装。
+// parse / parse_all はトークン列を作らず、字句を1つ読むたびにコンスセルを直接組み立てる。
+// 組み立てたリストの先頭のセルには '(' の位置（ファイル・行・桁）を位置の表（srcloc）に記録する。
 
 #include "parser.h"
 #include "object.h"
 #include "object_pool.h"
 #include "tokenizer.h"
+#include "srcloc.h"
 #include <string.h>
 #include <stdlib.h>
+#include <errno.h>
+#include "bignum.h"
+#include "heap.h"
 #define DEPTH_MAX 256
+#define NUMBER_BUF 64  // これより長い数値リテラルは heap に写して変換する
 
-static Object* make_atom_token(const Token *t) {
+// 数値リテラル: 小数点があれば浮動小数点数、
+// int64_t に収まらない整数は多倍長整数にする
+static Object* convert_number(const char *text) {
+    if (strchr(text, '.')) return make_float(strtod(text, NULL));
+    errno = 0;
+    long long value = strtoll(text, NULL, 10);
+    if (errno == ERANGE) {
+        Object *big = bignum_parse(text);
+        return big ? big : obj_nil;
+    }
+    return make_number((int64_t)value);
+}
+
+// 入力中の length バイトの数値リテラル（strtod などが字句の後ろまで読まないよう '\0' 終端に写す）
+static Object* make_number_literal(const char *text, size_t length) {
+    char buf[NUMBER_BUF];
+    char *copy = length < sizeof(buf) ? buf : heap_alloc(length + 1);
+    if (!copy) return obj_nil;
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    Object *result = convert_number(copy);
+    if (copy != buf) heap_free(copy);
+    return result;
+}
+
+// アトムのトークンをオブジェクトにする。字句をコピーするのは構文木に残るシンボルと文字列だけ
+static Object* make_atom(const char *source, const Token *t) {
+    const char *text = source + t->offset;
     switch (t->kind) {
-        case TOKEN_SYMBOL:   return make_symbol(t->value);
-        case TOKEN_NUMBER:   return make_number(atoi(t->value));
-        case TOKEN_STRING:   return make_string(t->value);
+        case TOKEN_SYMBOL:   return make_symbol_len(text, t->length);
+        case TOKEN_NUMBER:   return make_number_literal(text, t->length);
+        case TOKEN_STRING:   return make_string_len(text, t->length);
         case TOKEN_NIL:      return obj_nil;
         case TOKEN_TRUE:     return obj_true;
         case TOKEN_FALSE:    return obj_nil;  // falseはnilと同じ
-        case TOKEN_PLUS:     return obj_plus;
-        case TOKEN_MINUS:    return obj_minus;
-        case TOKEN_ASTERISK: return obj_asterisk;
-        case TOKEN_SLASH:    return obj_slash;
-        case TOKEN_EQ:       return obj_eq;
-        case TOKEN_LT:       return obj_lt;
-        case TOKEN_GT:       return obj_gt;
-        case TOKEN_LTE:      return obj_lte;
-        case TOKEN_GTE:      return obj_gte;
-        // 組み込み関数
-        case TOKEN_PRINT:    return obj_print;
-        case TOKEN_PRINTLN:  return obj_println;
-        case TOKEN_STR:      return obj_str;
-        case TOKEN_LENGTH:   return obj_length;
-        case TOKEN_BOOLP:    return obj_boolp;
-        // タイマー関数
-        case TOKEN_NOW:      return obj_now;
-        case TOKEN_SLEEP:    return obj_sleep;
-        case TOKEN_TIME_DIFF: return obj_time_diff;
-        // ループ制御関数
-        case TOKEN_DOTIMES:   return obj_dotimes;
+        // 演算子: 登録表（builtins.inc）から名前で引く。登録表になければ普通のシンボルにする。
+        // 組み込み関数の名前は TOKEN_SYMBOL のまま、大域環境の束縛（同じ登録表から作る）で解決する
+        case TOKEN_PLUS:
+        case TOKEN_MINUS:
+        case TOKEN_ASTERISK:
+        case TOKEN_SLASH:
+        case TOKEN_EQ:
+        case TOKEN_LT:
+        case TOKEN_GT:
+        case TOKEN_LTE:
+        case TOKEN_GTE: {
+            Object* callee = get_fixed_callee_len(text, t->length);
+            return callee ? callee : make_symbol_len(text, t->length);
+        }
+        // 特殊形式
+        case TOKEN_QUOTE:    return get_special_symbol(SF_QUOTE);
+        case TOKEN_IF:       return get_special_symbol(SF_IF);
+        case TOKEN_DEFINE:   return get_special_symbol(SF_DEFINE);
+        case TOKEN_SET:      return get_special_symbol(SF_SET);
+        case TOKEN_LAMBDA:   return get_special_symbol(SF_LAMBDA);
+        case TOKEN_LOOP:     return get_special_symbol(SF_LOOP);
+        case TOKEN_DOTIMES:  return get_special_symbol(SF_DOTIMES);
+        case TOKEN_DEFMACRO: return get_special_symbol(SF_DEFMACRO);
         default:             return obj_nil;
     }
 }
 
+typedef struct { Object *head; Object **current; uint32_t open; } Frame;  // open は '(' の位置
+
+// 読みかけのリストの末尾に要素を足す。要素がない（作れなかった）かセルが取れなければ false
+static bool append(Frame *frame, Object *element) {
+    Object *cell = element ? make_cons(element, obj_nil) : NULL;
+    if (!cell) return false;
+    *(frame->current) = cell;
+    frame->current = &cell->data.cons.cdr;
+    return true;
+}
+
+// 最初の要素を足してリストの先頭のセルができたら、その '(' の位置を記録する
+static bool append_located(Lexer *lexer, Frame *frame, Object *element) {
+    bool first = frame->current == &frame->head;
+    if (!append(frame, element)) return false;
+    if (first) {
+        uint32_t line, column;
+        lexer_location(lexer, frame->open, &line, &column);
+        srcloc_set(frame->head, lexer->file, line, column);
+    }
+    return true;
+}
+
 // 汎用: index 位置から1式パースし index 更新
 Object *parse_expression(TokenArray *tokens, size_t *index) {
     if (!tokens || !index) return obj_nil;
     size_t i = *index;
     if (i >= tokens->size) return obj_nil;
 
-    typedef struct { Object *head; Object **current; } Frame;
     Frame stack[DEPTH_MAX];
     int sp = -1;
 
     if (tokens->tokens[i].kind != TOKEN_LPAREN) {
-        Object *atom = make_atom_token(&tokens->tokens[i]);
+        Object *atom = make_atom(tokens->source, &tokens->tokens[i]);
         *index = i + 1;
         return atom;
     }
@@ -72,42 +130,77 @@ Object *parse_expression(TokenArray *tokens, size_t *index) {
             Object *completed = obj_nil;
             if (sp >= 0) { completed = stack[sp].head; --sp; } else { *index = i; return obj_nil; }
             if (sp < 0) { *index = i; return completed ? completed : obj_nil; }
-            *(stack[sp].current) = make_cons(completed, obj_nil);
-            stack[sp].current = &((*(stack[sp].current))->data.cons.cdr);
+            if (!append(&stack[sp], completed)) { *index = i; return obj_nil; }
             continue;
         } else {
-            Object *atom = make_atom_token(tok); i++;
+            Object *atom = make_atom(tokens->source, &tokens->tokens[i]); i++;
             if (sp < 0) { *index = i; return atom; }
-            *(stack[sp].current) = make_cons(atom, obj_nil);
-            stack[sp].current = &((*(stack[sp].current))->data.cons.cdr);
+            if (!append(&stack[sp], atom)) { *index = i; return obj_nil; }
             continue;
         }
     }
 }
 
-// 最初の1式のみ互換API
+//------------------------------------------
+// 入力から直接読む
+//------------------------------------------
+
+// 字句を1つずつ読みながら1式を組み立てる（parse_expression と同じ規則）
+Object *parse_next(Lexer *lexer) {
+    Frame stack[DEPTH_MAX];
+    int sp = -1;
+    Token tok;
+
+    while (1) {
+        const char *before = lexer->cursor;
+        if (!lexer_next(lexer, &tok)) {
+            if (lexer->error) return NULL;
+            // 入力の終わり: 閉じていないリストは読めたところまで返す
+            return sp >= 0 ? stack[0].head : NULL;
+        }
+        if (tok.kind == TOKEN_LPAREN) {
+            if (sp + 1 >= DEPTH_MAX) {
+                // 深すぎる: この '(' から読み直せるよう位置を戻す
+                lexer->cursor = before;
+                return obj_nil;
+            }
+            ++sp; stack[sp].head = obj_nil; stack[sp].current = &stack[sp].head; stack[sp].open = tok.offset;
+        } else if (tok.kind == TOKEN_RPAREN) {
+            if (sp < 0) return obj_nil;  // 対応のない ')'
+            Object *completed = stack[sp--].head;
+            if (sp < 0) return completed;
+            if (!append_located(lexer, &stack[sp], completed)) break;
+        } else {
+            Object *atom = make_atom(lexer->source, &tok);
+            if (!atom) break;
+            if (sp < 0) return atom;
+            if (!append_located(lexer, &stack[sp], atom)) break;
+        }
+    }
+    // オブジェクトプールが尽きた: 組み立てかけの式は捨てる（評価済みの式の値は残っている）
+    lexer->exhausted = true;
+    return NULL;
+}
+
+// 最初の1式のみ互換API（最初の式より後ろは読まない）
 Object *parse(const char *src) {
-    TokenArray *tokens = tokenize(src);
-    if (!tokens) return obj_nil;
-    size_t idx = 0;
-    Object *result = parse_expression(tokens, &idx);
-    free_token_array(tokens);
+    Lexer lexer;
+    lexer_init(&lexer, src);
+    Object *result = parse_next(&lexer);
     return result ? result : obj_nil;
 }
 
 // 複数トップレベル式を全て読みリストにする
 Object *parse_all(const char *src) {
-    TokenArray *tokens = tokenize(src);
-    if (!tokens) return obj_nil;
-    size_t idx = 0;
+    Lexer lexer;
+    lexer_init(&lexer, src);
     Object *head = obj_nil; Object **cur = &head;
-    while (idx < tokens->size) {
-        // 空白や無効トークンをスキップする仕組みがなければ直接 parse_expression
-        Object *expr = parse_expression(tokens, &idx);
-        if (!expr) break; // エラー / 進展しない場合終了
+    Object *expr;
+    while ((expr = parse_next(&lexer)) != NULL) {
         *cur = make_cons(expr, obj_nil);
+        if (!*cur) return obj_nil;
         cur = &((*cur)->data.cons.cdr);
     }
-    free_token_array(tokens);
-    return head ? head : obj_nil;
+    if (lexer.error || lexer.exhausted) return obj_nil;  // 閉じていない文字列リテラル・メモリ不足
+    return head;
 }
@@ -14,5 +14,9 @@ Object* parse(const char* src);
 Object* parse_expression(TokenArray* tokens, size_t* index);
 // 入力中の全トップレベル式をリスト (expr1 expr2 ...) として返す補助
 Object* parse_all(const char* src);
+// 字句解析器の位置から次のトップレベル式を1つ読む（入力をコピーせずにその場で読む）。
+// 式がもうなければ NULL、閉じていない文字列リテラルでも NULL（lexer->error が立つ）。
+// オブジェクトプールが尽きて式を組み立てられなくても NULL（lexer->exhausted が立つ）
+Object* parse_next(Lexer* lexer);
 
 #endif // __PARSER_H__
\ No newline at end of file
@@ -0,0 +1,231 @@
+// printer.c
+// オブジェクトの表示（明示的なスタックでたどる）と、標準出力用のバッファ。
+
+#include "printer.h"
+#include "hashtable.h"
+#include "memo.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PRINT_STACK_LOCAL 64   // これより深い入れ子では malloc で伸ばす
+
+//------------------------------------------
+// 入れ子の走査
+//------------------------------------------
+
+typedef enum {
+    FRAME_LIST,     // node: まだ書いていない残りのリスト
+    FRAME_PAIR,     // node: cdr（PRINT_DUMP のドット対。index は cdr を書いたら 1）
+    FRAME_VECTOR    // node: ベクタ、index: 次に書く要素
+} FrameKind;
+
+typedef struct {
+    Object*   node;
+    size_t    index;
+    FrameKind kind;
+} PrintFrame;
+
+typedef struct {
+    PrintFrame* frames;
+    size_t      count;
+    size_t      capacity;
+    bool        owned;    // frames を malloc で確保した
+} PrintStack;
+
+static PrintFrame* push_frame(PrintStack* stack) {
+    if (stack->count == stack->capacity) {
+        size_t capacity = stack->capacity * 2;
+        PrintFrame* grown = stack->owned
+            ? realloc(stack->frames, sizeof(PrintFrame) * capacity)
+            : malloc(sizeof(PrintFrame) * capacity);
+        if (!grown) return NULL;
+        if (!stack->owned) {
+            for (size_t i = 0; i < stack->count; i++) grown[i] = stack->frames[i];
+        }
+        stack->frames = grown;
+        stack->capacity = capacity;
+        stack->owned = true;
+    }
+    return &stack->frames[stack->count++];
+}
+
+static void append_count(StrBuf* sb, const char* prefix, size_t count) {
+    strbuf_append_cstr(sb, prefix);
+    strbuf_append_int(sb, (int64_t)count);
+    strbuf_append_char(sb, '>');
+}
+
+// 入れ子を持たないオブジェクト（と空のベクタ）を書く
+static void append_atom(StrBuf* sb, Object* obj, PrintStyle style) {
+    if (!obj) {
+        strbuf_append_cstr(sb, style == PRINT_DUMP ? "NULL" : "nil");
+        return;
+    }
+    bool display = style == PRINT_DISPLAY;
+    switch (obj->type) {
+        case OBJ_NIL:    strbuf_append(sb, "nil", 3); break;
+        case OBJ_BOOL:   strbuf_append_cstr(sb, obj == obj_true ? "t" : "nil"); break;
+        case OBJ_NUMBER: strbuf_append_int(sb, obj->data.number); break;
+        case OBJ_BIGNUM: strbuf_append_bignum(sb, obj); break;
+        case OBJ_FLOAT: {
+            char buf[40];
+            size_t length = format_float(obj->data.real, buf, sizeof(buf));
+            strbuf_append(sb, buf, length < sizeof(buf) ? length : sizeof(buf) - 1);
+            break;
+        }
+        case OBJ_STRING:
+            if (!display) strbuf_append_char(sb, '"');
+            if (obj->data.string.text) strbuf_append(sb, obj->data.string.text, obj->data.string.length);
+            if (!display) strbuf_append_char(sb, '"');
+            break;
+        case OBJ_SYMBOL:
+            if (obj->data.symbol.name) strbuf_append(sb, obj->data.symbol.name, obj->data.symbol.length);
+            break;
+        case OBJ_VECTOR:   strbuf_append(sb, "#()", 3); break;
+        case OBJ_OPERATOR: strbuf_append_cstr(sb, obj_operator_name(obj)); break;
+        case OBJ_BUILTIN:  strbuf_append_cstr(sb, obj_builtin_name(obj)); break;
+        case OBJ_HASHTABLE: append_count(sb, "#<hash-table ", obj->data.hashtable.table->count); break;
+        case OBJ_MAP:       append_count(sb, "#<map ", obj->data.map.count); break;
+        case OBJ_MAPNODE:   append_count(sb, "#<map-node ", obj->data.map_node.count); break;
+        case OBJ_MEMO:
+            if (style == PRINT_DUMP) append_count(sb, "#<memo ", obj->data.memo.cache->count);
+            else strbuf_append_cstr(sb, display ? "<memo>" : "#<memo>");
+            break;
+        case OBJ_MACRO:    strbuf_append_cstr(sb, display ? "<macro>" : "#<macro>"); break;
+        case OBJ_FUNCTION: strbuf_append_cstr(sb, display ? "<function>" : "#<function>"); break;
+        case OBJ_LAMBDA:   strbuf_append_cstr(sb, display ? "<lambda>" : "#<lambda>"); break;
+        case OBJ_FRAME:    strbuf_append_cstr(sb, "#<frame>"); break;
+        case OBJ_VOID:     // print 等の戻り値。デバッグ表示以外では何も書かない
+            if (style == PRINT_DUMP) strbuf_append_cstr(sb, "#<void>");
+            break;
+        default:
+            append_count(sb, "#<unknown-type-", (size_t)obj->type);
+            break;
+    }
+}
+
+// 開いているコンテナの次の要素を *next に取り出す（区切りも書く）。
+// 要素が尽きたコンテナは閉じて外側へ戻る。すべて閉じたら false
+static bool next_element(StrBuf* sb, PrintStack* stack, Object** next) {
+    while (stack->count > 0) {
+        PrintFrame* frame = &stack->frames[stack->count - 1];
+        switch (frame->kind) {
+            case FRAME_LIST: {
+                Object* rest = frame->node;
+                if (rest && rest->type == OBJ_CONS) {
+                    strbuf_append_char(sb, ' ');
+                    *next = rest->data.cons.car;
+                    frame->node = rest->data.cons.cdr;
+                    return true;
+                }
+                if (rest && rest != obj_nil) { // ドットリスト
+                    strbuf_append(sb, " . ", 3);
+                    *next = rest;
+                    frame->node = obj_nil;
+                    return true;
+                }
+                break;
+            }
+            case FRAME_PAIR:
+                if (frame->index == 0) {
+                    strbuf_append(sb, " . ", 3);
+                    *next = frame->node;
+                    frame->index = 1;
+                    return true;
+                }
+                break;
+            case FRAME_VECTOR:
+                if (frame->index < frame->node->data.vector.length) {
+                    strbuf_append_char(sb, ' ');
+                    *next = frame->node->data.vector.items[frame->index++];
+                    return true;
+                }
+                break;
+        }
+        strbuf_append_char(sb, ')');
+        stack->count--;
+    }
+    return false;
+}
+
+void printer_append(StrBuf* sb, Object* obj, PrintStyle style) {
+    PrintFrame local[PRINT_STACK_LOCAL];
+    PrintStack stack = { local, 0, PRINT_STACK_LOCAL, false };
+
+    for (;;) {
+        bool is_list = obj && obj->type == OBJ_CONS;
+        bool is_vector = obj && obj->type == OBJ_VECTOR && obj->data.vector.length > 0;
+        if (is_list || is_vector) {
+            // 開き括弧を書いて最初の要素へ進む
+            PrintFrame* frame = push_frame(&stack);
+            if (frame) {
+                frame->index = 0;
+                if (is_vector) {
+                    strbuf_append(sb, "#(", 2);
+                    frame->kind = FRAME_VECTOR;
+                    frame->node = obj;
+                    frame->index = 1;
+                    obj = obj->data.vector.items[0];
+                } else {
+                    strbuf_append_char(sb, '(');
+                    frame->kind = style == PRINT_DUMP ? FRAME_PAIR : FRAME_LIST;
+                    frame->node = obj->data.cons.cdr;
+                    obj = obj->data.cons.car;
+                }
+                continue;
+            }
+            strbuf_append(sb, "...", 3); // 作業領域が取れなければ中身を省く
+        } else {
+            append_atom(sb, obj, style);
+        }
+        if (!next_element(sb, &stack, &obj)) break;
+    }
+
+    if (stack.owned) free(stack.frames);
+}
+
+//------------------------------------------
+// 標準出力用のバッファ
+//------------------------------------------
+
+static char output_storage[PRINTER_BUFFER_SIZE];
+static StrBuf output;
+static PrinterMode output_mode;
+static bool output_ready = false;
+
+static StrBuf* output_buffer(void) {
+    if (!output_ready) {
+        strbuf_init_stream(&output, stdout, output_storage, sizeof(output_storage));
+        output_mode = isatty(fileno(stdout)) ? PRINTER_LINE : PRINTER_FULL;
+        atexit(printer_flush);   // 終了時に残りを書き出す
+        output_ready = true;
+    }
+    return &output;
+}
+
+void printer_flush(void) {
+    if (!output_ready) return;
+    strbuf_flush(&output);
+    fflush(stdout);
+}
+
+void printer_set_mode(PrinterMode mode) {
+    output_buffer();
+    output_mode = mode;
+    if (mode == PRINTER_LINE) printer_flush();
+}
+
+void printer_write_object(Object* obj, PrintStyle style) {
+    printer_append(output_buffer(), obj, style);
+}
+
+void printer_write(const char* text, size_t length) {
+    strbuf_append(output_buffer(), text, length);
+    if (output_mode == PRINTER_LINE && memchr(text, '\n', length)) printer_flush();
+}
+
+void printer_write_char(char c) {
+    strbuf_append_char(output_buffer(), c);
+    if (output_mode == PRINTER_LINE && c == '\n') printer_flush();
+}
@@ -0,0 +1,41 @@
+// printer.h
+// オブジェクトの表示。print/println・REPL の結果表示・デバッグ用の object_dump が共有する。
+// 入れ子は明示的なスタックでたどるので、深いリストでも C のスタックを使い切らない。
+// 標準出力へは大きな固定バッファにためて書き出す（端末なら改行ごと、それ以外はあふれたときと
+// トップレベルの式の評価を終えたとき・sleep の前）。
+
+#ifndef PRINTER_H
+#define PRINTER_H
+
+#include "object.h"
+#include "strbuf.h"
+
+#define PRINTER_BUFFER_SIZE (64 * 1024)   // 標準出力用バッファの大きさ
+
+// 表示形式
+typedef enum {
+    PRINT_DISPLAY,   // print / str: 文字列は引用符なし
+    PRINT_WRITE,     // REPL の結果: 文字列は引用符付き
+    PRINT_DUMP       // デバッグ: コンスはドット対、内部オブジェクトも中身の数を出す
+} PrintStyle;
+
+// 標準出力バッファを書き出す時機
+typedef enum {
+    PRINTER_LINE,    // 改行を書いたら書き出す（端末向け）
+    PRINTER_FULL     // あふれたとき・printer_flush で書き出す（パイプ・ファイル向け。eval_form が式ごとに呼ぶ）
+} PrinterMode;
+
+// obj を style の形式で sb に追加する
+void printer_append(StrBuf* sb, Object* obj, PrintStyle style);
+
+// 標準出力バッファへの書き込み
+void printer_write_object(Object* obj, PrintStyle style);
+void printer_write(const char* text, size_t length);
+void printer_write_char(char c);
+// たまっている分を標準出力へ書き出す（stdio を直接使う出力の前に呼ぶ）
+void printer_flush(void);
+
+// 書き出す時機を変える（既定は標準出力が端末なら PRINTER_LINE）
+void printer_set_mode(PrinterMode mode);
+
+#endif // PRINTER_H
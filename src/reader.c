@@ -0,0 +1,208 @@
+// reader.c
+// 入力を少しずつ読み込むリーダーの実装。
+// 文字列リテラルにエスケープはなく、コメントは ';' から行末まで（トークナイザと同じ規則）。
+
+#include "reader.h"
+#include "lexscan.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+static void reset(Reader* reader) {
+    memset(reader, 0, sizeof(Reader));
+    reader->fd = -1;
+}
+
+void reader_init(Reader* reader) {
+    reset(reader);
+}
+
+void reader_init_file(Reader* reader, FILE* file) {
+    reset(reader);
+    reader->file = file;
+}
+
+void reader_init_fd(Reader* reader, int fd) {
+    reset(reader);
+    reader->fd = fd;
+}
+
+void reader_free(Reader* reader) {
+    free(reader->buf);
+    reader->buf = NULL;
+    reader->len = reader->cap = 0;
+}
+
+bool reader_in_form(const Reader* reader) {
+    return reader->in_form;
+}
+
+//------------------------------------------
+// バッファ
+//------------------------------------------
+
+// あと extra バイトと終端の '\0' が入るようにする
+static bool reserve(Reader* reader, size_t extra) {
+    size_t need = reader->len + extra + 1;
+    if (need <= reader->cap) return true;
+    size_t cap = reader->cap ? reader->cap : READER_CHUNK;
+    while (cap < need) cap *= 2;
+    char* grown = realloc(reader->buf, cap);
+    if (!grown) return false;
+    reader->buf = grown;
+    reader->cap = cap;
+    return true;
+}
+
+// 前回返した式をバッファから取り除く
+static void compact(Reader* reader) {
+    if (reader->consumed == 0) return;
+    size_t rest = reader->len - reader->consumed;
+    reader->buf[reader->consumed] = reader->saved;
+    memmove(reader->buf, reader->buf + reader->consumed, rest);
+    reader->len   = rest;
+    reader->scan -= reader->consumed;
+    reader->start = 0;
+    reader->consumed = 0;
+}
+
+bool reader_feed(Reader* reader, const char* data, size_t length) {
+    compact(reader);
+    if (!reserve(reader, length)) return false;
+    memcpy(reader->buf + reader->len, data, length);
+    reader->len += length;
+    return true;
+}
+
+void reader_end(Reader* reader) {
+    reader->eof = true;
+}
+
+// 読み込み元から1回分読み足す。読めなければ false（入力の終わりなら eof を立てる）
+static bool fill(Reader* reader) {
+    if (reader->eof || (!reader->file && reader->fd < 0)) return false;
+    if (!reserve(reader, READER_CHUNK)) {
+        reader->eof = true;
+        return false;
+    }
+    if (reader->prompt) reader->prompt(reader);
+
+    char* dst = reader->buf + reader->len;
+    size_t n = 0;
+    if (reader->file) {
+        // 対話入力でも1行で戻るように fgets で読む（長い行は READER_CHUNK ずつ）
+        if (fgets(dst, READER_CHUNK + 1, reader->file)) n = strlen(dst);
+    } else {
+        ssize_t r;
+        do {
+            r = read(reader->fd, dst, READER_CHUNK);
+        } while (r < 0 && errno == EINTR);
+        if (r > 0) n = (size_t)r;
+    }
+    if (n == 0) {
+        reader->eof = true;
+        return false;
+    }
+    reader->len += n;
+    return true;
+}
+
+//------------------------------------------
+// 式の切り出し
+//------------------------------------------
+
+static bool is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
+
+// 走査済みの位置から続きを調べ、式が閉じたらその終わりを *end に入れて true
+static bool scan_form(Reader* reader, size_t* end) {
+    if (!reader->buf) return false;
+    const char* buf = reader->buf;
+    const char* buf_end = buf + reader->len;
+    for (; reader->scan < reader->len; reader->scan++) {
+        // コメント・文字列の本体・トップレベルのアトムは終わりの文字まで一気に進める
+        if (reader->in_comment) {
+            reader->scan = (size_t)(lexscan_find(buf + reader->scan, buf_end, '\n') - buf);
+            if (reader->scan == reader->len) break;
+            reader->in_comment = false;
+            continue;
+        }
+        if (reader->in_string) {
+            reader->scan = (size_t)(lexscan_find(buf + reader->scan, buf_end, '"') - buf);
+            if (reader->scan == reader->len) break;
+            reader->in_string = false;
+            if (reader->depth == 0) {
+                *end = reader->scan + 1;
+                return true;
+            }
+            continue;
+        }
+
+        char c = buf[reader->scan];
+        if (!reader->in_form) {
+            // 式の前の空白とコメントを読み飛ばす
+            if (is_space(c)) continue;
+            if (c == ';') {
+                reader->in_comment = true;
+                continue;
+            }
+            reader->in_form = true;
+            reader->start = reader->scan;
+            switch (c) {
+                case '(': reader->depth = 1; break;
+                case '"': reader->in_string = true; break;
+                case ')': *end = reader->scan + 1; return true;  // 対応のない ')' はそれだけで1つの式
+                default:  break;                                // アトムの1文字目
+            }
+            continue;
+        }
+
+        if (reader->depth == 0) {
+            // トップレベルのアトムは区切り文字の手前で終わる
+            reader->scan = (size_t)(lexscan_next_delimiter(buf + reader->scan, buf_end) - buf);
+            if (reader->scan == reader->len) break;
+            *end = reader->scan;
+            return true;
+        }
+        switch (c) {
+            case ';': reader->in_comment = true; break;
+            case '"': reader->in_string = true; break;
+            case '(': reader->depth++; break;
+            case ')':
+                if (--reader->depth == 0) {
+                    *end = reader->scan + 1;
+                    return true;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return false;
+}
+
+const char* reader_next(Reader* reader) {
+    compact(reader);
+    size_t end;
+    while (!scan_form(reader, &end)) {
+        if (fill(reader)) continue;
+        // 入力の終わり: 閉じていない式が残っていればそのまま返す
+        if (!reader->eof || !reader->in_form) return NULL;
+        end = reader->len;
+        break;
+    }
+
+    // 式の直後を '\0' で上書きして返し、次の呼び出しで元に戻して詰める
+    if (!reserve(reader, 0)) return NULL;
+    reader->saved = reader->buf[end];
+    reader->buf[end] = '\0';
+    reader->consumed = end;
+    reader->scan = end;
+    reader->depth = 0;
+    reader->in_string = false;
+    reader->in_comment = false;
+    reader->in_form = false;
+    return reader->buf + reader->start;
+}
@@ -0,0 +1,53 @@
+// reader.h
+// 入力を少しずつ読み込み、トップレベルの式が閉じるたびにその式の文字列を返すリーダー。
+// 括弧の深さ・文字列・コメントの中かどうかを読み込みの区切りをまたいで覚えているので、
+// 複数行にまたがる式をそのまま入力でき、大きなスクリプトも式1つ分と読み込み1回分のメモリで流せる。
+
+#ifndef READER_H
+#define READER_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define READER_CHUNK 4096  // 1回に読み込む最大バイト数
+
+typedef struct Reader {
+    FILE*  file;         // 読み込み元（1行ずつ読む。なければ NULL）
+    int    fd;           // 読み込み元のファイル記述子（なければ -1）
+    bool   eof;          // 入力の終わりに達した
+    char*  buf;          // まだ返していない入力（malloc。式を返すたびに先頭へ詰める）
+    size_t len;
+    size_t cap;
+    size_t scan;         // 走査済みの位置
+    size_t start;        // 現在の式の先頭
+    size_t consumed;     // 前回返した式の終わり（'\0' で上書きした位置）
+    char   saved;        // consumed の位置にあった文字
+    int    depth;        // 括弧の深さ
+    bool   in_string;
+    bool   in_comment;
+    bool   in_form;      // 現在の式が始まっている
+    // 入力を待つ前に呼ぶ（対話用のプロンプト表示など。NULL なら呼ばない）
+    void (*prompt)(struct Reader* reader);
+} Reader;
+
+// 読み込み元を持たないリーダー（reader_feed で入力を渡し、reader_end で終わりを伝える）
+void reader_init(Reader* reader);
+void reader_init_file(Reader* reader, FILE* file);
+void reader_init_fd(Reader* reader, int fd);
+void reader_free(Reader* reader);
+
+// 入力を追加する。確保できなければ false
+bool reader_feed(Reader* reader, const char* data, size_t length);
+// 入力がこれ以上ないことを伝える
+void reader_end(Reader* reader);
+
+// 次のトップレベルの式（'\0' 終端。次の呼び出しまで有効）。
+// 入力の終わりに閉じていない式が残っていれば、それをそのまま返す。
+// 式がもうなければ NULL（読み込み元のないリーダーでは、入力が足りないときも NULL）
+const char* reader_next(Reader* reader);
+
+// 閉じていない式を読み込み途中か（続きの行のプロンプト表示用）
+bool reader_in_form(const Reader* reader);
+
+#endif // READER_H
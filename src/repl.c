@@ -7,94 +7,72 @@
 #include "object.h"
 #include "eval.h"  // 評価関数のインターフェース
 #include "gc.h"    // GC の明示呼び出し
+#include "reader.h"  // 式単位の読み込み
+#include "image.h"   // イメージからの起動
+#include "printer.h" // 結果の表示
 
-static void print_obj(Object* obj) {
-    if (!obj) {
-        printf("NULL");
-        return;
-    }
-
-    switch (obj->type) {
-        case OBJ_NIL:
-            printf("nil");
-            break;
-        case OBJ_BOOL:
-            printf(obj == obj_true ? "t" : "nil");
-            break;
-        case OBJ_NUMBER:
-            printf("%d", obj->data.number);
-            break;
-        case OBJ_SYMBOL:
-            printf("%s", obj->data.symbol.name ? obj->data.symbol.name : "");
-            break;
-        case OBJ_STRING:
-            printf("\"%s\"", obj->data.string.text ? obj->data.string.text : "");
-            break;
-        case OBJ_CONS: {
-            printf("(");
-            Object* it = obj;
-            while (it && it->type == OBJ_CONS) {
-                print_obj(it->data.cons.car);
-                it = it->data.cons.cdr;
-                if (it && it->type == OBJ_CONS) printf(" ");
-            }
-            if (it && it->type != OBJ_NIL) {
-                printf(" . ");
-                print_obj(it);
-            }
-            printf(")");
-            break;
-        }
-        case OBJ_FUNCTION:
-            printf("#<function>");
-            break;
-        case OBJ_LAMBDA:
-            printf("#<lambda>");
-            break;
-        case OBJ_OPERATOR:
-            printf("%s", obj_operator_name(obj));
-            break;
-        case OBJ_VOID:
-            // voidは表示しない（この関数は呼ばれないはず）
-            break;
-        default:
-            printf("#<unknown-type-%d>", obj->type);
-            break;
-    }
+// 入力を待つ前のプロンプト（式の途中なら続きの行のプロンプト）
+static void print_prompt(Reader* reader) {
+    printer_flush();   // ためてある結果を先に出す
+    printf(reader_in_form(reader) ? "... " : "> ");
+    fflush(stdout);
 }
 
 int main(int argc, char* argv[]) {
     bool debug_enabled = false;
+    const char* script = NULL;
+    const char* image = NULL;
 
     // コマンドライン引数を処理
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "--debug") == 0 || strcmp(argv[i], "-d") == 0) {
             debug_enabled = true;
         } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
-            printf("Usage: %s [options]\n", argv[0]);
+            printf("Usage: %s [options] [script]\n", argv[0]);
             printf("Options:\n");
             printf("  --debug, -d    Enable debug output\n");
             printf("  --help, -h     Show this help message\n");
+            printf("  --image FILE   Start from an image written by save-image\n");
+            printf("  script         Evaluate the forms in the file instead of starting the REPL\n");
             printf("\nREPL Commands:\n");
             printf("  :quit          Exit the REPL\n");
             printf("  :mem           Show memory statistics\n");
             printf("  :gc            Run garbage collection manually\n");
             return 0;
+        } else if (strcmp(argv[i], "--image") == 0 && i + 1 < argc) {
+            image = argv[++i];
+        } else {
+            script = argv[i];
         }
     }
 
-    evaluator_init();
+    if (image) {
+        if (!image_load(image)) {
+            fprintf(stderr, "%s: cannot load image\n", image);
+            return 1;
+        }
+    } else {
+        evaluator_init();
+    }
     evaluator_set_debug(debug_enabled);
 
     if (debug_enabled) {
         printf("Debug mode enabled.\n");
     }
 
-    char line[1024];
+    if (script) {
+        bool ok = eval_file(script);
+        evaluator_shutdown();
+        return ok ? 0 : 1;
+    }
+
+    // 式が閉じるまで読み込む（複数行の式も、1行に並んだ複数の式も扱える）
+    Reader reader;
+    reader_init_file(&reader, stdin);
+    reader.prompt = print_prompt;
     printf("chibi-lisp REPL. Type :quit to exit, :mem for memory stats.\n");
-    while (1) {
-        printf("> ");
-        if (!fgets(line, sizeof(line), stdin)) break;
+    const char* line;
+    while ((line = reader_next(&reader)) != NULL) {
         if (strncmp(line, ":quit", 5) == 0) break;
         if (strncmp(line, ":mem", 4) == 0) {
             evaluator_show_memory_stats();
@@ -113,10 +91,11 @@ int main(int argc, char* argv[]) {
         // OBJ_VOID型（print関数等の戻り値）の場合のみ表示を抑制
         // 明示的なnilは表示する
         if (res && res->type != OBJ_VOID) {
-            print_obj(res);
-            printf("\n");
+            printer_write_object(res, PRINT_WRITE);
+            printer_write_char('\n');
         }
     }
+    reader_free(&reader);
 
     evaluator_shutdown();
     return 0;
@@ -0,0 +1,60 @@
+// srcloc.c
+// ソース上の位置の表の実装。
+// プールの添字ごとに SrcLoc を1つ持ち、line が 0 の要素は位置なしとする。
+// セルが解放されたら消すので、同じ添字に別のオブジェクトが確保されても古い位置は残らない。
+
+#include "srcloc.h"
+#include "object_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static SrcLoc locations[OBJECT_POOL_SIZE];
+static char* file_names[SRCLOC_MAX_FILES];   // 番号 0 は使わない（malloc）
+static uint16_t file_count = 1;
+
+uint16_t srcloc_file(const char* path) {
+    for (uint16_t i = 1; i < file_count; i++) {
+        if (strcmp(file_names[i], path) == 0) return i;
+    }
+    if (file_count >= SRCLOC_MAX_FILES) return 0;
+    char* copy = malloc(strlen(path) + 1);
+    if (!copy) return 0;
+    strcpy(copy, path);
+    file_names[file_count] = copy;
+    return file_count++;
+}
+
+const char* srcloc_file_name(uint16_t file) {
+    return (file > 0 && file < file_count) ? file_names[file] : "<input>";
+}
+
+void srcloc_set(Object* obj, uint16_t file, uint32_t line, uint32_t column) {
+    int index = object_pool_get_index(obj);
+    if (index < 0) return;
+    locations[index].line   = line;
+    locations[index].column = column > UINT16_MAX ? UINT16_MAX : (uint16_t)column;
+    locations[index].file   = file;
+}
+
+bool srcloc_get(Object* obj, SrcLoc* loc) {
+    int index = object_pool_get_index(obj);
+    if (index < 0 || locations[index].line == 0) return false;
+    *loc = locations[index];
+    return true;
+}
+
+size_t srcloc_format(Object* obj, char* buf, size_t size) {
+    SrcLoc loc;
+    if (!srcloc_get(obj, &loc)) return 0;
+    int n = snprintf(buf, size, "%s:%u:%u", srcloc_file_name(loc.file), (unsigned)loc.line, (unsigned)loc.column);
+    return n < 0 ? 0 : (size_t)n;
+}
+
+void srcloc_forget(int index) {
+    if (index >= 0 && index < OBJECT_POOL_SIZE) locations[index].line = 0;
+}
+
+void srcloc_reset(void) {
+    memset(locations, 0, sizeof(locations));
+}
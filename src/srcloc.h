@@ -0,0 +1,39 @@
+// srcloc.h
+// パーサが組み立てたリストのソース上の位置（ファイル・行・桁）の表。
+// 位置は Object には持たせず、オブジェクトプールの添字で引く別の固定長配列に置く（1要素 8 バイト）。
+// プロファイラ・トレース・エラーメッセージが、式のコンスセルから元のソースの位置を引くのに使う。
+
+#ifndef SRCLOC_H
+#define SRCLOC_H
+
+#include "object.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SRCLOC_MAX_FILES 256   // 登録できるファイル名の数
+
+typedef struct {
+    uint32_t line;    // 1 始まり
+    uint16_t column;  // 1 始まりのバイト位置（65535 で頭打ち）
+    uint16_t file;    // srcloc_file の番号（0 は文字列からパースした式）
+} SrcLoc;
+
+// ファイル名を登録して番号を返す（登録済みならその番号。表が一杯なら 0）
+uint16_t srcloc_file(const char* path);
+// 番号に対応するファイル名（0 と未登録の番号は "<input>"）
+const char* srcloc_file_name(uint16_t file);
+
+// リストの先頭のセル obj の位置を記録する（プール外のオブジェクトは記録しない）
+void srcloc_set(Object* obj, uint16_t file, uint32_t line, uint32_t column);
+// obj の位置を *loc に入れて true。位置を記録していなければ false
+bool srcloc_get(Object* obj, SrcLoc* loc);
+// obj の位置を "file:line:column" の形で buf に書く。
+// snprintf と同じく必要な長さを返す（位置がなければ何も書かずに 0）
+size_t srcloc_format(Object* obj, char* buf, size_t size);
+
+// プールのオブジェクトが解放されたとき・プールを初期化したときに呼ぶ（object_pool.c）
+void srcloc_forget(int index);
+void srcloc_reset(void);
+
+#endif // SRCLOC_H
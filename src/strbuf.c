@@ -0,0 +1,172 @@
+// strbuf.c
+// 伸長可能な文字列バッファと、表を引く整数の10進変換。
+
+#include "strbuf.h"
+#include "chibi_lisp.h"
+#include "heap.h"
+#include "bignum.h"
+#include <string.h>
+
+#define STRBUF_MAX     (HEAP_MAX_CHUNKS * CHUNK_SIZE)   // heap_alloc の1回の上限
+
+//------------------------------------------
+// 整数の10進変換
+//------------------------------------------
+
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+size_t format_int64(int64_t value, char* out) {
+    // INT64_MIN も扱えるよう絶対値は符号なしで持つ
+    uint64_t n = value < 0 ? (uint64_t)0 - (uint64_t)value : (uint64_t)value;
+    char tmp[INT64_DECIMAL_MAX];
+    char* p = tmp + sizeof(tmp);
+    while (n >= 100) {
+        const char* pair = digit_pairs + (n % 100) * 2;
+        n /= 100;
+        *--p = pair[1];
+        *--p = pair[0];
+    }
+    if (n >= 10) {
+        const char* pair = digit_pairs + n * 2;
+        *--p = pair[1];
+        *--p = pair[0];
+    } else {
+        *--p = (char)('0' + n);
+    }
+    if (value < 0) *--p = '-';
+    size_t length = (size_t)(tmp + sizeof(tmp) - p);
+    memcpy(out, p, length);
+    return length;
+}
+
+//------------------------------------------
+// バッファ
+//------------------------------------------
+
+void strbuf_init(StrBuf* sb) {
+    sb->data = NULL;
+    sb->length = 0;
+    sb->capacity = 0;
+    sb->sink = NULL;
+    sb->failed = false;
+}
+
+void strbuf_init_stream(StrBuf* sb, FILE* sink, char* storage, size_t size) {
+    sb->data = storage;
+    sb->length = 0;
+    sb->capacity = size;
+    sb->sink = sink;
+    sb->failed = false;
+}
+
+void strbuf_flush(StrBuf* sb) {
+    if (!sb->sink || sb->length == 0) return;
+    fwrite(sb->data, 1, sb->length, sb->sink);
+    sb->length = 0;
+}
+
+void strbuf_free(StrBuf* sb) {
+    if (!sb->sink && sb->data) heap_free(sb->data);
+    sb->data = NULL;
+    sb->length = 0;
+    sb->capacity = 0;
+}
+
+// あと extra バイト（と終端）を書ける場所を用意する。ストリームモードでは書き出して空ける
+static bool reserve(StrBuf* sb, size_t extra) {
+    if (sb->failed) return false;
+    if (sb->length + extra < sb->capacity) return true;
+    if (sb->sink) {
+        strbuf_flush(sb);
+        return extra < sb->capacity;
+    }
+
+    // heap モード: 割り当て単位に切り上げて倍々に伸ばす（最初は1チャンク）
+    size_t need = sb->length + extra + 1;
+    size_t capacity = sb->capacity ? sb->capacity * 2 : CHUNK_SIZE;
+    if (capacity < need) capacity = need;
+    capacity = (capacity + CHUNK_SIZE - 1) / CHUNK_SIZE * CHUNK_SIZE;
+    if (capacity > STRBUF_MAX) capacity = STRBUF_MAX;
+    char* data = capacity >= need ? heap_alloc(capacity) : NULL;
+    if (!data) {
+        sb->failed = true;
+        return false;
+    }
+    if (sb->data) {
+        memcpy(data, sb->data, sb->length);
+        heap_free(sb->data);
+    }
+    sb->data = data;
+    sb->capacity = capacity;
+    return true;
+}
+
+void strbuf_append(StrBuf* sb, const char* text, size_t length) {
+    if (sb->sink && length >= sb->capacity) {
+        // 固定領域より長い断片はそのまま書き出す
+        strbuf_flush(sb);
+        fwrite(text, 1, length, sb->sink);
+        return;
+    }
+    if (!reserve(sb, length)) return;
+    memcpy(sb->data + sb->length, text, length);
+    sb->length += length;
+}
+
+void strbuf_append_cstr(StrBuf* sb, const char* text) {
+    strbuf_append(sb, text, strlen(text));
+}
+
+void strbuf_append_char(StrBuf* sb, char c) {
+    if (!reserve(sb, 1)) return;
+    sb->data[sb->length++] = c;
+}
+
+void strbuf_append_int(StrBuf* sb, int64_t value) {
+    if (!reserve(sb, INT64_DECIMAL_MAX)) return;
+    sb->length += format_int64(value, sb->data + sb->length);
+}
+
+void strbuf_append_bignum(StrBuf* sb, Object* n) {
+    size_t length = bignum_format(n, NULL, 0);
+    if (sb->sink && length >= sb->capacity) {
+        // 表示用の固定領域に収まらないほど長ければ、一時領域で変換して書き出す
+        char* digits = heap_alloc(length + 1);
+        if (!digits) return;
+        bignum_format(n, digits, length + 1);
+        strbuf_append(sb, digits, length);
+        heap_free(digits);
+        return;
+    }
+    if (!reserve(sb, length)) return;
+    bignum_format(n, sb->data + sb->length, length + 1);
+    sb->length += length;
+}
+
+Object* strbuf_to_string(StrBuf* sb) {
+    if (sb->sink || sb->failed || !reserve(sb, 0)) {
+        strbuf_free(sb);
+        return NULL;
+    }
+    sb->data[sb->length] = '\0';
+    Object* obj = make_string_owned(sb->data, sb->length);
+    if (!obj) {
+        strbuf_free(sb);
+        return NULL;
+    }
+    // 本体の所有権は文字列オブジェクトへ移った
+    sb->data = NULL;
+    sb->length = 0;
+    sb->capacity = 0;
+    return obj;
+}
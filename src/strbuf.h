@@ -0,0 +1,46 @@
+// strbuf.h
+// 伸長可能な文字列バッファ。
+// heap 上で伸ばして最後にそのまま OBJ_STRING の本体にするモードと、
+// 呼び出し側の固定領域にためてあふれたらストリームへ書き出すモード（表示用）がある。
+
+#ifndef STRBUF_H
+#define STRBUF_H
+
+#include "object.h"
+#include <stdio.h>
+
+typedef struct {
+    char*  data;
+    size_t length;
+    size_t capacity;   // data の大きさ（終端の '\0' を含む）
+    FILE*  sink;       // 出力先（NULL なら heap 上で伸ばす）
+    bool   failed;     // 確保に失敗した（以後の追加は無視する）
+} StrBuf;
+
+// int64_t の10進表記の最大長（符号を含み、終端を含まない）
+#define INT64_DECIMAL_MAX 20
+
+// heap 上で伸ばすバッファ（最初の追加まで確保しない）
+void strbuf_init(StrBuf* sb);
+// storage にためて、あふれたら sink へ書き出すバッファ
+void strbuf_init_stream(StrBuf* sb, FILE* sink, char* storage, size_t size);
+// ストリームへ残りを書き出す（heap モードでは何もしない）
+void strbuf_flush(StrBuf* sb);
+// heap モードのバッファを解放する
+void strbuf_free(StrBuf* sb);
+
+void strbuf_append(StrBuf* sb, const char* text, size_t length);
+void strbuf_append_cstr(StrBuf* sb, const char* text);
+void strbuf_append_char(StrBuf* sb, char c);
+void strbuf_append_int(StrBuf* sb, int64_t value);
+// 整数（OBJ_NUMBER / OBJ_BIGNUM）の10進表記を追加する
+void strbuf_append_bignum(StrBuf* sb, Object* n);
+
+// heap モードのバッファを OBJ_STRING の本体として引き渡す（コピーしない）。
+// 失敗したら NULL（バッファは解放する）
+Object* strbuf_to_string(StrBuf* sb);
+
+// 2桁ずつ表を引いて10進表記を書く。終端の '\0' は付けない。書いた長さを返す
+size_t format_int64(int64_t value, char* out);
+
+#endif // STRBUF_H
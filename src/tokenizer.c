@@ -3,13 +3,11 @@
 
 #include "tokenizer.h"
 #include "chibi_lisp.h"
-#include "heap.h"
+#include "lexscan.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 
-#define STR_EQUAL(src, dst) (strncmp((src), (dst), strlen(dst)) == 0 )
-
 bool is_whitespace(char c) {
     return c == ' ' || c == '\n' || c == '\t';
 }
@@ -22,57 +20,198 @@ bool is_symbol_char(char c) {
     return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '?' || c == '!' || c == '-' || c == '=' || c == '<' || c == '>';
 }
 
-TokenArray* tokenize(const char* input) {
+// 初期容量の見積もり: 1トークンあたりの入力の平均的な長さ（外れたら倍に伸ばす）
+#define BYTES_PER_TOKEN 4
+#define MIN_CAPACITY    16
+
+// トークンを追加する（満杯なら倍の領域へ伸ばす）。伸ばせなければ false
+static bool push_token(TokenArray** tokens, const Token* token) {
+    TokenArray* t = *tokens;
+    if (t->size == t->capacity) {
+        size_t capacity = t->capacity * 2;
+        TokenArray* grown = realloc(t, sizeof(TokenArray) + sizeof(Token) * capacity);
+        if (grown == NULL) return false;
+        grown->capacity = capacity;
+        *tokens = t = grown;
+    }
+    t->tokens[t->size++] = *token;
+    return true;
+}
 
-    TokenArray *tokens = heap_alloc(sizeof(TokenArray));
-    Token token;
+//------------------------------------------
+// キーワードの判定（完全ハッシュ）
+//------------------------------------------
+
+typedef struct {
+    const char* name;
+    uint8_t     length;
+    TokenKind   kind;
+} Keyword;
+
+#define KEYWORD(name, kind) { name, sizeof(name) - 1, kind }
+
+// キーワードの一覧。ここに足すだけで判定表に入る（比較の連鎖は伸びない）
+static const Keyword keywords[] = {
+    KEYWORD("lambda",    TOKEN_LAMBDA),
+    KEYWORD("if",        TOKEN_IF),
+    KEYWORD("quote",     TOKEN_QUOTE),
+    KEYWORD("nil",       TOKEN_NIL),
+    KEYWORD("t",         TOKEN_TRUE),
+    KEYWORD("true",      TOKEN_TRUE),
+    KEYWORD("false",     TOKEN_FALSE),
+    KEYWORD("define",    TOKEN_DEFINE),
+    KEYWORD("set!",      TOKEN_SET),
+    KEYWORD("loop",      TOKEN_LOOP),
+    KEYWORD("dotimes",   TOKEN_DOTIMES),
+    KEYWORD("defmacro",  TOKEN_DEFMACRO),
+};
+
+#define KEYWORD_COUNT      (sizeof(keywords) / sizeof(keywords[0]))
+#define KEYWORD_BITS       6                    // 判定表は 64 要素（キーワード数の2倍以上）
+#define KEYWORD_SLOTS      (1u << KEYWORD_BITS)
+#define KEYWORD_MAX_LENGTH 16                   // これより長い字句はハッシュを計算せずにシンボルにする
+#define KEYWORD_MAX_SEED   65536                // 種を探す上限（見つからなければ線形探索にする）
+
+_Static_assert(KEYWORD_COUNT * 2 <= KEYWORD_SLOTS, "keyword table needs at least twice as many slots as keywords");
+_Static_assert(KEYWORD_COUNT <= INT8_MAX, "keyword_slots holds indices as int8_t");
+
+static int8_t   keyword_slots[KEYWORD_SLOTS];   // 各要素は keywords の添字（空きは -1）
+static uint32_t keyword_seed;
+static bool     keyword_linear = false;         // 衝突のない種がなかった（keywords を順に比べる）
+static bool     keyword_ready = false;
+
+// 長さと先頭・中央・末尾の文字だけから求めるハッシュ（字句全体は読まない）。
+// これらがすべて同じキーワードの組はどの種でも分けられないので、その場合は線形探索に落とす
+static uint32_t keyword_hash(const char* text, size_t length, uint32_t seed) {
+    uint32_t h = seed ^ (uint32_t)length;
+    h = (h ^ (uint8_t)text[0]) * 16777619u;
+    h = (h ^ (uint8_t)text[length / 2]) * 16777619u;
+    h = (h ^ (uint8_t)text[length - 1]) * 16777619u;
+    return h >> (32 - KEYWORD_BITS);
+}
 
-    if (tokens == NULL) {
-        return NULL;  // メモリ割り当て失敗
+// 衝突のない種を探して判定表を作る（最初の tokenize で1回だけ）
+static void build_keyword_table(void) {
+    for (size_t k = 0; k < KEYWORD_COUNT; k++) {
+        if (keywords[k].length > KEYWORD_MAX_LENGTH) keyword_linear = true;
+    }
+    for (uint32_t seed = 0; seed < KEYWORD_MAX_SEED && !keyword_linear; seed++) {
+        memset(keyword_slots, -1, sizeof(keyword_slots));
+        bool perfect = true;
+        for (size_t k = 0; k < KEYWORD_COUNT && perfect; k++) {
+            uint32_t slot = keyword_hash(keywords[k].name, keywords[k].length, seed);
+            if (keyword_slots[slot] >= 0) perfect = false;
+            else keyword_slots[slot] = (int8_t)k;
+        }
+        if (perfect) {
+            keyword_seed = seed;
+            keyword_ready = true;
+            return;
+        }
     }
+    keyword_linear = true;
+    keyword_ready = true;
+}
 
-    // トークンの初期化
-    tokens->size = 0;
-    tokens->tokens = heap_alloc(sizeof(Token) * 10);  // 初期サイズ
-    if (tokens->tokens == NULL) {
-        heap_free(tokens);
-        return NULL;
+// シンボルの字句からキーワードのトークンの種類を判定する（キーワードでなければ TOKEN_SYMBOL）。
+// 字句全体と完全に一致したときだけキーワードにする（"time" や "print-x" は普通のシンボル）
+static TokenKind classify_symbol(const char* start, size_t length) {
+    if (keyword_linear) {
+        for (size_t k = 0; k < KEYWORD_COUNT; k++) {
+            if (keywords[k].length == length && memcmp(start, keywords[k].name, length) == 0) return keywords[k].kind;
+        }
+        return TOKEN_SYMBOL;
     }
+    if (length > KEYWORD_MAX_LENGTH) return TOKEN_SYMBOL;
+    int8_t k = keyword_slots[keyword_hash(start, length, keyword_seed)];
+    if (k < 0 || keywords[k].length != length) return TOKEN_SYMBOL;
+    return memcmp(start, keywords[k].name, length) == 0 ? keywords[k].kind : TOKEN_SYMBOL;
+}
+
+const char* lexer_keyword(size_t index, TokenKind* kind) {
+    if (index >= KEYWORD_COUNT) return NULL;
+    if (kind) *kind = keywords[index].kind;
+    return keywords[index].name;
+}
+
+//------------------------------------------
+// 1トークンずつの走査
+//------------------------------------------
 
-    const char *ch = input;
-    while (*ch) {
+void lexer_init(Lexer* lexer, const char* input) {
+    lexer_init_len(lexer, input, strlen(input));
+}
+
+void lexer_init_len(Lexer* lexer, const char* input, size_t length) {
+    if (!keyword_ready) build_keyword_table();
+    lexer->source = input;
+    lexer->cursor = input;
+    lexer->end    = input + length;
+    lexer->error  = false;
+    lexer->exhausted = false;
+    lexer->file   = 0;
+    lexer->line_cursor = input;
+    lexer->line_start  = input;
+    lexer->line        = 1;
+}
+
+// 位置はリストごとに1回しか求めないので、改行は必要になったところまで memchr で数える
+void lexer_location(Lexer* lexer, uint32_t offset, uint32_t* line, uint32_t* column) {
+    const char* target = lexer->source + offset;
+    if (target < lexer->line_cursor) {
+        // 読み直しで戻ったときは先頭から数え直す
+        lexer->line_cursor = lexer->source;
+        lexer->line_start  = lexer->source;
+        lexer->line        = 1;
+    }
+    const char* p = lexer->line_cursor;
+    while ((p = lexscan_find(p, target, '\n')) < target) {
+        lexer->line++;
+        lexer->line_start = ++p;
+    }
+    lexer->line_cursor = target;
+    *line   = lexer->line;
+    *column = (uint32_t)(target - lexer->line_start) + 1;
+}
+
+// 字句はコピーせずに位置と長さだけを返す。end より先は読まない（'\0' 終端でなくてよい）。
+// 空白・コメント・文字列の本体・シンボルは lexscan.h の走査関数で読み飛ばす
+bool lexer_next(Lexer* lexer, Token* token) {
+    const char* ch  = lexer->cursor;
+    const char* end = lexer->end;
+    while (ch < end) {
         // 空白をスキップ
-        while (is_whitespace(*ch)) {
-            ch++;
-        }
-        if (*ch == '\0') {
+        ch = lexscan_skip_space(ch, end);
+        if (ch == end) {
             break;  // 文字列の終端
         }
 
         if (*ch == ';') {
             // コメント行は無視
-            while (*ch && *ch != '\n') {
-                ch++;
-            }
+            ch = lexscan_find(ch, end, '\n');
             continue;  // 次のトークンへ
         }
 
         // トークンの種類を判定
+        const char *start = ch;
+        TokenKind kind;
         switch (*ch) {
-            case '(':
-                token.kind = TOKEN_LPAREN;
-                token.value = heap_alloc(2);  // '(' と '\0'
-                if (token.value == NULL) goto ERROR;  // メモリ割り当て失敗
-                strcpy(token.value, "(");
-                ch++;
+            case '(': kind = TOKEN_LPAREN;   ch++; break;
+            case ')': kind = TOKEN_RPAREN;   ch++; break;
+            case '+': kind = TOKEN_PLUS;     ch++; break;
+            case '-': kind = TOKEN_MINUS;    ch++; break;
+            case '*': kind = TOKEN_ASTERISK; ch++; break;
+            case '/': kind = TOKEN_SLASH;    ch++; break;
+            case '=': kind = TOKEN_EQ;       ch++; break;
+            case '>':
+                // ">=" / ">"
+                if (ch + 1 < end && ch[1] == '=') { kind = TOKEN_GTE; ch += 2; }
+                else              { kind = TOKEN_GT;  ch++; }
                 break;
-            case ')':
-                token.kind = TOKEN_RPAREN;
-                token.value = heap_alloc(2);  // ')' と '\0'
-                if (token.value == NULL) goto ERROR;  // メモリ割り当て失敗
-                token.value[0] = ')';
-                token.value[1] = '\0';
-                ch++;
+            case '<':
+                // "<=" / "<"
+                if (ch + 1 < end && ch[1] == '=') { kind = TOKEN_LTE; ch += 2; }
+                else              { kind = TOKEN_LT;  ch++; }
                 break;
             case '0':
             case '1':
@@ -84,240 +223,83 @@ TokenArray* tokenize(const char* input) {
             case '7':
             case '8':
             case '9':
-                token.kind        = TOKEN_NUMBER;
-                const char *start = ch;
-                while (is_digit(*ch)) ch++;
-                size_t length = ch - start;
-                token.value   = heap_alloc(length + 1);  // 数値と '\0'
-                if (token.value == NULL) goto ERROR;     // メモリ割り当て失敗
-                strncpy(token.value, start, length);
-                token.value[length] = '\0';
-                break;
-            case '+':
-                token.kind = TOKEN_PLUS;
-                token.value = heap_alloc(2);  // '+' と '\0'
-                if (token.value == NULL) goto ERROR;  // メモリ割り当て失敗
-                token.value[0] = '+';
-                token.value[1] = '\0';
-                ch++;
-                break;
-            case '-':
-                token.kind = TOKEN_MINUS;
-                token.value = heap_alloc(2);  // '-' と '\0'
-                if (token.value == NULL) goto ERROR;  // メモリ割り当e失敗
-                token.value[0] = '-';
-                token.value[1] = '\0';
-                ch++;
-                break;
-            case '*':
-                token.kind = TOKEN_ASTERISK;
-                token.value = heap_alloc(2);  // '*' と '\0'
-                if (token.value == NULL) goto ERROR;  // メモリ割り当て失敗
-                token.value[0] = '*';
-                token.value[1] = '\0';
-                ch++;
-                break;
-            case '/':
-                token.kind = TOKEN_SLASH;
-                token.value = heap_alloc(2);  // '/' と '\0'
-                if (token.value == NULL) goto ERROR;  // メモリ割り当て失敗
-                token.value[0] = '/';
-                token.value[1] = '\0';
-                ch++;
-                break;
-            case '"':
-                // 文字列リテラル
-                token.kind = TOKEN_STRING;
-                {
-                    const char *str_start = ++ch;  // 開始クォートをスキップ
-                    while (*ch && *ch != '"') ch++;  // 終了クォートまで進む
-                    if (*ch != '"') goto ERROR;  // 閉じクォートがない
-                    size_t str_length = ch - str_start;
-                    token.value = heap_alloc(str_length + 1);
-                    if (token.value == NULL) goto ERROR;  // メモリ割り当て失敗
-                    strncpy(token.value, str_start, str_length);
-                    token.value[str_length] = '\0';
-                    ch++;  // 終了クォートをスキップ
-                }
-                break;
-            case '=':
-                token.kind = TOKEN_EQ;
-                token.value = heap_alloc(2);  // '=' と '\0'
-                if (token.value == NULL) goto ERROR;  // メモリ割り当て失敗
-                token.value[0] = '=';
-                token.value[1] = '\0';
-                ch++;
-                break;
-            case '>':
-                if (*(ch + 1) == '=') {
-                    token.kind = TOKEN_GTE;
-                    token.value = heap_alloc(3);  // ">=" と '\0'
-                    if (token.value == NULL) goto ERROR;  // メモリ割り当て失敗
-                    token.value[0] = '>';
-                    token.value[1] = '=';
-                    token.value[2] = '\0';
-                    ch += 2;  // ">=" をスキップ
-                } else {
-                    token.kind = TOKEN_GT;
-                    token.value = heap_alloc(2);  // '>' と '\0'
-                    if (token.value == NULL) goto ERROR;  // メモリ割り当て失敗
-                    token.value[0] = '>';
-                    token.value[1] = '\0';
+                kind = TOKEN_NUMBER;
+                while (ch < end && is_digit(*ch)) ch++;
+                // 小数部（"1.5" のように '.' の後に数字が続くときだけ）
+                if (ch + 1 < end && *ch == '.' && is_digit(ch[1])) {
                     ch++;
+                    while (ch < end && is_digit(*ch)) ch++;
                 }
                 break;
-            case '<':
-                if (*(ch + 1) == '=') {
-                    token.kind = TOKEN_LTE;
-                    token.value = heap_alloc(3);  // "<=" と '\0'
-                    if (token.value == NULL) goto ERROR;  // メモリ割り当   て失敗
-                    token.value[0] = '<';
-                    token.value[1] = '=';
-                    token.value[2] = '\0';
-                    ch += 2;  // "<=" をスキップ
-                } else {
-                    token.kind = TOKEN_LT;
-                    token.value = heap_alloc(2);  // '<' と '\0'
-                    if (token.value == NULL) goto ERROR;  // メモリ割り当て失敗
-                    token.value[0] = '<';
-                    token.value[1] = '\0';
-                    ch++;
+            case '"': {
+                // 文字列リテラル（トークンは引用符の内側を指す）
+                start = ch + 1;  // 開始クォートをスキップ
+                const char* close = lexscan_find(start, end, '"');  // 終了クォートまで進む
+                if (close == end) {
+                    // 閉じクォートがない
+                    lexer->cursor = end;
+                    lexer->error = true;
+                    return false;
                 }
-                break;
+                token->kind   = TOKEN_STRING;
+                token->offset = (uint32_t)(start - lexer->source);
+                token->length = (uint32_t)(close - start);
+                lexer->cursor = close + 1;  // 終了クォートをスキップ
+                return true;
+            }
             default:
-                if (is_symbol_char(*ch)) {
-                    // シンボルとして扱う
-                    const char *start = ch;
-                    while (is_symbol_char(*ch)) ch++;
-                    size_t length = ch - start;
-                    token.value = heap_alloc(length + 1);  // シンボルと '\0'
-                    if (token.value == NULL) goto ERROR;  // メモリ割り当て失敗
-                    strncpy(token.value, start, length);
-                    token.value[length] = '\0';
-
-                    // トークンの種類を判定
-                    if (STR_EQUAL(token.value, "lambda")) {
-                        token.kind = TOKEN_LAMBDA;
-                        break;
-                    }
-
-                    if (STR_EQUAL(token.value, "if")) {
-                        token.kind = TOKEN_IF;
-                        break;
-                    }
-
-                    if (STR_EQUAL(token.value, "quote")) {
-                        token.kind = TOKEN_QUOTE;
-                        break;
-                    }
-
-                    if (STR_EQUAL(token.value, "nil")) {
-                        token.kind = TOKEN_NIL;
-                        break;
-                    }
-
-                    if (STR_EQUAL(token.value, "t")) {
-                        token.kind = TOKEN_TRUE;
-                        break;
-                    }
-
-                    if (STR_EQUAL(token.value, "define")) {
-                        token.kind = TOKEN_DEFINE;
-                        break;
-                    }
-                    if (STR_EQUAL(token.value, "set!")) {
-                        token.kind = TOKEN_SET;
-                        break;
-                    }
-
-                    if (STR_EQUAL(token.value, "loop")) {
-                        token.kind = TOKEN_LOOP;
-                        break;
-                    }
-
-                    if (STR_EQUAL(token.value, "dotimes")) {
-                        token.kind = TOKEN_DOTIMES;
-                        break;
-                    }
-
-                    if (STR_EQUAL(token.value, "print")) {
-                        token.kind = TOKEN_PRINT;
-                        break;
-                    }
-
-                    if (STR_EQUAL(token.value, "println")) {
-                        token.kind = TOKEN_PRINTLN;
-                        break;
-                    }
-
-                    if (STR_EQUAL(token.value, "str")) {
-                        token.kind = TOKEN_STR;
-                        break;
-                    }
-
-                    if (STR_EQUAL(token.value, "length")) {
-                        token.kind = TOKEN_LENGTH;
-                        break;
-                    }
-
-                    if (STR_EQUAL(token.value, "bool?")) {
-                        token.kind = TOKEN_BOOLP;
-                        break;
-                    }
-
-                    if (STR_EQUAL(token.value, "now")) {
-                        token.kind = TOKEN_NOW;
-                        break;
-                    }
-
-                    if (STR_EQUAL(token.value, "sleep")) {
-                        token.kind = TOKEN_SLEEP;
-                        break;
-                    }
-
-                    if (STR_EQUAL(token.value, "time-diff")) {
-                        token.kind = TOKEN_TIME_DIFF;
-                        break;
-                    }
-
-                    token.kind = TOKEN_SYMBOL;
-
-                } else {
-                        // 未知の文字はスキップ
-                        ch++;
-                        continue;
+                if (!is_symbol_char(*ch)) {
+                    // 未知の文字はスキップ
+                    ch++;
+                    continue;
                 }
-
+                // シンボルとして扱う
+                ch = lexscan_symbol_end(ch, end);
+                kind = classify_symbol(start, ch - start);
                 break;
         }
 
-        // トークンを配列に追加
-        tokens->tokens[tokens->size] = token;
-        tokens->size++;
+        token->kind   = kind;
+        token->offset = (uint32_t)(start - lexer->source);
+        token->length = (uint32_t)(ch - start);
+        lexer->cursor = ch;
+        return true;
     }
+    lexer->cursor = end;
+    return false;
+}
 
+//------------------------------------------
+// トークン列
+//------------------------------------------
+
+// 入力全体を1回走査してトークン列にする。
+// 確保はトークン列1つだけ（見積もりを超えたときだけ伸ばす）
+TokenArray* tokenize(const char* input) {
+    Lexer lexer;
+    lexer_init(&lexer, input);
+    size_t capacity = (size_t)(lexer.end - input) / BYTES_PER_TOKEN + MIN_CAPACITY;
+    TokenArray *tokens = malloc(sizeof(TokenArray) + sizeof(Token) * capacity);
+    if (tokens == NULL) {
+        return NULL;  // メモリ割り当て失敗
+    }
+    tokens->size     = 0;
+    tokens->capacity = capacity;
+    tokens->source   = input;
+
+    Token token;
+    while (lexer_next(&lexer, &token)) {
+        if (!push_token(&tokens, &token)) goto ERROR;
+    }
+    if (lexer.error) goto ERROR;
     return tokens;
 
 ERROR:
-    heap_free(tokens->tokens);
-    heap_free(tokens);
+    free(tokens);
     return NULL;
 }
 
-// メモリ解放関数を追加
 void free_token_array(TokenArray* tokens) {
-    if (tokens == NULL) return;
-
-    // 各トークンの値文字列を解放
-    for (int i = 0; i < tokens->size; i++) {
-        if (tokens->tokens[i].value != NULL) {
-            heap_free(tokens->tokens[i].value);
-        }
-    }
-
-    // トークン配列を解放
-    heap_free(tokens->tokens);
-
-    // TokenArray構造体を解放
-    heap_free(tokens);
-}
\ No newline at end of file
+    // 字句は入力を指しているだけなので、解放するのはトークン列だけ
+    free(tokens);
+}
@@ -1,6 +1,7 @@
 #ifndef __TOKENIZER_H__
 #define __TOKENIZER_H__
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 
@@ -28,31 +29,58 @@ typedef enum {
     TOKEN_GT,          // >
     TOKEN_LTE,         // <=
     TOKEN_GTE,         // >=
-    // 組み込み関数
-    TOKEN_PRINT,       // print
-    TOKEN_PRINTLN,     // println
-    TOKEN_STR,         // str
-    TOKEN_LENGTH,      // length
-    TOKEN_BOOLP,       // bool?
-    // タイマー関数
-    TOKEN_NOW,         // now (現在時刻のミリ秒取得)
-    TOKEN_SLEEP,       // sleep (指定秒数待機)
-    TOKEN_TIME_DIFF,   // time-diff (時間差計算)
     // ループ制御関数
     TOKEN_DOTIMES,      // dotimes (指定回数繰り返し)
+    // マクロ
+    TOKEN_DEFMACRO,     // defmacro (マクロ定義)
 } TokenKind;
 
+// トークンは入力文字列の一部分を指すだけで、字句をコピーしない
 typedef struct {
-    TokenKind kind;  // Type of the token
-    char* value;     // セミコロンを追加
+    TokenKind kind;   // Type of the token
+    uint32_t offset;  // 入力の先頭からの位置（文字列リテラルは開き引用符の次）
+    uint32_t length;  // 字句の長さ（文字列リテラルは引用符の内側の長さ）
 } Token;
 
+// トークン列。配列はヘッダと一続きに確保し、足りなくなったら丸ごと伸ばす
 typedef struct {
     size_t size;
-    Token* tokens;
+    size_t capacity;
+    const char* source;  // トークンが指す入力（tokenize の呼び出し側が保持する）
+    Token tokens[];
 } TokenArray;
 
+// i 番目のトークンの字句の先頭（'\0' 終端ではない。長さは tokens[i].length）
+static inline const char* token_text(const TokenArray* tokens, size_t i) {
+    return tokens->source + tokens->tokens[i].offset;
+}
+
+// 入力を先頭から1トークンずつ読む走査位置（パーサはトークン列を作らずにこれで直接読む）
+typedef struct {
+    const char* source;  // 入力の先頭（トークンの offset の基準）
+    const char* cursor;  // 次に読む位置
+    const char* end;     // 入力の終わり
+    bool error;          // 閉じていない文字列リテラルで止まった
+    bool exhausted;      // パーサが式を組み立てる途中でオブジェクトプールが尽きた
+    uint16_t file;       // 位置の表（srcloc）に記録するファイル番号（0 は文字列の入力）
+    // 行の計算用: line_cursor より前の改行は数え終わっている（前に進むときは差分だけ数える）
+    const char* line_cursor;
+    const char* line_start;  // line 行目の先頭
+    uint32_t line;
+} Lexer;
+
 // 関数宣言
+void lexer_init(Lexer* lexer, const char* input);
+// '\0' 終端でない length バイトの入力（mmap したファイルなど）を読む
+void lexer_init_len(Lexer* lexer, const char* input, size_t length);
+// 次のトークンを *token に入れて true。入力の終わりまたはエラー（error が立つ）なら false
+bool lexer_next(Lexer* lexer, Token* token);
+// 入力の先頭から offset の位置の行と桁（どちらも 1 始まり。桁はバイト単位）
+void lexer_location(Lexer* lexer, uint32_t offset, uint32_t* line, uint32_t* column);
+// index 番目のキーワードの名前（*kind にトークンの種類）。範囲外なら NULL（テスト用）
+const char* lexer_keyword(size_t index, TokenKind* kind);
+
+// 入力をトークン列にする。返したトークン列を使い終わるまで input を解放しないこと
 TokenArray* tokenize(const char* input);
 void free_token_array(TokenArray* tokens);
 
@@ -0,0 +1,560 @@
+// vm.c
+// バイトコードVMの実装。
+// トップレベルの式をスタックマシンの命令列にコンパイルして実行する。
+// 命令ループ本体は vm_dispatch.inc にあり、computed goto 版と switch 版の
+// 2通りにインクルードして同じ命令定義から両方のディスパッチを作る。
+
+#include "vm.h"
+#include "eval.h"
+#include "closure.h"
+#include "macro.h"
+#include "object_pool.h"
+#include "gc.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define VM_STACK_MAX  256   // 値スタックの最大深さ
+#define VM_LOCALS_MAX 64    // ローカルスロットの最大数
+
+//------------------------------------------
+// 命令セット
+//------------------------------------------
+
+// X(名前): 命令の一覧。enum と computed goto のラベル表をここから作る
+#define VM_OPCODES(X) \
+    X(PUSH_CONST)      /* a: 定数番号                      */ \
+    X(LOAD_LOCAL)      /* a: スロット                      */ \
+    X(STORE_LOCAL)     /* a: スロット (値はスタックに残す) */ \
+    X(POP_LOCAL)       /* a: スロット (値を取り出して格納) */ \
+    X(REPLACE_LOCAL)   /* a: スロット (前の値を解放して格納) */ \
+    X(LOAD_GLOBAL)     /* a: 名前の定数番号                */ \
+    X(SET_GLOBAL)      /* a: 名前の定数番号                */ \
+    X(DEFINE_GLOBAL)   /* a: 名前の定数番号                */ \
+    X(POP)                                                    \
+    X(JUMP)            /* b: 飛び先                        */ \
+    X(BRANCH_FALSE)    /* b: 偽のときの飛び先              */ \
+    X(ADD)                                                    \
+    X(SUB)                                                    \
+    X(MUL)                                                    \
+    X(EQ)                                                     \
+    X(LT)                                                     \
+    X(GT)                                                     \
+    X(LTE)                                                    \
+    X(GTE)                                                    \
+    X(CALL_NATIVE)     /* a: 関数の定数番号, b: 引数の数   */ \
+    X(CALL)            /* b: 引数の数                      */ \
+    X(EVAL_AST)        /* a: 式の定数番号                  */ \
+    X(DOTIMES_INIT)    /* a: 変数スロット, b: 終了先       */ \
+    X(RETURN)                                                 \
+    /* スーパー命令 */                                        \
+    X(LOADL_PUSHC_ADD) /* a: スロット, b: 定数番号         */ \
+    X(CMP_BRANCH)      /* a: 比較命令, b: 偽のときの飛び先 */ \
+    X(DOTIMES_STEP)    /* a: 変数スロット, b: ループ先頭   */ \
+    X(DOTIMES_BUMP)    /* a: 変数スロット, b: ループ先頭   */
+
+typedef enum {
+#define VM_ENUM(name) VM_##name,
+    VM_OPCODES(VM_ENUM)
+#undef VM_ENUM
+    VM_OP_COUNT
+} VmOpcode;
+
+typedef struct {
+    const void* handler;  // computed goto 版の飛び先（初回実行時に埋める）
+    uint8_t  op;
+    int32_t  a;
+    int32_t  b;
+    uint32_t stamp;       // LOAD_GLOBAL のキャッシュの環境バージョン
+    Object*  cache;       // LOAD_GLOBAL のキャッシュした束縛のセル
+} VmInstr;
+
+// コンパイル時の作業領域なのでオブジェクトヒープではなく malloc で確保する
+struct VmCode {
+    VmInstr* code;
+    size_t   length;
+    size_t   capacity;
+    Object** constants;   // 構文木の一部か固定オブジェクトのみ（構文木とともに生存）
+    size_t   nconstants;
+    size_t   constants_capacity;
+    int      nlocals;
+    bool     threaded;    // handler を埋めたか
+};
+
+static bool superinstructions_enabled = true;
+
+void vm_set_superinstructions(bool enable) {
+    superinstructions_enabled = enable;
+}
+
+size_t vm_code_length(const VmCode* code) {
+    return code ? code->length : 0;
+}
+
+void vm_free(VmCode* code) {
+    if (!code) return;
+    free(code->code);
+    free(code->constants);
+    free(code);
+}
+
+//------------------------------------------
+// コンパイラ
+//------------------------------------------
+
+typedef struct {
+    VmCode* code;
+    const char* locals[VM_LOCALS_MAX];  // スコープ中のローカル名 (隠しスロットは NULL)
+    int nlocals;
+    int depth;          // 現在のスタック深さ
+    int barrier;        // これより前の命令は飛び先になりうるので融合しない
+    bool failed;
+} Compiler;
+
+static int add_constant(Compiler* c, Object* value) {
+    VmCode* code = c->code;
+    for (size_t i = 0; i < code->nconstants; i++) {
+        if (code->constants[i] == value) return (int)i;
+    }
+    if (code->nconstants == code->constants_capacity) {
+        size_t capacity = code->constants_capacity ? code->constants_capacity * 2 : 8;
+        Object** grown = realloc(code->constants, sizeof(Object*) * capacity);
+        if (!grown) { c->failed = true; return 0; }
+        code->constants = grown;
+        code->constants_capacity = capacity;
+    }
+    code->constants[code->nconstants] = value;
+    return (int)code->nconstants++;
+}
+
+// 命令を追加する。delta はスタック深さの増減
+static int emit(Compiler* c, VmOpcode op, int a, int b, int delta) {
+    VmCode* code = c->code;
+    if (code->length == code->capacity) {
+        size_t capacity = code->capacity ? code->capacity * 2 : 32;
+        VmInstr* grown = realloc(code->code, sizeof(VmInstr) * capacity);
+        if (!grown) { c->failed = true; return 0; }
+        code->code = grown;
+        code->capacity = capacity;
+    }
+    c->depth += delta;
+    if (c->depth > VM_STACK_MAX) c->failed = true;
+    VmInstr* instr = &code->code[code->length];
+    memset(instr, 0, sizeof(*instr));
+    instr->op = (uint8_t)op;
+    instr->a  = a;
+    instr->b  = b;
+    return (int)code->length++;
+}
+
+// 現在位置を飛び先として返す（以降の融合はこの位置をまたがない）
+static int label_here(Compiler* c) {
+    c->barrier = (int)c->code->length;
+    return c->barrier;
+}
+
+static void patch_target(Compiler* c, int at, int target) {
+    c->code->code[at].b = target;
+}
+
+// 直前の命令列が融合可能な位置にあるか
+static VmInstr* last_instr(Compiler* c, int back) {
+    int index = (int)c->code->length - back;
+    if (!superinstructions_enabled || index < c->barrier) return NULL;
+    return &c->code->code[index];
+}
+
+static int new_local(Compiler* c, const char* name) {
+    if (c->nlocals >= VM_LOCALS_MAX) { c->failed = true; return 0; }
+    c->locals[c->nlocals] = name;
+    if (c->nlocals + 1 > c->code->nlocals) c->code->nlocals = c->nlocals + 1;
+    return c->nlocals++;
+}
+
+static int find_local(Compiler* c, const char* name) {
+    for (int i = c->nlocals - 1; i >= 0; i--) {
+        if (c->locals[i] && strcmp(c->locals[i], name) == 0) return i;
+    }
+    return -1;
+}
+
+static void compile_expr(Compiler* c, Object* expr);
+
+// 二項演算 (+ - * = < > <= >=) の命令。対象外なら -1
+static int binary_opcode(Object* op) {
+    if (!op || op->type != OBJ_OPERATOR) return -1;
+    switch (op->data.operator_type) {
+        case OP_PLUS:     return VM_ADD;
+        case OP_MINUS:    return VM_SUB;
+        case OP_ASTERISK: return VM_MUL;
+        case OP_EQ:       return VM_EQ;
+        case OP_LT:       return VM_LT;
+        case OP_GT:       return VM_GT;
+        case OP_LTE:      return VM_LTE;
+        case OP_GTE:      return VM_GTE;
+        default:          return -1;
+    }
+}
+
+static bool is_comparison(int op) {
+    return op == VM_EQ || op == VM_LT || op == VM_GT || op == VM_LTE || op == VM_GTE;
+}
+
+static void emit_binary(Compiler* c, int op) {
+    VmInstr* pushc = last_instr(c, 1);
+    VmInstr* loadl = last_instr(c, 2);
+    if (op == VM_ADD && loadl && loadl->op == VM_LOAD_LOCAL && pushc->op == VM_PUSH_CONST) {
+        // LOAD_LOCAL + PUSH_CONST + ADD → LOADL_PUSHC_ADD
+        int slot = loadl->a, constant = pushc->a;
+        c->code->length -= 2;
+        c->depth -= 2;
+        emit(c, VM_LOADL_PUSHC_ADD, slot, constant, 1);
+        return;
+    }
+    emit(c, (VmOpcode)op, 0, 0, -1);
+}
+
+// 条件分岐を出力し、飛び先を後で埋める命令の位置を返す
+static int emit_branch_false(Compiler* c) {
+    VmInstr* cmp = last_instr(c, 1);
+    if (cmp && is_comparison(cmp->op)) {
+        // 比較 + BRANCH_FALSE → CMP_BRANCH
+        int op = cmp->op;
+        c->code->length -= 1;
+        c->depth += 1;
+        return emit(c, VM_CMP_BRANCH, op, 0, -2);
+    }
+    return emit(c, VM_BRANCH_FALSE, 0, 0, -1);
+}
+
+// 本体の式を順に評価し、最後の値をスロット result に入れる
+static void compile_body(Compiler* c, Object* body, int result) {
+    for (Object* it = body; is_cons(it); it = obj_cdr(it)) {
+        compile_expr(c, obj_car(it));
+        if (is_cons(obj_cdr(it))) {
+            emit(c, VM_POP, 0, 0, -1);
+        } else {
+            emit(c, VM_POP_LOCAL, result, 0, -1);
+        }
+    }
+}
+
+// (if cond then [else])
+static void compile_if(Compiler* c, Object* args) {
+    compile_expr(c, obj_car(args));
+    int branch = emit_branch_false(c);
+    compile_expr(c, obj_car(obj_cdr(args)));
+    int jump = emit(c, VM_JUMP, 0, 0, -1);
+    patch_target(c, branch, label_here(c));
+    Object* else_part = obj_cdr(obj_cdr(args));
+    compile_expr(c, is_cons(else_part) ? obj_car(else_part) : obj_nil);
+    patch_target(c, jump, label_here(c));
+}
+
+// (dotimes (var count) body...)
+// スロット: var, 反復カウンタ, 回数, 結果
+static void compile_dotimes(Compiler* c, Object* args) {
+    Object* spec = obj_car(args);
+    Object* var  = obj_car(spec);
+    if (!is_symbol(var) || !is_cons(obj_cdr(spec))) { c->failed = true; return; }
+
+    int saved = c->nlocals;
+    compile_expr(c, obj_car(obj_cdr(spec)));
+    int slot = new_local(c, NULL);
+    new_local(c, NULL);
+    new_local(c, NULL);
+    int result = new_local(c, NULL);
+    c->locals[slot] = var->data.symbol.name;
+
+    int init = emit(c, VM_DOTIMES_INIT, slot, 0, -1);
+    int body = label_here(c);
+    compile_body(c, obj_cdr(args), result);
+    // 本体が変数の値を保存しなければカウンタの箱をその場で進める
+    bool reuse = !closure_value_escapes(var->data.symbol.name, obj_cdr(args));
+    emit(c, reuse ? VM_DOTIMES_BUMP : VM_DOTIMES_STEP, slot, body, 0);
+    patch_target(c, init, label_here(c));
+    emit(c, VM_LOAD_LOCAL, result, 0, 1);
+    c->nlocals = saved;
+}
+
+// (loop (var init) condition update body...)
+// スロット: var, 更新式で作った値（解放してよい値の目印）, 結果
+static void compile_loop(Compiler* c, Object* args) {
+    Object* spec = obj_car(args);
+    Object* var  = obj_car(spec);
+    if (!is_symbol(var)) { c->failed = true; return; }
+
+    // 変数の値がどこにも保存されず、更新式が毎回新しい値を返す演算子の呼び出しなら、
+    // 置き換えた古い値はすぐに解放できる
+    Object* rest = obj_cdr(args);
+    Object* update = obj_car(obj_cdr(rest));
+    bool release = !closure_value_escapes(var->data.symbol.name, rest)
+                   && is_cons(update) && is_operator(obj_car(update));
+
+    int saved = c->nlocals;
+    compile_expr(c, obj_car(obj_cdr(spec)));
+    int slot = new_local(c, var->data.symbol.name);
+    int owned = new_local(c, NULL);
+    int result = new_local(c, NULL);
+    emit(c, VM_POP_LOCAL, slot, 0, -1);
+    emit(c, VM_PUSH_CONST, add_constant(c, obj_nil), 0, 1);
+    emit(c, VM_STORE_LOCAL, owned, 0, 0);
+    emit(c, VM_POP_LOCAL, result, 0, -1);
+
+    int test = label_here(c);
+    compile_expr(c, obj_car(rest));
+    int branch = emit_branch_false(c);
+    compile_body(c, obj_cdr(obj_cdr(rest)), result);
+    compile_expr(c, update);
+    emit(c, release ? VM_REPLACE_LOCAL : VM_POP_LOCAL, slot, 0, -1);
+    emit(c, VM_JUMP, 0, test, 0);
+    patch_target(c, branch, label_here(c));
+    emit(c, VM_LOAD_LOCAL, result, 0, 1);
+    c->nlocals = saved;
+}
+
+// 関数呼び出し (head args...)
+static void compile_call(Compiler* c, Object* expr) {
+    Object* head = obj_car(expr);
+    int argc = 0;
+    for (Object* it = obj_cdr(expr); is_cons(it); it = obj_cdr(it)) argc++;
+
+    int op = binary_opcode(head);
+    if (op >= 0 && argc == 2) {
+        compile_expr(c, obj_car(obj_cdr(expr)));
+        compile_expr(c, obj_car(obj_cdr(obj_cdr(expr))));
+        emit_binary(c, op);
+        return;
+    }
+
+    // 評価前に展開できなかったマクロ呼び出しは構文木のまま評価して展開させる
+    if (is_symbol(head) && find_local(c, head->data.symbol.name) < 0 &&
+        is_macro(evaluator_global_value(head->data.symbol.name))) {
+        c->failed = true;
+        return;
+    }
+
+    bool native = head && (head->type == OBJ_OPERATOR || head->type == OBJ_BUILTIN);
+    if (native && !evaluator_arity_ok(head, (size_t)argc)) {
+        // 引数の数が合わない呼び出しは評価器と同じく引数を評価せず nil になる。
+        // 検査はここで済ませるので、実行時は関数ポインタを直接呼ぶ
+        emit(c, VM_PUSH_CONST, add_constant(c, obj_nil), 0, 1);
+        return;
+    }
+    if (!native) compile_expr(c, head);
+    for (Object* it = obj_cdr(expr); is_cons(it); it = obj_cdr(it)) {
+        compile_expr(c, obj_car(it));
+    }
+    if (native) {
+        emit(c, VM_CALL_NATIVE, add_constant(c, evaluator_native_callee(head)), argc, 1 - argc);
+    } else {
+        emit(c, VM_CALL, 0, argc, -argc);
+    }
+}
+
+static void compile_expr(Compiler* c, Object* expr) {
+    if (c->failed) return;
+    if (is_symbol(expr)) {
+        int slot = find_local(c, expr->data.symbol.name);
+        if (slot >= 0) {
+            emit(c, VM_LOAD_LOCAL, slot, 0, 1);
+        } else {
+            emit(c, VM_LOAD_GLOBAL, add_constant(c, expr), 0, 1);
+        }
+        return;
+    }
+    if (!is_cons(expr)) {
+        emit(c, VM_PUSH_CONST, add_constant(c, expr ? expr : obj_nil), 0, 1);
+        return;
+    }
+
+    Object* args = obj_cdr(expr);
+    Object* name = obj_car(args);
+    switch (obj_special_form(obj_car(expr))) {
+        case SF_QUOTE:
+            emit(c, VM_PUSH_CONST, add_constant(c, obj_car(args)), 0, 1);
+            break;
+        case SF_IF:
+            compile_if(c, args);
+            break;
+        case SF_DEFINE:
+            if (!is_symbol(name)) { c->failed = true; break; }
+            compile_expr(c, obj_car(obj_cdr(args)));
+            emit(c, VM_DEFINE_GLOBAL, add_constant(c, name), 0, 0);
+            break;
+        case SF_SET: {
+            if (!is_symbol(name)) { c->failed = true; break; }
+            int slot = find_local(c, name->data.symbol.name);
+            compile_expr(c, obj_car(obj_cdr(args)));
+            if (slot >= 0) {
+                emit(c, VM_STORE_LOCAL, slot, 0, 0);
+            } else {
+                emit(c, VM_SET_GLOBAL, add_constant(c, name), 0, 0);
+            }
+            break;
+        }
+        case SF_LAMBDA:
+        case SF_DEFMACRO:
+            // クロージャはローカルスロットを捕捉できないので、ローカルがなければ構文木のまま評価する
+            if (c->nlocals > 0) { c->failed = true; break; }
+            emit(c, VM_EVAL_AST, add_constant(c, expr), 0, 1);
+            break;
+        case SF_EXPANSION:
+            compile_expr(c, macro_expansion(args));
+            break;
+        case SF_DOTIMES:
+            compile_dotimes(c, args);
+            break;
+        case SF_LOOP:
+            compile_loop(c, args);
+            break;
+        default:
+            compile_call(c, expr);
+            break;
+    }
+}
+
+VmCode* vm_compile(Object* expr) {
+    VmCode* code = calloc(1, sizeof(VmCode));
+    if (!code) return NULL;
+
+    Compiler c;
+    memset(&c, 0, sizeof(c));
+    c.code = code;
+    compile_expr(&c, expr);
+    emit(&c, VM_RETURN, 0, 0, -1);
+    if (c.failed) {
+        vm_free(code);
+        return NULL;
+    }
+    return code;
+}
+
+//------------------------------------------
+// 実行
+//------------------------------------------
+
+static bool vm_truthy(Object* obj) {
+    return obj && obj != obj_nil && obj != obj_false;
+}
+
+// 整数以外（浮動小数点数・多倍長整数など）が混じる演算は組み込みの演算子に任せる
+// （演算子は引数リストを保存しないので、リストはCスタック上に組み立てる）
+static Object* vm_call_operator(Object* op, Object* x, Object* y) {
+    Object args[2] = {
+        {.type = OBJ_CONS, .data.cons = {.car = x, .cdr = &args[1]}},
+        {.type = OBJ_CONS, .data.cons = {.car = y, .cdr = obj_nil}},
+    };
+    return evaluator_native_callee(op)->data.function.native_func(&args[0]);
+}
+
+// 比較演算。int64_t 同士だけその場で比べる
+static bool vm_compare(int op, Object* x, Object* y) {
+    if (op == VM_EQ && x && x == y) return true;
+    if (!x || !y || x->type != OBJ_NUMBER || y->type != OBJ_NUMBER) {
+        Object* operator;
+        switch (op) {
+            case VM_EQ:  operator = obj_eq;  break;
+            case VM_LT:  operator = obj_lt;  break;
+            case VM_GT:  operator = obj_gt;  break;
+            case VM_LTE: operator = obj_lte; break;
+            default:     operator = obj_gte; break;
+        }
+        return vm_truthy(vm_call_operator(operator, x, y));
+    }
+    int order = (x->data.number > y->data.number) - (x->data.number < y->data.number);
+    switch (op) {
+        case VM_EQ:  return order == 0;
+        case VM_LT:  return order < 0;
+        case VM_GT:  return order > 0;
+        case VM_LTE: return order <= 0;
+        case VM_GTE: return order >= 0;
+        default:     return false;
+    }
+}
+
+// 算術演算。int64_t 同士で桁あふれしなければその場で計算する
+static Object* vm_arith(int op, Object* x, Object* y) {
+    if (x && y && x->type == OBJ_NUMBER && y->type == OBJ_NUMBER) {
+        int64_t result;
+        bool overflow;
+        switch (op) {
+            case VM_ADD: overflow = __builtin_add_overflow(x->data.number, y->data.number, &result); break;
+            case VM_SUB: overflow = __builtin_sub_overflow(x->data.number, y->data.number, &result); break;
+            default:     overflow = __builtin_mul_overflow(x->data.number, y->data.number, &result); break;
+        }
+        if (!overflow) return make_number(result);
+    }
+    switch (op) {
+        case VM_ADD: return vm_call_operator(obj_plus, x, y);
+        case VM_SUB: return vm_call_operator(obj_minus, x, y);
+        default:     return vm_call_operator(obj_asterisk, x, y);
+    }
+}
+
+// スタック上の argc 個の値を引数リストにする。確保できなければ NULL
+static Object* vm_make_args(Object** sp, int argc) {
+    Object* args = obj_nil;
+    for (int i = 1; i <= argc && args; i++) {
+        args = make_cons(sp[-i], args);
+    }
+    return args;
+}
+
+Object* vm_execute_switch(VmCode* code) {
+    Object* stack[VM_STACK_MAX];
+    Object* locals[VM_LOCALS_MAX];
+    Object** sp = stack;
+    VmInstr* ip = code->code;
+    Object** constants = code->constants;
+
+#define VM_TARGET(name) case VM_##name:
+#define VM_DISPATCH()   continue
+#define VM_LOOP_BEGIN   for (;;) { switch (ip->op) {
+#define VM_LOOP_END     default: return obj_nil; } }
+#include "vm_dispatch.inc"
+#undef VM_TARGET
+#undef VM_DISPATCH
+#undef VM_LOOP_BEGIN
+#undef VM_LOOP_END
+}
+
+#if VM_HAVE_COMPUTED_GOTO
+static Object* vm_execute_threaded(VmCode* code) {
+#define VM_LABEL(name) &&L_##name,
+    static const void* const handlers[VM_OP_COUNT] = { VM_OPCODES(VM_LABEL) };
+#undef VM_LABEL
+
+    // 直接スレッディング: 各命令に飛び先アドレスを埋め込んでおく
+    if (!code->threaded) {
+        for (size_t i = 0; i < code->length; i++) {
+            code->code[i].handler = handlers[code->code[i].op];
+        }
+        code->threaded = true;
+    }
+
+    Object* stack[VM_STACK_MAX];
+    Object* locals[VM_LOCALS_MAX];
+    Object** sp = stack;
+    VmInstr* ip = code->code;
+    Object** constants = code->constants;
+
+#define VM_TARGET(name) L_##name:
+#define VM_DISPATCH()   goto *ip->handler
+#define VM_LOOP_BEGIN   VM_DISPATCH();
+#define VM_LOOP_END     return obj_nil;  /* 到達しない */
+#include "vm_dispatch.inc"
+#undef VM_TARGET
+#undef VM_DISPATCH
+#undef VM_LOOP_BEGIN
+#undef VM_LOOP_END
+}
+#endif
+
+Object* vm_execute(VmCode* code) {
+    if (!code) return obj_nil;
+#if VM_HAVE_COMPUTED_GOTO
+    return vm_execute_threaded(code);
+#else
+    return vm_execute_switch(code);
+#endif
+}
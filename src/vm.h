@@ -0,0 +1,41 @@
+// vm.h
+// バイトコードVM（スレッデッドコードによる実行バックエンド）のインターフェース定義。
+
+#ifndef VM_H
+#define VM_H
+
+#include "object.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// GCCの computed goto が使えれば直接スレッディング、なければ switch で実行する
+#if defined(__GNUC__) && !defined(VM_NO_COMPUTED_GOTO)
+#define VM_HAVE_COMPUTED_GOTO 1
+#else
+#define VM_HAVE_COMPUTED_GOTO 0
+#endif
+
+typedef struct VmCode VmCode;
+
+// 式をバイトコードにコンパイルする。対応していない式なら NULL
+VmCode* vm_compile(Object* expr);
+void vm_free(VmCode* code);
+
+// バイトコードを実行する（使えれば computed goto 版）
+Object* vm_execute(VmCode* code);
+// switch 版のディスパッチで実行する（比較・ベンチマーク用）
+Object* vm_execute_switch(VmCode* code);
+
+// スーパー命令への融合の有効/無効（既定は有効。以後のコンパイルに効く）
+void vm_set_superinstructions(bool enable);
+
+// 命令数
+size_t vm_code_length(const VmCode* code);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VM_H
@@ -0,0 +1,95 @@
+// test_bignum.c
+// 64bit整数の桁あふれ検査と多倍長整数へのフォールバックのテスト
+
+#include <string.h>
+#include "unity.h"
+#include "../src/object.h"
+#include "../src/eval.h"
+#include "../src/bignum.h"
+
+void setUp(void) {
+    object_system_init();
+    evaluator_init();
+}
+
+void tearDown(void) {
+    evaluator_shutdown();
+}
+
+static void assert_integer(const char* expected, Object* result) {
+    char buf[256];
+    TEST_ASSERT_TRUE(is_integer(result));
+    bignum_format(result, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING(expected, buf);
+}
+
+//------------------------------------------
+// 64bit の範囲
+//------------------------------------------
+
+void test_int64_stays_unboxed(void) {
+    Object* result = eval_string("(* 100000 100000)");
+    TEST_ASSERT_EQUAL(OBJ_NUMBER, result->type);
+    TEST_ASSERT_EQUAL_INT64(10000000000LL, result->data.number);
+}
+
+void test_literal_beyond_int32(void) {
+    Object* result = eval_string("9000000000");
+    TEST_ASSERT_EQUAL(OBJ_NUMBER, result->type);
+    TEST_ASSERT_EQUAL_INT64(9000000000LL, result->data.number);
+}
+
+//------------------------------------------
+// 多倍長への昇格
+//------------------------------------------
+
+void test_add_overflow_promotes(void) {
+    Object* result = eval_string("(+ 9223372036854775807 1)");
+    TEST_ASSERT_EQUAL(OBJ_BIGNUM, result->type);
+    assert_integer("9223372036854775808", result);
+}
+
+void test_mul_overflow_promotes(void) {
+    assert_integer("85070591730234615847396907784232501249",
+                   eval_string("(* 9223372036854775807 9223372036854775807)"));
+}
+
+void test_bignum_literal_and_demotion(void) {
+    // 多倍長のリテラルから引いて int64_t に収まれば OBJ_NUMBER に戻る
+    Object* result = eval_string("(- 100000000000000000000 99999999999999999999)");
+    TEST_ASSERT_EQUAL(OBJ_NUMBER, result->type);
+    TEST_ASSERT_EQUAL_INT64(1, result->data.number);
+}
+
+void test_bignum_division(void) {
+    assert_integer("12345678901234567890",
+                   eval_string("(/ 123456789012345678901234567890 10000000000)"));
+    assert_integer("-3", eval_string("(/ (- 0 100000000000000000000) 30000000000000000000)"));
+}
+
+void test_bignum_compare(void) {
+    TEST_ASSERT_EQUAL_PTR(obj_true, eval_string("(< 9223372036854775807 9223372036854775808)"));
+    TEST_ASSERT_EQUAL_PTR(obj_true, eval_string("(= 100000000000000000000 100000000000000000000)"));
+    TEST_ASSERT_EQUAL_PTR(obj_nil, eval_string("(> 1 100000000000000000000)"));
+}
+
+void test_factorial_does_not_wrap(void) {
+    eval_string("(define acc 1)");
+    eval_string("(dotimes (i 25) (set! acc (* acc (+ i 1))))");
+    assert_integer("15511210043330985984000000", eval_string("acc"));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_int64_stays_unboxed);
+    RUN_TEST(test_literal_beyond_int32);
+    RUN_TEST(test_add_overflow_promotes);
+    RUN_TEST(test_mul_overflow_promotes);
+    RUN_TEST(test_bignum_literal_and_demotion);
+    RUN_TEST(test_bignum_division);
+    RUN_TEST(test_bignum_compare);
+    RUN_TEST(test_factorial_does_not_wrap);
+
+    return UNITY_END();
+}
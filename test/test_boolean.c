@@ -2,10 +2,12 @@
 // ^UlɊւeXg
 
 #include "unity.h"
+#include "test_helper.h"
 #include "../src/object.h"
 #include "../src/tokenizer.h"
 #include "../src/parser.h"
 #include "../src/eval.h"
+#include <string.h>
 
 void setUp(void) {
     // eXgȌ
@@ -129,7 +131,7 @@ void test_boolean_tokenization(void) {
     TEST_ASSERT_NOT_NULL(tokens);
     TEST_ASSERT_EQUAL(1, tokens->size);
     TEST_ASSERT_EQUAL(TOKEN_TRUE, tokens->tokens[0].kind);
-    TEST_ASSERT_EQUAL_STRING("t", tokens->tokens[0].value);
+    assert_token("t", tokens, 0);
     free_token_array(tokens);
 
     // "nil" ̃g[N
@@ -137,7 +139,7 @@ void test_boolean_tokenization(void) {
     TEST_ASSERT_NOT_NULL(tokens);
     TEST_ASSERT_EQUAL(1, tokens->size);
     TEST_ASSERT_EQUAL(TOKEN_NIL, tokens->tokens[0].kind);
-    TEST_ASSERT_EQUAL_STRING("nil", tokens->tokens[0].value);
+    assert_token("nil", tokens, 0);
     free_token_array(tokens);
 
     // "true" ̃g[N
@@ -145,7 +147,7 @@ void test_boolean_tokenization(void) {
     TEST_ASSERT_NOT_NULL(tokens);
     TEST_ASSERT_EQUAL(1, tokens->size);
     TEST_ASSERT_EQUAL(TOKEN_TRUE, tokens->tokens[0].kind);
-    TEST_ASSERT_EQUAL_STRING("true", tokens->tokens[0].value);
+    assert_token("true", tokens, 0);
     free_token_array(tokens);
 
     // "false" ̃g[N
@@ -153,7 +155,7 @@ void test_boolean_tokenization(void) {
     TEST_ASSERT_NOT_NULL(tokens);
     TEST_ASSERT_EQUAL(1, tokens->size);
     TEST_ASSERT_EQUAL(TOKEN_FALSE, tokens->tokens[0].kind);
-    TEST_ASSERT_EQUAL_STRING("false", tokens->tokens[0].value);
+    assert_token("false", tokens, 0);
     free_token_array(tokens);
 }
 
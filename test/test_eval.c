@@ -0,0 +1,257 @@
+// test_eval.c
+// 評価器（特殊形式・呼び出し）のテスト
+
+#include "unity.h"
+#include "test_helper.h"
+#include "../src/object.h"
+#include "../src/eval.h"
+
+void setUp(void) {
+    object_system_init();
+    evaluator_init();
+}
+
+void tearDown(void) {
+    evaluator_shutdown();
+}
+
+//------------------------------------------
+// 特殊形式
+//------------------------------------------
+
+void test_quote(void) {
+    Object* result = eval_string("(quote (1 2))");
+    TEST_ASSERT_TRUE(is_cons(result));
+    assert_number(1, obj_car(result));
+    assert_number(2, obj_car(obj_cdr(result)));
+}
+
+void test_if(void) {
+    assert_number(1, eval_string("(if (< 1 2) 1 2)"));
+    assert_number(2, eval_string("(if (> 1 2) 1 2)"));
+    TEST_ASSERT_EQUAL_PTR(obj_nil, eval_string("(if nil 1)"));
+}
+
+void test_define_and_set(void) {
+    TEST_ASSERT_EQUAL_PTR(obj_void, eval_string("(define x 5)"));
+    assert_number(25, eval_string("(* x x)"));
+    assert_number(7, eval_string("(set! x 7)"));
+    assert_number(7, eval_string("x"));
+    // 再定義は既存の束縛を書き換える
+    eval_string("(define x 9)");
+    assert_number(9, eval_string("x"));
+}
+
+void test_loop(void) {
+    eval_string("(define acc 0)");
+    eval_string("(loop (c 0) (< c 5) (+ c 1) (set! acc (+ acc c)))");
+    assert_number(10, eval_string("acc"));
+}
+
+void test_nested_dotimes(void) {
+    eval_string("(define acc 0)");
+    eval_string("(dotimes (i 3) (dotimes (j 4) (set! acc (+ acc 1))))");
+    assert_number(12, eval_string("acc"));
+}
+
+//------------------------------------------
+// コールサイトキャッシュ
+//------------------------------------------
+
+void test_call_site_cache_invalidation(void) {
+    eval_string("(define f +)");
+    // 同じコールサイトを2回評価し、途中で f を再束縛する
+    eval_string("(define r 0)");
+    eval_string("(dotimes (i 2) (set! r (f 10 1)) (define f -))");
+    assert_number(9, eval_string("r"));
+}
+
+// 大域のカウンタをループの中で更新しても、呼び出し先のキャッシュは捨てない
+void test_counter_update_keeps_call_site_cache(void) {
+    eval_string("(define f (lambda (x) (* x 2)))");
+    eval_string("(define total 0)");
+    eval_string("(define run (lambda (n) (dotimes (i n) (set! total (+ total (f i))))))");
+    uint32_t version = evaluator_env_version();
+    eval_string("(dotimes (i 100) (set! total (+ total (f i))))");
+    eval_string("(run 100)");
+    assert_number(19800, eval_string("total"));
+    TEST_ASSERT_EQUAL(version, evaluator_env_version());
+
+    // 呼び出し先を再束縛すれば新しい値を呼ぶ
+    eval_string("(set! f (lambda (x) x))");
+    TEST_ASSERT_NOT_EQUAL(version, evaluator_env_version());
+    eval_string("(set! total 0)");
+    eval_string("(run 100)");
+    assert_number(4950, eval_string("total"));
+}
+
+//------------------------------------------
+// ラムダとクロージャ
+//------------------------------------------
+
+void test_lambda_call(void) {
+    assert_number(7, eval_string("((lambda (x y) (+ x y)) 3 4)"));
+    eval_string("(define f (lambda (x) (* x x)))");
+    assert_number(36, eval_string("(f 6)"));
+}
+
+void test_lambda_recursion(void) {
+    eval_string("(define f (lambda (x) (if (< x 2) 1 (* x (f (- x 1))))))");
+    assert_number(120, eval_string("(f 5)"));
+}
+
+void test_closure_captures_value(void) {
+    // 外側の引数を捕捉した内側のラムダを返す
+    eval_string("(define g (lambda (x) (lambda (y) (+ x y))))");
+    eval_string("(define f (g 10))");
+    assert_number(15, eval_string("(f 5)"));
+    // 別の呼び出しで作ったクロージャは別の値を保持する
+    eval_string("(define c (g 100))");
+    assert_number(101, eval_string("(c 1)"));
+    assert_number(11, eval_string("(f 1)"));
+}
+
+void test_closure_captures_loop_variable(void) {
+    eval_string("(define acc 0)");
+    eval_string("(dotimes (j 3) (set! acc ((lambda (x) (+ x j)) acc)))");
+    assert_number(3, eval_string("acc"));
+}
+
+void test_lambda_set_param(void) {
+    eval_string("(define f (lambda (x) (set! x (+ x 1)) x))");
+    assert_number(5, eval_string("(f 4)"));
+}
+
+// 仮引数や捕捉変数を呼び出し先にする（同名のグローバル束縛より優先し、キャッシュしない）
+void test_parameter_as_callee(void) {
+    eval_string("(define sq (lambda (x) (* x x)))");
+    assert_number(9, eval_string("((lambda (f) (f 3)) sq)"));
+
+    eval_string("(define g (lambda (x) 99))");
+    eval_string("(define k (lambda (g) (g (quote (1 2)))))");
+    assert_number(1, eval_string("(k car)"));
+    assert_number(2, eval_string("(car (k cdr))"));
+    assert_number(99, eval_string("(g 0)"));
+}
+
+// 組み込み関数の名前も普通のシンボルなので、仮引数で隠せる
+void test_parameter_shadows_builtin(void) {
+    assert_number(20, eval_string("((lambda (print) (print 2)) (lambda (x) (* x 10)))"));
+    assert_number(3, eval_string("((lambda (length) length) 3)"));
+    assert_number(2, eval_string("(length (list 1 2))"));
+}
+
+void test_captured_closure_as_callee(void) {
+    eval_string("(define compose (lambda (f h) (lambda (x) (f (h x)))))");
+    eval_string("(define inc (lambda (x) (+ x 1)))");
+    eval_string("(define dbl (lambda (x) (* x 2)))");
+    eval_string("(define inc-dbl (compose inc dbl))");
+    eval_string("(define dbl-inc (compose dbl inc))");
+    assert_number(11, eval_string("(inc-dbl 5)"));
+    assert_number(12, eval_string("(dbl-inc 5)"));
+    // dotimes の変数も呼び出し先にできる
+    eval_string("(define acc 0)");
+    eval_string("(define fs (list inc dbl))");
+    eval_string("(dotimes (i 1) ((lambda (f) (set! acc (f 20))) (car fs)))");
+    assert_number(21, eval_string("acc"));
+}
+
+void test_long_loops_run_in_constant_memory(void) {
+    // プール (1024個) より多く反復しても、束縛とカウンタの分のオブジェクトは増えない
+    TEST_ASSERT_EQUAL_PTR(obj_true, eval_string("(dotimes (j 3000) (< j 3000))"));
+    TEST_ASSERT_EQUAL_PTR(obj_true, eval_string("(loop (c 0) (< c 3000) (+ c 1) (< c 3000))"));
+    // ラムダ本体は木構造の評価器で実行される
+    eval_string("(define f (lambda (n) (dotimes (j n) (< j n))))");
+    TEST_ASSERT_EQUAL_PTR(obj_true, eval_string("(f 3000)"));
+    eval_string("(define g (lambda (n) (loop (c 0) (< c n) (+ c 1) (< c n))))");
+    TEST_ASSERT_EQUAL_PTR(obj_true, eval_string("(g 3000)"));
+}
+
+void test_allocating_loops_collect_garbage(void) {
+    // 反復ごとにオブジェクトを作る本体でも、プールより長いループが最後まで回る
+    eval_string("(define n 0)");
+    eval_string("(dotimes (i 2000) (set! n (+ n 1)))");
+    assert_number(2000, eval_string("n"));
+    eval_string("(define acc nil)");
+    eval_string("(loop (c 0) (< c 2000) (+ c 1) (set! acc (list c c)))");
+    assert_number(1999, eval_string("(car acc)"));
+    // ラムダ本体は木構造の評価器で実行される
+    eval_string("(define f (lambda (k) (dotimes (i k) (set! acc (list i i)))))");
+    eval_string("(f 2000)");
+    assert_number(1999, eval_string("(car (cdr acc))"));
+}
+
+void test_loop_gc_keeps_pending_arguments(void) {
+    // 引数の評価途中でループが回収しても、評価済みの引数は残る
+    eval_string("(define r (list (list 7 8) (dotimes (i 2000) (list i))))");
+    assert_number(8, eval_string("(car (cdr (car r)))"));
+    assert_number(1999, eval_string("(car (car (cdr r)))"));
+    eval_string("(define g (lambda (k) (list (list 7 8) (dotimes (i k) (list i)))))");
+    eval_string("(define r (g 2000))");
+    assert_number(8, eval_string("(car (cdr (car r)))"));
+    assert_number(1999, eval_string("(car (car (cdr r)))"));
+}
+
+void test_escaping_loop_variable_keeps_its_value(void) {
+    // 本体が変数の値を保存するときはカウンタの箱を使い回さない
+    eval_string("(define acc 0)");
+    eval_string("(dotimes (j 3) (if (= j 1) (set! acc j) nil))");
+    assert_number(1, eval_string("acc"));
+    eval_string("(loop (c 0) (< c 3) (+ c 1) (if (= c 1) (set! acc (* c 5)) nil) (if (= c 2) (set! acc c) nil))");
+    assert_number(2, eval_string("acc"));
+    eval_string("(define f (lambda (n) (dotimes (j n) (if (= j 1) (set! acc j) nil))))");
+    eval_string("(f 3)");
+    assert_number(1, eval_string("acc"));
+}
+
+// 登録表の組み込み関数はすべてグローバル環境に束縛されている
+void test_builtin_registry(void) {
+    for (int i = 0; i < BUILTIN_COUNT; i++) {
+        Object* fixed = get_builtin((BuiltinType)i);
+        Object* value = evaluator_global_value(obj_builtin_name(fixed));
+        TEST_ASSERT_NOT_NULL(value);
+        TEST_ASSERT_EQUAL_PTR(fixed, evaluator_fixed_callee(value));
+    }
+    TEST_ASSERT_EQUAL_PTR(get_operator(OP_LTE), get_fixed_callee("<="));
+    TEST_ASSERT_NULL(get_fixed_callee("no-such-builtin"));
+}
+
+// 引数の数が登録表の範囲外なら、引数を評価せずに nil になる
+void test_builtin_arity(void) {
+    TEST_ASSERT_EQUAL_PTR(obj_nil, eval_string("(= 1)"));
+    TEST_ASSERT_EQUAL_PTR(obj_nil, eval_string("(car)"));
+    eval_string("(define acc 0)");
+    TEST_ASSERT_EQUAL_PTR(obj_nil, eval_string("(length (set! acc 1) 2)"));
+    assert_number(0, eval_string("acc"));
+    eval_string("(define f (lambda (x) (car x x)))");
+    TEST_ASSERT_EQUAL_PTR(obj_nil, eval_string("(f (quote (1 2)))"));
+    assert_number(2, eval_string("(length (quote (1 2)))"));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_quote);
+    RUN_TEST(test_if);
+    RUN_TEST(test_define_and_set);
+    RUN_TEST(test_loop);
+    RUN_TEST(test_nested_dotimes);
+    RUN_TEST(test_call_site_cache_invalidation);
+    RUN_TEST(test_counter_update_keeps_call_site_cache);
+    RUN_TEST(test_lambda_call);
+    RUN_TEST(test_lambda_recursion);
+    RUN_TEST(test_closure_captures_value);
+    RUN_TEST(test_closure_captures_loop_variable);
+    RUN_TEST(test_lambda_set_param);
+    RUN_TEST(test_parameter_as_callee);
+    RUN_TEST(test_parameter_shadows_builtin);
+    RUN_TEST(test_captured_closure_as_callee);
+    RUN_TEST(test_long_loops_run_in_constant_memory);
+    RUN_TEST(test_allocating_loops_collect_garbage);
+    RUN_TEST(test_loop_gc_keeps_pending_arguments);
+    RUN_TEST(test_escaping_loop_variable_keeps_its_value);
+    RUN_TEST(test_builtin_registry);
+    RUN_TEST(test_builtin_arity);
+
+    return UNITY_END();
+}
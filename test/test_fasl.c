@@ -0,0 +1,157 @@
+// test_fasl.c
+// パース済みの式のバイナリ形式（fasl.c）のテスト
+
+#include "unity.h"
+#include "../src/object.h"
+#include "../src/eval.h"
+#include "../src/parser.h"
+#include "../src/hashtable.h"
+#include "../src/fasl.h"
+#include "../src/srcloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+void setUp(void) {
+    object_system_init();
+    evaluator_init();
+}
+
+void tearDown(void) {
+    evaluator_shutdown();
+}
+
+// path の中身を malloc した領域に読む
+static char* read_all(const char* path, size_t* size) {
+    FILE* file = fopen(path, "rb");
+    TEST_ASSERT_NOT_NULL(file);
+    fseek(file, 0, SEEK_END);
+    *size = (size_t)ftell(file);
+    rewind(file);
+    char* data = malloc(*size);
+    TEST_ASSERT_EQUAL(*size, fread(data, 1, *size, file));
+    fclose(file);
+    return data;
+}
+
+static void write_text(const char* path, const char* text) {
+    FILE* file = fopen(path, "wb");
+    TEST_ASSERT_NOT_NULL(file);
+    fputs(text, file);
+    fclose(file);
+}
+
+// すべての種類のリテラルと特殊形式・組み込み関数が書き出しと読み込みで元に戻る
+void test_round_trip(void) {
+    const char* source =
+        "(define (f x) (if (<= x 1.5) \"s t r\" (quote (a b x))))\n"
+        "7 123456789012345678901234567890 nil t (println (length (str x)) (vec-sum ()))";
+    const char* path = "/tmp/chibi_test_round_trip.fasl";
+    Object* forms = parse_all(source);
+
+    FaslWriter writer;
+    fasl_writer_init(&writer, source, strlen(source));
+    int count = 0;
+    for (Object* it = forms; is_cons(it); it = obj_cdr(it)) {
+        TEST_ASSERT_TRUE(fasl_write_form(&writer, obj_car(it)));
+        count++;
+    }
+    // 名前の表は f x <= a b println length str vec-sum（x は何度出てきても1つ）
+    TEST_ASSERT_EQUAL(9, writer.symbol_count);
+    TEST_ASSERT_TRUE(fasl_writer_save(&writer, path));
+    fasl_writer_free(&writer);
+
+    size_t size;
+    char* data = read_all(path, &size);
+    FaslReader reader;
+    TEST_ASSERT_TRUE(fasl_reader_open(&reader, data, size, source, strlen(source)));
+    Object* it = forms;
+    Object* form;
+    while ((form = fasl_next(&reader)) != NULL) {
+        TEST_ASSERT_TRUE(hashtable_keys_equal(obj_car(it), form, HASH_EQUAL));
+        // リストのソース上の位置も戻る
+        SrcLoc expected, loc;
+        TEST_ASSERT_EQUAL(srcloc_get(obj_car(it), &expected), srcloc_get(form, &loc));
+        if (is_cons(form)) {
+            TEST_ASSERT_EQUAL(expected.line, loc.line);
+            TEST_ASSERT_EQUAL(expected.column, loc.column);
+        }
+        it = obj_cdr(it);
+        count--;
+    }
+    TEST_ASSERT_FALSE(reader.error);
+    TEST_ASSERT_EQUAL(0, count);
+    free(data);
+    unlink(path);
+}
+
+// ソースが変わった・中身が壊れたキャッシュは使わない
+void test_rejects_stale_or_broken(void) {
+    const char* source = "(+ 1 2)";
+    const char* path = "/tmp/chibi_test_stale.fasl";
+    FaslWriter writer;
+    fasl_writer_init(&writer, source, strlen(source));
+    TEST_ASSERT_TRUE(fasl_write_form(&writer, parse(source)));
+    TEST_ASSERT_TRUE(fasl_writer_save(&writer, path));
+    fasl_writer_free(&writer);
+
+    size_t size;
+    char* data = read_all(path, &size);
+    FaslReader reader;
+    TEST_ASSERT_TRUE(fasl_reader_open(&reader, data, size, source, strlen(source)));
+    TEST_ASSERT_FALSE(fasl_reader_open(&reader, data, size, "(+ 1 3)", 7));
+    data[size - 1] ^= 0x40;
+    TEST_ASSERT_FALSE(fasl_reader_open(&reader, data, size, source, strlen(source)));
+    TEST_ASSERT_FALSE(fasl_reader_open(&reader, data, size / 2, source, strlen(source)));
+    free(data);
+    unlink(path);
+}
+
+// パースした結果でなければ書き出さない
+void test_rejects_runtime_objects(void) {
+    FaslWriter writer;
+    fasl_writer_init(&writer, "", 0);
+    TEST_ASSERT_FALSE(fasl_write_form(&writer, eval_string("(make-vector 2)")));
+    TEST_ASSERT_FALSE(fasl_writer_save(&writer, "/tmp/chibi_test_never.fasl"));
+    fasl_writer_free(&writer);
+    TEST_ASSERT_TRUE(access("/tmp/chibi_test_never.fasl", F_OK) != 0);
+}
+
+// eval_file は1回目にキャッシュを書き、2回目はそれを読んで同じように評価する
+void test_eval_file_uses_cache(void) {
+    const char* path = "/tmp/chibi_test_cached.lisp";
+    char* cache = fasl_cache_path(path);
+    unlink(cache);
+    write_text(path, "(set! counter (+ counter 1))\n(define label \"run\")\n");
+    eval_string("(define counter 0)");
+
+    TEST_ASSERT_TRUE(eval_file(path));
+    TEST_ASSERT_TRUE(access(cache, F_OK) == 0);
+    TEST_ASSERT_TRUE(eval_file(path));
+    TEST_ASSERT_EQUAL(2, eval_string("counter")->data.number);
+
+    // 壊れたキャッシュは無視してソースから読み、書き直す
+    write_text(cache, "garbage");
+    TEST_ASSERT_TRUE(eval_file(path));
+    TEST_ASSERT_EQUAL(3, eval_string("counter")->data.number);
+    size_t size;
+    char* data = read_all(cache, &size);
+    TEST_ASSERT_TRUE(size > 7);
+    free(data);
+
+    unlink(path);
+    unlink(cache);
+    free(cache);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_rejects_stale_or_broken);
+    RUN_TEST(test_rejects_runtime_objects);
+    RUN_TEST(test_eval_file_uses_cache);
+
+    return UNITY_END();
+}
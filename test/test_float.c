@@ -0,0 +1,156 @@
+// test_float.c
+// 浮動小数点数の読み込み・混合演算と、数値リストの一括演算カーネルのテスト
+
+#include <string.h>
+#include "unity.h"
+#include "../src/object.h"
+#include "../src/eval.h"
+#include "../src/numkernel.h"
+
+void setUp(void) {
+    object_system_init();
+    evaluator_init();
+}
+
+void tearDown(void) {
+    numkernel_set_isa(NUMKERNEL_AVX2);
+    evaluator_shutdown();
+}
+
+static void assert_float(double expected, Object* result) {
+    TEST_ASSERT_NOT_NULL(result);
+    TEST_ASSERT_EQUAL(OBJ_FLOAT, result->type);
+    TEST_ASSERT_EQUAL_DOUBLE(expected, result->data.real);
+}
+
+//------------------------------------------
+// リテラルと表示
+//------------------------------------------
+
+void test_float_literal(void) {
+    assert_float(1.5, eval_string("1.5"));
+    assert_float(0.25, eval_string("0.25"));
+}
+
+void test_format_float_marks_integral_values(void) {
+    char buf[40];
+    format_float(2.0, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("2.0", buf);
+    format_float(0.125, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("0.125", buf);
+    Object* s = eval_string("(str 1.5 \"/\" 3)");
+    TEST_ASSERT_EQUAL_STRING("1.5/3", s->data.string.text);
+}
+
+//------------------------------------------
+// 混合演算
+//------------------------------------------
+
+void test_integer_arithmetic_stays_integer(void) {
+    Object* result = eval_string("(+ 1 2 3)");
+    TEST_ASSERT_EQUAL(OBJ_NUMBER, result->type);
+    TEST_ASSERT_EQUAL_INT64(6, result->data.number);
+    TEST_ASSERT_EQUAL_INT64(3, eval_string("(/ 7 2)")->data.number);
+}
+
+void test_mixed_arithmetic_promotes_to_float(void) {
+    assert_float(3.5, eval_string("(+ 1 2.5)"));
+    assert_float(3.5, eval_string("(+ 2.5 1)"));
+    assert_float(7.5, eval_string("(* 3 2.5)"));
+    assert_float(-1.5, eval_string("(- 1 2.5)"));
+    assert_float(-2.5, eval_string("(- 2.5)"));
+    assert_float(3.5, eval_string("(/ 7 2.0)"));
+    assert_float(0.25, eval_string("(/ 4.0)"));
+    assert_float(1.5, eval_string("(/ 1500 1000.0)"));
+}
+
+void test_float_division_by_zero_is_nil(void) {
+    TEST_ASSERT_EQUAL_PTR(obj_nil, eval_string("(/ 1.5 0)"));
+    TEST_ASSERT_EQUAL_PTR(obj_nil, eval_string("(/ 1 0.0)"));
+}
+
+void test_mixed_comparison(void) {
+    TEST_ASSERT_EQUAL_PTR(obj_true, eval_string("(= 1 1.0)"));
+    TEST_ASSERT_EQUAL_PTR(obj_true, eval_string("(< 1 1.5)"));
+    TEST_ASSERT_EQUAL_PTR(obj_true, eval_string("(>= 2.5 2)"));
+    TEST_ASSERT_EQUAL_PTR(obj_nil, eval_string("(> 1.5 2)"));
+}
+
+void test_float_in_compiled_loop(void) {
+    // dotimes は VM で実行される（浮動小数点数は組み込みの演算子に任せる）
+    eval_string("(define acc 0)");
+    eval_string("(dotimes (i 4) (set! acc (+ acc 0.5)))");
+    assert_float(2.0, evaluator_global_value("acc"));
+}
+
+//------------------------------------------
+// 一括演算カーネル
+//------------------------------------------
+
+// SIMD 版とスカラー版が（整数値で丸め誤差が出ない範囲で）同じ結果を返す
+void test_kernels_match_scalar(void) {
+    double x[37], y[37];
+    for (int i = 0; i < 37; i++) {
+        x[i] = (double)((i * 7) % 23) - 11.0;
+        y[i] = (double)(i % 5);
+    }
+    NumKernelIsa best = numkernel_set_isa(NUMKERNEL_AVX2);
+    double sum = numkernel_sum(x, 37), dot = numkernel_dot(x, y, 37);
+    double min = numkernel_min(x, 37), max = numkernel_max(x, 37);
+    double scaled[37];
+    numkernel_scale(scaled, x, 2.0, 37);
+
+    TEST_ASSERT_EQUAL(NUMKERNEL_SCALAR, numkernel_set_isa(NUMKERNEL_SCALAR));
+    TEST_ASSERT_EQUAL_DOUBLE(numkernel_sum(x, 37), sum);
+    TEST_ASSERT_EQUAL_DOUBLE(numkernel_dot(x, y, 37), dot);
+    TEST_ASSERT_EQUAL_DOUBLE(-11.0, min);
+    TEST_ASSERT_EQUAL_DOUBLE(11.0, max);
+    TEST_ASSERT_EQUAL_DOUBLE(numkernel_min(x, 37), min);
+    TEST_ASSERT_EQUAL_DOUBLE(numkernel_max(x, 37), max);
+    for (int i = 0; i < 37; i++) TEST_ASSERT_EQUAL_DOUBLE(x[i] * 2.0, scaled[i]);
+    TEST_ASSERT_TRUE(best >= NUMKERNEL_SCALAR);
+}
+
+void test_kernels_short_inputs(void) {
+    double x[3] = {4.0, -2.0, 9.0};
+    for (int isa = NUMKERNEL_SCALAR; isa <= NUMKERNEL_AVX2; isa++) {
+        numkernel_set_isa((NumKernelIsa)isa);
+        TEST_ASSERT_EQUAL_DOUBLE(4.0, numkernel_min(x, 1));
+        TEST_ASSERT_EQUAL_DOUBLE(-2.0, numkernel_min(x, 3));
+        TEST_ASSERT_EQUAL_DOUBLE(9.0, numkernel_max(x, 3));
+        TEST_ASSERT_EQUAL_DOUBLE(11.0, numkernel_sum(x, 3));
+    }
+}
+
+void test_vec_builtins(void) {
+    assert_float(10.0, eval_string("(vec-sum (quote (1 2 3 4)))"));
+    assert_float(0.0, eval_string("(vec-sum (quote ()))"));
+    assert_float(32.0, eval_string("(vec-dot (quote (1 2 3)) (quote (4 5 6)))"));
+    assert_float(0.5, eval_string("(vec-min (quote (2 0.5 7)))"));
+    assert_float(7.0, eval_string("(vec-max (quote (2 0.5 7)))"));
+    TEST_ASSERT_EQUAL_PTR(obj_nil, eval_string("(vec-max (quote ()))"));
+    TEST_ASSERT_EQUAL_PTR(obj_nil, eval_string("(vec-dot (quote (1 2)) (quote (1)))"));
+    TEST_ASSERT_EQUAL_PTR(obj_nil, eval_string("(vec-sum (quote (1 \"a\")))"));
+
+    Object* scaled = eval_string("(vec-scale (quote (1 2 3)) 0.5)");
+    TEST_ASSERT_EQUAL(OBJ_CONS, scaled->type);
+    assert_float(0.5, scaled->data.cons.car);
+    assert_float(1.5, scaled->data.cons.cdr->data.cons.cdr->data.cons.car);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_float_literal);
+    RUN_TEST(test_format_float_marks_integral_values);
+    RUN_TEST(test_integer_arithmetic_stays_integer);
+    RUN_TEST(test_mixed_arithmetic_promotes_to_float);
+    RUN_TEST(test_float_division_by_zero_is_nil);
+    RUN_TEST(test_mixed_comparison);
+    RUN_TEST(test_float_in_compiled_loop);
+    RUN_TEST(test_kernels_match_scalar);
+    RUN_TEST(test_kernels_short_inputs);
+    RUN_TEST(test_vec_builtins);
+
+    return UNITY_END();
+}
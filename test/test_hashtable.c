@@ -0,0 +1,121 @@
+// test_hashtable.c
+// ハッシュテーブル（OBJ_HASHTABLE）と関連ビルトインのテスト
+
+#include "unity.h"
+#include "test_helper.h"
+#include "../src/object.h"
+#include "../src/eval.h"
+#include "../src/hashtable.h"
+
+void setUp(void) {
+    object_system_init();
+    evaluator_init();
+}
+
+void tearDown(void) {
+    evaluator_shutdown();
+}
+
+void test_set_and_ref(void) {
+    eval_string("(define h (make-hash-table))");
+    assert_number(1, eval_string("(hash-set! h (quote k) 1)"));
+    eval_string("(hash-set! h \"b\" 2)");
+    eval_string("(hash-set! h 3 30)");
+    assert_number(1, eval_string("(hash-ref h (quote k))"));
+    assert_number(2, eval_string("(hash-ref h \"b\")"));
+    assert_number(30, eval_string("(hash-ref h 3)"));
+    assert_number(3, eval_string("(hash-count h)"));
+    TEST_ASSERT_EQUAL_PTR(obj_nil, eval_string("(hash-ref h (quote c))"));
+    assert_number(7, eval_string("(hash-ref h (quote c) 7)"));
+
+    // 上書きしても要素数は変わらない
+    eval_string("(hash-set! h (quote k) 5)");
+    assert_number(5, eval_string("(hash-ref h (quote k))"));
+    assert_number(3, eval_string("(hash-count h)"));
+}
+
+void test_equal_and_eq_tables(void) {
+    eval_string("(define h (make-hash-table))");
+    eval_string("(hash-set! h (quote (1 2)) 12)");
+    eval_string("(hash-set! h \"ab\" 1)");
+    assert_number(12, eval_string("(hash-ref h (quote (1 2)))"));
+    assert_number(1, eval_string("(hash-ref h (str \"a\" \"b\"))"));
+
+    // eq テーブルでは中身の同じ別の文字列は別のキー（シンボルと整数は値で比べる）
+    eval_string("(define g (make-hash-table-eq))");
+    eval_string("(hash-set! g \"ab\" 1)");
+    eval_string("(hash-set! g (quote k) 2)");
+    eval_string("(hash-set! g 40 3)");
+    TEST_ASSERT_EQUAL_PTR(obj_nil, eval_string("(hash-ref g (str \"a\" \"b\"))"));
+    assert_number(2, eval_string("(hash-ref g (quote k))"));
+    assert_number(3, eval_string("(hash-ref g 40)"));
+}
+
+void test_growth_keeps_all_entries(void) {
+    eval_string("(define h (make-hash-table))");
+    // 8 スロットから何度か拡張される（要素数はオブジェクトプールに収まる範囲にとどめる）
+    eval_string("(dotimes (i 100) (hash-set! h i (* i 2)))");
+    assert_number(100, eval_string("(hash-count h)"));
+    TEST_ASSERT_TRUE(evaluator_global_value("h")->data.hashtable.table->capacity >= 128);
+    eval_string("(define c 0)");
+    eval_string("(dotimes (i 100) (if (= (hash-ref h i) (* i 2)) (set! c (+ c 1))))");
+    assert_number(100, evaluator_global_value("c"));
+    assert_number(100, eval_string("(length (hash-keys h))"));
+}
+
+void test_remove_and_reuse(void) {
+    eval_string("(define h (make-hash-table))");
+    eval_string("(hash-set! h (quote k) 1)");
+    TEST_ASSERT_EQUAL_PTR(obj_true, eval_string("(hash-remove! h (quote k))"));
+    TEST_ASSERT_EQUAL_PTR(obj_nil, eval_string("(hash-remove! h (quote k))"));
+    TEST_ASSERT_EQUAL_PTR(obj_nil, eval_string("(hash-ref h (quote k))"));
+    assert_number(0, eval_string("(hash-count h)"));
+
+    // 追加と削除を繰り返しても削除済みスロットで埋まらない
+    eval_string("(dotimes (i 100) (hash-set! h i i) (hash-remove! h i))");
+    assert_number(0, eval_string("(hash-count h)"));
+    assert_number(9, eval_string("(hash-set! h 9 9)"));
+    assert_number(1, eval_string("(hash-count h)"));
+}
+
+// テーブル単体: 容量の上限を超える挿入は失敗し、既存の要素は残る
+void test_capacity_limit(void) {
+    HashTable* table = hashtable_create(HASH_EQ);
+    TEST_ASSERT_NOT_NULL(table);
+    size_t limit = HASHTABLE_MAX_CAPACITY * 7 / 8;
+    for (size_t i = 0; i < limit; i++) {
+        TEST_ASSERT_TRUE(hashtable_put(table, make_number((int64_t)i), obj_true));
+    }
+    TEST_ASSERT_FALSE(hashtable_put(table, make_number(-1), obj_true));
+    TEST_ASSERT_EQUAL(limit, table->count);
+    for (size_t i = 0; i < limit; i++) {
+        TEST_ASSERT_EQUAL_PTR(obj_true, hashtable_get(table, make_number((int64_t)i)));
+    }
+    // 削除すれば空いた分だけ入る
+    TEST_ASSERT_TRUE(hashtable_remove(table, make_number(0)));
+    TEST_ASSERT_TRUE(hashtable_put(table, make_number(-1), obj_true));
+    hashtable_destroy(table);
+}
+
+void test_gc_keeps_keys_and_values(void) {
+    eval_string("(define h (make-hash-table))");
+    eval_string("(hash-set! h (str \"k\" 1) (list->vector (quote (5 6))))");
+    eval_string("nil");  // 環境をルートにしてGCを走らせる
+    assert_number(6, eval_string("(vector-ref (hash-ref h \"k1\") 1)"));
+    Object* keys = eval_string("(hash-keys h)");
+    TEST_ASSERT_EQUAL(OBJ_STRING, keys->data.cons.car->type);
+    TEST_ASSERT_EQUAL_STRING("k1", keys->data.cons.car->data.string.text);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_set_and_ref);
+    RUN_TEST(test_equal_and_eq_tables);
+    RUN_TEST(test_growth_keeps_all_entries);
+    RUN_TEST(test_remove_and_reuse);
+    RUN_TEST(test_capacity_limit);
+    RUN_TEST(test_gc_keeps_keys_and_values);
+
+    return UNITY_END();
+}
@@ -0,0 +1,46 @@
+// test_helper.h
+// テスト間で共有する補助関数。
+
+#ifndef TEST_HELPER_H
+#define TEST_HELPER_H
+
+#include "unity.h"
+#include "../src/object.h"
+#include "../src/eval.h"
+#include "../src/printer.h"
+#include "../src/tokenizer.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// 評価結果が整数 expected であること
+static inline void assert_number(int64_t expected, Object* result) {
+    TEST_ASSERT_NOT_NULL(result);
+    TEST_ASSERT_EQUAL(OBJ_NUMBER, result->type);
+    TEST_ASSERT_EQUAL_INT64(expected, result->data.number);
+}
+
+// i 番目のトークンの字句が expected と等しいか（トークンは入力の一部分を指す）
+static inline void assert_token(const char* expected, TokenArray* tokens, size_t i) {
+    TEST_ASSERT_EQUAL(strlen(expected), tokens->tokens[i].length);
+    TEST_ASSERT_TRUE(strncmp(expected, token_text(tokens, i), strlen(expected)) == 0);
+}
+
+// 標準出力を捨てて評価する（print を大量に呼ぶ式でテストの出力を汚さない）
+static inline Object* eval_string_quietly(const char* src) {
+    printer_flush();
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int null = open("/dev/null", O_WRONLY);
+    dup2(null, STDOUT_FILENO);
+    close(null);
+    Object* result = eval_string(src);
+    printer_flush();
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+    return result;
+}
+
+#endif // TEST_HELPER_H
@@ -0,0 +1,100 @@
+// test_image.c
+// 処理系の状態のイメージ（image.c）のテスト
+
+#include "unity.h"
+#include "test_helper.h"
+#include "../src/object.h"
+#include "../src/eval.h"
+#include "../src/image.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define IMAGE_PATH "/tmp/chibi_test_image.img"
+
+void setUp(void) {
+    object_system_init();
+    evaluator_init();
+}
+
+void tearDown(void) {
+    evaluator_shutdown();
+    unlink(IMAGE_PATH);
+}
+
+// 保存してから初期状態に戻し、イメージを読み込む
+static void save_and_reload(void) {
+    TEST_ASSERT_EQUAL_PTR(obj_true, eval_string("(save-image \"" IMAGE_PATH "\")"));
+    evaluator_init();
+    TEST_ASSERT_NULL(evaluator_global_value("square"));
+    TEST_ASSERT_TRUE(image_load(IMAGE_PATH));
+}
+
+// 定義した値・クロージャ・コンテナ・マクロがイメージから評価なしで戻る
+void test_round_trip(void) {
+    eval_string("(define square (lambda (x) (* x x)))");
+    eval_string("(define adder (lambda (n) (lambda (x) (+ x n))))");
+    eval_string("(define add10 (adder 10))");
+    eval_string("(define big 123456789012345678901234567890)");
+    eval_string("(define half 0.5)");
+    eval_string("(define greeting \"hello image\")");
+    eval_string("(define items (list->vector (list 1 2 3)))");
+    eval_string("(define table (make-hash-table))");
+    eval_string("(hash-set! table \"k\" 42)");
+    eval_string("(define m (map-assoc (make-map) 1 100))");
+    eval_string("(define msq (memoize square))");
+    eval_string("(msq 9)");
+    eval_string("(defmacro when (c body) (list (quote if) c body nil))");
+    eval_string("(define show str)");
+
+    save_and_reload();
+
+    assert_number(49, eval_string("(square 7)"));
+    assert_number(15, eval_string("(add10 5)"));
+    Object* big = eval_string("(str big)");
+    TEST_ASSERT_EQUAL_STRING("123456789012345678901234567890", big->data.string.text);
+    Object* half = eval_string("half");
+    TEST_ASSERT_EQUAL(OBJ_FLOAT, half->type);
+    TEST_ASSERT_EQUAL_STRING("hello image", eval_string("greeting")->data.string.text);
+    assert_number(2, eval_string("(vector-ref items 1)"));
+    assert_number(42, eval_string("(hash-ref table \"k\")"));
+    assert_number(100, eval_string("(map-get m 1)"));
+    assert_number(81, eval_string("(msq 9)"));
+    assert_number(3, eval_string("(when (< 1 2) 3)"));
+    TEST_ASSERT_EQUAL_STRING("12", eval_string("(show 1 2)")->data.string.text);
+
+    // 組み込み関数も束縛されたままで、新しい定義もできる
+    eval_string("(define y (+ (length (list 1 2)) 1))");
+    assert_number(3, eval_string("y"));
+}
+
+// 壊れた・存在しないイメージは読まず、空の環境に戻る
+void test_rejects_broken(void) {
+    eval_string("(define square (lambda (x) (* x x)))");
+    TEST_ASSERT_EQUAL_PTR(obj_true, eval_string("(save-image \"" IMAGE_PATH "\")"));
+
+    FILE* file = fopen(IMAGE_PATH, "r+b");
+    TEST_ASSERT_NOT_NULL(file);
+    fseek(file, -1, SEEK_END);
+    int last = fgetc(file);
+    fseek(file, -1, SEEK_END);
+    fputc(last ^ 0xFF, file);
+    fclose(file);
+
+    TEST_ASSERT_FALSE(image_load(IMAGE_PATH));
+    TEST_ASSERT_NULL(evaluator_global_value("square"));
+    TEST_ASSERT_NULL(evaluator_global_value("+"));
+
+    TEST_ASSERT_FALSE(image_load("/tmp/chibi_test_image_missing.img"));
+    TEST_ASSERT_EQUAL_PTR(obj_nil, eval_string("(save-image 1)"));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_rejects_broken);
+
+    return UNITY_END();
+}
@@ -1,5 +1,9 @@
 #include <unity.h>
+#include "test_helper.h"
 #include "../src/tokenizer.h"
+#include "../src/lexscan.h"
+#include <stdbool.h>
+#include <string.h>
 
 void setUp(void) {}
 void tearDown(void) {}
@@ -9,11 +13,11 @@ void test_simple_tokenization(void) {
     TokenArray *tokens = tokenize(input);
     TEST_ASSERT_NOT_NULL(tokens);
     TEST_ASSERT_EQUAL_INT(5, tokens->size);
-    TEST_ASSERT_EQUAL_STRING("(", tokens->tokens[0].value);
-    TEST_ASSERT_EQUAL_STRING("+", tokens->tokens[1].value);
-    TEST_ASSERT_EQUAL_STRING("1", tokens->tokens[2].value);
-    TEST_ASSERT_EQUAL_STRING("2", tokens->tokens[3].value);
-    TEST_ASSERT_EQUAL_STRING(")", tokens->tokens[4].value);
+    assert_token("(", tokens, 0);
+    assert_token("+", tokens, 1);
+    assert_token("1", tokens, 2);
+    assert_token("2", tokens, 3);
+    assert_token(")", tokens, 4);
     free_token_array(tokens);
 }
 
@@ -22,21 +26,83 @@ void test_nested_tokenization(void) {
     TokenArray *tokens = tokenize(input);
     TEST_ASSERT_NOT_NULL(tokens);
     TEST_ASSERT_EQUAL_INT(9, tokens->size);
-    TEST_ASSERT_EQUAL_STRING("(", tokens->tokens[0].value);
-    TEST_ASSERT_EQUAL_STRING("*", tokens->tokens[1].value);
-    TEST_ASSERT_EQUAL_STRING("(", tokens->tokens[2].value);
-    TEST_ASSERT_EQUAL_STRING("+", tokens->tokens[3].value);
-    TEST_ASSERT_EQUAL_STRING("1", tokens->tokens[4].value);
-    TEST_ASSERT_EQUAL_STRING("2", tokens->tokens[5].value);
-    TEST_ASSERT_EQUAL_STRING(")", tokens->tokens[6].value);
-    TEST_ASSERT_EQUAL_STRING("3", tokens->tokens[7].value);
-    TEST_ASSERT_EQUAL_STRING(")", tokens->tokens[8].value);
+    assert_token("(", tokens, 0);
+    assert_token("*", tokens, 1);
+    assert_token("(", tokens, 2);
+    assert_token("+", tokens, 3);
+    assert_token("1", tokens, 4);
+    assert_token("2", tokens, 5);
+    assert_token(")", tokens, 6);
+    assert_token("3", tokens, 7);
+    assert_token(")", tokens, 8);
     free_token_array(tokens);
 }
 
+typedef const char* (*ScanFunc)(const char* p, const char* end);
+
+static const char* scan_skip_space(const char* p, const char* end)     { return lexscan_skip_space(p, end); }
+static const char* scan_symbol_end(const char* p, const char* end)     { return lexscan_symbol_end(p, end); }
+static const char* scan_next_delimiter(const char* p, const char* end) { return lexscan_next_delimiter(p, end); }
+
+static const ScanFunc scan_funcs[] = { scan_skip_space, scan_symbol_end, scan_next_delimiter };
+
+// 走査関数 s が止まるべきバイトか（lexscan.h の分類とは別に書いた期待値）
+static bool stops_at(size_t s, char c) {
+    bool space = c != '\0' && strchr(" \n\t", c) != NULL;
+    bool symbol = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                  (c != '\0' && strchr("_?!-=<>", c) != NULL);
+    bool delimiter = space || (c != '\0' && strchr("\r()\";", c) != NULL);
+    switch (s) {
+        case 0:  return !space;
+        case 1:  return !symbol;
+        default: return delimiter;
+    }
+}
+
+// 埋め草の中の offset の位置に byte を1つ置き、止まる位置が文字の分類どおりか調べる
+void test_scanners_classify_all_bytes(void) {
+    static const char fills[] = { 'a', ' ', '9' };
+    char buf[80];
+    for (size_t f = 0; f < sizeof(fills); f++) {
+        for (int byte = 1; byte < 256; byte++) {
+            for (size_t offset = 0; offset < 70; offset++) {
+                memset(buf, fills[f], sizeof(buf));
+                buf[offset] = (char)byte;
+                for (size_t s = 0; s < sizeof(scan_funcs) / sizeof(scan_funcs[0]); s++) {
+                    const char* expected = buf + sizeof(buf);
+                    for (size_t i = 0; i < sizeof(buf); i++) {
+                        if (stops_at(s, buf[i])) { expected = buf + i; break; }
+                    }
+                    TEST_ASSERT_EQUAL_PTR(expected, scan_funcs[s](buf, buf + sizeof(buf)));
+                }
+            }
+        }
+    }
+}
+
+// 開始位置と終了位置をずらしても範囲の外は読まない
+void test_scanners_respect_bounds(void) {
+    const char* text = "  \t\n(define long-symbol-name-over-thirty-two-bytes \"str ing\") ; c\n  x";
+    size_t len = strlen(text);
+    for (size_t start = 0; start <= len; start++) {
+        for (size_t stop = start; stop <= len; stop++) {
+            for (size_t s = 0; s < sizeof(scan_funcs) / sizeof(scan_funcs[0]); s++) {
+                const char* found = scan_funcs[s](text + start, text + stop);
+                TEST_ASSERT_TRUE(found >= text + start && found <= text + stop);
+                for (const char* q = text + start; q < found; q++) TEST_ASSERT_FALSE(stops_at(s, *q));
+                if (found < text + stop) TEST_ASSERT_TRUE(stops_at(s, *found));
+            }
+            const char* newline = lexscan_find(text + start, text + stop, '\n');
+            TEST_ASSERT_TRUE(newline == text + stop || *newline == '\n');
+        }
+    }
+}
+
 int main(void) {
     UNITY_BEGIN();
     RUN_TEST(test_simple_tokenization);
     RUN_TEST(test_nested_tokenization);
+    RUN_TEST(test_scanners_classify_all_bytes);
+    RUN_TEST(test_scanners_respect_bounds);
     return UNITY_END();
 }
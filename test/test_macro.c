@@ -0,0 +1,97 @@
+// test_macro.c
+// マクロ（defmacro）の展開とコールサイトへの展開結果のキャッシュのテスト
+
+#include "unity.h"
+#include "test_helper.h"
+#include "../src/object.h"
+#include "../src/eval.h"
+#include "../src/macro.h"
+
+void setUp(void) {
+    object_system_init();
+    evaluator_init();
+    eval_string("(defmacro when (c body) (list (quote if) c body nil))");
+    eval_string("(defmacro unless (c body) (list (quote if) c nil body))");
+}
+
+void tearDown(void) {
+    evaluator_shutdown();
+}
+
+void test_when_and_unless(void) {
+    assert_number(10, eval_string("(when (< 1 2) 10)"));
+    TEST_ASSERT_EQUAL_PTR(obj_nil, eval_string("(when (> 1 2) 10)"));
+    assert_number(5, eval_string("(unless (> 1 2) 5)"));
+    TEST_ASSERT_EQUAL(OBJ_MACRO, evaluator_global_value("when")->type);
+}
+
+// 引数は評価せずに式のまま変換関数へ渡る
+void test_arguments_are_not_evaluated(void) {
+    eval_string("(defmacro my-quote (x) (list (quote quote) x))");
+    Object* list = eval_string("(my-quote (a b))");
+    TEST_ASSERT_TRUE(is_cons(list));
+    TEST_ASSERT_EQUAL_STRING("a", obj_symbol_name(obj_car(list)));
+    TEST_ASSERT_EQUAL_STRING("b", obj_symbol_name(obj_car(obj_cdr(list))));
+}
+
+// ラムダ本体やループ本体の呼び出しは一度だけ展開され、以後は展開結果を評価する
+void test_expanded_once_per_call_site(void) {
+    size_t before = macro_expansion_count();
+    eval_string("(define f (lambda (x) (when (< 0 x) (* x 2))))");
+    TEST_ASSERT_EQUAL(before + 1, macro_expansion_count());
+    for (int i = 0; i < 10; i++) assert_number(6, eval_string("(f 3)"));
+    TEST_ASSERT_EQUAL_PTR(obj_nil, eval_string("(f 0)"));
+    TEST_ASSERT_EQUAL(before + 1, macro_expansion_count());
+
+    eval_string("(define n 0)");
+    before = macro_expansion_count();
+    eval_string("(dotimes (i 50) (unless (< i 10) (set! n (+ n 1))))");
+    assert_number(40, evaluator_global_value("n"));
+    TEST_ASSERT_EQUAL(before + 1, macro_expansion_count());
+}
+
+// マクロを再定義すると、キャッシュ済みの展開結果は次の評価で作り直される
+void test_redefinition_invalidates_expansions(void) {
+    eval_string("(define f (lambda (x) (when (< 0 x) (* x 2))))");
+    assert_number(6, eval_string("(f 3)"));
+
+    eval_string("(defmacro when (c body) (list (quote if) c (list (quote +) body 1) nil))");
+    size_t before = macro_expansion_count();
+    assert_number(7, eval_string("(f 3)"));
+    assert_number(9, eval_string("(f 4)"));
+    TEST_ASSERT_EQUAL(before + 1, macro_expansion_count());
+
+    // 関数に定義し直せば普通の呼び出しになる
+    eval_string("(define when (lambda (c body) 42))");
+    assert_number(42, eval_string("(f 3)"));
+}
+
+// 使う側より後に定義したマクロは、最初の評価時に展開される
+void test_macro_defined_after_use(void) {
+    eval_string("(define g (lambda (x) (double x)))");
+    eval_string("(defmacro double (e) (list (quote *) e 2))");
+    size_t before = macro_expansion_count();
+    assert_number(8, eval_string("(g 4)"));
+    assert_number(10, eval_string("(g 5)"));
+    TEST_ASSERT_EQUAL(before + 1, macro_expansion_count());
+}
+
+void test_while_macro(void) {
+    eval_string("(defmacro while (c body) (list (quote loop) (list (quote w) nil) c nil body))");
+    eval_string("(define i 0)");
+    eval_string("(while (< i 10) (set! i (+ i 1)))");
+    assert_number(10, evaluator_global_value("i"));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_when_and_unless);
+    RUN_TEST(test_arguments_are_not_evaluated);
+    RUN_TEST(test_expanded_once_per_call_site);
+    RUN_TEST(test_redefinition_invalidates_expansions);
+    RUN_TEST(test_macro_defined_after_use);
+    RUN_TEST(test_while_macro);
+
+    return UNITY_END();
+}
@@ -0,0 +1,122 @@
+// test_map.c
+// 永続マップ（OBJ_MAP）と関連ビルトインのテスト
+
+#include "unity.h"
+#include "test_helper.h"
+#include "../src/object.h"
+#include "../src/eval.h"
+#include "../src/map.h"
+#include "../src/object_pool.h"
+
+void setUp(void) {
+    object_system_init();
+    evaluator_init();
+}
+
+void tearDown(void) {
+    evaluator_shutdown();
+}
+
+void test_assoc_and_get(void) {
+    eval_string("(define m (make-map (quote a) 1 \"b\" 2))");
+    assert_number(1, eval_string("(map-get m (quote a))"));
+    assert_number(2, eval_string("(map-get m \"b\")"));
+    assert_number(2, eval_string("(map-count m)"));
+    TEST_ASSERT_EQUAL_PTR(obj_nil, eval_string("(map-get m (quote c))"));
+    assert_number(7, eval_string("(map-get m (quote c) 7)"));
+    // 値のないキーは作れない
+    TEST_ASSERT_EQUAL_PTR(obj_nil, eval_string("(make-map 1 2 3)"));
+}
+
+// 変更は新しいマップを返し、元のマップはそのまま使える
+void test_old_versions_are_unchanged(void) {
+    eval_string("(define m1 (make-map 1 10 2 20))");
+    eval_string("(define m2 (map-assoc m1 1 11))");
+    eval_string("(define m3 (map-dissoc m2 2))");
+    assert_number(10, eval_string("(map-get m1 1)"));
+    assert_number(11, eval_string("(map-get m2 1)"));
+    assert_number(20, eval_string("(map-get m2 2)"));
+    TEST_ASSERT_EQUAL_PTR(obj_nil, eval_string("(map-get m3 2)"));
+    assert_number(2, eval_string("(map-count m1)"));
+    assert_number(1, eval_string("(map-count m3)"));
+}
+
+// 多段の節点にまたがる数のキーを入れて、順に削除する
+void test_many_keys(void) {
+    Object* map = make_map();
+    for (int i = 0; i < 64; i++) map = map_assoc(map, make_number(i), make_number(i * 3));
+    TEST_ASSERT_EQUAL(64, map->data.map.count);
+    for (int i = 0; i < 64; i++) assert_number(i * 3, map_get(map, make_number(i)));
+    TEST_ASSERT_NULL(map_get(map, make_number(64)));
+
+    // 同じ値の上書きと、ないキーの削除はマップを作らない
+    TEST_ASSERT_EQUAL_PTR(map, map_assoc(map, make_number(5), map_get(map, make_number(5))));
+    TEST_ASSERT_EQUAL_PTR(map, map_dissoc(map, make_number(100)));
+
+    for (int i = 0; i < 64; i += 2) map = map_dissoc(map, make_number(i));
+    TEST_ASSERT_EQUAL(32, map->data.map.count);
+    TEST_ASSERT_NULL(map_get(map, make_number(10)));
+    assert_number(33, map_get(map, make_number(11)));
+    for (int i = 1; i < 64; i += 2) map = map_dissoc(map, make_number(i));
+    TEST_ASSERT_EQUAL(0, map->data.map.count);
+    TEST_ASSERT_NULL(map->data.map.root);
+}
+
+// 1つのキーの変更で新しく作られるのは、根からの経路上の節点だけ
+void test_structural_sharing(void) {
+    Object* map = make_map();
+    for (int i = 0; i < 64; i++) map = map_assoc(map, make_number(i), obj_true);
+    Object* key = make_number(7);
+    size_t before = object_pool_used_count();
+    Object* next = map_assoc(map, key, obj_nil);
+    TEST_ASSERT_NOT_NULL(next);
+    TEST_ASSERT_TRUE(object_pool_used_count() - before <= 1 + MAP_MAX_DEPTH);
+    TEST_ASSERT_EQUAL_PTR(obj_true, map_get(map, key));
+    TEST_ASSERT_EQUAL_PTR(obj_nil, map_get(next, key));
+}
+
+// ハッシュが完全に一致するキー（深く入れ子になったリストは同じハッシュになる）
+void test_hash_collisions(void) {
+    eval_string("(define m (make-map (quote (((((1)))))) 1 (quote (((((2)))))) 2 (quote (((((3)))))) 3))");
+    assert_number(3, eval_string("(map-count m)"));
+    assert_number(2, eval_string("(map-get m (quote (((((2)))))))"));
+    eval_string("(define m2 (map-dissoc m (quote (((((1))))))))");
+    assert_number(2, eval_string("(map-count m2)"));
+    TEST_ASSERT_EQUAL_PTR(obj_nil, eval_string("(map-get m2 (quote (((((1)))))))"));
+    assert_number(3, eval_string("(map-get m2 (quote (((((3)))))))"));
+    assert_number(1, eval_string("(map-get m (quote (((((1)))))))"));
+}
+
+void test_iteration(void) {
+    eval_string("(define m (make-map 1 10 2 20 3 30))");
+    assert_number(3, eval_string("(length (map-keys m))"));
+    Object* pairs = eval_string("(map->list m)");
+    int sum = 0;
+    for (Object* it = pairs; is_cons(it); it = obj_cdr(it)) {
+        sum += (int)(obj_cdr(obj_car(it))->data.number - obj_car(obj_car(it))->data.number);
+    }
+    TEST_ASSERT_EQUAL(54, sum);
+    TEST_ASSERT_EQUAL_PTR(obj_nil, eval_string("(map-keys (make-map))"));
+}
+
+// 要素が等しいマップは挿入順によらず equal なので、ハッシュテーブルのキーにできる
+void test_maps_as_keys(void) {
+    eval_string("(define h (make-hash-table))");
+    eval_string("(hash-set! h (make-map 1 2 3 4) 5)");
+    assert_number(5, eval_string("(hash-ref h (make-map 3 4 1 2))"));
+    TEST_ASSERT_EQUAL_PTR(obj_nil, eval_string("(hash-ref h (make-map 1 2))"));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_assoc_and_get);
+    RUN_TEST(test_old_versions_are_unchanged);
+    RUN_TEST(test_many_keys);
+    RUN_TEST(test_structural_sharing);
+    RUN_TEST(test_hash_collisions);
+    RUN_TEST(test_iteration);
+    RUN_TEST(test_maps_as_keys);
+
+    return UNITY_END();
+}
@@ -0,0 +1,91 @@
+// test_memo.c
+// メモ化関数（memoize）の結果キャッシュのテスト
+
+#include "unity.h"
+#include "test_helper.h"
+#include "../src/object.h"
+#include "../src/eval.h"
+#include "../src/memo.h"
+
+void setUp(void) {
+    object_system_init();
+    evaluator_init();
+}
+
+void tearDown(void) {
+    evaluator_shutdown();
+}
+
+// メモ化関数 name の統計（0: ヒット数, 1: ミス数, 2: エントリ数）
+static int64_t stat(const char* name, int n) {
+    Object* memo = evaluator_global_value(name);
+    TEST_ASSERT_EQUAL(OBJ_MEMO, memo->type);
+    MemoCache* cache = memo->data.memo.cache;
+    switch (n) {
+        case 0:  return (int64_t)cache->stats.hits;
+        case 1:  return (int64_t)cache->stats.misses;
+        default: return (int64_t)cache->count;
+    }
+}
+
+void test_memoized_recursion(void) {
+    // メモ化しなければ指数時間かかる再帰も、各引数1回の評価で済む
+    eval_string("(define fib (memoize (lambda (n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))))");
+    assert_number(1548008755920LL, eval_string("(fib 60)"));
+    TEST_ASSERT_EQUAL_INT64(61, stat("fib", 1));
+    TEST_ASSERT_EQUAL_INT64(58, stat("fib", 0));
+}
+
+void test_hits_and_stats_from_lisp(void) {
+    eval_string("(define g (memoize (lambda (x c) (+ x c))))");
+    eval_string("(define r1 (g 1 2))");
+    eval_string("(define r2 (g 1 2))");
+    eval_string("(define r3 (g 2 1))");
+    assert_number(3, evaluator_global_value("r3"));
+    Object* stats = eval_string("(memo-stats g)");
+    assert_number(1, obj_car(stats));
+    assert_number(2, obj_car(obj_cdr(stats)));
+    assert_number(2, obj_car(obj_cdr(obj_cdr(stats))));
+    TEST_ASSERT_EQUAL_PTR(obj_nil, eval_string("(memo-stats 5)"));
+    TEST_ASSERT_EQUAL_PTR(obj_nil, eval_string("(memoize 5)"));
+    // 組み込み関数は純粋なものだけメモ化できる
+    TEST_ASSERT_EQUAL_PTR(obj_nil, eval_string("(memoize print)"));
+    TEST_ASSERT_EQUAL(OBJ_MEMO, eval_string("(memoize length)")->type);
+}
+
+void test_lru_eviction(void) {
+    eval_string("(define g (memoize (lambda (x) (* x 10)) 2))");
+    eval_string("(define a (g 1))");
+    eval_string("(define b (g 2))");
+    eval_string("(define c (g 1))");   // 1 が最近使われた側になる
+    eval_string("(define j (g 3))");   // 容量2なので最も古い 2 が捨てられる
+    TEST_ASSERT_EQUAL_INT64(2, stat("g", 2));
+    eval_string("(define k (g 1))");
+    TEST_ASSERT_EQUAL_INT64(2, stat("g", 0));
+    eval_string("(define v (g 2))");
+    TEST_ASSERT_EQUAL_INT64(4, stat("g", 1));
+    assert_number(20, evaluator_global_value("v"));
+}
+
+// 結果は弱参照: どこからも参照されなくなった結果はGCでエントリごと消える
+void test_gc_drops_unreferenced_results(void) {
+    eval_string("(define g (memoize (lambda (x) (* x 1000))))");
+    eval_string("(define kept (g 5))");
+    eval_string("(g 6)");  // 結果はどこにも保存しない
+    eval_string("nil");     // 環境をルートにしてGCを走らせる
+    TEST_ASSERT_EQUAL_INT64(1, stat("g", 2));
+    assert_number(5000, eval_string("(g 5)"));
+    TEST_ASSERT_EQUAL_INT64(1, stat("g", 0));
+    TEST_ASSERT_TRUE(memo_total_stats()->evictions > 0);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_memoized_recursion);
+    RUN_TEST(test_hits_and_stats_from_lisp);
+    RUN_TEST(test_lru_eviction);
+    RUN_TEST(test_gc_drops_unreferenced_results);
+
+    return UNITY_END();
+}
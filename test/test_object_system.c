@@ -78,7 +78,7 @@ void test_object_pool_free() {
 }
 
 void test_make_number() {
-    extern Object* make_number(int value);
+    extern Object* make_number(int64_t value);
 
     Object* num = make_number(42);
     TEST_ASSERT_NOT_NULL(num);
@@ -87,7 +87,7 @@ void test_make_number() {
 }
 
 void test_gc_mark_and_sweep() {
-    extern Object* make_number(int value);
+    extern Object* make_number(int64_t value);
     extern Object* make_cons(Object* car, Object* cdr);
 
     // IuWFNg쐬
@@ -124,7 +124,7 @@ void test_gc_mark_and_sweep() {
 
 void test_gc_circular_reference() {
     extern Object* make_cons(Object* car, Object* cdr);
-    extern Object* make_number(int value);
+    extern Object* make_number(int64_t value);
 
     // zQƂ쐬
     Object* cons1 = object_pool_alloc();
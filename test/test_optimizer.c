@@ -0,0 +1,106 @@
+// test_optimizer.c
+// 構文木最適化パスのテスト
+
+#include "unity.h"
+#include "test_helper.h"
+#include "../src/object.h"
+#include "../src/eval.h"
+#include "../src/parser.h"
+#include "../src/optimizer.h"
+
+void setUp(void) {
+    object_system_init();
+    evaluator_init();
+}
+
+void tearDown(void) {
+    evaluator_shutdown();
+}
+
+//------------------------------------------
+// 定数畳み込み
+//------------------------------------------
+
+void test_fold_arithmetic(void) {
+    assert_number(60000, optimize(parse("(* 60 1000)")));
+    assert_number(7, optimize(parse("(+ 1 (* 2 3))")));
+}
+
+void test_fold_comparison(void) {
+    TEST_ASSERT_EQUAL_PTR(obj_true, optimize(parse("(< 1 2)")));
+    TEST_ASSERT_EQUAL_PTR(obj_nil, optimize(parse("(> 1 2)")));
+}
+
+void test_fold_keeps_non_literal(void) {
+    Object* result = optimize(parse("(+ c (* 2 3))"));
+    TEST_ASSERT_TRUE(is_cons(result));
+    // 内側のリテラル部分だけが畳み込まれる
+    assert_number(6, obj_car(obj_cdr(obj_cdr(result))));
+}
+
+void test_fold_skips_quote(void) {
+    Object* result = optimize(parse("(quote (+ 1 2))"));
+    TEST_ASSERT_TRUE(is_cons(result));
+    TEST_ASSERT_TRUE(is_cons(obj_car(obj_cdr(result))));
+}
+
+void test_fold_pure_builtins(void) {
+    Object* s = optimize(parse("(str \"a\" 1)"));
+    TEST_ASSERT_EQUAL(OBJ_STRING, s->type);
+    TEST_ASSERT_EQUAL_STRING("a1", s->data.string.text);
+    assert_number(0, optimize(parse("(length nil)")));
+    TEST_ASSERT_EQUAL_PTR(obj_nil, optimize(parse("(car nil)")));
+    // 副作用のある関数と、結果が式として評価されてしまう呼び出しは残す
+    TEST_ASSERT_TRUE(is_cons(optimize(parse("(print 1)"))));
+    TEST_ASSERT_TRUE(is_cons(optimize(parse("(list 1 2)"))));
+    // 引数の数が合わなければ畳み込まない
+    TEST_ASSERT_TRUE(is_cons(optimize(parse("(length nil nil)"))));
+}
+
+void test_inline_registered_builtin(void) {
+    Object* result = optimize(parse("(vector-length c)"));
+    TEST_ASSERT_EQUAL_PTR(get_builtin(BUILTIN_VECTOR_LENGTH), obj_car(result));
+}
+
+//------------------------------------------
+// 死んだ分岐の除去
+//------------------------------------------
+
+void test_dead_branch_removed(void) {
+    assert_number(1, optimize(parse("(if (< 1 2) 1 (print 2))")));
+    assert_number(2, optimize(parse("(if nil (print 1) 2)")));
+    TEST_ASSERT_EQUAL_PTR(obj_nil, optimize(parse("(if nil 1)")));
+}
+
+//------------------------------------------
+// 評価結果が変わらないこと
+//------------------------------------------
+
+void test_rebound_name_not_inlined(void) {
+    eval_string("(define f +)");
+    eval_string("(define r 0)");
+    eval_string("(dotimes (i 2) (set! r (f 10 1)) (define f -))");
+    assert_number(9, eval_string("r"));
+}
+
+void test_eval_with_folding(void) {
+    eval_string("(define acc 0)");
+    eval_string("(dotimes (i 3) (set! acc (+ acc (* 60 1000))))");
+    assert_number(180000, eval_string("acc"));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_fold_arithmetic);
+    RUN_TEST(test_fold_comparison);
+    RUN_TEST(test_fold_keeps_non_literal);
+    RUN_TEST(test_fold_skips_quote);
+    RUN_TEST(test_fold_pure_builtins);
+    RUN_TEST(test_inline_registered_builtin);
+    RUN_TEST(test_dead_branch_removed);
+    RUN_TEST(test_rebound_name_not_inlined);
+    RUN_TEST(test_eval_with_folding);
+
+    return UNITY_END();
+}
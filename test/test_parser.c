@@ -4,6 +4,8 @@
 #include "../src/gc.h"
 #include "../src/parser.h"
 #include "../src/tokenizer.h"
+#include "../src/hashtable.h"
+#include "../src/srcloc.h"
 #include <string.h>
 
 void setUp(void) {
@@ -130,6 +132,87 @@ void test_parse_multiple_top_level(void) {
     TEST_ASSERT_TRUE(rest4 == obj_nil || (is_cons(rest4)==false && rest4==obj_nil));
 }
 
+// g[N炸ɓǂ parse_all ́Ag[N񂩂ǂ parse_expression Ɠ\؂Ԃ
+void test_parse_all_matches_token_array(void) {
+    const char *src = "(define (f x) ; Rg\n (if (<= x 1.5) \"s t r\" (quote (a b))))\n"
+                      ") 12345678901234567890123 nil t (print-x (()))  (f";
+    Object *list = parse_all(src);
+    TokenArray *tokens = tokenize(src);
+    TEST_ASSERT_NOT_NULL(tokens);
+    size_t index = 0;
+    int count = 0;
+    while (index < tokens->size) {
+        Object *expected = parse_expression(tokens, &index);
+        TEST_ASSERT_TRUE(is_cons(list));
+        TEST_ASSERT_TRUE(hashtable_keys_equal(expected, obj_car(list), HASH_EQUAL));
+        list = obj_cdr(list);
+        count++;
+    }
+    TEST_ASSERT_EQUAL_PTR(obj_nil, list);
+    TEST_ASSERT_EQUAL(7, count);
+    free_token_array(tokens);
+
+    // ĂȂ񃊃e͓ǂ߂Ȃ
+    TEST_ASSERT_EQUAL_PTR(obj_nil, parse_all("(a) \"abc"));
+}
+
+// '\0' I[łȂ́immap t@CȂǁj͈͂̊Oǂ܂1ǂ߂
+void test_parse_next_without_terminator(void) {
+    static const char text[] = { '(', 'a', ' ', '1', '.', '5', ')', ' ', '4', '2', '>' };
+    Lexer lexer;
+    lexer_init_len(&lexer, text, sizeof(text));
+    Object *first = parse_next(&lexer);
+    TEST_ASSERT_TRUE(is_cons(first));
+    TEST_ASSERT_EQUAL_DOUBLE(1.5, obj_car(obj_cdr(first))->data.real);
+    Object *second = parse_next(&lexer);
+    TEST_ASSERT_TRUE(is_number(second));
+    TEST_ASSERT_EQUAL(42, obj_number_value(second));
+    Object *third = parse_next(&lexer);
+    TEST_ASSERT_TRUE(is_operator(third));
+    TEST_ASSERT_EQUAL(OP_GT, obj_operator_type(third));
+    TEST_ASSERT_NULL(parse_next(&lexer));
+    TEST_ASSERT_FALSE(lexer.error);
+}
+
+// gݗĂXg̐擪̃Z '(' ̃t@CEsEL^iObject ̊O̕\Ɏj
+void test_parse_records_locations(void) {
+    const char *src = "(define x 1)\n; Rg\n  (f (g 2)\n     3)";
+    Lexer lexer;
+    lexer_init(&lexer, src);
+    lexer.file = srcloc_file("locations.lisp");
+    Object *first = parse_next(&lexer);
+    Object *second = parse_next(&lexer);
+    SrcLoc loc;
+    TEST_ASSERT_TRUE(srcloc_get(first, &loc));
+    TEST_ASSERT_EQUAL(1, loc.line);
+    TEST_ASSERT_EQUAL(1, loc.column);
+    TEST_ASSERT_TRUE(srcloc_get(second, &loc));
+    TEST_ASSERT_EQUAL(3, loc.line);
+    TEST_ASSERT_EQUAL(3, loc.column);
+    Object *nested = obj_car(obj_cdr(second));
+    char where[64];
+    TEST_ASSERT_EQUAL(strlen("locations.lisp:3:6"), srcloc_format(nested, where, sizeof(where)));
+    TEST_ASSERT_EQUAL_STRING("locations.lisp:3:6", where);
+
+    // AgƉZɂ͈ʒuȂB񂩂ǂ񂾎̃t@C "<input>"
+    TEST_ASSERT_FALSE(srcloc_get(obj_car(second), &loc));
+    object_pool_free(second);
+    TEST_ASSERT_FALSE(srcloc_get(second, &loc));
+    TEST_ASSERT_EQUAL(0, srcloc_format(second, where, sizeof(where)));
+    srcloc_format(parse("\n (a)"), where, sizeof(where));
+    TEST_ASSERT_EQUAL_STRING("<input>:2:2", where);
+}
+
+// IuWFNgv[sgݗĂ̎̂Ă NULL Ԃilexer.exhausted j
+void test_parse_next_when_pool_exhausted(void) {
+    while (make_cons(obj_nil, obj_nil) != NULL) {}
+    Lexer lexer;
+    lexer_init(&lexer, "(a (b c) d)");
+    TEST_ASSERT_NULL(parse_next(&lexer));
+    TEST_ASSERT_TRUE(lexer.exhausted);
+    TEST_ASSERT_FALSE(lexer.error);
+}
+
 int main(void) {
     UNITY_BEGIN();
 
@@ -139,6 +222,10 @@ int main(void) {
     RUN_TEST(test_parse_deep_nest_ok);
     RUN_TEST(test_parse_deep_nest_overflow);
     RUN_TEST(test_parse_multiple_top_level);
+    RUN_TEST(test_parse_all_matches_token_array);
+    RUN_TEST(test_parse_next_without_terminator);
+    RUN_TEST(test_parse_records_locations);
+    RUN_TEST(test_parse_next_when_pool_exhausted);
 
     return UNITY_END();
 }
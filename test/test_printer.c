@@ -0,0 +1,120 @@
+// test_printer.c
+// オブジェクトの表示と標準出力用バッファ（printer.c）のテスト
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "unity.h"
+#include "../src/object.h"
+#include "../src/eval.h"
+#include "../src/printer.h"
+
+#define OUTPUT_PATH "/tmp/chibi_test_printer.out"
+
+void setUp(void) {
+    object_system_init();
+    evaluator_init();
+}
+
+void tearDown(void) {
+    evaluator_shutdown();
+    unlink(OUTPUT_PATH);
+}
+
+// obj を style で文字列にして比べる
+static void assert_printed(const char* expected, Object* obj, PrintStyle style) {
+    StrBuf sb;
+    strbuf_init(&sb);
+    printer_append(&sb, obj, style);
+    Object* text = strbuf_to_string(&sb);
+    TEST_ASSERT_NOT_NULL(text);
+    TEST_ASSERT_EQUAL_STRING(expected, text->data.string.text);
+}
+
+// 形式ごとの違い（文字列の引用符・ドット対・内部オブジェクトの表記）
+void test_styles(void) {
+    Object* list = eval_string("(list 1 \"a\" (quote b) 2.5 (list->vector (list 3 4)))");
+    assert_printed("(1 a b 2.5 #(3 4))", list, PRINT_DISPLAY);
+    assert_printed("(1 \"a\" b 2.5 #(3 4))", list, PRINT_WRITE);
+    assert_printed("(1 . (\"a\" . (b . (2.5 . (#(3 4) . nil)))))", list, PRINT_DUMP);
+
+    Object* dotted = eval_string("(cons 1 2)");
+    assert_printed("(1 . 2)", dotted, PRINT_DISPLAY);
+    assert_printed("(1 . 2)", dotted, PRINT_DUMP);
+
+    assert_printed("#()", eval_string("(list->vector nil)"), PRINT_WRITE);
+    assert_printed("<lambda>", eval_string("(lambda (x) x)"), PRINT_DISPLAY);
+    assert_printed("#<lambda>", eval_string("(lambda (x) x)"), PRINT_WRITE);
+    assert_printed("+", eval_string("+"), PRINT_DISPLAY);
+    assert_printed("#<void>", obj_void, PRINT_DUMP);
+    assert_printed("NULL", NULL, PRINT_DUMP);
+}
+
+// 作業用スタックの初期領域を超える深い入れ子もたどれる
+void test_deep_nesting(void) {
+    enum { DEPTH = 300 };
+    Object* nested = obj_nil;
+    for (int i = 0; i < DEPTH; i++) nested = make_cons(nested, obj_nil);
+
+    char expected[DEPTH * 2 + 4];
+    size_t length = 0;
+    for (int i = 0; i < DEPTH; i++) expected[length++] = '(';
+    memcpy(expected + length, "nil", 3);
+    length += 3;
+    for (int i = 0; i < DEPTH; i++) expected[length++] = ')';
+    expected[length] = '\0';
+    assert_printed(expected, nested, PRINT_DISPLAY);
+}
+
+static off_t output_size(void) {
+    struct stat st;
+    fflush(stdout);
+    return stat(OUTPUT_PATH, &st) == 0 ? st.st_size : -1;
+}
+
+// PRINTER_FULL ではためておき、トップレベルの式を評価し終えたら書き出す。PRINTER_LINE では改行で書き出す
+void test_buffered_output(void) {
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int fd = open(OUTPUT_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    TEST_ASSERT_TRUE(saved >= 0 && fd >= 0);
+    dup2(fd, STDOUT_FILENO);
+    close(fd);
+
+    printer_set_mode(PRINTER_FULL);
+    printer_write("held ", 5);
+    off_t held = output_size();
+    eval_string("(print 1 \"two\" (list 3))");
+    off_t evaluated = output_size();
+
+    printer_set_mode(PRINTER_LINE);
+    printer_write("line\n", 5);
+    off_t line = output_size();
+
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+
+    TEST_ASSERT_EQUAL(0, held);
+    TEST_ASSERT_EQUAL(15, evaluated);   // "held 1 two (3)\n"
+    TEST_ASSERT_EQUAL(20, line);
+
+    char text[32] = {0};
+    FILE* file = fopen(OUTPUT_PATH, "r");
+    TEST_ASSERT_NOT_NULL(file);
+    fread(text, 1, sizeof(text) - 1, file);
+    fclose(file);
+    TEST_ASSERT_EQUAL_STRING("held 1 two (3)\nline\n", text);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_styles);
+    RUN_TEST(test_deep_nesting);
+    RUN_TEST(test_buffered_output);
+
+    return UNITY_END();
+}
@@ -0,0 +1,129 @@
+// test_reader.c
+// 入力を少しずつ読み込むリーダー（reader.c）のテスト
+
+#include "unity.h"
+#include "../src/object.h"
+#include "../src/eval.h"
+#include "../src/reader.h"
+#include "../src/fasl.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static Reader reader;
+
+void setUp(void) {
+    object_system_init();
+    evaluator_init();
+    reader_init(&reader);
+}
+
+void tearDown(void) {
+    reader_free(&reader);
+    evaluator_shutdown();
+}
+
+static void feed(const char* text) {
+    TEST_ASSERT_TRUE(reader_feed(&reader, text, strlen(text)));
+}
+
+void test_forms_split_across_chunks(void) {
+    feed("(+ 1");
+    TEST_ASSERT_NULL(reader_next(&reader));
+    TEST_ASSERT_TRUE(reader_in_form(&reader));
+    feed(" 2) 42 \"a b");
+    TEST_ASSERT_EQUAL_STRING("(+ 1 2)", reader_next(&reader));
+    TEST_ASSERT_EQUAL_STRING("42", reader_next(&reader));
+    TEST_ASSERT_NULL(reader_next(&reader));
+    feed(")\" (x ; )\n y)");
+    TEST_ASSERT_EQUAL_STRING("\"a b)\"", reader_next(&reader));
+    TEST_ASSERT_EQUAL_STRING("(x ; )\n y)", reader_next(&reader));
+    TEST_ASSERT_NULL(reader_next(&reader));
+    TEST_ASSERT_FALSE(reader_in_form(&reader));
+}
+
+// 入力の終わりで、区切りのないアトムと閉じていない式もそのまま返す
+void test_end_of_input(void) {
+    feed("; comment only\n abc");
+    TEST_ASSERT_NULL(reader_next(&reader));
+    reader_end(&reader);
+    TEST_ASSERT_EQUAL_STRING("abc", reader_next(&reader));
+    TEST_ASSERT_NULL(reader_next(&reader));
+
+    reader_free(&reader);
+    reader_init(&reader);
+    feed("(+ 1 (* 2");
+    reader_end(&reader);
+    TEST_ASSERT_EQUAL_STRING("(+ 1 (* 2", reader_next(&reader));
+    TEST_ASSERT_NULL(reader_next(&reader));
+}
+
+// 複数行の定義を数バイトずつ渡しても、閉じた時点で評価できる
+void test_multiline_definition(void) {
+    const char* source = "(define dbl (lambda (x)\n  ; 2倍にする\n  (* x 2)))\n(dbl 21)\n";
+    Object* last = NULL;
+    for (size_t i = 0; source[i]; i += 3) {
+        size_t n = strlen(source + i) < 3 ? strlen(source + i) : 3;
+        TEST_ASSERT_TRUE(reader_feed(&reader, source + i, n));
+        const char* form;
+        while ((form = reader_next(&reader)) != NULL) last = eval_string(form);
+    }
+    TEST_ASSERT_NOT_NULL(last);
+    TEST_ASSERT_EQUAL(OBJ_NUMBER, last->type);
+    TEST_ASSERT_EQUAL(42, last->data.number);
+}
+
+// ファイル記述子から大きな入力を流しても、バッファは式1つと読み込み1回分で済む
+void test_stream_from_fd(void) {
+    FILE* file = tmpfile();
+    TEST_ASSERT_NOT_NULL(file);
+    for (int i = 0; i < 5000; i++) fprintf(file, "(item %d \"text\")\n", i);
+    fflush(file);
+    rewind(file);
+
+    Reader stream;
+    reader_init_fd(&stream, fileno(file));
+    int count = 0;
+    const char* form;
+    while ((form = reader_next(&stream)) != NULL) {
+        TEST_ASSERT_TRUE(strncmp(form, "(item ", 6) == 0);
+        count++;
+    }
+    TEST_ASSERT_EQUAL(5000, count);
+    TEST_ASSERT_TRUE(stream.cap <= 2 * READER_CHUNK);
+    reader_free(&stream);
+    fclose(file);
+}
+
+// スクリプトファイルは mmap してその場でパースし、複数行の式も順に評価する
+void test_eval_file(void) {
+    char path[] = "/tmp/chibi_script_XXXXXX";
+    int fd = mkstemp(path);
+    TEST_ASSERT_TRUE(fd >= 0);
+    const char* source = "; script\n(define dbl (lambda (x)\n  (* x 2)))\n(define answer\n  (dbl 21))";
+    TEST_ASSERT_EQUAL(strlen(source), write(fd, source, strlen(source)));
+    close(fd);
+
+    TEST_ASSERT_TRUE(eval_file(path));
+    Object* answer = eval_string("answer");
+    TEST_ASSERT_EQUAL(OBJ_NUMBER, answer->type);
+    TEST_ASSERT_EQUAL(42, answer->data.number);
+
+    unlink(path);
+    TEST_ASSERT_FALSE(eval_file(path));
+    char* cache = fasl_cache_path(path);
+    unlink(cache);
+    free(cache);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_forms_split_across_chunks);
+    RUN_TEST(test_end_of_input);
+    RUN_TEST(test_multiline_definition);
+    RUN_TEST(test_stream_from_fd);
+    RUN_TEST(test_eval_file);
+
+    return UNITY_END();
+}
@@ -0,0 +1,77 @@
+// test_strbuf.c
+// 文字列バッファ（strbuf）と str / 整数の10進変換のテスト
+
+#include <limits.h>
+#include <string.h>
+#include "unity.h"
+#include "../src/object.h"
+#include "../src/eval.h"
+#include "../src/heap.h"
+#include "../src/strbuf.h"
+
+void setUp(void) {
+    object_system_init();
+    evaluator_init();
+}
+
+void tearDown(void) {
+    evaluator_shutdown();
+}
+
+static void assert_int_text(const char* expected, int64_t value) {
+    char buf[INT64_DECIMAL_MAX + 1];
+    size_t length = format_int64(value, buf);
+    buf[length] = '\0';
+    TEST_ASSERT_EQUAL_STRING(expected, buf);
+}
+
+void test_format_int64(void) {
+    assert_int_text("0", 0);
+    assert_int_text("7", 7);
+    assert_int_text("10", 10);
+    assert_int_text("99", 99);
+    assert_int_text("100", 100);
+    assert_int_text("-12345", -12345);
+    assert_int_text("9223372036854775807", INT64_MAX);
+    assert_int_text("-9223372036854775808", INT64_MIN);
+}
+
+void test_heap_buffer_grows(void) {
+    StrBuf sb;
+    strbuf_init(&sb);
+    for (int i = 0; i < 100; i++) strbuf_append_int(&sb, i % 10);
+    strbuf_append_cstr(&sb, "!");
+    Object* s = strbuf_to_string(&sb);
+    TEST_ASSERT_NOT_NULL(s);
+    TEST_ASSERT_EQUAL(101, s->data.string.length);
+    TEST_ASSERT_EQUAL('9', s->data.string.text[99]);
+    TEST_ASSERT_EQUAL_STRING("!", s->data.string.text + 100);
+}
+
+void test_str_concatenates(void) {
+    Object* s = eval_string("(str \"a\" 12 (quote b) nil 1.5 (quote (1 2)))");
+    TEST_ASSERT_EQUAL(OBJ_STRING, s->type);
+    TEST_ASSERT_EQUAL_STRING("a12bnil1.5(1 2)", s->data.string.text);
+    TEST_ASSERT_EQUAL(15, s->data.string.length);
+    TEST_ASSERT_EQUAL_STRING("", eval_string("(str)")->data.string.text);
+    TEST_ASSERT_EQUAL_STRING("100000000000000000000", eval_string("(str (* 10000000000 10000000000))")->data.string.text);
+}
+
+// str の結果は GC で回収され、heap に何も残さない
+void test_str_does_not_leak_heap(void) {
+    eval_string("(str \"abc\" 12345)");
+    size_t used = heap_used_size();
+    for (int i = 0; i < 20; i++) eval_string("(str \"abc\" 12345)");
+    TEST_ASSERT_EQUAL(used, heap_used_size());
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_format_int64);
+    RUN_TEST(test_heap_buffer_grows);
+    RUN_TEST(test_str_concatenates);
+    RUN_TEST(test_str_does_not_leak_heap);
+
+    return UNITY_END();
+}
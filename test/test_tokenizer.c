@@ -1,5 +1,8 @@
 #include <unity.h>
+#include "test_helper.h"
 #include "../src/tokenizer.h"
+#include <stdio.h>
+#include <string.h>
 
 // O[oϐŃg[NzǗ
 static TokenArray* current_tokens = NULL;
@@ -33,7 +36,7 @@ void test_tokens(const char* input, int expected_size, TokenKind kinds[], const
 
     // eg[N`FbNiANZX@j
     for (int i = 0; i < expected_size; i++) {
-        TEST_ASSERT_EQUAL_STRING(values[i], current_tokens->tokens[i].value);
+        assert_token(values[i], current_tokens, i);
         TEST_ASSERT_EQUAL_INT(kinds[i], current_tokens->tokens[i].kind);
     }
 }
@@ -50,10 +53,68 @@ void test_nested_tokenization(void) {
     test_tokens("(* (+ 1 2) 3)", 9, kinds, values);
 }
 
+// ̓Rs[A͂̈ꕔwi񃊃e͈p̓j
+void test_tokens_are_slices_of_input(void) {
+    const char* input = "(str \"ab c\" x1)";
+    current_tokens = tokenize(input);
+    TEST_ASSERT_NOT_NULL(current_tokens);
+    TEST_ASSERT_EQUAL_INT(5, current_tokens->size);
+    TEST_ASSERT_EQUAL_PTR(input + 6, token_text(current_tokens, 2));
+    assert_token("ab c", current_tokens, 2);
+    assert_token("x1", current_tokens, 3);
+}
+
+// g[Neʂ̌ς𒴂Ăz񂪐Lт
+void test_many_tokens(void) {
+    static char input[1100];
+    size_t n = 0;
+    input[n++] = '(';
+    for (int i = 0; i < 1000; i++) input[n++] = '+';
+    input[n++] = ')';
+    input[n] = '\0';
+    current_tokens = tokenize(input);
+    TEST_ASSERT_NOT_NULL(current_tokens);
+    TEST_ASSERT_EQUAL_INT(1002, current_tokens->size);
+    TEST_ASSERT_EQUAL_INT(TOKEN_PLUS, current_tokens->tokens[1000].kind);
+    TEST_ASSERT_EQUAL_INT(TOKEN_RPAREN, current_tokens->tokens[1001].kind);
+    TEST_ASSERT_EQUAL_INT(1001, current_tokens->tokens[1001].offset);
+}
+
+// L[[h͎ŜvƂiOvł͂Ȃj
+void test_keywords_match_exactly(void) {
+    TokenKind kinds[]    = {TOKEN_TRUE, TOKEN_SYMBOL, TOKEN_SYMBOL, TOKEN_TRUE, TOKEN_FALSE, TOKEN_SYMBOL,
+                            TOKEN_SYMBOL, TOKEN_SYMBOL, TOKEN_SYMBOL, TOKEN_DEFINE, TOKEN_SYMBOL,
+                            TOKEN_SYMBOL, TOKEN_SYMBOL, TOKEN_SET, TOKEN_SYMBOL, TOKEN_SYMBOL, TOKEN_NIL};
+    const char* values[] = {"t", "time", "total", "true", "false", "falsey",
+                            "print", "println", "print-x", "define", "define-syntax",
+                            "strbuf", "str", "set!", "se", "time-diff", "nil"};
+    test_tokens("t time total true false falsey print println print-x define define-syntax "
+                "strbuf str set! se time-diff nil", 17, kinds, values);
+}
+
+// \ɍڂׂẴL[[h̎ނɔ肳AꕶƃV{ɂȂ
+void test_every_keyword_classifies_to_its_kind(void) {
+    TokenKind kind;
+    const char* name;
+    size_t count = 0;
+    for (size_t i = 0; (name = lexer_keyword(i, &kind)) != NULL; i++, count++) {
+        char input[32];
+        snprintf(input, sizeof(input), "%s %sx", name, name);
+        TokenKind kinds[]    = {kind, TOKEN_SYMBOL};
+        const char* values[] = {name, input + strlen(name) + 1};
+        test_tokens(input, 2, kinds, values);
+    }
+    TEST_ASSERT_TRUE(count > 0);
+}
+
 int main(void) {
     UNITY_BEGIN();
     RUN_TEST(test_simple_tokenization);
     RUN_TEST(test_nested_tokenization);
+    RUN_TEST(test_tokens_are_slices_of_input);
+    RUN_TEST(test_many_tokens);
+    RUN_TEST(test_keywords_match_exactly);
+    RUN_TEST(test_every_keyword_classifies_to_its_kind);
     return UNITY_END();
 }
 
@@ -0,0 +1,75 @@
+// test_vector.c
+// ベクタ型（OBJ_VECTOR）と関連ビルトインのテスト
+
+#include "unity.h"
+#include "test_helper.h"
+#include "../src/object.h"
+#include "../src/eval.h"
+
+void setUp(void) {
+    object_system_init();
+    evaluator_init();
+}
+
+void tearDown(void) {
+    evaluator_shutdown();
+}
+
+void test_make_vector_fills_elements(void) {
+    eval_string("(define v (make-vector 3 7))");
+    Object* v = evaluator_global_value("v");
+    TEST_ASSERT_EQUAL(OBJ_VECTOR, v->type);
+    TEST_ASSERT_EQUAL(3, v->data.vector.length);
+    assert_number(7, eval_string("(vector-ref v 2)"));
+    assert_number(3, eval_string("(vector-length v)"));
+    assert_number(3, eval_string("(length v)"));
+    TEST_ASSERT_EQUAL_PTR(obj_nil, eval_string("(vector-ref (make-vector 2) 0)"));
+}
+
+void test_vector_set_and_bounds(void) {
+    eval_string("(define v (make-vector 4 0))");
+    assert_number(9, eval_string("(vector-set! v 1 9)"));
+    assert_number(9, eval_string("(vector-ref v 1)"));
+    TEST_ASSERT_EQUAL_PTR(obj_nil, eval_string("(vector-ref v 4)"));
+    TEST_ASSERT_EQUAL_PTR(obj_nil, eval_string("(vector-set! v 4 1)"));
+    TEST_ASSERT_EQUAL_PTR(obj_nil, eval_string("(vector-ref 5 0)"));
+}
+
+void test_vector_list_conversion(void) {
+    eval_string("(define v (list->vector (quote (1 2 3))))");
+    assert_number(2, eval_string("(vector-ref v 1)"));
+    Object* list = eval_string("(vector->list v)");
+    TEST_ASSERT_EQUAL(OBJ_CONS, list->type);
+    assert_number(1, list->data.cons.car);
+    assert_number(3, obj_car(obj_cdr(obj_cdr(list))));
+    TEST_ASSERT_EQUAL_PTR(obj_nil, obj_cdr(obj_cdr(obj_cdr(list))));
+}
+
+void test_vector_fill_loop(void) {
+    eval_string("(define v (make-vector 100 0))");
+    eval_string("(dotimes (i 100) (vector-set! v i (* i i)))");
+    assert_number(9801, eval_string("(vector-ref v 99)"));
+    // 数値ベクタは一括演算にそのまま渡せる
+    Object* sum = eval_string("(vec-sum v)");
+    TEST_ASSERT_EQUAL(OBJ_FLOAT, sum->type);
+    TEST_ASSERT_EQUAL_DOUBLE(328350.0, sum->data.real);
+}
+
+void test_gc_keeps_vector_elements(void) {
+    eval_string("(define v (make-vector 3 0))");
+    eval_string("(vector-set! v 0 (list->vector (quote (5 6))))");
+    eval_string("nil");  // 環境をルートにしてGCを走らせる
+    assert_number(6, eval_string("(vector-ref (vector-ref v 0) 1)"));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_make_vector_fills_elements);
+    RUN_TEST(test_vector_set_and_bounds);
+    RUN_TEST(test_vector_list_conversion);
+    RUN_TEST(test_vector_fill_loop);
+    RUN_TEST(test_gc_keeps_vector_elements);
+
+    return UNITY_END();
+}
@@ -0,0 +1,131 @@
+// test_vm.c
+// バイトコードVMのテスト
+
+#include "unity.h"
+#include "test_helper.h"
+#include "../src/object.h"
+#include "../src/eval.h"
+#include "../src/parser.h"
+#include "../src/vm.h"
+
+void setUp(void) {
+    object_system_init();
+    evaluator_init();
+    vm_set_superinstructions(true);
+}
+
+void tearDown(void) {
+    evaluator_shutdown();
+}
+
+// computed goto 版と switch 版の両方で実行して結果が一致することを確かめる
+static Object* run_both(const char* src) {
+    VmCode* code = vm_compile(parse(src));
+    TEST_ASSERT_NOT_NULL(code);
+    Object* threaded = vm_execute(code);
+    Object* switched = vm_execute_switch(code);
+    vm_free(code);
+    TEST_ASSERT_EQUAL(threaded->type, switched->type);
+    if (threaded->type == OBJ_NUMBER) {
+        TEST_ASSERT_EQUAL(threaded->data.number, switched->data.number);
+    } else {
+        TEST_ASSERT_EQUAL_PTR(threaded, switched);
+    }
+    return switched;
+}
+
+//------------------------------------------
+// 基本命令
+//------------------------------------------
+
+void test_vm_arithmetic(void) {
+    assert_number(7, run_both("(+ 1 (* 2 3))"));
+    assert_number(10, run_both("(+ 1 2 3 4)"));
+    TEST_ASSERT_EQUAL_PTR(obj_true, run_both("(< 1 2)"));
+    TEST_ASSERT_EQUAL_PTR(obj_nil, run_both("(+ 1 (quote (2)))"));
+}
+
+void test_vm_if(void) {
+    eval_string("(define x 3)");
+    assert_number(1, run_both("(if (< x 5) 1 2)"));
+    assert_number(2, run_both("(if (> x 5) 1 2)"));
+    TEST_ASSERT_EQUAL_PTR(obj_nil, run_both("(if (> x 5) 1)"));
+}
+
+void test_vm_dotimes(void) {
+    eval_string("(define acc 0)");
+    VmCode* code = vm_compile(parse("(dotimes (i 5) (set! acc (+ acc i)))"));
+    TEST_ASSERT_NOT_NULL(code);
+    // eval_string はGCを走らせるので、コードの構文木が生きている間は使わない
+    vm_execute(code);
+    assert_number(10, evaluator_global_value("acc"));
+    vm_execute_switch(code);
+    assert_number(20, evaluator_global_value("acc"));
+    vm_free(code);
+    TEST_ASSERT_EQUAL_PTR(obj_nil, run_both("(dotimes (i 0) 1)"));
+}
+
+void test_vm_loop(void) {
+    assert_number(4, run_both("(loop (c 0) (< c 5) (+ c 1) c)"));
+}
+
+void test_vm_calls_lambda(void) {
+    eval_string("(define f (lambda (x) (* x x)))");
+    assert_number(49, run_both("(f 7)"));
+}
+
+//------------------------------------------
+// スーパー命令
+//------------------------------------------
+
+void test_vm_superinstructions_shorten_code(void) {
+    const char* src = "(loop (c 0) (< c 10) (+ c 1) c)";
+    vm_set_superinstructions(false);
+    VmCode* plain = vm_compile(parse(src));
+    vm_set_superinstructions(true);
+    VmCode* fused = vm_compile(parse(src));
+    TEST_ASSERT_TRUE(vm_code_length(fused) < vm_code_length(plain));
+    assert_number(9, vm_execute(plain));
+    assert_number(9, vm_execute(fused));
+    vm_free(plain);
+    vm_free(fused);
+}
+
+//------------------------------------------
+// オブジェクトプールが尽きたとき
+//------------------------------------------
+
+void test_vm_survives_pool_exhaustion(void) {
+    // 反復ごとにオブジェクトを確保するループも、安全点で回収しながら最後まで回る
+    eval_string("(define n 0)");
+    eval_string_quietly("(dotimes (i 1500) (print i) (set! n i))");
+    assert_number(1499, evaluator_global_value("n"));
+    eval_string("(define h (make-hash-table))");
+    eval_string("(dotimes (i 180) (hash-set! h i (* i 2)))");
+    assert_number(180, eval_string("(hash-count h)"));
+    assert_number(358, eval_string("(hash-ref h 179)"));
+    eval_string("(define acc nil)");
+    eval_string("(dotimes (i 1500) (set! acc (list i i)))");
+    assert_number(1499, eval_string("(car acc)"));
+    assert_number(3, eval_string("(+ 1 2)"));
+}
+
+void test_vm_rejects_lambda_over_locals(void) {
+    // ループ変数を捕捉するラムダは構文木の評価器に任せる
+    TEST_ASSERT_NULL(vm_compile(parse("(dotimes (j 3) (lambda () j))")));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_vm_arithmetic);
+    RUN_TEST(test_vm_if);
+    RUN_TEST(test_vm_dotimes);
+    RUN_TEST(test_vm_loop);
+    RUN_TEST(test_vm_calls_lambda);
+    RUN_TEST(test_vm_superinstructions_shorten_code);
+    RUN_TEST(test_vm_rejects_lambda_over_locals);
+    RUN_TEST(test_vm_survives_pool_exhaustion);
+
+    return UNITY_END();
+}